@@ -86,6 +86,13 @@ void RunWriteBenchmark(Env *env, DB *db) {
 
     Error rs = db->GetProperty("db.cf.default.levels", &value);
     ::printf("%s\n", value.c_str());
+    
+    db->GetProperty("db.write.group-count", &value);
+    ::printf("Write Groups: %s\n", value.c_str());
+    db->GetProperty("db.write.group-size", &value);
+    ::printf("Avg Group Size: %s\n", value.c_str());
+    db->GetProperty("db.write.wait-micros", &value);
+    ::printf("Write Wait Time: %s us\n", value.c_str());
 
     delete[] wr_thrds;
 }
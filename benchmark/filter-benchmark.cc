@@ -0,0 +1,166 @@
+#include "table/filter-block-builder.h"
+#include "table/key-bloom-filter.h"
+#include "table/blocked-bloom-filter.h"
+#include "base/hash.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include <stdio.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+using ::mai::table::FilterBlockBuilder;
+using ::mai::table::KeyBloomFilter;
+using ::mai::table::BlockedBloomFilter;
+using ::mai::base::Hash;
+
+DEFINE_int32(n_keys, 1000000, "Number of keys in filter.");
+DEFINE_int32(n_probes, 1000000, "Number of probing keys, half of them exist.");
+DEFINE_int32(batch_size, 16, "Keys in one batch probing.");
+
+struct BenchmarkResult {
+    const char *name;
+    size_t filter_size;
+    double ns_per_probe;
+    double fpr;
+};
+
+class Stopwatch {
+public:
+    Stopwatch() : start_(std::chrono::steady_clock::now()) {}
+    
+    double ElapsedNanos() const {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        return std::chrono::duration<double, std::nano>(elapsed).count();
+    }
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+static std::string MakeKey(int i) {
+    char buf[32];
+    ::snprintf(buf, sizeof(buf), "key-%010d", i);
+    return buf;
+}
+
+// Even probe keys exist in filter, odd ones not.
+static std::vector<std::string> MakeProbeKeys() {
+    std::vector<std::string> keys;
+    for (int i = 0; i < FLAGS_n_probes; ++i) {
+        if (i % 2 == 0) {
+            keys.push_back(MakeKey((i / 2) % FLAGS_n_keys));
+        } else {
+            keys.push_back(MakeKey(FLAGS_n_keys + i));
+        }
+    }
+    return keys;
+}
+
+static double FalsePositiveRate(const bool *results, size_t n) {
+    size_t n_false_positive = 0, n_negative = 0;
+    for (size_t i = 1; i < n; i += 2) {
+        n_negative++;
+        n_false_positive += results[i] ? 1 : 0;
+    }
+    return n_negative ? static_cast<double>(n_false_positive) / n_negative : 0;
+}
+
+static void CheckNoFalseNegative(const bool *results, size_t n,
+                                 const char *name) {
+    for (size_t i = 0; i < n; i += 2) {
+        if (!results[i]) {
+            ::fprintf(stderr, "%s: false negative at probe %zd!\n", name, i);
+            ::exit(-1);
+        }
+    }
+}
+
+BenchmarkResult RunLegacy(const std::vector<std::string> &probes, bool *results) {
+    size_t size = FilterBlockBuilder::ComputeBoomFilterSize(FLAGS_n_keys, 4,
+                        Hash::kNumberBloomFilterHashs);
+    FilterBlockBuilder builder(size, Hash::kBloomFilterHashs,
+                               Hash::kNumberBloomFilterHashs);
+    for (int i = 0; i < FLAGS_n_keys; ++i) {
+        builder.AddKey(MakeKey(i));
+    }
+    std::string_view bits = builder.Finish();
+    
+    Stopwatch watch;
+    for (size_t i = 0; i < probes.size(); ++i) {
+        results[i] = KeyBloomFilter::MayMatch(bits, probes[i],
+                                              Hash::kBloomFilterHashs,
+                                              Hash::kNumberBloomFilterHashs);
+    }
+    double ns = watch.ElapsedNanos();
+    CheckNoFalseNegative(results, probes.size(), "legacy");
+    return {"legacy", bits.size(), ns / probes.size(),
+            FalsePositiveRate(results, probes.size())};
+}
+
+static std::string BuildBlocked() {
+    std::string bits(BlockedBloomFilter::ComputeSize(FLAGS_n_keys), 0);
+    for (int i = 0; i < FLAGS_n_keys; ++i) {
+        BlockedBloomFilter::AddHash(BlockedBloomFilter::Hash(MakeKey(i)),
+                                    &bits[0], bits.size());
+    }
+    return bits;
+}
+
+BenchmarkResult RunBlocked(const std::vector<std::string> &probes, bool *results) {
+    std::string bits = BuildBlocked();
+    
+    Stopwatch watch;
+    for (size_t i = 0; i < probes.size(); ++i) {
+        results[i] = BlockedBloomFilter::MayMatch(probes[i], bits);
+    }
+    double ns = watch.ElapsedNanos();
+    CheckNoFalseNegative(results, probes.size(), "blocked");
+    return {"blocked", bits.size(), ns / probes.size(),
+            FalsePositiveRate(results, probes.size())};
+}
+
+BenchmarkResult RunBlockedBatch(const std::vector<std::string> &probes,
+                                bool *results) {
+    std::string bits = BuildBlocked();
+    const size_t batch_size = FLAGS_batch_size < 1 ? 1 : FLAGS_batch_size;
+    std::unique_ptr<uint64_t[]> hash_vals(new uint64_t[batch_size]);
+    
+    Stopwatch watch;
+    for (size_t i = 0; i < probes.size(); i += batch_size) {
+        size_t n = std::min(batch_size, probes.size() - i);
+        for (size_t j = 0; j < n; ++j) {
+            hash_vals[j] = BlockedBloomFilter::Hash(probes[i + j]);
+        }
+        BlockedBloomFilter::MayMatchBatch(hash_vals.get(), n, bits,
+                                          results + i);
+    }
+    double ns = watch.ElapsedNanos();
+    CheckNoFalseNegative(results, probes.size(), "blocked-batch");
+    return {"blocked-batch", bits.size(), ns / probes.size(),
+            FalsePositiveRate(results, probes.size())};
+}
+
+int main(int argc, char *argv[]) {
+    ::gflags::ParseCommandLineFlags(&argc, &argv, true);
+    if (FLAGS_n_keys < 1 || FLAGS_n_probes < 2) {
+        ::fprintf(stderr, "Bad n_keys or n_probes.\n");
+        return -1;
+    }
+    
+    std::vector<std::string> probes = MakeProbeKeys();
+    std::unique_ptr<bool[]> results(new bool[probes.size()]);
+    
+    BenchmarkResult all[] = {
+        RunLegacy(probes, results.get()),
+        RunBlocked(probes, results.get()),
+        RunBlockedBatch(probes, results.get()),
+    };
+    ::printf("keys: %d, probes: %d\n", FLAGS_n_keys, FLAGS_n_probes);
+    ::printf("%-16s%-16s%-16s%-16s\n", "filter", "size(bytes)", "ns/probe", "fpr");
+    for (const auto &result : all) {
+        ::printf("%-16s%-16zd%-16.2f%-16.4f\n", result.name, result.filter_size,
+                 result.ns_per_probe, result.fpr);
+    }
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "mai/transaction-db.h"
+#include "mai/transaction.h"
+#include "mai/env.h"
+#include "mai/at-exit.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include <stdio.h>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using ::mai::TransactionDB;
+using ::mai::Transaction;
+
+DEFINE_int32(n_threads, 4, "Number of threads running transactions.");
+DEFINE_int32(n_keys, 100000, "Number of keys be locked, less keys, more "
+             "contention.");
+DEFINE_int32(n_txns, 100000, "Number of transactions in every thread.");
+DEFINE_int32(keys_per_txn, 4, "Number of keys locked by one transaction.");
+DEFINE_int32(shared_percent, 0, "Percent of shared locks.");
+DEFINE_int32(lock_timeout, 10, "Lock timeout in milliseconds.");
+DEFINE_bool(deadlock_detect, false, "Detect deadlock or just wait timeout.");
+DEFINE_int32(scan_len, 0, "Lock a scan of so many keys in every transaction "
+             "instead of random keys.");
+DEFINE_bool(range_lock, false, "Lock scans by one range lock, or by point "
+            "locks of every key.");
+DEFINE_string(db, "tests/lock-benchmark", "Directory of benchmark db.");
+
+struct BenchmarkResult {
+    uint64_t n_commits = 0;
+    uint64_t n_aborts = 0;
+};
+
+static std::string MakeKey(int i) {
+    char buf[32];
+    ::snprintf(buf, sizeof(buf), "key-%010d", i);
+    return buf;
+}
+
+static void RunTransactions(TransactionDB *db, mai::ColumnFamily *cf, int seed,
+                            BenchmarkResult *result) {
+    std::mt19937 rand(seed);
+    mai::WriteOptions wr_opts;
+    mai::ReadOptions rd_opts;
+    mai::TransactionOptions txn_opts;
+    txn_opts.lock_timeout = FLAGS_lock_timeout;
+    txn_opts.deadlock_detect = FLAGS_deadlock_detect;
+
+    std::unique_ptr<Transaction> txn;
+    std::string value;
+    for (int i = 0; i < FLAGS_n_txns; ++i) {
+        txn.reset(db->BeginTransaction(wr_opts, txn_opts, txn.release()));
+        bool ok = true;
+        if (FLAGS_scan_len > 0) {
+            bool exclusive = static_cast<int>(rand() % 100) >= FLAGS_shared_percent;
+            int start = rand() % FLAGS_n_keys;
+            if (FLAGS_range_lock) {
+                auto rs = txn->LockRange(cf, MakeKey(start),
+                                         MakeKey(start + FLAGS_scan_len - 1),
+                                         exclusive);
+                ok = rs.ok();
+            }
+            for (int j = 0; j < FLAGS_scan_len && ok; ++j) {
+                auto rs = txn->GetForUpdate(rd_opts, cf, MakeKey(start + j),
+                                            &value, exclusive);
+                ok = rs.ok() || rs.IsNotFound();
+            }
+        } else {
+            for (int j = 0; j < FLAGS_keys_per_txn && ok; ++j) {
+                std::string key = MakeKey(rand() % FLAGS_n_keys);
+                bool exclusive = static_cast<int>(rand() % 100) >=
+                                 FLAGS_shared_percent;
+                auto rs = txn->GetForUpdate(rd_opts, cf, key, &value, exclusive);
+                ok = rs.ok() || rs.IsNotFound();
+            }
+        }
+        txn->Rollback();
+        if (ok) {
+            result->n_commits++;
+        } else {
+            result->n_aborts++;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    ::gflags::ParseCommandLineFlags(&argc, &argv, true);
+    ::mai::AtExit at_exit(::mai::AtExit::INITIALIZER);
+    if (FLAGS_n_threads < 1 || FLAGS_n_keys < 1 || FLAGS_keys_per_txn < 1) {
+        ::fprintf(stderr, "Bad n_threads, n_keys or keys_per_txn.\n");
+        return -1;
+    }
+
+    mai::Options opts;
+    opts.create_if_missing = true;
+    mai::TransactionDBOptions txn_db_opts;
+    txn_db_opts.optimism = false;
+    txn_db_opts.range_locking = FLAGS_range_lock;
+    std::vector<mai::ColumnFamilyDescriptor> descs;
+    mai::ColumnFamilyDescriptor desc;
+    desc.name = mai::kDefaultColumnFamilyName;
+    descs.push_back(desc);
+
+    std::vector<mai::ColumnFamily *> cfs;
+    TransactionDB *db = nullptr;
+    auto rs = TransactionDB::Open(opts, txn_db_opts, FLAGS_db, descs, &cfs, &db);
+    if (!rs) {
+        ::fprintf(stderr, "Open db fail: %s\n", rs.ToString().c_str());
+        return -1;
+    }
+
+    std::vector<BenchmarkResult> results(FLAGS_n_threads);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < FLAGS_n_threads; ++i) {
+        threads.emplace_back(RunTransactions, db, cfs[0], i, &results[i]);
+    }
+    for (auto &thrd : threads) {
+        thrd.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() -
+                                            start;
+
+    BenchmarkResult total;
+    for (const auto &result : results) {
+        total.n_commits += result.n_commits;
+        total.n_aborts  += result.n_aborts;
+    }
+    ::printf("threads: %d, keys: %d, keys/txn: %d, shared: %d%%\n",
+             FLAGS_n_threads, FLAGS_n_keys, FLAGS_keys_per_txn,
+             FLAGS_shared_percent);
+    if (FLAGS_scan_len > 0) {
+        ::printf("scan: %d keys, by %s\n", FLAGS_scan_len,
+                 FLAGS_range_lock ? "range lock" : "point locks");
+    }
+    ::printf("%-16s%-16s%-16s%-16s\n", "txns", "aborts", "seconds", "txns/s");
+    ::printf("%-16llu%-16llu%-16.3f%-16.0f\n",
+             static_cast<unsigned long long>(total.n_commits + total.n_aborts),
+             static_cast<unsigned long long>(total.n_aborts), elapsed.count(),
+             (total.n_commits + total.n_aborts) / elapsed.count());
+
+    for (auto cf : cfs) {
+        db->ReleaseColumnFamily(cf);
+    }
+    delete db;
+    mai::Env::Default()->DeleteFile(FLAGS_db, true);
+    return 0;
+}
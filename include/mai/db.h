@@ -3,6 +3,7 @@
 
 #include "mai/options.h"
 #include "mai/error.h"
+#include "mai/pinnable-value.h"
 #include <string>
 #include <string_view>
 #include <vector>
@@ -85,8 +86,29 @@ public:
     virtual Error Get(const ReadOptions &opts, ColumnFamily *cf, std::string_view key,
                       std::string *value) = 0;
     
+    // Get value without copying. The value pins the cached block or memory
+    // table it points to, so release it soon after using.
+    virtual Error Get(const ReadOptions &opts, ColumnFamily *cf, std::string_view key,
+                      PinnableValue *value);
+    
+    // Get a batch of keys in one call. values and errors will be resized to
+    // keys' size and filled by keys' order. Return fail only if the whole batch
+    // can not be read, e.g. the column family has been dropped.
+    virtual Error MultiGet(const ReadOptions &opts, ColumnFamily *cf,
+                           const std::vector<std::string_view> &keys,
+                           std::vector<std::string> *values,
+                           std::vector<Error> *errors);
+    
     virtual Iterator *NewIterator(const ReadOptions &opts, ColumnFamily *cf) = 0;
     
+    // Add the files built by SstFileWriter into column family, skip the WAL
+    // and memory table. Every file be placed at the lowest level where it does
+    // not overlap any newer data. The key ranges of files must not overlap
+    // each other.
+    virtual Error IngestExternalFiles(const IngestExternalFileOptions &opts,
+                                      ColumnFamily *cf,
+                                      const std::vector<std::string> &files);
+    
     virtual const Snapshot *GetSnapshot() = 0;
     
     virtual void ReleaseSnapshot(const Snapshot *snapshot) = 0;
@@ -95,7 +117,22 @@ public:
     
     // db.log.current-name: The path of the WAL rodo log file.
     // db.log.active: All active redo log file ids.
-    // db.bkg.jobs: Background running jobs.
+    // db.bkg.jobs: Background scheduled and running jobs.
+    // db.bkg.queue-depth: Background jobs waiting for a free thread.
+    // db.bkg.running-flushes: Running memory table flush jobs.
+    // db.bkg.running-compactions: Running file table compaction jobs.
+    // db.write.group-count: Number of group commits written to WAL.
+    // db.write.group-writers: Number of writers committed by groups.
+    // db.write.group-size: Average writers per group commit.
+    // db.write.wait-micros: Total micro seconds writers waiting in queue.
+    // db.block-cache.capacity: Capacity bytes of block cache.
+    // db.block-cache.usage: Bytes of blocks in block cache.
+    // db.block-cache.stats: Hits, misses, evictions and usage of every shard.
+    // db.stats: p50, p99 and p999 micros of operations, if
+    //           Options::enable_statistics be set.
+    // db.rate-limiter.bytes-per-sec: Current rate of rate limiter.
+    // db.rate-limiter.stats: Bytes, throttled bytes and waiting micro seconds
+    //                        of every I/O priority.
     virtual Error GetProperty(std::string_view property, std::string *value) = 0;
 
     DB(const DB &) = delete;
@@ -3,6 +3,7 @@
 
 #include "mai/error.h"
 #include <string_view>
+#include <functional>
 #include <string>
 #include <memory>
 #include <vector>
@@ -36,6 +37,11 @@ public:
                                       std::unique_ptr<RandomAccessFile> *file,
                                       bool use_mmap = true) = 0;
     
+    // Open file by O_DIRECT, the reading bypasses page cache of OS, so the
+    // data only be cached in block cache. Default is a normal file.
+    virtual Error NewDirectRandomAccessFile(const std::string &file_name,
+                                            std::unique_ptr<RandomAccessFile> *file);
+    
     virtual Error MakeDirectory(const std::string &name,
                                 bool create_if_missing) = 0;
     
@@ -48,6 +54,14 @@ public:
     
     virtual Error DeleteFile(const std::string &name, bool recursive) = 0;
     
+    // Rename file, the target file be replaced if it exists.
+    // Default is not supported.
+    virtual Error RenameFile(const std::string &from, const std::string &to);
+    
+    // Make a hard link of file, the target file must not exist.
+    // Default is not supported.
+    virtual Error LinkFile(const std::string &from, const std::string &to);
+    
     virtual Error GetFileSize(const std::string &name, uint64_t *size) = 0;
 
     // New system real random generator
@@ -94,16 +108,39 @@ public:
     virtual Error GetFileSize(uint64_t *size) = 0;
     virtual Error Truncate(uint64_t size) = 0;
     
+    // Preallocate disk space of [offset, offset + len), the file size is not
+    // changed. Default does nothing.
+    virtual Error Allocate(uint64_t offset, uint64_t len);
+    
 }; // class WritableFile
 
 class RandomAccessFile {
 public:
+    struct ReadRequest {
+        uint64_t          offset;
+        size_t            n;
+        std::string      *scratch;
+        std::string_view  result;
+        Error             rs;
+    }; // struct ReadRequest
+    
+    // Run job(0) ... job(n - 1) and return after all of them finished, the
+    // jobs can be run in parallel.
+    using ParallelRunner =
+        std::function<void (size_t n, const std::function<void (size_t)> &job)>;
+    
     RandomAccessFile() {}
     virtual ~RandomAccessFile();
     
     virtual Error Read(uint64_t offset, size_t n, std::string_view *result,
                        std::string *scratch) = 0;
     
+    // Read many ranges in one call, every request gets the same result as
+    // Read(). The implementations can submit all requests to disk at once,
+    // default reads them by runner, or one by one if no runner.
+    virtual void MultiRead(ReadRequest *reqs, size_t n,
+                           const ParallelRunner &runner = nullptr);
+    
     virtual Error GetFileSize(uint64_t *size) = 0;
 }; // class RandomAccessFile
 
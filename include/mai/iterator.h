@@ -6,6 +6,8 @@
 
 namespace mai {
     
+class PinnableValue;
+    
 enum Direction {
     kForward,
     kReserve
@@ -29,8 +31,15 @@ public:
     
     virtual Error error() const = 0;
     
+    // Keep current value alive after the iterator moved. Default is copying,
+    // the iterators on cached blocks or memory tables pin them instead.
+    virtual void PinValue(PinnableValue *result) const;
+    
     static Iterator *AsError(Error error);
     
+    // The iterator has no any key.
+    static Iterator *AsEmpty();
+    
     typedef void (*cleanup_func_t)(void *, void *);
     inline void RegisterCleanup(cleanup_func_t handler,
                                 void *arg1 = nullptr, void *arg2 = nullptr);
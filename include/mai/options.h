@@ -3,11 +3,24 @@
 
 #include "mai/env.h"
 #include "mai/comparator.h"
+#include "mai/prefix-extractor.h"
+#include "mai/rate-limiter.h"
 
 namespace mai {
     
 class Snapshot;
     
+enum CompressionType : uint8_t {
+    kNoCompression  = 0,
+    kLZ4Compression = 1,
+};
+    
+enum CompactionStyle : uint8_t {
+    // Every level is one sorted run, and is multiplier times of its upper
+    // level. See LevelCompactionPicker.
+    kCompactionStyleLevel = 0,
+};
+    
 struct ColumnFamilyOptions {
     
     // Should use hash table?
@@ -29,6 +42,59 @@ struct ColumnFamilyOptions {
     // Only use for sst table
     int block_restart_interval = 16;
     
+    // Only use for ordered table: The number of slots of hash index in memory
+    // table, the point lookup finds the newest version of key by this index
+    // and no need search the skip list. 0 means no hash index.
+    size_t memtable_hash_index_slots = 0;
+    
+    // Only use for sst table: Build the prefix bloom filter for every table,
+    // the iterator with ReadOptions::prefix can skip the tables without this
+    // prefix. nullptr means no prefix filter.
+    const PrefixExtractor *prefix_extractor = nullptr;
+    
+    // Only use for sst table: Split key filter to partitions by data blocks,
+    // every partition be about this size and be loaded into block cache on
+    // demand. 0 means one whole filter for table, it's resident in memory.
+    size_t filter_partition_size = 4 * 1024;
+    
+    // Only use for sst table: Use cache line blocked bloom filter, probing
+    // one key only touches one cache line. The tables built by legacy bloom
+    // filter still can be read.
+    bool blocked_bloom_filter = true;
+    
+    // The data blocks be compressed by this type. The block will be stored
+    // uncompressed if compression can not save 1/8 space at least.
+    CompressionType compression = kLZ4Compression;
+    
+    // The max number of compaction jobs can run in parallel on this column
+    // family. Only the jobs on disjoint level ranges can run in parallel.
+    int max_concurrent_compactions = 2;
+    
+    CompactionStyle compaction_style = kCompactionStyleLevel;
+    
+    // Number of levels include level 0, it can not be more than 7. Don't
+    // reduce it for an existing column family, the files in deeper levels
+    // will never be compacted.
+    int num_levels = 4;
+    
+    // Compact level 0 when it has this number of files. The writing be
+    // stalled when level 0 has more files and compaction is running.
+    int level0_file_num_compaction_trigger = 10;
+    
+    // Target size of level 1, and every next level is
+    // max_bytes_for_level_multiplier times of its upper level.
+    uint64_t max_bytes_for_level_base = 10ULL * 1024 * 1024 * 1024; // 10GB
+    
+    double max_bytes_for_level_multiplier = 10;
+    
+    // Compute the level targets from the size of the last level, then up to
+    // the base level, the first level its target not less than
+    // max_bytes_for_level_base. Level 0 be compacted to the base level
+    // directly, the levels upper than it are empty. So the size ratio of
+    // every two levels keeps multiplier, even if the db is much larger than
+    // the static targets.
+    bool level_compaction_dynamic_level_bytes = false;
+    
     std::string dir;
     
     const Comparator* comparator = Comparator::Bytewise();
@@ -40,6 +106,23 @@ struct ReadOptions final {
     
     bool verify_checksums = true;
     
+    // Should the data blocks read for this read be inserted into block cache?
+    // Set it false for bulk scans, so they don't evict the hot blocks.
+    bool fill_cache = true;
+    
+    // The max readahead size of iterators. The iterator starts to read ahead
+    // when it finds the data blocks be read sequentially, the readahead size
+    // grows from 8KB to it. 0 means no readahead.
+    size_t readahead_size = 2 * 1024 * 1024;
+    
+    // Read the next range in background during scanning the current range.
+    // The reading be run in the DB's background thread pool.
+    bool async_readahead = true;
+    
+    // Only iterate the keys with this prefix. The iterator can skip the sst
+    // tables without this prefix, if it be extracted by prefix_extractor.
+    std::string prefix;
+    
 }; // struct ReadOptions
     
 struct WriteOptions final {
@@ -48,6 +131,15 @@ struct WriteOptions final {
     
 }; // struct WriteOptions
     
+struct IngestExternalFileOptions final {
+    
+    // Move the files into DB instead of copying them. The files be linked
+    // into DB, and be deleted only after ingestion succeeded. If they can
+    // not be linked (e.g. not in the same file system as DB), copy them.
+    bool move_files = false;
+    
+}; // struct IngestExternalFileOptions
+    
 struct Options final : public ColumnFamilyOptions {
     
     Env *env = Env::Default();
@@ -63,11 +155,70 @@ struct Options final : public ColumnFamilyOptions {
     // 80 MB
     size_t max_total_wal_size = 80 * 1024 * 1024;
     
+    // The large WAL records be compressed by this type. The record will be
+    // stored uncompressed if compression can not save 1/8 space at least.
+    CompressionType wal_compression = kNoCompression;
+    
+    // Keep this number of obsolete WAL files, and reuse them as new WAL
+    // files. Overwriting a recycled file not need to update its size and
+    // block map, so the syncing is cheaper.
+    size_t recycle_log_file_num = 0;
+    
+    // Preallocate space of WAL file by this size of chunk. 0 means no
+    // preallocation.
+    size_t wal_preallocate_size = 0;
+    
     bool allow_mmap_reads = false;
     
+    // Read table files by O_DIRECT, the blocks not be cached twice by page
+    // cache and block cache. It be ignored if allow_mmap_reads is set.
+    bool use_direct_reads = false;
+    
     bool allow_mmap_writes = false;
     
-    size_t block_cache_capacity = 10240;
+    // The writers of a write group insert their own batches into memory
+    // tables in parallel after the leader has written WAL. Only the ordered
+    // memory table supports it, otherwise the leader inserts all batches.
+    bool allow_concurrent_memtable_write = false;
+    
+    // Total bytes of data blocks in block cache.
+    size_t block_cache_capacity = 32 * 1024 * 1024;
+    
+    // The secondary block cache keeps the compressed blocks, it can hold
+    // more blocks than block cache in the same memory, a hit only needs
+    // uncompressing but no I/O. 0 means no secondary cache.
+    size_t compressed_block_cache_capacity = 0;
+    
+    // The number of background threads for flush and compaction jobs.
+    // Flush jobs have higher priority than compaction jobs, one thread be
+    // reserved for them, so it's 2 at least.
+    int max_background_jobs = 4;
+    
+    // The number of threads for reading blocks in parallel: block prefetch,
+    // MultiRead and async readahead of iterators. They are apart from the
+    // background threads, so the reads never delay flush jobs. It's 2 at
+    // least.
+    int max_io_threads = 2;
+    
+    // The max number of key range shards of one compaction job. The shards
+    // run in parallel and output to different files.
+    int max_subcompactions = 4;
+    
+    // The min input bytes of a subcompaction shard.
+    uint64_t min_subcompaction_size = 32 * 1024 * 1024;
+    
+    // The max number of waiting immutable memory tables be flushed in
+    // parallel, every one outputs a level-0 file.
+    int max_parallel_flushes = 4;
+    
+    // Limit the writing of WAL, flush and compaction files. The point lookups
+    // report their latency of reading tables to it for auto tuning. nullptr
+    // means no limit.
+    RateLimiter *rate_limiter = nullptr;
+    
+    // Collect histograms of operations: Get, Put, Delete, Write, Seek, Next,
+    // flush and compaction. See DB::GetProperty("db.stats").
+    bool enable_statistics = false;
 }; // struct Options
     
 } // namespace mai
@@ -0,0 +1,62 @@
+#ifndef MAI_PERF_CONTEXT_H_
+#define MAI_PERF_CONTEXT_H_
+
+#include <stdint.h>
+#include <string>
+
+namespace mai {
+
+enum PerfLevel : int {
+    kPerfDisable     = 0, // Collect nothing.
+    kPerfEnableCount = 1, // Only counters.
+    kPerfEnableTime  = 2, // Counters and time.
+};
+
+#define DECL_PERF_CONTEXT_METRICS(V) \
+    V(memtable_probes)      \
+    V(sst_files_touched)    \
+    V(bloom_filter_useful)  \
+    V(bloom_filter_useless) \
+    V(block_cache_hits)     \
+    V(block_cache_misses)   \
+    V(block_read_count)     \
+    V(block_read_bytes)     \
+    V(wal_write_bytes)      \
+    V(db_mutex_wait_nanos)  \
+    V(wal_sync_nanos)       \
+    V(txn_check_skips)      \
+    V(txn_check_lookups)
+
+// The counters of operations in current thread, for finding out why an
+// operation is slow:
+//
+// PerfContext::SetLevel(kPerfEnableTime);
+// PerfContext::Current()->Reset();
+// db->Get(...);
+// printf("%s\n", PerfContext::Current()->ToString().c_str());
+//
+// bloom_filter_useful: Number of tables be skipped by bloom filter.
+// bloom_filter_useless: Number of tables passed bloom filter but have no key.
+// txn_check_skips: Number of conflict checks answered by recent writes.
+// txn_check_lookups: Number of conflict checks looked up in tables.
+struct PerfContext final {
+#define DEFINE_METRIC(name) uint64_t name = 0;
+    DECL_PERF_CONTEXT_METRICS(DEFINE_METRIC)
+#undef DEFINE_METRIC
+
+    void Reset() { *this = PerfContext{}; }
+
+    // Only the not zero counters.
+    std::string ToString() const;
+
+    // The perf context of current thread.
+    static PerfContext *Current();
+
+    // The perf level of current thread, default is kPerfDisable.
+    static PerfLevel GetLevel();
+    static void SetLevel(PerfLevel level);
+}; // struct PerfContext
+
+} // namespace mai
+
+#endif // MAI_PERF_CONTEXT_H_
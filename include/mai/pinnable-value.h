@@ -0,0 +1,72 @@
+#ifndef MAI_PINNABLE_VALUE_H_
+#define MAI_PINNABLE_VALUE_H_
+
+#include <string_view>
+#include <string>
+
+namespace mai {
+
+// The value be read without copying.
+// If it's pinned, the value points to a cached block or a memory table directly,
+// and the block or table be hold until this value reset or destroyed.
+// Otherwise the value be copied into its own buffer.
+class PinnableValue final {
+public:
+    typedef void (*cleanup_func_t)(void *, void *);
+
+    PinnableValue() {}
+    ~PinnableValue() { Reset(); }
+
+    std::string_view value() const { return value_; }
+    const char *data() const { return value_.data(); }
+    size_t size() const { return value_.size(); }
+    bool empty() const { return value_.empty(); }
+
+    bool pinned() const { return handler_ != nullptr; }
+
+    // Point to data, and handler(arg1, arg2) will be called on reset.
+    inline void Pin(std::string_view data, cleanup_func_t handler,
+                    void *arg1 = nullptr, void *arg2 = nullptr);
+
+    // Copy data into own buffer.
+    inline void Assign(std::string_view data);
+
+    inline void Reset();
+
+    PinnableValue(const PinnableValue &) = delete;
+    PinnableValue(PinnableValue &&) = delete;
+    void operator = (const PinnableValue &) = delete;
+private:
+    std::string_view value_;
+    std::string buf_;
+    cleanup_func_t handler_ = nullptr;
+    void *arg1_ = nullptr;
+    void *arg2_ = nullptr;
+}; // class PinnableValue
+
+inline void PinnableValue::Pin(std::string_view data, cleanup_func_t handler,
+                               void *arg1, void *arg2) {
+    Reset();
+    value_   = data;
+    handler_ = handler;
+    arg1_    = arg1;
+    arg2_    = arg2;
+}
+
+inline void PinnableValue::Assign(std::string_view data) {
+    Reset();
+    buf_.assign(data.data(), data.size());
+    value_ = buf_;
+}
+
+inline void PinnableValue::Reset() {
+    if (handler_) {
+        handler_(arg1_, arg2_);
+        handler_ = nullptr;
+    }
+    value_ = std::string_view();
+}
+
+} // namespace mai
+
+#endif // MAI_PINNABLE_VALUE_H_
@@ -0,0 +1,34 @@
+#ifndef MAI_PREFIX_EXTRACTOR_H_
+#define MAI_PREFIX_EXTRACTOR_H_
+
+#include <string_view>
+#include <string>
+
+namespace mai {
+
+// Extract prefix from user key. The prefix bloom filter of sst table be built
+// by extracted prefixes. If key is a prefix of other key, prefix extracted by
+// them should be the same.
+class PrefixExtractor {
+public:
+    PrefixExtractor() {}
+    virtual ~PrefixExtractor() {}
+
+    // REQUIRES: InDomain(key)
+    virtual std::string_view Extract(std::string_view key) const = 0;
+
+    // Can the prefix be extracted from this key?
+    virtual bool InDomain(std::string_view key) const = 0;
+
+    // The name be saved in sst table. The prefix filter only be used when
+    // name is the same.
+    virtual const char *Name() const = 0;
+
+    // Use fixed length prefix. The keys shorter than len are not in domain.
+    // The caller should delete it after all column families be released.
+    static PrefixExtractor *NewFixed(size_t len);
+}; // class PrefixExtractor
+
+} // namespace mai
+
+#endif // MAI_PREFIX_EXTRACTOR_H_
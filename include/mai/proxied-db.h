@@ -54,10 +54,25 @@ public:
                       std::string_view key, std::string *value) override {
         return db_->Get(opts, cf, key, value);
     }
+    virtual Error Get(const ReadOptions &opts, ColumnFamily *cf,
+                      std::string_view key, PinnableValue *value) override {
+        return db_->Get(opts, cf, key, value);
+    }
+    virtual Error MultiGet(const ReadOptions &opts, ColumnFamily *cf,
+                           const std::vector<std::string_view> &keys,
+                           std::vector<std::string> *values,
+                           std::vector<Error> *errors) override {
+        return db_->MultiGet(opts, cf, keys, values, errors);
+    }
     virtual Iterator *
     NewIterator(const ReadOptions &opts, ColumnFamily *cf) override {
         return db_->NewIterator(opts, cf);
     }
+    virtual Error
+    IngestExternalFiles(const IngestExternalFileOptions &opts, ColumnFamily *cf,
+                        const std::vector<std::string> &files) override {
+        return db_->IngestExternalFiles(opts, cf, files);
+    }
     virtual const Snapshot *GetSnapshot() override {
         return db_->GetSnapshot();
     }
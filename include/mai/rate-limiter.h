@@ -0,0 +1,68 @@
+#ifndef MAI_RATE_LIMITER_H_
+#define MAI_RATE_LIMITER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace mai {
+
+class Env;
+
+// Limit the bytes per second of background writing, so the foreground reads
+// and writes do not wait for the disk be saturated by compactions.
+//
+// The requests be granted by priority: WAL first, then flush, compaction at
+// last. One limiter can be shared by many db.
+class RateLimiter {
+public:
+    enum IOPriority : int {
+        kIOPriorityWAL,
+        kIOPriorityFlush,
+        kIOPriorityCompaction,
+        kNumIOPriorities,
+    };
+
+    RateLimiter() {}
+    virtual ~RateLimiter() {}
+
+    // Block until bytes be granted.
+    // REQUIRES: bytes <= GetSingleBurstBytes()
+    virtual void Request(size_t bytes, IOPriority pri) = 0;
+
+    // The max bytes can be granted in one request.
+    virtual size_t GetSingleBurstBytes() const = 0;
+
+    virtual uint64_t GetBytesPerSecond() const = 0;
+
+    virtual void SetBytesPerSecond(uint64_t bytes_per_second) = 0;
+
+    // Report the latency of a foreground operation. The auto tuned limiter
+    // reduces rate when the average latency exceeds its target, and raises it
+    // when the latency be low.
+    virtual void ReportLatency(uint64_t micros) = 0;
+
+    // Total bytes be granted.
+    virtual uint64_t GetTotalBytes(IOPriority pri) const = 0;
+
+    // Total bytes of the requests had to wait.
+    virtual uint64_t GetTotalBytesThrottled(IOPriority pri) const = 0;
+
+    // Total micro seconds of requests waiting.
+    virtual uint64_t GetTotalWaitMicros(IOPriority pri) const = 0;
+
+    // Token bucket refilled every refill_period_micros. If
+    // target_latency_micros is not 0, the rate be tuned in
+    // [bytes_per_second / 20, bytes_per_second] by the reported latency.
+    // The caller should delete it after all db be closed.
+    static RateLimiter *NewGeneric(uint64_t bytes_per_second,
+                                   uint64_t refill_period_micros = 100 * 1000,
+                                   uint64_t target_latency_micros = 0,
+                                   Env *env = nullptr);
+
+    RateLimiter(const RateLimiter &) = delete;
+    void operator = (const RateLimiter &) = delete;
+}; // class RateLimiter
+
+} // namespace mai
+
+#endif // MAI_RATE_LIMITER_H_
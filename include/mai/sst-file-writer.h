@@ -0,0 +1,47 @@
+#ifndef MAI_SST_FILE_WRITER_H_
+#define MAI_SST_FILE_WRITER_H_
+
+#include "mai/options.h"
+#include "mai/error.h"
+#include <string>
+#include <string_view>
+
+namespace mai {
+
+// Build a table file out of DB, then it can be ingested into a column family
+// by DB::IngestExternalFiles() without WAL and memory table.
+//
+// The options must be the same as the column family's, so the file has the
+// same format. The keys must be added in ascending order of comparator.
+class SstFileWriter {
+public:
+    SstFileWriter() {}
+    virtual ~SstFileWriter() {}
+
+    // approximated_n_entries: The size of bloom filter and the number of hash
+    // slots (for unordered column family) be computed by it.
+    static SstFileWriter *New(const ColumnFamilyOptions &options,
+                              Env *env = Env::Default(),
+                              size_t approximated_n_entries = 0);
+
+    virtual Error Open(const std::string &file_name) = 0;
+
+    virtual Error Put(std::string_view key, std::string_view value) = 0;
+
+    virtual Error Delete(std::string_view key) = 0;
+
+    // Write the index, filter and properties, then close the file.
+    virtual Error Finish() = 0;
+
+    virtual uint64_t FileSize() const = 0;
+
+    virtual uint64_t NumEntries() const = 0;
+
+    SstFileWriter(const SstFileWriter &) = delete;
+    SstFileWriter(SstFileWriter &&) = delete;
+    void operator = (const SstFileWriter &) = delete;
+}; // class SstFileWriter
+
+} // namespace mai
+
+#endif // MAI_SST_FILE_WRITER_H_
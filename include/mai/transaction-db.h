@@ -22,6 +22,18 @@ struct TransactionDBOptions final {
     
     uint32_t max_num_deadlocks = 50;
     
+    // Lock keys in ordered lock tables, then transactions can lock ranges.
+    bool range_locking = false;
+    
+    // Escalate point locks of a transaction in a column family to range
+    // locks once it holds so many of them, every range only covers nearby
+    // keys. 0 for never.
+    int range_lock_escalation = 256;
+    
+    // Slots of index of recent writes for optimistic transactions, most of
+    // conflict checks can be answered by it. 0 for disable.
+    size_t recent_writes_slots = 1 << 16;
+    
 }; // struct TransactionDBOptions
     
 struct TransactionOptions final {
@@ -54,6 +66,10 @@ public:
                      const TransactionOptions &txn_opts = TransactionOptions{},
                      Transaction *old_txn = nullptr) = 0;
     
+    // Get the prepared but not decided transactions recovered by Open(), the
+    // caller should commit or rollback them, then delete them.
+    virtual Error GetAllPreparedTransactions(std::vector<Transaction *> *txns) = 0;
+    
     TransactionDB(const TransactionDB &) = delete;
     TransactionDB(TransactionDB &&) = delete;
     void operator = (const TransactionDB &) = delete;
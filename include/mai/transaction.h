@@ -39,6 +39,12 @@ public:
     
     virtual Error Rollback() = 0;
     
+    // The first phase of two-phase commit: write all updates into DB, but they
+    // are invisible until Commit(). The prepared transaction can be recovered
+    // after DB reopen, see TransactionDB::GetAllPreparedTransactions().
+    // REQUIRES: The transaction has been named.
+    virtual Error Prepare() = 0;
+    
     virtual Error Commit() = 0;
     
     virtual Error Put(ColumnFamily *cf, std::string_view key,
@@ -54,6 +60,11 @@ public:
                                bool exclusive = true,
                                const bool do_validate = true) = 0;
     
+    // Lock all keys in [begin, end], include the keys not be inserted yet.
+    // REQUIRES: TransactionDBOptions::range_locking
+    virtual Error LockRange(ColumnFamily *cf, std::string_view begin,
+                            std::string_view end, bool exclusive = true) = 0;
+    
     virtual Iterator* GetIterator(const ReadOptions& opts,
                                   ColumnFamily* cf) = 0;
     
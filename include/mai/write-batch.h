@@ -24,6 +24,15 @@ public:
         n_entries_ = 0;
     }
     
+    // Append all entries of other batch to this batch.
+    void Append(const WriteBatch &other) {
+        redo_.append(other.redo_, kHeaderSize, std::string::npos);
+        n_entries_ += other.n_entries_;
+    }
+    
+    // The size of redo buffer, include header.
+    size_t ApproximateSize() const { return redo_.size(); }
+    
     class Stub {
     public:
         Stub() {}
@@ -33,6 +42,13 @@ public:
                          std::string_view value) = 0;
         virtual void Delete(uint32_t cfid, std::string_view key) = 0;
         
+        // Markers of two-phase commit, only be written by transactions.
+        // The entries between begin and end prepare markers be prepared.
+        virtual void MarkBeginPrepare() {}
+        virtual void MarkEndPrepare(std::string_view /*name*/) {}
+        virtual void MarkCommit(std::string_view /*name*/) {}
+        virtual void MarkRollback(std::string_view /*name*/) {}
+        
         Stub(const Stub &) = delete;
         Stub(Stub &&) = delete;
         void operator = (const Stub &) = delete;
@@ -56,6 +72,15 @@ public:
     WriteBatch(WriteBatch &&) = delete;
     void operator = (const WriteBatch &) = delete;
 protected:
+    enum Marker : uint8_t {
+        kMarkBeginPrepare = 0x80,
+        kMarkEndPrepare,
+        kMarkCommit,   // Use one sequence number
+        kMarkRollback, // Use one sequence number
+    };
+    
+    void AddMarker(Marker marker, std::string_view name);
+    
     const std::string *raw_buf() const { return &redo_; }
     std::string *mutable_raw_buf() { return &redo_; }
     void set_n_entries(uint32_t n_entries) { n_entries_ = n_entries; }
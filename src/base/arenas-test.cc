@@ -29,6 +29,27 @@ TEST_F(ArenaTest, Sanity) {
     ASSERT_NE(nullptr, arena.Allocate(1024, 4));
 }
     
+TEST_F(ArenaTest, Reset) {
+    const size_t page_size = StandaloneArena::kPageSize;
+    StandaloneArena arena;
+    void *first = arena.Allocate(128, 4);
+    ASSERT_NE(nullptr, first);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_NE(nullptr, arena.Allocate(1024, 4));
+    }
+    ASSERT_NE(nullptr, arena.Allocate(page_size * 2, 4));
+    ASSERT_GT(arena.memory_usage(), page_size);
+    
+    arena.Reset();
+    ASSERT_EQ(page_size, arena.memory_usage());
+    std::vector<ArenaStatistics> normal, large;
+    arena.GetUsageStatistics(&normal, &large);
+    ASSERT_EQ(1, normal.size());
+    ASSERT_EQ(0, normal[0].usage);
+    ASSERT_TRUE(large.empty());
+    ASSERT_NE(nullptr, arena.Allocate(1024, 4));
+}
+    
 TEST_F(ArenaTest, FuzzAllocation) {
     StandaloneArena arena;
     for (int i = 0; i < 10240; ++i) {
@@ -197,6 +218,32 @@ TEST_F(ArenaTest, StaticOverflowAllocation) {
     ASSERT_EQ(nullptr, x);
 }
     
+TEST_F(ArenaTest, ShardedAllocation) {
+    ShardedArena arena;
+    ASSERT_EQ(0, arena.memory_usage());
+    
+    void *p = arena.Allocate(3);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(p) % sizeof(void *));
+    p = arena.Allocate(5);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(p) % sizeof(void *));
+    ASSERT_EQ(16 * base::kKB, arena.memory_usage());
+    
+    std::thread worker_thrds[4];
+    for (auto &thrd : worker_thrds) {
+        thrd = std::thread([&]() {
+            for (int i = 0; i < 1024; i++) {
+                char *chunk = static_cast<char *>(arena.Allocate(100));
+                ASSERT_NE(nullptr, chunk);
+                ::memset(chunk, 0xcc, 100);
+            }
+        });
+    }
+    for (auto &thrd : worker_thrds) {
+        thrd.join();
+    }
+    ASSERT_GE(arena.memory_usage(), 4 * 1024 * 100);
+}
+    
 } // namespace base
     
 } // namespace mai
@@ -49,6 +49,36 @@ void StandaloneArena::Purge(bool reinit) {
     }
 }
     
+void StandaloneArena::Reset() {
+    PageHead *page = current_.load(std::memory_order_relaxed);
+    if (!page) {
+        Purge(true);
+        return;
+    }
+    PageHead *x = page->next.load(std::memory_order_relaxed);
+    while (x) {
+        PageHead *next = x->next.load(std::memory_order_relaxed);
+#if defined(DEBUG) || defined(_DEBUG)
+        Round32BytesFill(kFreeZag, x, kPageSize);
+#endif
+        ::free(x);
+        x = next;
+    }
+    while (large_) {
+        x = large_;
+        large_ = x->next.load(std::memory_order_relaxed);
+#if defined(DEBUG) || defined(_DEBUG)
+        size_t page_size = x->u.size;
+        Round32BytesFill(kFreeZag, x, page_size);
+#endif
+        ::free(x);
+    }
+    page->next.store(nullptr, std::memory_order_relaxed);
+    page->u.free.store(reinterpret_cast<char *>(page + 1),
+                       std::memory_order_relaxed);
+    memory_usage_.store(kPageSize, std::memory_order_relaxed);
+}
+    
 void *StandaloneArena::NewNormal(size_t size, size_t alignment) {
     PageHead *page = current_.load(std::memory_order_acquire);
     size_t alloc_size = RoundUp(size, alignment);
@@ -101,6 +131,49 @@ void StandaloneArena::GetUsageStatistics(std::vector<Statistics> *normal,
     }
 }
     
+/*virtual*/ ShardedArena::~ShardedArena() {
+    for (int i = 0; i < kMaxShards; ++i) {
+        delete shards_[i].load(std::memory_order_relaxed);
+    }
+}
+    
+/*virtual*/ void ShardedArena::Purge(bool reinit) {
+    for (int i = 0; i < kMaxShards; ++i) {
+        StandaloneArena *shard = shards_[i].load(std::memory_order_acquire);
+        if (shard) {
+            shard->Purge(reinit);
+        }
+    }
+}
+    
+/*virtual*/ size_t ShardedArena::memory_usage() const {
+    size_t usage = 0;
+    for (int i = 0; i < kMaxShards; ++i) {
+        StandaloneArena *shard = shards_[i].load(std::memory_order_acquire);
+        if (shard) {
+            usage += shard->memory_usage();
+        }
+    }
+    return usage;
+}
+    
+StandaloneArena *ShardedArena::GetShard() {
+    // Threads get their shard index by order of first allocation.
+    static std::atomic<int> next_index(0);
+    static thread_local int index = next_index.fetch_add(1) % kMaxShards;
+    
+    StandaloneArena *shard = shards_[index].load(std::memory_order_acquire);
+    if (!shard) {
+        StandaloneArena *arena = new StandaloneArena();
+        if (shards_[index].compare_exchange_strong(shard, arena)) {
+            shard = arena;
+        } else {
+            delete arena; // Other thread has created it.
+        }
+    }
+    return shard;
+}
+    
 /*virtual*/ void ScopedArena::Purge(bool /*reinit*/) {
     for (auto chunk : chunks_) {
         ::free(chunk);
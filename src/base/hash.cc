@@ -1,4 +1,5 @@
 #include "base/hash.h"
+#include <string.h>
 
 namespace mai {
     
@@ -62,6 +63,49 @@ const hash_func_t Hash::kBloomFilterHashs[Hash::kNumberBloomFilterHashs] = {
     return ::crc32(0, s, n);
 }
     
+/*static*/ uint64_t Hash::Murmur64(const char *s, size_t n, uint64_t seed) {
+    static const uint64_t m = 0xc6a4a7935bd1e995ull;
+    static const int r = 47;
+    
+    uint64_t h = seed ^ (n * m);
+    const char *end = s + (n & ~static_cast<size_t>(7));
+    for (const char *p = s; p < end; p += 8) {
+        uint64_t k;
+        ::memcpy(&k, p, sizeof(k));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    
+    const uint8_t *tail = reinterpret_cast<const uint8_t *>(end);
+    switch (n & 7) {
+        case 7: h ^= static_cast<uint64_t>(tail[6]) << 48;
+            [[fallthrough]];
+        case 6: h ^= static_cast<uint64_t>(tail[5]) << 40;
+            [[fallthrough]];
+        case 5: h ^= static_cast<uint64_t>(tail[4]) << 32;
+            [[fallthrough]];
+        case 4: h ^= static_cast<uint64_t>(tail[3]) << 24;
+            [[fallthrough]];
+        case 3: h ^= static_cast<uint64_t>(tail[2]) << 16;
+            [[fallthrough]];
+        case 2: h ^= static_cast<uint64_t>(tail[1]) << 8;
+            [[fallthrough]];
+        case 1: h ^= static_cast<uint64_t>(tail[0]);
+            h *= m;
+            break;
+        default:
+            break;
+    }
+    
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+    
 } // namespace base
     
 } // namespace mai
@@ -23,6 +23,9 @@ struct Hash {
     static uint32_t Bkdr(const char *s, size_t n);
     static uint32_t Crc32(const char *s, size_t n);
     
+    // MurmurHash64A, all bits of result are well mixed.
+    static uint64_t Murmur64(const char *s, size_t n, uint64_t seed = 0);
+    
 }; // struct Hash
 
 } // namespace base
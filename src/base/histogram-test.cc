@@ -0,0 +1,72 @@
+#include "base/histogram.h"
+#include "gtest/gtest.h"
+#include <thread>
+#include <vector>
+
+namespace mai {
+
+namespace base {
+
+TEST(HistogramTest, BucketLimits) {
+    ASSERT_EQ(1, Histogram::BucketLimit(0));
+    ASSERT_EQ(2, Histogram::BucketLimit(1));
+    ASSERT_EQ(0, Histogram::BucketIndex(0));
+    ASSERT_EQ(0, Histogram::BucketIndex(1));
+    ASSERT_EQ(1, Histogram::BucketIndex(2));
+    for (int i = 1; i < 100; ++i) {
+        ASSERT_LT(Histogram::BucketLimit(i - 1), Histogram::BucketLimit(i));
+        if (Histogram::BucketLimit(i) == UINT64_MAX) {
+            break;
+        }
+    }
+    ASSERT_LT(Histogram::BucketIndex(UINT64_MAX), Histogram::kMaxBuckets);
+}
+
+TEST(HistogramTest, Percentile) {
+    Histogram histogram;
+    ASSERT_EQ(0, histogram.count());
+    ASSERT_EQ(0, histogram.Percentile(50));
+
+    for (uint64_t i = 1; i <= 10000; ++i) {
+        histogram.Add(i);
+    }
+    ASSERT_EQ(10000, histogram.count());
+    ASSERT_EQ(1, histogram.min());
+    ASSERT_EQ(10000, histogram.max());
+    ASSERT_NEAR(5000.5, histogram.Average(), 0.001);
+
+    // The buckets are about 1.5 times of previous one.
+    ASSERT_NEAR(5000, histogram.Percentile(50), 5000 * 0.25);
+    ASSERT_NEAR(9900, histogram.Percentile(99), 9900 * 0.25);
+    ASSERT_NEAR(9990, histogram.Percentile(99.9), 9990 * 0.25);
+    ASSERT_LE(histogram.Percentile(99.9), 10000);
+    ASSERT_LE(histogram.Percentile(50), histogram.Percentile(99));
+
+    histogram.Clear();
+    ASSERT_EQ(0, histogram.count());
+    ASSERT_EQ(0, histogram.max());
+}
+
+TEST(HistogramTest, ConcurrentAdding) {
+    static constexpr int kThreads = 4;
+    static constexpr int kN = 100000;
+    Histogram histogram;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&histogram, i] () {
+            for (int j = 0; j < kN; ++j) {
+                histogram.Add(i * kN + j);
+            }
+        });
+    }
+    for (auto &thrd : threads) {
+        thrd.join();
+    }
+    ASSERT_EQ(kThreads * kN, histogram.count());
+    ASSERT_EQ(0, histogram.min());
+    ASSERT_EQ(kThreads * kN - 1, histogram.max());
+}
+
+} // namespace base
+
+} // namespace mai
@@ -0,0 +1,117 @@
+#include "base/histogram.h"
+#include "base/slice.h"
+#include "glog/logging.h"
+#include <algorithm>
+#include <inttypes.h>
+#include <limits>
+#include <vector>
+
+namespace mai {
+
+namespace base {
+
+namespace {
+
+// 1, 2, 3, 4, 6, 9, 13, 19, 28, 42, 63, 94, 140, 210, ...
+// Keep two significant digits, so the limits are readable.
+class BucketLimits final {
+public:
+    BucketLimits() {
+        limits_.push_back(1);
+        limits_.push_back(2);
+        const uint64_t kLast = std::numeric_limits<uint64_t>::max() / 3;
+        while (limits_.back() < kLast) {
+            uint64_t limit = limits_.back() + limits_.back() / 2;
+            uint64_t pow10 = 1;
+            while (limit / pow10 >= 100) {
+                pow10 *= 10;
+            }
+            limit = limit / pow10 * pow10;
+            limits_.push_back(std::max(limit, limits_.back() + 1));
+        }
+        limits_.push_back(std::numeric_limits<uint64_t>::max());
+        DCHECK_LE(limits_.size(), Histogram::kMaxBuckets);
+    }
+
+    const std::vector<uint64_t> &limits() const { return limits_; }
+
+private:
+    std::vector<uint64_t> limits_;
+}; // class BucketLimits
+
+const std::vector<uint64_t> &GetBucketLimits() {
+    static const BucketLimits *limits = new BucketLimits();
+    return limits->limits();
+}
+
+} // namespace
+
+/*static*/ int Histogram::BucketIndex(uint64_t value) {
+    const auto &limits = GetBucketLimits();
+    return static_cast<int>(std::lower_bound(limits.begin(), limits.end(), value) -
+                            limits.begin());
+}
+
+/*static*/ uint64_t Histogram::BucketLimit(int index) {
+    const auto &limits = GetBucketLimits();
+    DCHECK_GE(index, 0);
+    DCHECK_LT(index, limits.size());
+    return limits[index];
+}
+
+void Histogram::Add(uint64_t value) {
+    buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t old = min_.load(std::memory_order_relaxed);
+    while (value < old &&
+           !min_.compare_exchange_weak(old, value, std::memory_order_relaxed)) {
+    }
+    old = max_.load(std::memory_order_relaxed);
+    while (value > old &&
+           !max_.compare_exchange_weak(old, value, std::memory_order_relaxed)) {
+    }
+}
+
+void Histogram::Clear() {
+    for (auto &bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+double Histogram::Percentile(double p) const {
+    const auto &limits = GetBucketLimits();
+    const double threshold = count() * (p / 100.0);
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < limits.size(); ++i) {
+        const uint64_t n = buckets_[i].load(std::memory_order_relaxed);
+        cumulative += n;
+        if (n > 0 && cumulative >= threshold) {
+            // Interpolate in the bucket.
+            const double left  = i == 0 ? 0 : limits[i - 1];
+            const double right = limits[i];
+            const double pos   = (threshold - (cumulative - n)) / n;
+            double r = left + (right - left) * pos;
+            r = std::max(r, static_cast<double>(min()));
+            r = std::min(r, static_cast<double>(max()));
+            return r;
+        }
+    }
+    return max();
+}
+
+std::string Histogram::ToString(double scale) const {
+    return Sprintf("count=%" PRIu64 " avg=%.2f p50=%.2f p99=%.2f p999=%.2f "
+                   "max=%.2f", count(), Average() / scale,
+                   Percentile(50) / scale, Percentile(99) / scale,
+                   Percentile(99.9) / scale, max() / scale);
+}
+
+} // namespace base
+
+} // namespace mai
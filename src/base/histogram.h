@@ -0,0 +1,62 @@
+#ifndef MAI_BASE_HISTOGRAM_H_
+#define MAI_BASE_HISTOGRAM_H_
+
+#include "base/base.h"
+#include <atomic>
+#include <string>
+
+namespace mai {
+
+namespace base {
+
+// Lock-free histogram, the values be counted by exponential buckets, every
+// bucket limit is about 1.5 times of previous one. So the percentiles are
+// approximate.
+class Histogram final {
+public:
+    static constexpr int kMaxBuckets = 128;
+
+    Histogram() { Clear(); }
+
+    void Add(uint64_t value);
+
+    void Clear();
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    uint64_t min() const {
+        return count() == 0 ? 0 : min_.load(std::memory_order_relaxed);
+    }
+
+    double Average() const {
+        uint64_t n = count();
+        return n == 0 ? 0 : static_cast<double>(sum()) / n;
+    }
+
+    // p in [0, 100]
+    double Percentile(double p) const;
+
+    // The values be divided by scale, e.g. 1000 for nanos to micros.
+    std::string ToString(double scale = 1) const;
+
+    // Index of the bucket for value.
+    static int BucketIndex(uint64_t value);
+
+    // Max value of bucket.
+    static uint64_t BucketLimit(int index);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(Histogram);
+private:
+    std::atomic<uint64_t> buckets_[kMaxBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> min_;
+    std::atomic<uint64_t> max_;
+}; // class Histogram
+
+} // namespace base
+
+} // namespace mai
+
+#endif // MAI_BASE_HISTOGRAM_H_
@@ -1,13 +1,122 @@
 #include "base/io-utils.h"
 #include "mai/db.h"
 #include "mai/write-batch.h"
+#include "gtest/gtest.h"
 
 namespace mai {
-    
+
 namespace base {
+
+class StringWritableFile final : public WritableFile {
+public:
+    StringWritableFile(size_t fail_after = SIZE_MAX) : fail_after_(fail_after) {}
+
+    virtual Error Append(std::string_view data) override {
+        if (buf_.size() + data.size() > fail_after_) {
+            return MAI_IO_ERROR("Disk full.");
+        }
+        buf_.append(data);
+        return Error::OK();
+    }
+    virtual Error PositionedAppend(std::string_view data,
+                                   uint64_t offset) override {
+        buf_.resize(offset);
+        return Append(data);
+    }
+    virtual Error Flush() override { return Error::OK(); }
+    virtual Error Sync() override { return Error::OK(); }
+    virtual Error GetFileSize(uint64_t *size) override {
+        *size = buf_.size();
+        return Error::OK();
+    }
+    virtual Error Truncate(uint64_t size) override {
+        buf_.resize(size);
+        return Error::OK();
+    }
+
+    const std::string &buf() const { return buf_; }
+
+private:
+    const size_t fail_after_;
+    std::string buf_;
+}; // class StringWritableFile
+
+TEST(IOUtilsTest, AsyncWritableFile) {
+    StringWritableFile file;
+    std::string expected;
+    ThreadPool pool(2);
+    {
+        AsyncWritableFile async(&file, false, &pool);
+        for (int i = 0; i < 100000; ++i) {
+            std::string data(Sprintf("%d.", i));
+            data.resize(i % 17 + 1, 'x');
+            expected.append(data);
+            auto rs = async.Append(data);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+        uint64_t size = 0;
+        auto rs = async.GetFileSize(&size);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ(expected.size(), size);
+
+        rs = async.Append("tail");
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        expected.append("tail");
+    }
+    ASSERT_EQ(expected, file.buf());
+}
+
+TEST(IOUtilsTest, AsyncWritableFileError) {
+    StringWritableFile file(AsyncWritableFile::kBufferSize * 2);
+    ThreadPool pool(2);
+    AsyncWritableFile async(&file, false, &pool);
+    std::string data(AsyncWritableFile::kBufferSize, 'x');
+    for (int i = 0; i < 2; ++i) {
+        auto rs = async.Append(data);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    Error rs;
+    for (int i = 0; i < 16 && rs.ok(); ++i) {
+        rs = async.Append(data);
+    }
+    ASSERT_TRUE(rs.fail());
+    rs = async.Sync();
+    ASSERT_TRUE(rs.fail());
+    ASSERT_EQ(AsyncWritableFile::kBufferSize * 2, file.buf().size());
+}
+
+TEST(IOUtilsTest, AsyncWritableFileInBusyPool) {
+    StringWritableFile file;
+    ThreadPool pool(2);
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool release = false;
+    for (int i = 0; i < pool.n_threads(); ++i) {
+        pool.Schedule(ThreadPool::kHigh, [&] () {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] () { return release; });
+        });
+    }
     
+    // All threads be busy, the writing jobs can not start.
+    std::string data(AsyncWritableFile::kBufferSize, 'x');
+    {
+        AsyncWritableFile async(&file, false, &pool);
+        for (int i = 0; i < 8; ++i) {
+            auto rs = async.Append(data);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+    }
+    ASSERT_EQ(data.size() * 8, file.buf().size());
     
-    
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    pool.Shutdown();
+}
+
 } // namespace base
 
 } // namespace mai
@@ -2,7 +2,14 @@
 #define MAI_BASE_IO_UTILS_H_
 
 #include "mai/env.h"
+#include "mai/rate-limiter.h"
 #include "base/slice.h"
+#include "base/thread-pool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 
 namespace mai {
     
@@ -312,12 +319,252 @@ public:
         }
         return file_->Truncate(size);
     }
+    
+    virtual Error Allocate(uint64_t offset, uint64_t len) override {
+        return file_->Allocate(offset, len);
+    }
 
 private:
     WritableFile *const file_;
     const bool ownership_;
     std::string buf_;
 }; // class BufferedWritableFile
+
+// Request the bytes from rate limiter before appending them to file.
+class RateLimitedWritableFile final : public WritableFile {
+public:
+    RateLimitedWritableFile(WritableFile *file, bool ownership,
+                            RateLimiter *limiter, RateLimiter::IOPriority pri)
+        : file_(DCHECK_NOTNULL(file))
+        , ownership_(ownership)
+        , limiter_(DCHECK_NOTNULL(limiter))
+        , pri_(pri) {}
+
+    virtual ~RateLimitedWritableFile() {
+        if (ownership_) { delete file_; }
+    }
+
+    virtual Error Append(std::string_view data) override {
+        Request(data.size());
+        return file_->Append(data);
+    }
+
+    virtual Error PositionedAppend(std::string_view data,
+                                   uint64_t offset) override {
+        Request(data.size());
+        return file_->PositionedAppend(data, offset);
+    }
+
+    virtual Error Flush() override { return file_->Flush(); }
+
+    virtual Error Sync() override { return file_->Sync(); }
+
+    virtual Error GetFileSize(uint64_t *size) override {
+        return file_->GetFileSize(size);
+    }
+
+    virtual Error Truncate(uint64_t size) override {
+        return file_->Truncate(size);
+    }
+
+    virtual Error Allocate(uint64_t offset, uint64_t len) override {
+        return file_->Allocate(offset, len);
+    }
+
+private:
+    void Request(size_t n) {
+        while (n > 0) {
+            size_t bytes = std::min(n, limiter_->GetSingleBurstBytes());
+            limiter_->Request(bytes, pri_);
+            n -= bytes;
+        }
+    }
+
+    WritableFile *const file_;
+    const bool ownership_;
+    RateLimiter *const limiter_;
+    const RateLimiter::IOPriority pri_;
+}; // class RateLimitedWritableFile
+    
+// Hand the appended bytes to a job in pool, which writes them to the
+// delegated file. So the caller can build the next blocks when the previous
+// ones be written. At most kMaxPendingBuffers buffers be waiting.
+// The caller writes the pending buffers itself if the job has not started,
+// so it never be dead locked even if the caller runs in the same pool.
+class AsyncWritableFile final : public WritableFile {
+public:
+    static const int kBufferSize = 256 * base::kKB;
+    static const int kMaxPendingBuffers = 4;
+    
+    AsyncWritableFile(WritableFile *file, bool ownership, ThreadPool *pool,
+                      ThreadPool::Priority prio = ThreadPool::kHigh)
+        : file_(DCHECK_NOTNULL(file))
+        , ownership_(ownership)
+        , pool_(DCHECK_NOTNULL(pool))
+        , prio_(prio)
+        , state_(new State(file)) {}
+    
+    virtual ~AsyncWritableFile() {
+        Error rs = Drain();
+        if (!rs) {
+            LOG(ERROR) << "Write file fail! cause: " << rs.ToString();
+        }
+        {
+            std::unique_lock<std::mutex> lock(state_->mutex);
+            while (state_->writing) {
+                state_->cv.wait(lock);
+            }
+        }
+        if (ownership_) { delete file_; }
+    }
+    
+    virtual Error Append(std::string_view data) override {
+        buf_.append(data);
+        if (buf_.size() >= kBufferSize) {
+            return Submit();
+        }
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->error;
+    }
+    
+    virtual Error PositionedAppend(std::string_view data,
+                                   uint64_t offset) override {
+        Error rs = Drain();
+        if (!rs) {
+            return rs;
+        }
+        return file_->PositionedAppend(data, offset);
+    }
+    
+    virtual Error Flush() override {
+        Error rs = Drain();
+        if (!rs) {
+            return rs;
+        }
+        return file_->Flush();
+    }
+    
+    virtual Error Sync() override {
+        Error rs = Flush();
+        if (!rs) {
+            return rs;
+        }
+        return file_->Sync();
+    }
+    
+    virtual Error GetFileSize(uint64_t *size) override {
+        Error rs = Drain();
+        if (!rs) {
+            return rs;
+        }
+        return file_->GetFileSize(size);
+    }
+    
+    virtual Error Truncate(uint64_t size) override {
+        Error rs = Drain();
+        if (!rs) {
+            return rs;
+        }
+        return file_->Truncate(size);
+    }
+    
+    virtual Error Allocate(uint64_t offset, uint64_t len) override {
+        Error rs = Drain();
+        if (!rs) {
+            return rs;
+        }
+        return file_->Allocate(offset, len);
+    }
+    
+private:
+    // Shared with the job in pool. The job may run after this file be
+    // deleted, but it finds nothing pending and never touches the file.
+    struct State {
+        explicit State(WritableFile *f) : file(f) {}
+        
+        WritableFile *const file;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::string> pending;
+        bool writing = false;
+        bool scheduled = false; // Has a job in pool.
+        Error error;
+    }; // struct State
+    
+    // Hand buf_ to job, wait if too many buffers be pending.
+    Error Submit() {
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        while (state_->pending.size() >= kMaxPendingBuffers &&
+               state_->error.ok()) {
+            WaitOrWrite(state_.get(), &lock);
+        }
+        if (state_->error.ok()) {
+            state_->pending.push_back(std::move(buf_));
+            if (!state_->scheduled) {
+                state_->scheduled = true;
+                pool_->Schedule(prio_, [state = state_] () {
+                    Run(state.get());
+                });
+            }
+        }
+        buf_.clear();
+        return state_->error;
+    }
+    
+    // Submit buf_ and wait for all pending buffers be written.
+    Error Drain() {
+        if (!buf_.empty()) {
+            Error rs = Submit();
+            if (!rs) {
+                return rs;
+            }
+        }
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        while ((!state_->pending.empty() || state_->writing) &&
+               state_->error.ok()) {
+            WaitOrWrite(state_.get(), &lock);
+        }
+        return state_->error;
+    }
+    
+    static void Run(State *state) {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        while (!state->pending.empty()) {
+            WaitOrWrite(state, &lock);
+        }
+        state->scheduled = false;
+    }
+    
+    // REQUIRES: state->mutex.lock()
+    static void WaitOrWrite(State *state, std::unique_lock<std::mutex> *lock) {
+        if (state->writing || state->pending.empty()) {
+            state->cv.wait(*lock);
+            return;
+        }
+        // Only one writer at the same time, so the buffers be written in
+        // order.
+        std::string buf(std::move(state->pending.front()));
+        state->pending.pop_front();
+        if (state->error.ok()) {
+            state->writing = true;
+            lock->unlock();
+            Error rs = state->file->Append(buf);
+            lock->lock();
+            state->writing = false;
+            if (!rs) {
+                state->error = rs;
+            }
+        } // Drop the data after first error.
+        state->cv.notify_all();
+    }
+    
+    WritableFile *const file_;
+    const bool ownership_;
+    ThreadPool *const pool_;
+    const ThreadPool::Priority prio_;
+    std::string buf_; // Only be accessed by caller thread.
+    std::shared_ptr<State> state_;
+}; // class AsyncWritableFile
     
 } // namespace base
     
@@ -0,0 +1,82 @@
+#include "base/lz4.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <random>
+
+namespace mai {
+
+namespace base {
+
+static std::string RoundTrip(const std::string &input, size_t *compressed_size) {
+    std::string compressed(Lz4::MaxCompressedSize(input.size()), 0);
+    *compressed_size = Lz4::Compress(input.data(), input.size(), &compressed[0]);
+    EXPECT_LE(*compressed_size, compressed.size());
+
+    std::string output(input.size(), 0);
+    EXPECT_TRUE(Lz4::Uncompress(compressed.data(), *compressed_size,
+                                &output[0], output.size()));
+    return output;
+}
+
+TEST(Lz4Test, Sanity) {
+    size_t size;
+    ASSERT_EQ("", RoundTrip("", &size));
+    ASSERT_EQ("a", RoundTrip("a", &size));
+    ASSERT_EQ("hello, world", RoundTrip("hello, world", &size));
+
+    std::string input;
+    for (int i = 0; i < 1000; ++i) {
+        input.append("key-" + std::to_string(i % 37) + ":value;");
+    }
+    ASSERT_EQ(input, RoundTrip(input, &size));
+    ASSERT_LT(size, input.size() / 4);
+
+    input.assign(100000, 'x');
+    ASSERT_EQ(input, RoundTrip(input, &size));
+    ASSERT_LT(size, 1000);
+}
+
+TEST(Lz4Test, Incompressible) {
+    std::mt19937 rand(1);
+    std::string input;
+    for (int i = 0; i < 65536 + 100; ++i) {
+        input.push_back(static_cast<char>(rand()));
+    }
+    size_t size;
+    ASSERT_EQ(input, RoundTrip(input, &size));
+    ASSERT_LE(size, Lz4::MaxCompressedSize(input.size()));
+}
+
+TEST(Lz4Test, BrokenInput) {
+    std::string input;
+    for (int i = 0; i < 100; ++i) {
+        input.append("abcdefgh");
+    }
+    std::string compressed(Lz4::MaxCompressedSize(input.size()), 0);
+    size_t size = Lz4::Compress(input.data(), input.size(), &compressed[0]);
+    compressed.resize(size);
+
+    std::string output(input.size(), 0);
+    // Wrong uncompressed size.
+    ASSERT_FALSE(Lz4::Uncompress(compressed.data(), compressed.size(),
+                                 &output[0], output.size() - 1));
+    output.push_back(0);
+    ASSERT_FALSE(Lz4::Uncompress(compressed.data(), compressed.size(),
+                                 &output[0], output.size()));
+    output.pop_back();
+    // Truncated input.
+    for (size_t n = 0; n < compressed.size(); ++n) {
+        ASSERT_FALSE(Lz4::Uncompress(compressed.data(), n, &output[0],
+                                     output.size())) << n;
+    }
+    // Offset out of output: [token][8 literals][offset:2]...
+    std::string bad = compressed;
+    bad[9]  = static_cast<char>(0xff);
+    bad[10] = static_cast<char>(0xff);
+    ASSERT_FALSE(Lz4::Uncompress(bad.data(), bad.size(), &output[0],
+                                 output.size()));
+}
+
+} // namespace base
+
+} // namespace mai
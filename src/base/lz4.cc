@@ -0,0 +1,176 @@
+#include "base/lz4.h"
+#include <string.h>
+
+namespace mai {
+    
+namespace base {
+    
+static const int kHashBits = 12;
+static const size_t kMinMatch = 4;
+// The last 5 bytes always be literals, and the last match must start 12
+// bytes before end of input. It's required by LZ4 block format.
+static const size_t kLastLiterals = 5;
+static const size_t kMatchFindLimit = 12;
+static const size_t kMaxOffset = 65535;
+    
+static inline uint32_t Load32(const uint8_t *p) {
+    uint32_t v;
+    ::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t Hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - kHashBits);
+}
+    
+static inline uint8_t *WriteLength(uint8_t *op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = static_cast<uint8_t>(len);
+    return op;
+}
+    
+static inline uint8_t *WriteSequence(uint8_t *op, const uint8_t *literals,
+                                     size_t n_literals, size_t offset,
+                                     size_t match_len) {
+    uint8_t *token = op++;
+    *token = static_cast<uint8_t>((n_literals < 15 ? n_literals : 15) << 4);
+    if (n_literals >= 15) {
+        op = WriteLength(op, n_literals - 15);
+    }
+    ::memcpy(op, literals, n_literals);
+    op += n_literals;
+    if (match_len == 0) {
+        return op; // The last sequence only has literals.
+    }
+    *op++ = static_cast<uint8_t>(offset);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    
+    match_len -= kMinMatch;
+    *token |= static_cast<uint8_t>(match_len < 15 ? match_len : 15);
+    if (match_len >= 15) {
+        op = WriteLength(op, match_len - 15);
+    }
+    return op;
+}
+    
+/*static*/ size_t Lz4::Compress(const char *src, size_t n, char *dst) {
+    const uint8_t *const begin = reinterpret_cast<const uint8_t *>(src);
+    const uint8_t *const end = begin + n;
+    const uint8_t *ip = begin;
+    const uint8_t *anchor = begin;
+    uint8_t *op = reinterpret_cast<uint8_t *>(dst);
+    
+    if (n > kMatchFindLimit) {
+        const uint8_t *const match_limit = end - kLastLiterals;
+        const uint8_t *const find_limit = end - kMatchFindLimit;
+        uint32_t table[1 << kHashBits];
+        ::memset(table, 0, sizeof(table));
+        
+        ip++; // The position 0 has been in table.
+        while (ip < find_limit) {
+            const uint32_t seq = Load32(ip);
+            const uint32_t h = Hash4(seq);
+            const uint8_t *match = begin + table[h];
+            table[h] = static_cast<uint32_t>(ip - begin);
+            if (match >= ip || ip - match > kMaxOffset || Load32(match) != seq) {
+                ip++;
+                continue;
+            }
+            // Extend the match backward and forward.
+            while (ip > anchor && match > begin && ip[-1] == match[-1]) {
+                ip--;
+                match--;
+            }
+            const uint8_t *p = ip + kMinMatch;
+            const uint8_t *q = match + kMinMatch;
+            while (p < match_limit && *p == *q) {
+                p++;
+                q++;
+            }
+            op = WriteSequence(op, anchor, ip - anchor, ip - match, p - ip);
+            ip = p;
+            anchor = p;
+            if (ip < find_limit) {
+                table[Hash4(Load32(ip - 2))] = static_cast<uint32_t>(ip - 2 - begin);
+            }
+        }
+    }
+    op = WriteSequence(op, anchor, end - anchor, 0, 0);
+    return op - reinterpret_cast<uint8_t *>(dst);
+}
+    
+// Read the extra bytes of length, return false if input is broken.
+static inline bool ReadLength(const uint8_t **ip, const uint8_t *end,
+                              size_t *len) {
+    uint8_t b;
+    do {
+        if (*ip >= end) {
+            return false;
+        }
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+    
+/*static*/ bool Lz4::Uncompress(const char *src, size_t n, char *dst,
+                                size_t dst_size) {
+    const uint8_t *ip = reinterpret_cast<const uint8_t *>(src);
+    const uint8_t *const end = ip + n;
+    uint8_t *const begin = reinterpret_cast<uint8_t *>(dst);
+    uint8_t *op = begin;
+    uint8_t *const op_end = begin + dst_size;
+    
+    while (ip < end) {
+        const uint8_t token = *ip++;
+        size_t n_literals = token >> 4;
+        if (n_literals == 15 && !ReadLength(&ip, end, &n_literals)) {
+            return false;
+        }
+        if (n_literals > static_cast<size_t>(end - ip) ||
+            n_literals > static_cast<size_t>(op_end - op)) {
+            return false;
+        }
+        ::memcpy(op, ip, n_literals);
+        op += n_literals;
+        ip += n_literals;
+        if (ip == end) {
+            break; // The last sequence.
+        }
+        
+        if (end - ip < 2) {
+            return false;
+        }
+        const size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - begin)) {
+            return false;
+        }
+        size_t match_len = token & 0xf;
+        if (match_len == 15 && !ReadLength(&ip, end, &match_len)) {
+            return false;
+        }
+        match_len += kMinMatch;
+        if (match_len > static_cast<size_t>(op_end - op)) {
+            return false;
+        }
+        // The match can overlap with output, so copy it byte by byte.
+        const uint8_t *match = op - offset;
+        if (offset >= match_len) {
+            ::memcpy(op, match, match_len);
+            op += match_len;
+        } else {
+            for (size_t i = 0; i < match_len; ++i) {
+                *op++ = *match++;
+            }
+        }
+    }
+    return op == op_end;
+}
+    
+} // namespace base
+    
+} // namespace mai
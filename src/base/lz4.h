@@ -0,0 +1,35 @@
+#ifndef MAI_BASE_LZ4_H_
+#define MAI_BASE_LZ4_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mai {
+    
+namespace base {
+    
+// Compressor of LZ4 block format, the output can be uncompressed by the
+// standard LZ4_decompress_safe(), and vice versa. It's a fast greedy
+// compressor, no frame format and no dictionary.
+struct Lz4 {
+    // The max size of compressed output for n bytes input.
+    static size_t MaxCompressedSize(size_t n) { return n + n / 255 + 16; }
+    
+    // The max size of uncompressed output for n bytes compressed input, one
+    // byte of input can not expand to more than 255 bytes.
+    static size_t MaxUncompressedSize(size_t n) { return n * 255 + 16; }
+    
+    // REQUIRES: dst has MaxCompressedSize(n) bytes at least.
+    // Return the size of compressed output.
+    static size_t Compress(const char *src, size_t n, char *dst);
+    
+    // Uncompress exactly dst_size bytes to dst, return false if src is broken.
+    static bool Uncompress(const char *src, size_t n, char *dst,
+                           size_t dst_size);
+}; // struct Lz4
+    
+} // namespace base
+    
+} // namespace mai
+
+#endif // MAI_BASE_LZ4_H_
@@ -0,0 +1,117 @@
+#include "mai/rate-limiter.h"
+#include "mai/env.h"
+#include "base/io-utils.h"
+#include "base/base.h"
+#include "gtest/gtest.h"
+#include <thread>
+#include <atomic>
+
+namespace mai {
+
+namespace base {
+
+class RateLimiterTest : public ::testing::Test {
+public:
+    Env *env_ = Env::Default();
+}; // class RateLimiterTest
+
+TEST_F(RateLimiterTest, Sanity) {
+    // 1MB/s, 10ms
+    std::unique_ptr<RateLimiter> limiter(RateLimiter::NewGeneric(kMB, 10 * 1000));
+    ASSERT_EQ(kMB / 100, limiter->GetSingleBurstBytes());
+    ASSERT_EQ(kMB, limiter->GetBytesPerSecond());
+
+    const size_t burst = limiter->GetSingleBurstBytes();
+    uint64_t jiffies = env_->CurrentTimeMicros();
+    for (int i = 0; i < 40; ++i) {
+        limiter->Request(burst, RateLimiter::kIOPriorityCompaction);
+    }
+    jiffies = env_->CurrentTimeMicros() - jiffies;
+    // The first burst be granted without waiting.
+    ASSERT_GE(jiffies, 380 * 1000);
+
+    ASSERT_EQ(40 * burst, limiter->GetTotalBytes(RateLimiter::kIOPriorityCompaction));
+    ASSERT_GE(limiter->GetTotalBytesThrottled(RateLimiter::kIOPriorityCompaction),
+              39 * burst);
+    ASSERT_GT(limiter->GetTotalWaitMicros(RateLimiter::kIOPriorityCompaction), 0);
+    ASSERT_EQ(0, limiter->GetTotalBytes(RateLimiter::kIOPriorityWAL));
+}
+
+TEST_F(RateLimiterTest, Priority) {
+    // 100KB/s, 10ms
+    std::unique_ptr<RateLimiter> limiter(RateLimiter::NewGeneric(100 * kKB,
+                                                                 10 * 1000));
+    const size_t burst = limiter->GetSingleBurstBytes();
+    std::atomic<bool> wal_done(false);
+    std::atomic<bool> compaction_done_first(false);
+
+    std::thread compaction([&] () {
+        for (int i = 0; i < 50; ++i) {
+            limiter->Request(burst, RateLimiter::kIOPriorityCompaction);
+        }
+        compaction_done_first.store(!wal_done.load());
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::thread wal([&] () {
+        for (int i = 0; i < 10; ++i) {
+            limiter->Request(burst, RateLimiter::kIOPriorityWAL);
+        }
+        wal_done.store(true);
+    });
+    wal.join();
+    compaction.join();
+
+    // WAL requests bypass the waiting compaction requests.
+    ASSERT_FALSE(compaction_done_first.load());
+    ASSERT_LT(limiter->GetTotalWaitMicros(RateLimiter::kIOPriorityWAL),
+              limiter->GetTotalWaitMicros(RateLimiter::kIOPriorityCompaction));
+}
+
+TEST_F(RateLimiterTest, AutoTuned) {
+    // 10MB/s, 1ms, target latency: 100us
+    std::unique_ptr<RateLimiter> limiter(RateLimiter::NewGeneric(10 * kMB, 1000,
+                                                                 100));
+    for (int i = 0; i < 5; ++i) {
+        limiter->ReportLatency(1000);
+        std::this_thread::sleep_for(std::chrono::milliseconds(11));
+        limiter->Request(1, RateLimiter::kIOPriorityCompaction);
+    }
+    uint64_t rate = limiter->GetBytesPerSecond();
+    ASSERT_LT(rate, 10 * kMB);
+    ASSERT_GE(rate, 10 * kMB / 20);
+
+    // Low latency, the rate be raised.
+    for (int i = 0; i < 5; ++i) {
+        limiter->ReportLatency(10);
+        std::this_thread::sleep_for(std::chrono::milliseconds(11));
+        limiter->Request(1, RateLimiter::kIOPriorityCompaction);
+    }
+    ASSERT_GT(limiter->GetBytesPerSecond(), rate);
+    ASSERT_LE(limiter->GetBytesPerSecond(), 10 * kMB);
+}
+
+TEST_F(RateLimiterTest, RateLimitedWritableFile) {
+    static const char kFileName[] = "tests/34-rate-limited-file.tmp";
+    std::unique_ptr<RateLimiter> limiter(RateLimiter::NewGeneric(kMB, 10 * 1000));
+    std::unique_ptr<WritableFile> file;
+    Error rs = env_->NewWritableFile(kFileName, false, &file);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    RateLimitedWritableFile limited(file.release(), true, limiter.get(),
+                                    RateLimiter::kIOPriorityFlush);
+
+    // Larger than single burst bytes.
+    std::string data(100 * kKB, 'a');
+    rs = limited.Append(data);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    uint64_t size = 0;
+    rs = limited.GetFileSize(&size);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(data.size(), size);
+    ASSERT_EQ(data.size(), limiter->GetTotalBytes(RateLimiter::kIOPriorityFlush));
+
+    env_->DeleteFile(kFileName, false);
+}
+
+} // namespace base
+
+} // namespace mai
@@ -0,0 +1,208 @@
+#include "mai/rate-limiter.h"
+#include "mai/env.h"
+#include "base/base.h"
+#include "glog/logging.h"
+#include <condition_variable>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <algorithm>
+
+namespace mai {
+
+namespace base {
+
+class GenericRateLimiter final : public RateLimiter {
+public:
+    // Tune the rate every this number of refill periods.
+    static constexpr int kTunePeriods = 10;
+    // The min rate of tuning is 1/kMinRateDivisor of the max rate.
+    static constexpr int kMinRateDivisor = 20;
+
+    GenericRateLimiter(uint64_t bytes_per_second, uint64_t refill_period_micros,
+                       uint64_t target_latency_micros, Env *env)
+        : env_(env ? env : Env::Default())
+        , refill_period_micros_(std::max<uint64_t>(1, refill_period_micros))
+        , target_latency_micros_(target_latency_micros)
+        , max_rate_(std::max<uint64_t>(1, bytes_per_second))
+        , rate_(max_rate_) {
+        const uint64_t now = env_->CurrentTimeMicros();
+        available_   = RefillBytes();
+        next_refill_ = now + refill_period_micros_;
+        next_tune_   = now + refill_period_micros_ * kTunePeriods;
+        for (int i = 0; i < kNumIOPriorities; ++i) {
+            total_bytes_[i].store(0, std::memory_order_relaxed);
+            throttled_bytes_[i].store(0, std::memory_order_relaxed);
+            wait_micros_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    virtual ~GenericRateLimiter() override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (const auto &queue : queues_) {
+            DCHECK(queue.empty());
+        }
+    }
+
+    virtual void Request(size_t bytes, IOPriority pri) override {
+        DCHECK_GE(pri, 0);
+        DCHECK_LT(pri, kNumIOPriorities);
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t now = env_->CurrentTimeMicros();
+        MaybeTune(now);
+        if (now >= next_refill_) {
+            Refill(now);
+            cv_.notify_all();
+        }
+        total_bytes_[pri].fetch_add(bytes, std::memory_order_relaxed);
+
+        bytes = std::min(bytes, RefillBytes());
+        if (QueuesEmpty() && available_ >= bytes) {
+            available_ -= bytes;
+            return;
+        }
+
+        // Wait for refilling, the requests be granted by priority.
+        const uint64_t start = now;
+        Req req{bytes, false};
+        queues_[pri].push_back(&req);
+        while (!req.granted) {
+            now = env_->CurrentTimeMicros();
+            if (now >= next_refill_) {
+                Refill(now);
+                cv_.notify_all();
+                continue;
+            }
+            cv_.wait_for(lock, std::chrono::microseconds(next_refill_ - now));
+        }
+        throttled_bytes_[pri].fetch_add(bytes, std::memory_order_relaxed);
+        wait_micros_[pri].fetch_add(env_->CurrentTimeMicros() - start,
+                                    std::memory_order_relaxed);
+    }
+
+    virtual size_t GetSingleBurstBytes() const override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return RefillBytes();
+    }
+
+    virtual uint64_t GetBytesPerSecond() const override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return rate_;
+    }
+
+    virtual void SetBytesPerSecond(uint64_t bytes_per_second) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        max_rate_ = std::max<uint64_t>(1, bytes_per_second);
+        rate_     = max_rate_;
+    }
+
+    virtual void ReportLatency(uint64_t micros) override {
+        latency_sum_.fetch_add(micros, std::memory_order_relaxed);
+        latency_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    virtual uint64_t GetTotalBytes(IOPriority pri) const override {
+        return total_bytes_[pri].load(std::memory_order_relaxed);
+    }
+
+    virtual uint64_t GetTotalBytesThrottled(IOPriority pri) const override {
+        return throttled_bytes_[pri].load(std::memory_order_relaxed);
+    }
+
+    virtual uint64_t GetTotalWaitMicros(IOPriority pri) const override {
+        return wait_micros_[pri].load(std::memory_order_relaxed);
+    }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(GenericRateLimiter);
+private:
+    struct Req {
+        size_t bytes;
+        bool   granted;
+    }; // struct Req
+
+    // REQUIRES: mutex_.lock()
+    size_t RefillBytes() const {
+        return std::max<uint64_t>(1, rate_ * refill_period_micros_ / 1000000);
+    }
+
+    // REQUIRES: mutex_.lock()
+    bool QueuesEmpty() const {
+        for (const auto &queue : queues_) {
+            if (!queue.empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Add tokens of elapsed periods, then grant the waiting requests. The
+    // lower priority ones can not bypass a higher priority one.
+    // REQUIRES: mutex_.lock()
+    void Refill(uint64_t now) {
+        const uint64_t periods = (now - next_refill_) / refill_period_micros_ + 1;
+        const size_t burst = RefillBytes();
+        available_ = std::min<uint64_t>(available_ + periods * burst, burst);
+        next_refill_ += periods * refill_period_micros_;
+
+        for (auto &queue : queues_) {
+            while (!queue.empty()) {
+                Req *req = queue.front();
+                // The rate may be reduced after the request be queued.
+                const size_t bytes = std::min(req->bytes, burst);
+                if (available_ < bytes) {
+                    return;
+                }
+                available_ -= bytes;
+                req->granted = true;
+                queue.pop_front();
+            }
+        }
+    }
+
+    // REQUIRES: mutex_.lock()
+    void MaybeTune(uint64_t now) {
+        if (target_latency_micros_ == 0 || now < next_tune_) {
+            return;
+        }
+        next_tune_ = now + refill_period_micros_ * kTunePeriods;
+        const uint64_t sum   = latency_sum_.exchange(0, std::memory_order_relaxed);
+        const uint64_t count = latency_count_.exchange(0, std::memory_order_relaxed);
+        const uint64_t min_rate = std::max<uint64_t>(1, max_rate_ / kMinRateDivisor);
+        if (count > 0 && sum / count > target_latency_micros_) {
+            rate_ = std::max(min_rate, rate_ - rate_ / 5);
+        } else if (count == 0 || sum / count < target_latency_micros_ / 2) {
+            rate_ = std::min(max_rate_, rate_ + std::max<uint64_t>(1, rate_ / 4));
+        }
+    }
+
+    Env *const env_;
+    const uint64_t refill_period_micros_;
+    const uint64_t target_latency_micros_;
+    uint64_t max_rate_;
+    uint64_t rate_;
+    uint64_t available_ = 0;
+    uint64_t next_refill_ = 0;
+    uint64_t next_tune_ = 0;
+    std::deque<Req *> queues_[kNumIOPriorities];
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+
+    std::atomic<uint64_t> latency_sum_ = 0;
+    std::atomic<uint64_t> latency_count_ = 0;
+    std::atomic<uint64_t> total_bytes_[kNumIOPriorities];
+    std::atomic<uint64_t> throttled_bytes_[kNumIOPriorities];
+    std::atomic<uint64_t> wait_micros_[kNumIOPriorities];
+}; // class GenericRateLimiter
+
+} // namespace base
+
+/*static*/ RateLimiter *RateLimiter::NewGeneric(uint64_t bytes_per_second,
+                                                uint64_t refill_period_micros,
+                                                uint64_t target_latency_micros,
+                                                Env *env) {
+    return new base::GenericRateLimiter(bytes_per_second, refill_period_micros,
+                                        target_latency_micros, env);
+}
+
+} // namespace mai
@@ -1,3 +1,4 @@
+#include "base/thread-pool.h"
 #include "base/base.h"
 #include "gtest/gtest.h"
 #include <thread>
@@ -113,6 +114,74 @@ TEST(ThreadPool, BlockingQueue1To4) {
     }
 }
     
+TEST(ThreadPool, ScheduleJobs) {
+    std::atomic<int> n(0);
+    ThreadPool pool(4);
+    for (int i = 0; i < 1000; ++i) {
+        pool.Schedule(i % 2 ? ThreadPool::kLow : ThreadPool::kHigh,
+                      [&n] () { n.fetch_add(1); });
+    }
+    pool.Shutdown();
+    ASSERT_EQ(1000, n.load());
+    ASSERT_EQ(0, pool.queued(ThreadPool::kHigh));
+    ASSERT_EQ(0, pool.queued(ThreadPool::kLow));
+}
+    
+static void RunHighPriorityNotStarved(ThreadPool *pool) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool release = false;
+    
+    // Low priority jobs can not occupy all threads.
+    for (int i = 0; i < pool->n_threads() * 2; ++i) {
+        pool->Schedule(ThreadPool::kLow, [&] () {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] () { return release; });
+        });
+    }
+    std::promise<void> high_done;
+    pool->Schedule(ThreadPool::kHigh, [&] () { high_done.set_value(); });
+    high_done.get_future().wait();
+    ASSERT_LE(pool->running(ThreadPool::kLow), pool->n_threads() - 1);
+    
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    pool->Shutdown();
+}
+    
+TEST(ThreadPool, HighPriorityNotStarved) {
+    for (int n_threads : {1, 2, 4}) {
+        ThreadPool pool(n_threads);
+        ASSERT_EQ(std::max(n_threads, 2), pool.n_threads());
+        RunHighPriorityNotStarved(&pool);
+    }
+}
+    
+TEST(ThreadPool, ParallelRun) {
+    ThreadPool pool(2);
+    std::vector<int> results(100, 0);
+    pool.ParallelRun(ThreadPool::kLow, results.size(), [&results] (size_t i) {
+        results[i] = static_cast<int>(i) * 2;
+    });
+    for (size_t i = 0; i < results.size(); ++i) {
+        ASSERT_EQ(static_cast<int>(i) * 2, results[i]);
+    }
+    
+    // Nested in a pool job, all low priority threads be busy.
+    std::atomic<int> n(0);
+    std::promise<void> done;
+    pool.Schedule(ThreadPool::kLow, [&] () {
+        pool.ParallelRun(ThreadPool::kLow, 8, [&n] (size_t) { n.fetch_add(1); });
+        done.set_value();
+    });
+    done.get_future().wait();
+    ASSERT_EQ(8, n.load());
+    pool.Shutdown();
+}
+    
 }
     
 }
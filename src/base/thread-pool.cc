@@ -0,0 +1,124 @@
+#include "base/thread-pool.h"
+#include "glog/logging.h"
+#include <algorithm>
+
+namespace mai {
+
+namespace base {
+
+ThreadPool::ThreadPool(int n_threads)
+    : n_threads_(std::max(n_threads, 2))
+    , max_low_running_(n_threads_ - 1) {
+    DCHECK_GT(n_threads, 0);
+    for (int i = 0; i < n_threads_; ++i) {
+        workers_.emplace_back([this] () { this->WorkerMain(); });
+    }
+}
+
+ThreadPool::~ThreadPool() { Shutdown(); }
+
+void ThreadPool::Schedule(Priority prio, Job &&job) {
+    DCHECK_GE(prio, 0);
+    DCHECK_LT(prio, kMaxPriority);
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Running jobs can still schedule jobs in shutting down, they will be
+    // taken before the worker threads exit.
+    queues_[prio].push_back(std::move(job));
+    cv_.notify_all();
+}
+
+namespace {
+
+struct ParallelRunState {
+    std::function<void (size_t)> job;
+    size_t n;
+    std::atomic<size_t> next{0};
+    size_t n_done = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
+}; // struct ParallelRunState
+
+} // namespace
+
+void ThreadPool::ParallelRun(Priority prio, size_t n,
+                             std::function<void (size_t)> &&job) {
+    auto state = std::make_shared<ParallelRunState>();
+    state->job = std::move(job);
+    state->n   = n;
+    // The late pool jobs find nothing to do, and never touch the caller's
+    // stack.
+    auto run = [state] () {
+        size_t i;
+        while ((i = state->next.fetch_add(1)) < state->n) {
+            state->job(i);
+            std::unique_lock<std::mutex> lock(state->mutex);
+            if (++state->n_done == state->n) {
+                state->cv.notify_all();
+            }
+        }
+    };
+    size_t n_helpers = std::min(n, static_cast<size_t>(n_threads_));
+    for (size_t i = 1; i < n_helpers; ++i) {
+        Schedule(prio, run);
+    }
+    run();
+    
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&state] () { return state->n_done == state->n; });
+}
+
+void ThreadPool::Shutdown() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (shutting_down_) {
+            return;
+        }
+        shutting_down_ = true;
+        cv_.notify_all();
+    }
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+void ThreadPool::WorkerMain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        Priority prio;
+        Job job;
+        if (!Pick(&prio, &job)) {
+            if (shutting_down_ && queues_[kHigh].empty() &&
+                queues_[kLow].empty()) {
+                break;
+            }
+            cv_.wait(lock);
+            continue;
+        }
+        running_[prio]++;
+        lock.unlock();
+        job();
+        lock.lock();
+        running_[prio]--;
+        // The low priority jobs may be waiting for free thread.
+        cv_.notify_all();
+    }
+}
+
+// REQUIRES: mutex_.lock()
+bool ThreadPool::Pick(Priority *prio, Job *job) {
+    if (!queues_[kHigh].empty()) {
+        *prio = kHigh;
+    } else if (!queues_[kLow].empty() && running_[kLow] < max_low_running_) {
+        *prio = kLow;
+    } else {
+        return false;
+    }
+    *job = std::move(queues_[*prio].front());
+    queues_[*prio].pop_front();
+    return true;
+}
+
+} // namespace base
+
+} // namespace mai
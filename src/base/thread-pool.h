@@ -0,0 +1,79 @@
+#ifndef MAI_BASE_THREAD_POOL_H_
+#define MAI_BASE_THREAD_POOL_H_
+
+#include "base/base.h"
+#include <functional>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <deque>
+#include <vector>
+
+namespace mai {
+
+namespace base {
+
+// Fixed size thread pool with two priorities.
+// High priority jobs always be taken first. Low priority jobs can not occupy
+// all threads, so high priority jobs never be starved by them.
+// There are 2 threads at least, one of them be reserved for high priority.
+class ThreadPool final {
+public:
+    enum Priority {
+        kHigh,
+        kLow,
+        kMaxPriority,
+    };
+
+    using Job = std::function<void ()>;
+
+    explicit ThreadPool(int n_threads);
+    ~ThreadPool();
+
+    DEF_VAL_GETTER(int, n_threads);
+
+    void Schedule(Priority prio, Job &&job);
+    
+    // Run job(0) ... job(n - 1) in the calling thread and pool threads, and
+    // wait for all of them done. The calling thread also takes the jobs, so
+    // it never be dead locked even if it runs in this pool.
+    void ParallelRun(Priority prio, size_t n,
+                     std::function<void (size_t)> &&job);
+
+    // Wait for all queued and running jobs done, then stop all threads.
+    void Shutdown();
+
+    int queued(Priority prio) const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return static_cast<int>(queues_[prio].size());
+    }
+
+    int running(Priority prio) const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return running_[prio];
+    }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ThreadPool);
+private:
+    void WorkerMain();
+
+    // REQUIRES: mutex_.lock()
+    bool Pick(Priority *prio, Job *job);
+
+    const int n_threads_;
+    const int max_low_running_;
+    bool shutting_down_ = false;
+    std::deque<Job> queues_[kMaxPriority];
+    int running_[kMaxPriority] = {0, 0};
+    std::vector<std::thread> workers_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+}; // class ThreadPool
+
+} // namespace base
+
+} // namespace mai
+
+#endif // MAI_BASE_THREAD_POOL_H_
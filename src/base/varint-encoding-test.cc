@@ -50,6 +50,21 @@ TEST_P(Varint32Test, Encoding) {
     EXPECT_EQ(encode_len, len);
 }
 
+TEST(VarintTest, BoundedDecode) {
+    char buf[Varint32::kMaxLen];
+    size_t encode_len = Varint32::Encode(buf, 1 << 21);
+    
+    uint32_t value = 0;
+    size_t len = 0;
+    EXPECT_TRUE(Varint32::Decode(buf, encode_len, &value, &len));
+    EXPECT_EQ(1 << 21, value);
+    EXPECT_EQ(encode_len, len);
+    EXPECT_FALSE(Varint32::Decode(buf, encode_len - 1, &value, &len));
+    
+    const char bad[] = "\xff\xff\xff\xff\xff\xff";
+    EXPECT_FALSE(Varint32::Decode(bad, sizeof(bad), &value, &len));
+}
+
 class Varint64Test : public ::testing::TestWithParam<uint64_t> {
 };
 
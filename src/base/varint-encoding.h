@@ -34,6 +34,20 @@ struct Varint32 {
     static uint32_t Decode(const void *buf, size_t *len) {
         return static_cast<uint32_t>(Varint64::Decode(buf, len));
     }
+    
+    // Read limit bytes at most, return false if the value does not end in
+    // them or in kMaxLen bytes.
+    static bool Decode(const void *buf, size_t limit, uint32_t *value,
+                       size_t *len) {
+        auto in = static_cast<const uint8_t *>(buf);
+        for (size_t i = 0; i < limit && i < kMaxLen; ++i) {
+            if (in[i] < 0x80) {
+                *value = Decode(buf, len);
+                return true;
+            }
+        }
+        return false;
+    }
 
     static size_t Sizeof(uint32_t value) {
         if (value == 0) {
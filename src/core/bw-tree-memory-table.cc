@@ -1,6 +1,7 @@
 #include "core/bw-tree-memory-table.h"
 #include "mai/env.h"
 #include "mai/iterator.h"
+#include "mai/pinnable-value.h"
 
 
 namespace mai {
@@ -10,7 +11,8 @@ namespace core {
 class BwTreeMemoryTable::IteratorImpl final : public Iterator {
 public:
     IteratorImpl(const BwTreeMemoryTable *bmt)
-        : iter_(&bmt->table_) {}
+        : owns_(bmt)
+        , iter_(&bmt->table_) {}
     
     virtual bool Valid() const override { return iter_.Valid(); }
     virtual void SeekToFirst() override { iter_.SeekToFirst(); }
@@ -34,12 +36,18 @@ public:
     virtual std::string_view value() const override {
         return iter_.key()->value();
     }
+    virtual void PinValue(PinnableValue *result) const override {
+        owns_->AddRef();
+        result->Pin(iter_.key()->value(), &Cleanup,
+                    const_cast<BwTreeMemoryTable *>(owns_));
+    }
     virtual Error error() const override { return error_; }
     
     static void Cleanup(void *arg1, void */*arg2*/) {
         DCHECK_NOTNULL(static_cast<BwTreeMemoryTable *>(arg1))->ReleaseRef();
     }
 private:
+    const BwTreeMemoryTable *const owns_;
     Table::Iterator iter_;
     Error error_;
 }; // class BwTreeMemoryTable::IteratorImpl
@@ -63,7 +71,7 @@ void BwTreeMemoryTable::Put(std::string_view key, std::string_view value,
 
 /*virtual*/
 Error BwTreeMemoryTable::Get(std::string_view key, SequenceNumber version,
-                             Tag *tag, std::string *value) const {
+                             Tag *tag, std::string_view *value) const {
     base::ScopedMemory scope;
     const KeyBoundle *ikey = KeyBoundle::New(key, version,
                                              base::ScopedAllocator{&scope});
@@ -78,7 +86,7 @@ Error BwTreeMemoryTable::Get(std::string_view key, SequenceNumber version,
     }
     switch (iter.key()->tag().flag()) {
         case Tag::kFlagValue:
-            value->assign(iter.key()->value());
+            *value = iter.key()->value();
             break;
         case Tag::kFlagDeletion:
             break;
@@ -17,8 +17,9 @@ public:
     
     virtual void Put(std::string_view key, std::string_view value,
                      SequenceNumber version, uint8_t flag) override;
+    using MemoryTable::Get;
     virtual Error Get(std::string_view key, SequenceNumber version, Tag *tag,
-                      std::string *value) const override;
+                      std::string_view *value) const override;
     virtual Iterator *NewIterator() override;
     virtual size_t NumEntries() const override;
     virtual size_t ApproximateMemoryUsage() const override;
@@ -7,6 +7,20 @@ Env::Env() {}
     
 /*virtual*/ Env::~Env() {}
     
+/*virtual*/
+Error Env::NewDirectRandomAccessFile(const std::string &file_name,
+                                     std::unique_ptr<RandomAccessFile> *file) {
+    return NewRandomAccessFile(file_name, file, false);
+}
+    
+/*virtual*/ Error Env::RenameFile(const std::string &from, const std::string &to) {
+    return MAI_NOT_SUPPORTED("RenameFile()");
+}
+    
+/*virtual*/ Error Env::LinkFile(const std::string &from, const std::string &to) {
+    return MAI_NOT_SUPPORTED("LinkFile()");
+}
+    
 /*virtual*/ uint64_t Env::CurrentTimeMicros() {
     using namespace std::chrono;
     
@@ -16,8 +30,27 @@ Env::Env() {}
 
 /*virtual*/ WritableFile::~WritableFile() {}
     
+/*virtual*/ Error WritableFile::Allocate(uint64_t offset, uint64_t len) {
+    return Error::OK();
+}
+    
 /*virtual*/ RandomAccessFile::~RandomAccessFile() {}
     
+/*virtual*/ void RandomAccessFile::MultiRead(ReadRequest *reqs, size_t n,
+                                             const ParallelRunner &runner) {
+    auto read = [this, reqs] (size_t i) {
+        reqs[i].rs = Read(reqs[i].offset, reqs[i].n, &reqs[i].result,
+                          reqs[i].scratch);
+    };
+    if (runner && n > 1) {
+        runner(n, read);
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        read(i);
+    }
+}
+    
 /*virtual*/ ThreadLocalSlot::~ThreadLocalSlot() {}
     
 } // namespace mai
@@ -43,6 +43,10 @@ IteratorWarpper::~IteratorWarpper() {}
     return delegated_->value();
 }
 
+/*virtual*/ void IteratorWarpper::PinValue(PinnableValue *result) const {
+    delegated_->PinValue(result);
+}
+
 /*virtual*/ Error IteratorWarpper::error() const {
     return delegated_->error();
 }
@@ -23,6 +23,7 @@ public:
     virtual void Prev() override;
     virtual std::string_view key() const override;
     virtual std::string_view value() const override;
+    virtual void PinValue(PinnableValue *result) const override;
     virtual Error error() const override;
 
     DISALLOW_IMPLICIT_CONSTRUCTORS(IteratorWarpper);
@@ -1,4 +1,5 @@
 #include "mai/iterator.h"
+#include "mai/pinnable-value.h"
 #include "base/base.h"
 #include "glog/logging.h"
 
@@ -35,6 +36,28 @@ private:
     
     Error error_;
 }; // class ErrorInternalIterator
+    
+class EmptyIterator : public Iterator {
+public:
+    EmptyIterator() {}
+    virtual ~EmptyIterator() {}
+    
+    virtual bool Valid() const override { return false; }
+    virtual void SeekToFirst() override {}
+    virtual void SeekToLast() override {}
+    virtual void Seek(std::string_view) override {}
+    virtual void Next() override { NOREACHED(); }
+    virtual void Prev() override { NOREACHED(); }
+    virtual std::string_view key() const override {
+        NOREACHED(); return "";
+    }
+    virtual std::string_view value() const override {
+        NOREACHED(); return "";
+    }
+    virtual Error error() const override { return Error::OK(); }
+    
+    DISALLOW_IMPLICIT_CONSTRUCTORS(EmptyIterator);
+}; // class EmptyIterator
 
 } // namespace
 
@@ -42,9 +65,17 @@ private:
     
 /*virtual*/ Iterator::~Iterator() { DoCleanup(); }
     
+/*virtual*/ void Iterator::PinValue(PinnableValue *result) const {
+    result->Assign(value());
+}
+    
 /*static*/ Iterator *Iterator::AsError(Error error) {
     DCHECK(error.fail());
     return new core::ErrorInternalIterator(error);
 }
     
+/*static*/ Iterator *Iterator::AsEmpty() {
+    return new core::EmptyIterator();
+}
+    
 } // namespace mai
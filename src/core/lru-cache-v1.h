@@ -28,10 +28,22 @@ struct LRUHandle {
     
     bool is_deletion() const { return flags.load() & 0x1; }
     void set_deletion(bool val) { set_flags(val, 0x1); }
+    // Detached handle is not owned by any cache, it will be freed when the
+    // last reference released.
+    bool is_detached() const { return flags.load() & 0x2; }
+    void set_detached(bool val) { set_flags(val, 0x2); }
     void set_flags(bool val, uint32_t bits);
     
     void AddRef() { refs.fetch_add(1); }
-    bool ReleaseRef() { return refs.fetch_sub(1) == 1; }
+    bool ReleaseRef() {
+        if (refs.fetch_sub(1) == 1) {
+            if (is_detached()) {
+                Free(this);
+            }
+            return true;
+        }
+        return false;
+    }
     int ref_count() const { return refs.load(); }
     
     static LRUHandle *New(std::string_view key, size_t value_size,
@@ -1,4 +1,5 @@
 #include "core/memory-table.h"
+#include "glog/logging.h"
 
 namespace mai {
     
@@ -6,9 +7,30 @@ namespace core {
 
 /*virtual*/ MemoryTable::~MemoryTable() {}
 
+Error MemoryTable::Get(std::string_view key, SequenceNumber version, Tag *tag,
+                       std::string *value) const {
+    std::string_view result;
+    Tag result_tag;
+    Error rs = Get(key, version, &result_tag, &result);
+    if (rs.ok() && result_tag.flag() == Tag::kFlagValue) {
+        value->assign(result.data(), result.size());
+    }
+    if (tag) {
+        *tag = result_tag;
+    }
+    return rs;
+}
+
+/*virtual*/ void MemoryTable::ConcurrentPut(std::string_view /*key*/,
+                                           std::string_view /*value*/,
+                                           SequenceNumber /*version*/,
+                                           uint8_t /*flag*/) {
+    NOREACHED() << "Concurrent put not supported.";
+}
+    
 /*virtual*/ bool MemoryTable::KeyExists(std::string_view key,
                                         SequenceNumber version) const {
-    std::string value;
+    std::string_view value;
     Error rs = Get(key, version, nullptr, &value);
     return rs.ok();
 }
@@ -18,9 +18,21 @@ public:
     
     virtual void Put(std::string_view key, std::string_view value,
                      SequenceNumber version, uint8_t flag) = 0;
+    
+    // Can ConcurrentPut() be called by many threads at the same time?
+    virtual bool concurrent_put_supported() const { return false; }
+    
+    // REQUIRES: concurrent_put_supported()
+    virtual void ConcurrentPut(std::string_view key, std::string_view value,
+                               SequenceNumber version, uint8_t flag);
 
+    // The value points to memory of this table, it's valid until the table
+    // be released.
     virtual Error Get(std::string_view key, SequenceNumber version, Tag *tag,
-                      std::string *value) const = 0;
+                      std::string_view *value) const = 0;
+    
+    Error Get(std::string_view key, SequenceNumber version, Tag *tag,
+              std::string *value) const;
     
     virtual Iterator *NewIterator() = 0;
     
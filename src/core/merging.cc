@@ -104,6 +104,11 @@ public:
         return current_->value();
     }
     
+    virtual void PinValue(PinnableValue *result) const override {
+        DCHECK(Valid());
+        current_->PinValue(result);
+    }
+    
     virtual Error error() const override {
         for (size_t i = 0; i < n_children_; ++i) {
             Iterator *child = &children_[i];
@@ -173,6 +173,76 @@ TEST_F(OrderedMemoryTableTest, BatchPut) {
     printf("get cost: %f\n", cost);
 }
     
+TEST_F(OrderedMemoryTableTest, HashIndex) {
+    auto table = base::MakeRef(new OrderedMemoryTable(&ikcmp_, 7));
+    table->Put("aaaa", "v1", 1, Tag::kFlagValue);
+    table->Put("bbbb", "v2", 2, Tag::kFlagValue);
+    table->Put("aaaa", "v3", 3, Tag::kFlagValue);
+    table->Put("bbbb", "", 4, Tag::kFlagDeletion);
+    for (int i = 0; i < 100; ++i) {
+        table->Put(base::Sprintf("k.%d", i), "v", 5 + i, Tag::kFlagValue);
+    }
+    
+    std::string value;
+    Tag tag;
+    Error rs = table->Get("aaaa", 100, &tag, &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("v3", value);
+    ASSERT_EQ(3, tag.sequence_number());
+    
+    // The older version be found by skip list.
+    rs = table->Get("aaaa", 2, &tag, &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("v1", value);
+    rs = table->Get("aaaa", 0, &tag, &value);
+    ASSERT_TRUE(rs.IsNotFound()) << rs.ToString();
+    
+    rs = table->Get("bbbb", 100, &tag, &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(Tag::kFlagDeletion, tag.flag());
+    
+    rs = table->Get("cccc", 100, &tag, &value);
+    ASSERT_TRUE(rs.IsNotFound()) << rs.ToString();
+    for (int i = 0; i < 100; ++i) {
+        rs = table->Get(base::Sprintf("k.%d", i), 200, &tag, &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ(5 + i, tag.sequence_number());
+    }
+}
+    
+TEST_F(OrderedMemoryTableTest, ConcurrentPutHashIndex) {
+    static const int kN = 1000;
+    static const int kThreads = 4;
+    
+    auto table = base::MakeRef(new OrderedMemoryTable(&ikcmp_, 101));
+    ASSERT_TRUE(table->concurrent_put_supported());
+    std::thread threads[kThreads];
+    for (int i = 0; i < kThreads; ++i) {
+        // All threads put the same keys with different versions.
+        threads[i] = std::thread([&table](int slot) {
+            for (int j = 0; j < kN; ++j) {
+                table->ConcurrentPut(base::Sprintf("k.%d", j),
+                                     base::Sprintf("v.%d", slot),
+                                     j * kThreads + slot + 1, Tag::kFlagValue);
+            }
+        }, i);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(kN * kThreads, table->NumEntries());
+    
+    std::string value;
+    Tag tag;
+    for (int j = 0; j < kN; ++j) {
+        Error rs = table->Get(base::Sprintf("k.%d", j), kN * kThreads, &tag,
+                              &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ(base::Sprintf("v.%d", kThreads - 1), value);
+        ASSERT_EQ((j + 1) * kThreads, tag.sequence_number());
+    }
+}
+    
 } // namespace core
     
 } // namespace mai
@@ -1,6 +1,7 @@
 #include "core/ordered-memory-table.h"
 #include "base/reference-count.h"
 #include "mai/iterator.h"
+#include "mai/pinnable-value.h"
 
 namespace mai {
     
@@ -9,7 +10,8 @@ namespace core {
 class OrderedMemoryTable::IteratorImpl final : public Iterator {
 public:
     IteratorImpl(const OrderedMemoryTable *omt)
-        : iter_(&omt->table_) {}
+        : owns_(omt)
+        , iter_(&omt->table_) {}
     
     virtual bool Valid() const override { return iter_.Valid(); }
     virtual void SeekToFirst() override { iter_.SeekToFirst(); }
@@ -33,6 +35,11 @@ public:
     virtual std::string_view value() const override {
         return iter_.key()->value();
     }
+    virtual void PinValue(PinnableValue *result) const override {
+        owns_->AddRef();
+        result->Pin(iter_.key()->value(), &Cleanup,
+                    const_cast<OrderedMemoryTable *>(owns_));
+    }
     virtual Error error() const override { return error_; }
     
     static void Cleanup(void *arg1, void */*arg2*/) {
@@ -44,13 +51,23 @@ private:
         NOREACHED();
     }
     
+    const OrderedMemoryTable *const owns_;
     Table::Iterator iter_;
     Error error_;
 }; // class UnorderedMemoryTable::IteratorImpl
     
-OrderedMemoryTable::OrderedMemoryTable(const InternalKeyComparator *ikcmp)
+OrderedMemoryTable::OrderedMemoryTable(const InternalKeyComparator *ikcmp,
+                                       size_t hash_index_slots)
     : table_(KeyComparator{ikcmp}, &arena_)
+    , n_index_slots_(hash_index_slots)
     , n_entries_(0) {
+    if (n_index_slots_ > 0) {
+        index_ = static_cast<std::atomic<IndexNode *> *>(
+            arena_.Allocate(sizeof(*index_) * n_index_slots_));
+        for (size_t i = 0; i < n_index_slots_; ++i) {
+            new (&index_[i]) std::atomic<IndexNode *>(nullptr);
+        }
+    }
 }
 
 /*virtual*/ OrderedMemoryTable::~OrderedMemoryTable() {
@@ -64,36 +81,64 @@ OrderedMemoryTable::Put(std::string_view key, std::string_view value,
                                              base::DelegatedAllocator{&arena_});
     //const KeyBoundle *ikey = KeyBoundle::New(key, value, version, flag);
     table_.Put(DCHECK_NOTNULL(ikey));
+    if (index_) {
+        UpdateIndex(ikey);
+    }
     n_entries_.fetch_add(1);
 }
     
+/*virtual*/ void
+OrderedMemoryTable::ConcurrentPut(std::string_view key, std::string_view value,
+                                  SequenceNumber version, uint8_t flag) {
+    const KeyBoundle *ikey = KeyBoundle::New(key, value, version, flag,
+                                             base::DelegatedAllocator{&arena_});
+    table_.PutConcurrently(DCHECK_NOTNULL(ikey));
+    if (index_) {
+        UpdateIndex(ikey);
+    }
+    n_entries_.fetch_add(1, std::memory_order_relaxed);
+}
+    
 /*virtual*/ Error
 OrderedMemoryTable::Get(std::string_view key, SequenceNumber version, Tag *tag,
-                        std::string *value) const {
-    base::ScopedMemory scope;
-    const KeyBoundle *ikey = KeyBoundle::New(key, version,
-                                             base::ScopedAllocator{&scope});
-    Table::Iterator iter(&table_);
-    iter.Seek(ikey);
-    
-    if (!iter.Valid()) {
-        return MAI_NOT_FOUND("Can not seek key.");
+                        std::string_view *value) const {
+    const KeyBoundle *found = nullptr;
+    if (index_) {
+        found = FindNewest(key);
+        if (!found) {
+            return MAI_NOT_FOUND("Key not in index.");
+        }
+        if (found->tag().sequence_number() > version) {
+            found = nullptr; // Need an older version, search skip list.
+        }
     }
-    if (iter.key()->user_key() != key) {
-        return MAI_NOT_FOUND("Key not equals target.");
+    if (!found) {
+        base::ScopedMemory scope;
+        const KeyBoundle *ikey = KeyBoundle::New(key, version,
+                                                 base::ScopedAllocator{&scope});
+        Table::Iterator iter(&table_);
+        iter.Seek(ikey);
+        
+        if (!iter.Valid()) {
+            return MAI_NOT_FOUND("Can not seek key.");
+        }
+        if (iter.key()->user_key() != key) {
+            return MAI_NOT_FOUND("Key not equals target.");
+        }
+        found = iter.key();
     }
-    switch (iter.key()->tag().flag()) {
+    switch (found->tag().flag()) {
         case Tag::kFlagValue:
-            value->assign(iter.key()->value());
+            *value = found->value();
             break;
         case Tag::kFlagDeletion:
             break;
         default:
-            DLOG(FATAL) << "Incorrect tag type: " << iter.key()->tag().flag();
+            DLOG(FATAL) << "Incorrect tag type: " << found->tag().flag();
             break;
     }
     if (tag) {
-        *tag = iter.key()->tag();
+        *tag = found->tag();
     }
     return Error::OK();
 }
@@ -113,6 +158,51 @@ OrderedMemoryTable::Get(std::string_view key, SequenceNumber version, Tag *tag,
     return arena_.memory_usage();
 }
 
+void OrderedMemoryTable::UpdateIndex(const KeyBoundle *ikey) {
+    const std::string_view key = ikey->user_key();
+    const SequenceNumber version = ikey->tag().sequence_number();
+    std::atomic<IndexNode *> *slot = index_slot(key);
+    
+    IndexNode *head = slot->load(std::memory_order_acquire);
+    IndexNode *node = nullptr;
+    while (true) {
+        for (IndexNode *x = head; x != nullptr; x = x->next) {
+            const KeyBoundle *newest = x->newest.load(std::memory_order_acquire);
+            if (newest->user_key() != key) {
+                continue;
+            }
+            while (newest->tag().sequence_number() < version) {
+                if (x->newest.compare_exchange_weak(newest, ikey,
+                                                    std::memory_order_acq_rel)) {
+                    break;
+                }
+            }
+            return;
+        }
+        if (!node) {
+            node = new (arena_.Allocate(sizeof(IndexNode))) IndexNode;
+            node->newest.store(ikey, std::memory_order_relaxed);
+        }
+        node->next = head;
+        // If fail, the head be changed by other writer, and it maybe has the
+        // same key, so find again.
+        if (slot->compare_exchange_weak(head, node, std::memory_order_acq_rel)) {
+            return;
+        }
+    }
+}
+    
+const KeyBoundle *OrderedMemoryTable::FindNewest(std::string_view key) const {
+    IndexNode *x = index_slot(key)->load(std::memory_order_acquire);
+    for (; x != nullptr; x = x->next) {
+        const KeyBoundle *newest = x->newest.load(std::memory_order_acquire);
+        if (newest->user_key() == key) {
+            return newest;
+        }
+    }
+    return nullptr;
+}
+    
 /*virtual*/ float OrderedMemoryTable::ApproximateConflictFactor() const {
     // Skip List has no Conflict Factor.
     // Equlas 0 forever.
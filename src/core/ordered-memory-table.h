@@ -5,6 +5,7 @@
 #include "core/skip-list.h"
 #include "core/internal-key-comparator.h"
 #include "base/arenas.h"
+#include "base/hash.h"
 #include "glog/logging.h"
 
 namespace mai {
@@ -15,13 +16,19 @@ class InternalKeyComparator;
 
 class OrderedMemoryTable final : public MemoryTable {
 public:
-    OrderedMemoryTable(const InternalKeyComparator *ikcmp);
+    // hash_index_slots: 0 means no hash index.
+    OrderedMemoryTable(const InternalKeyComparator *ikcmp,
+                       size_t hash_index_slots = 0);
     virtual ~OrderedMemoryTable();
     
     virtual void Put(std::string_view key, std::string_view value,
                      SequenceNumber version, uint8_t flag) override;
+    virtual bool concurrent_put_supported() const override { return true; }
+    virtual void ConcurrentPut(std::string_view key, std::string_view value,
+                               SequenceNumber version, uint8_t flag) override;
+    using MemoryTable::Get;
     virtual Error Get(std::string_view key, SequenceNumber version, Tag *tag,
-                      std::string *value) const override;
+                      std::string_view *value) const override;
     virtual Iterator *NewIterator() override;
     virtual size_t NumEntries() const override;
     virtual size_t ApproximateMemoryUsage() const override;
@@ -38,9 +45,28 @@ private:
     using Table = SkipList<const KeyBoundle *, KeyComparator>;
     
     class IteratorImpl;
+    
+    // The node of hash index, all versions of one user key share one node.
+    struct IndexNode {
+        std::atomic<const KeyBoundle *> newest;
+        IndexNode *next; // Immutable after be linked.
+    }; // struct IndexNode
+    
+    // Point the index node of key to the ikey if it is newer.
+    // Lock-free, can be called by concurrent writers.
+    void UpdateIndex(const KeyBoundle *ikey);
+    
+    const KeyBoundle *FindNewest(std::string_view key) const;
+    
+    std::atomic<IndexNode *> *index_slot(std::string_view key) const {
+        return &index_[base::Hash::Murmur64(key.data(), key.size()) %
+                       n_index_slots_];
+    }
 
-    base::StandaloneArena arena_;
+    base::ShardedArena arena_; // Concurrent writers use different shards.
     Table table_;
+    const size_t n_index_slots_;
+    std::atomic<IndexNode *> *index_ = nullptr; // Hash index of user keys.
     std::atomic<size_t> n_entries_;
 }; // class OrderedMemoryTable
     
@@ -0,0 +1,53 @@
+#ifndef MAI_CORE_PERF_CONTEXT_IMPL_H_
+#define MAI_CORE_PERF_CONTEXT_IMPL_H_
+
+#include "mai/perf-context.h"
+#include "base/base.h"
+#include <chrono>
+
+namespace mai {
+
+namespace core {
+
+extern thread_local PerfLevel tls_perf_level;
+extern thread_local PerfContext tls_perf_context;
+
+inline uint64_t NowNanos() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Add the elapsed nanos of scope to the metric, if time be enabled.
+class PerfTimer final {
+public:
+    explicit PerfTimer(uint64_t *metric)
+        : metric_(tls_perf_level >= kPerfEnableTime ? metric : nullptr)
+        , start_(metric_ ? NowNanos() : 0) {}
+
+    ~PerfTimer() {
+        if (metric_) {
+            *metric_ += NowNanos() - start_;
+        }
+    }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(PerfTimer);
+private:
+    uint64_t *const metric_;
+    const uint64_t start_;
+}; // class PerfTimer
+
+} // namespace core
+
+} // namespace mai
+
+#define PERF_COUNTER_ADD(metric, value) \
+    do { \
+        if (::mai::core::tls_perf_level >= ::mai::kPerfEnableCount) { \
+            ::mai::core::tls_perf_context.metric += (value); \
+        } \
+    } while (0)
+
+#define PERF_TIMER_GUARD(metric) \
+    ::mai::core::PerfTimer perf_timer_##metric(&::mai::core::tls_perf_context.metric)
+
+#endif // MAI_CORE_PERF_CONTEXT_IMPL_H_
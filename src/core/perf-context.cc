@@ -0,0 +1,36 @@
+#include "core/perf-context-impl.h"
+#include "base/slice.h"
+#include <inttypes.h>
+
+namespace mai {
+
+namespace core {
+
+thread_local PerfLevel tls_perf_level = kPerfDisable;
+thread_local PerfContext tls_perf_context;
+
+} // namespace core
+
+std::string PerfContext::ToString() const {
+    std::string buf;
+#define DEFINE_APPEND(name) \
+    if (name > 0) { \
+        buf.append(base::Sprintf(#name " = %" PRIu64 ", ", name)); \
+    }
+    DECL_PERF_CONTEXT_METRICS(DEFINE_APPEND)
+#undef DEFINE_APPEND
+    if (!buf.empty()) {
+        buf.erase(buf.size() - 2); // Remove last ", "
+    }
+    return buf;
+}
+
+/*static*/ PerfContext *PerfContext::Current() { return &core::tls_perf_context; }
+
+/*static*/ PerfLevel PerfContext::GetLevel() { return core::tls_perf_level; }
+
+/*static*/ void PerfContext::SetLevel(PerfLevel level) {
+    core::tls_perf_level = level;
+}
+
+} // namespace mai
@@ -47,6 +47,11 @@ public:
         std::copy(queue_.begin(), queue_.end(), result->begin() + old_size);
     }
     
+    size_t size() const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return queue_.size();
+    }
+    
     bool InProgress() const {
         std::unique_lock<std::mutex> lock(mutex_);
         return !queue_.empty();
@@ -0,0 +1,41 @@
+#include "mai/prefix-extractor.h"
+#include "base/base.h"
+#include "glog/logging.h"
+
+namespace mai {
+
+namespace core {
+
+class FixedPrefixExtractor final : public PrefixExtractor {
+public:
+    FixedPrefixExtractor(size_t len)
+        : len_(len)
+        , name_("::mai::FixedPrefixExtractor." + std::to_string(len)) {
+        DCHECK_GT(len_, 0);
+    }
+    virtual ~FixedPrefixExtractor() {}
+
+    virtual std::string_view Extract(std::string_view key) const override {
+        DCHECK(InDomain(key));
+        return key.substr(0, len_);
+    }
+
+    virtual bool InDomain(std::string_view key) const override {
+        return key.size() >= len_;
+    }
+
+    virtual const char *Name() const override { return name_.c_str(); }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(FixedPrefixExtractor);
+private:
+    const size_t len_;
+    const std::string name_;
+}; // class FixedPrefixExtractor
+
+} // namespace core
+
+/*static*/ PrefixExtractor *PrefixExtractor::NewFixed(size_t len) {
+    return new core::FixedPrefixExtractor(len);
+}
+
+} // namespace mai
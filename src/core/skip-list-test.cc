@@ -103,6 +103,36 @@ TEST_F(SkipListTest, ThreadingPut) {
     }
 }
 
+TEST_F(SkipListTest, ConcurrentPut) {
+    arena_.reset(new base::ShardedArena);
+    IntSkipList list([](int a, int b) { return a - b; }, arena_.get());
+    
+    static const int kThreads = 4;
+    static const int kN = 10000;
+    std::thread threads[kThreads];
+    for (int i = 0; i < kThreads; ++i) {
+        // Keys of threads are interleaved, so they put at the same places.
+        threads[i] = std::thread([&list] (int slot) {
+            for (int j = 0; j < kN; ++j) {
+                list.PutConcurrently(j * kThreads + slot);
+            }
+        }, i);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    
+    IntSkipList::Iterator iter(&list);
+    int i = 0;
+    for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+        ASSERT_EQ(i++, iter.key());
+    }
+    ASSERT_EQ(kThreads * kN, i);
+    for (i = 0; i < kThreads * kN; i += 7) {
+        ASSERT_TRUE(list.Contains(i)) << i;
+    }
+}
+
 //TEST_F(SkipListTest, ChunkPut) {
 //
 //    auto comparator = [] (const lsm::InternalKey &a, const lsm::InternalKey &b) {
@@ -6,6 +6,9 @@
 #include <stdint.h>
 #include <random>
 #include <atomic>
+#include <thread>
+#include <algorithm>
+#include <functional>
 
 namespace mai {
 
@@ -69,6 +72,41 @@ public:
         }
     }
 
+    // Put by many threads at the same time. Every level is linked by CAS,
+    // if the CAS fails the splice of this level be found again from its
+    // last prev node. Nodes only be linked from bottom to top, so readers
+    // always see a node in level 0 first.
+    // REQUIRES: Can not run with Put() at the same time.
+    void PutConcurrently(Key key) {
+        const int height = RandomHeightConcurrently();
+        intptr_t old_height = max_height_.load(std::memory_order_relaxed);
+        while (height > old_height) {
+            if (max_height_.compare_exchange_weak(old_height, height)) {
+                break;
+            }
+        }
+        
+        Node *prev[kMaxHeight];
+        Node *next[kMaxHeight];
+        Node *before = head_;
+        for (int i = std::max(height, max_height()) - 1; i >= 0; i--) {
+            FindSpliceForLevel(key, before, i, &prev[i], &next[i]);
+            before = prev[i];
+        }
+        
+        Node *x = NewNode(key, height);
+        for (int i = 0; i < height; i++) {
+            while (true) {
+                x->nobarrier_set_next(i, next[i]);
+                if (prev[i]->cas_next(i, next[i], x)) {
+                    break;
+                }
+                // Other writers have changed this level, find again.
+                FindSpliceForLevel(key, prev[i], i, &prev[i], &next[i]);
+            }
+        }
+    }
+
     bool Contains(Key key) const {
         Node* x = FindGreaterOrEqual(key, NULL);
         if (x != NULL && Equal(key, x->key)) {
@@ -111,6 +149,20 @@ private:
         }
     }
 
+    // Find prev and next of key in the level, start from the before node.
+    void FindSpliceForLevel(Key key, Node *before, int level, Node **prev,
+                            Node **next) const {
+        while (true) {
+            Node *x = before->next(level);
+            if (!KeyIsAfterNode(key, x)) {
+                *prev = before;
+                *next = x;
+                return;
+            }
+            before = x;
+        }
+    }
+
     Node *FindLessThan(Key key) const {
         Node* x = head_;
         int level = max_height() - 1;
@@ -161,6 +213,18 @@ private:
         return height;
     }
 
+    // rand_ is not thread safe, every thread has its own engine.
+    static int RandomHeightConcurrently() {
+        static thread_local std::minstd_rand engine(
+            static_cast<uint32_t>(std::hash<std::thread::id>{}(
+                std::this_thread::get_id())));
+        int height = 1;
+        while (height < kMaxHeight && (engine() % kBranching) == 0) {
+            height++;
+        }
+        return height;
+    }
+
     bool Equal(Key a, Key b) const {
         return compare_(a, b) == 0;
     }
@@ -213,6 +277,12 @@ public:
 
         next_[n].store(x, std::memory_order_relaxed);
     }
+    
+    bool cas_next(int n, Node *expected, Node *x) {
+        DCHECK_GE(n, 0);
+        return next_[n].compare_exchange_strong(expected, x,
+                                                std::memory_order_acq_rel);
+    }
 
 private:
     std::atomic<SkipList<Key, Comparator>::Node *> next_[1];
@@ -1,6 +1,7 @@
 #include "core/unordered-memory-table.h"
 #include "base/reference-count.h"
 #include "mai/iterator.h"
+#include "mai/pinnable-value.h"
 
 namespace mai {
     
@@ -9,7 +10,8 @@ namespace core {
 class UnorderedMemoryTable::IteratorImpl final : public Iterator {
 public:
     IteratorImpl(UnorderedMemoryTable *umt)
-        : iter_(&umt->table_) {}
+        : owns_(umt)
+        , iter_(&umt->table_) {}
     
     virtual bool Valid() const override { return iter_.Valid(); }
     virtual void SeekToFirst() override { iter_.SeekToFirst(); }
@@ -33,6 +35,10 @@ public:
     virtual std::string_view value() const override {
         return iter_.key()->value();
     }
+    virtual void PinValue(PinnableValue *result) const override {
+        owns_->AddRef();
+        result->Pin(iter_.key()->value(), &Cleanup, owns_);
+    }
     virtual Error error() const override { return error_; }
     
     static void Cleanup(void *arg1, void */*arg2*/) {
@@ -44,6 +50,7 @@ private:
         NOREACHED();
     }
 
+    UnorderedMemoryTable *const owns_;
     Table::Iterator iter_;
     Error error_;
 }; // class UnorderedMemoryTable::IteratorImpl
@@ -70,7 +77,7 @@ UnorderedMemoryTable::UnorderedMemoryTable(const InternalKeyComparator *ikcmp, i
     
 /*virtual*/ Error UnorderedMemoryTable::Get(std::string_view key,
                                             SequenceNumber version, Tag *tag,
-                                            std::string *value) const {
+                                            std::string_view *value) const {
     base::ScopedMemory scope;
     const KeyBoundle *ikey = KeyBoundle::New(key, version,
                                              base::ScopedAllocator{&scope});
@@ -85,7 +92,7 @@ UnorderedMemoryTable::UnorderedMemoryTable(const InternalKeyComparator *ikcmp, i
     }
     switch (iter.key()->tag().flag()) {
         case Tag::kFlagValue:
-            value->assign(iter.key()->value());
+            *value = iter.key()->value();
             break;
         case Tag::kFlagDeletion:
             break;
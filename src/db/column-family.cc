@@ -4,50 +4,15 @@
 #include "db/factory.h"
 #include "db/table-cache.h"
 #include "db/compaction.h"
+#include "db/compaction-picker.h"
 #include "db/config.h"
 #include "mai/iterator.h"
+#include <algorithm>
 
 namespace mai {
     
 namespace db {
     
-// Stores the minimal range that covers all entries in inputs in
-// *smallest, *largest.
-// REQUIRES: inputs is not empty
-void GetRange(const std::vector<base::intrusive_ptr<FileMetaData>> &inputs,
-              const core::InternalKeyComparator *ikcmp,
-              std::string *smallest, std::string *largest) {
-    DCHECK(!inputs.empty());
-    smallest->clear();
-    largest->clear();
-    for (size_t i = 0; i < inputs.size(); i++) {
-        base::intrusive_ptr<FileMetaData> fmd = inputs[i];
-        if (i == 0) {
-            *smallest = fmd->smallest_key;
-            *largest = fmd->largest_key;
-        } else {
-            if (ikcmp->Compare(fmd->smallest_key, *smallest) < 0) {
-                *smallest = fmd->smallest_key;
-            }
-            if (ikcmp->Compare(fmd->largest_key, *largest) > 0) {
-                *largest = fmd->largest_key;
-            }
-        }
-    }
-}
-
-// Stores the minimal range that covers all entries in inputs1 and inputs2
-// in *smallest, *largest.
-// REQUIRES: inputs is not empty
-    void GetRange2(const std::vector<base::intrusive_ptr<FileMetaData>> &inputs1,
-                   const std::vector<base::intrusive_ptr<FileMetaData>> &inputs2,
-                   const core::InternalKeyComparator *ikcmp,
-                   std::string *smallest, std::string *largest) {
-    std::vector<base::intrusive_ptr<FileMetaData>> all = inputs1;
-    all.insert(all.end(), inputs2.begin(), inputs2.end());
-    GetRange(all, ikcmp, smallest, largest);
-}
-    
 ////////////////////////////////////////////////////////////////////////////////
 /// class ColumnFamilyImpl
 ////////////////////////////////////////////////////////////////////////////////
@@ -65,11 +30,15 @@ ColumnFamilyImpl::ColumnFamilyImpl(const std::string &name, uint32_t id,
     , owns_(owner)
     , ref_count_(0)
     , dropped_(false)
-    , background_progress_(false)
-    , last_num_slots_(options.number_of_hash_slots) {
+    , background_jobs_(0)
+    , last_num_slots_(options.number_of_hash_slots)
+    , picker_(CompactionPicker::New(options)) {
     AddRef();
     dummy_versions_->next_ = dummy_versions_;
     dummy_versions_->prev_ = dummy_versions_;
+    for (int i = 0; i < Config::kMaxLevel; ++i) {
+        level_compacting_[i] = false;
+    }
 }
     
 /*virtual*/ ColumnFamilyImpl::~ColumnFamilyImpl() {
@@ -84,6 +53,11 @@ ColumnFamilyImpl::ColumnFamilyImpl(const std::string &name, uint32_t id,
         owns_->RemoveColumnFamily(this);
     }
     
+    if (super_version_) {
+        super_version_->ReleaseRef();
+        super_version_ = nullptr;
+    }
+    
     while (dummy_versions_->next() != dummy_versions_) {
         Version *x = dummy_versions_->next();
         Version *prev = x->prev();
@@ -125,8 +99,11 @@ void ColumnFamilyImpl::MakeImmutablePipeline(Factory *factory,
                                     mutable_->ApproximateConflictFactor(),
                                     Config::kLimitMinNumberSlots);
     DCHECK_GE(new_num_slots, Config::kLimitMinNumberSlots);
-    mutable_ = factory->NewMemoryTable(&ikcmp_, options_.use_unordered_table, new_num_slots);
+    mutable_ = factory->NewMemoryTable(&ikcmp_, options_.use_unordered_table,
+                                       new_num_slots,
+                                       options_.memtable_hash_index_slots);
     last_num_slots_ = new_num_slots;
+    InstallSuperVersion();
 }
 
 void ColumnFamilyImpl::Append(Version *version) {
@@ -137,98 +114,109 @@ void ColumnFamilyImpl::Append(Version *version) {
     prev->next_ = version;
     dummy_versions_->prev_ = version;
     current_ = version;
+    InstallSuperVersion();
 }
     
-bool ColumnFamilyImpl::NeedsCompaction() const {
-//    if (current()->NumberLevelFiles(0) > Config::kMaxNumberLevel0File) {
-//        return true;
-//    }
-//
-//    if (current()->SizeLevelFiles(0) > Config::kMaxSizeLevel0File) {
-//        return true;
-//    }
-//
-//    for (auto i = 1; i < Config::kMaxLevel; i++) {
-//        if (current()->SizeLevelFiles(i) > Config::kMaxSizeLevel0File * (i + 1)) {
-//            return true;
-//        }
-//    }
-//    return false;
-    return current()->compaction_score_ >= 1.0;
+void ColumnFamilyImpl::InstallSuperVersion() {
+    SuperVersion *sv = new SuperVersion(current_);
+    sv->AddRef();
+    sv->mutable_table = mutable_;
+    immutable_pipeline_.PeekAll(&sv->immutable_tables);
+    std::reverse(sv->immutable_tables.begin(), sv->immutable_tables.end());
+    
+    SuperVersion *old;
+    {
+        base::WriterSpinLock lock(&super_version_mutex_);
+        old = super_version_;
+        super_version_ = sv;
+    }
+    // The old one will be deleted after all readers released it.
+    if (old) {
+        old->ReleaseRef();
+    }
 }
     
-bool ColumnFamilyImpl::PickCompaction(CompactionContext *ctx) {
-    if (!NeedsCompaction()) {
-        return false;
-    }
-
-    bool size_compaction = (current()->compaction_score_ >= 1.0);
-    DCHECK(ctx != nullptr);
-    if (size_compaction) {
-        ctx->level = current_->compaction_level_;
-        DCHECK_GE(ctx->level, 0);
-        DCHECK_LT(ctx->level + 1, Config::kMaxLevel);
-
-        for (auto fmd : current_->level_files(ctx->level)) {
-            if (compaction_point_[ctx->level].empty() ||
-                ikcmp_.Compare(compaction_point_[ctx->level],
-                               fmd->largest_key) < 0) {
-                ctx->inputs[0].push_back(fmd);
-                break;
-            }
+void ColumnFamilyImpl::AddLiveFiles(std::set<uint64_t> *live) const {
+    for (Version *v = dummy_versions_->next(); v != dummy_versions_;
+         v = v->next()) {
+        if (v != current_ && !v->pinned()) {
+            continue;
         }
-        
-        if (ctx->inputs[0].empty()) {
-            ctx->inputs[0].push_back(current_->files_[ctx->level][0]);
+        for (int i = 0; i < Config::kMaxLevel; ++i) {
+            for (const auto &fmd : v->level_files(i)) {
+                live->insert(fmd->number);
+            }
         }
-    } else {
-        return false;
     }
+}
     
-    ctx->input_version = current_;
-    
-    // Files in level 0 may overlap each other, so pick up all overlapping ones
-    if (ctx->level == 0) {
-        std::string smallest, largest;
-        GetRange(ctx->inputs[0], &ikcmp_, &smallest, &largest);
-        // Note that the next call will discard the file we placed in
-        // c->inputs_[0] earlier and replace it with an overlapping set
-        // which will include the picked file.
-        current_->GetOverlappingInputs(0, smallest, largest, &ctx->inputs[0]);
-        DCHECK(!ctx->inputs[0].empty());
-    }
+bool ColumnFamilyImpl::NeedsCompaction() const {
+    return picker_->NeedsCompaction(this);
+}
     
-    SetupOtherInputs(ctx);
+bool ColumnFamilyImpl::PickCompaction(CompactionContext *ctx) {
+    if (!picker_->PickCompaction(this, ctx)) {
+        return false;
+    }
+    DCHECK(!level_compacting_[ctx->level]);
+    DCHECK(!level_compacting_[ctx->output_level]);
+    level_compacting_[ctx->level]        = true;
+    level_compacting_[ctx->output_level] = true;
     return true;
 }
     
-void ColumnFamilyImpl::SetupOtherInputs(CompactionContext *ctx) {
-    const int level = ctx->level;
-    std::string smallest, largest;
-    GetRange(ctx->inputs[0], ikcmp(), &smallest, &largest);
-    
-    current_->GetOverlappingInputs(level + 1, smallest, largest,
-                                   &ctx->inputs[1]);
-    
-    // Get entire range covered by compaction
-    std::string all_start, all_limit;
-    GetRange2(ctx->inputs[0], ctx->inputs[1], ikcmp(), &all_start, &all_limit);
+void ColumnFamilyImpl::ReleaseCompaction(const CompactionContext &ctx) {
+    DCHECK(level_compacting_[ctx.level]);
+    DCHECK(level_compacting_[ctx.output_level]);
+    level_compacting_[ctx.level]        = false;
+    level_compacting_[ctx.output_level] = false;
+}
     
-    // TODO:
+// Split compaction into key range shards by input files' boundaries.
+// Shard i covers user keys [boundaries[i - 1], boundaries[i]).
+void ColumnFamilyImpl::SplitCompaction(const CompactionContext &ctx,
+                                       size_t max_shards,
+                                       std::vector<std::string> *boundaries) const {
+    boundaries->clear();
+    if (max_shards <= 1) {
+        return;
+    }
     
-    // Update the place where we will do the next compaction for this level.
-    // We update this immediately instead of waiting for the VersionEdit
-    // to be applied so that if the compaction fails, we will try a different
-    // key range next time.
-    //compaction_pointer_[level] = largest;
-    compaction_point_[level] = largest;
-    ctx->patch.SetCompactionPoint(id(), level, largest);
+    std::vector<std::string> keys;
+    for (const auto &inputs : ctx.inputs) {
+        for (auto fmd : inputs) {
+            keys.emplace_back(core::KeyBoundle::ExtractUserKey(fmd->largest_key));
+        }
+    }
+    const Comparator *ucmp = ikcmp_.ucmp();
+    std::sort(keys.begin(), keys.end(), [ucmp] (const auto &a, const auto &b) {
+        return ucmp->Compare(a, b) < 0;
+    });
+    keys.erase(std::unique(keys.begin(), keys.end(),
+                           [ucmp] (const auto &a, const auto &b) {
+                               return ucmp->Equals(a, b);
+                           }), keys.end());
+    if (keys.size() <= 1) {
+        return;
+    }
+    keys.pop_back(); // The largest key can not split anything.
+    
+    const size_t n_shards = std::min(max_shards, keys.size() + 1);
+    for (size_t i = 1; i < n_shards; ++i) {
+        const std::string &key = keys[i * keys.size() / n_shards];
+        // Same boundaries make empty shards.
+        if (boundaries->empty() || !ucmp->Equals(boundaries->back(), key)) {
+            boundaries->push_back(key);
+        }
+    }
 }
-
+    
 Error ColumnFamilyImpl::Install(Factory *factory) {
     // TODO:
     mutable_ = factory->NewMemoryTable(&ikcmp_, options_.use_unordered_table,
-                                       options_.number_of_hash_slots);
+                                       options_.number_of_hash_slots,
+                                       options_.memtable_hash_index_slots);
+    InstallSuperVersion();
     std::string cfdir = GetDir();
     Error rs = owns_->env()->MakeDirectory(cfdir, false);
     if (!rs) {
@@ -267,14 +255,15 @@ std::string ColumnFamilyImpl::GetTableFileName(uint64_t file_number) const {
                                 file_number);
 }
     
-Error ColumnFamilyImpl::AddIterators(const ReadOptions &opts,
+Error ColumnFamilyImpl::AddIterators(const ReadOptions &opts, Version *version,
                                     std::vector<Iterator *> *result) {
     Error rs;
     for (int i = 0; i < Config::kMaxLevel; ++i) {
-        for (const auto &fmd : current()->level_files(i)) {
+        for (const auto &fmd : version->level_files(i)) {
             std::unique_ptr<Iterator>
                 iter(owns_->table_cache()->NewIterator(opts, this, fmd->number,
-                                                       fmd->size));
+                                                       fmd->size,
+                                                       fmd->global_sequence));
             if (iter->error().fail()) {
                 return iter->error();
             }
@@ -284,6 +273,17 @@ Error ColumnFamilyImpl::AddIterators(const ReadOptions &opts,
     return rs;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// struct SuperVersion
+////////////////////////////////////////////////////////////////////////////////
+    
+SuperVersion::SuperVersion(Version *version)
+    : current(DCHECK_NOTNULL(version)) {
+    current->Pin();
+}
+    
+SuperVersion::~SuperVersion() { current->Unpin(); }
+    
 ////////////////////////////////////////////////////////////////////////////////
 /// class ColumnFamilyHandle
 ////////////////////////////////////////////////////////////////////////////////
@@ -11,8 +11,10 @@
 #include "mai/db.h"
 #include "glog/logging.h"
 #include <unordered_map>
+#include <set>
 #include <condition_variable>
 #include <atomic>
+#include <memory>
 
 namespace mai {
     
@@ -26,7 +28,20 @@ class TableCache;
 class ColumnFamilySet;
 class ColumnFamilyImpl;
 class ColumnFamilyHandle;
+class CompactionPicker;
 struct CompactionContext;
+    
+// The read view of a column family: memory tables and current version.
+// Readers pin it by reference count, so they never take the db mutex.
+struct SuperVersion final : public base::ReferenceCounted<SuperVersion> {
+    explicit SuperVersion(Version *version);
+    ~SuperVersion();
+    
+    base::intrusive_ptr<core::MemoryTable> mutable_table;
+    // The newest immutable table should be first.
+    std::vector<base::intrusive_ptr<core::MemoryTable>> immutable_tables;
+    Version *const current;
+}; // struct SuperVersion
 
 class ColumnFamilyImpl final {
 public:
@@ -58,7 +73,8 @@ public:
     void Drop();
     bool dropped() const { return dropped_.load(); }
     
-    Error AddIterators(const ReadOptions &opts, std::vector<Iterator *> *result);
+    Error AddIterators(const ReadOptions &opts, Version *version,
+                       std::vector<Iterator *> *result);
     
     DEF_VAL_GETTER(std::string, name);
     DEF_VAL_GETTER(uint32_t, id);
@@ -72,14 +88,20 @@ public:
     DEF_VAL_MUTABLE_GETTER(std::condition_variable, background_cv);
     DEF_VAL_PROP_RW(uint64_t, redo_log_number);
     
-    void set_background_progress(bool value) {
-        background_progress_.store(value);
-    }
+    // REQUIRES: db mutex_.lock()
+    DEF_VAL_PROP_RW(bool, flush_scheduled);
+    // REQUIRES: db mutex_.lock()
+    DEF_VAL_PROP_RW(int, compaction_scheduled);
+    
+    void AddBackgroundJob() { background_jobs_.fetch_add(1); }
     
-    bool background_progress() const {
-        return background_progress_.load();
+    void RemoveBackgroundJob() {
+        int old_val = background_jobs_.fetch_sub(1);
+        DCHECK_GT(old_val, 0);
     }
     
+    bool background_progress() const { return background_jobs_.load() > 0; }
+    
     core::MemoryTable *mutable_table() const { return mutable_.get(); }
     ImmutablePipeline *immutable_pipeline() { return &immutable_pipeline_; }
     
@@ -89,10 +111,46 @@ public:
         return compaction_point_[level];
     }
     
+    // REQUIRES: db mutex_.lock()
+    void set_compaction_point(int level, std::string_view key) {
+        DCHECK_GE(level, 0);
+        DCHECK_LT(level, Config::kMaxLevel);
+        compaction_point_[level] = key;
+    }
+    
+    // Is the level used by a running compaction?
+    // REQUIRES: db mutex_.lock()
+    bool level_compacting(int level) const {
+        DCHECK_GE(level, 0);
+        DCHECK_LT(level, Config::kMaxLevel);
+        return level_compacting_[level];
+    }
+    
+    CompactionPicker *compaction_picker() const { return picker_.get(); }
+    
     void MakeImmutablePipeline(Factory *factory, uint64_t redo_log_number);
     void Append(Version *version);
+    
+    // Add file numbers of current and pinned versions.
+    // REQUIRES: db mutex_.lock()
+    void AddLiveFiles(std::set<uint64_t> *live) const;
+    
+    // Build a new super version by memory tables and current version.
+    // Must be called after any of them changed.
+    // REQUIRES: db mutex_.lock()
+    void InstallSuperVersion();
+    
+    // Thread safe, no db mutex needed.
+    base::intrusive_ptr<SuperVersion> AcquireSuperVersion() {
+        base::ReaderSpinLock lock(&super_version_mutex_);
+        return base::MakeRef(super_version_);
+    }
+    
     bool NeedsCompaction() const;
     bool PickCompaction(CompactionContext *ctx);
+    void ReleaseCompaction(const CompactionContext &ctx);
+    void SplitCompaction(const CompactionContext &ctx, size_t max_shards,
+                         std::vector<std::string> *boundaries) const;
     
     const core::InternalKeyComparator *ikcmp() const { return &ikcmp_; }
 
@@ -100,8 +158,6 @@ public:
     friend class VersionSet;
     DISALLOW_IMPLICIT_CONSTRUCTORS(ColumnFamilyImpl);
 private:
-    void SetupOtherInputs(CompactionContext *ctx);
-    
     const std::string name_;
     const uint32_t id_;
     const ColumnFamilyOptions options_;
@@ -109,8 +165,11 @@ private:
     mutable std::atomic<int> ref_count_;
     std::atomic<bool> dropped_;
     Version *dummy_versions_;
-    std::atomic<bool> background_progress_;
+    std::atomic<int> background_jobs_;
+    bool flush_scheduled_ = false;
+    int compaction_scheduled_ = 0;
     size_t last_num_slots_;
+    const std::unique_ptr<CompactionPicker> picker_;
     
     Version *current_ = nullptr;
     bool initialized_ = false;
@@ -119,10 +178,15 @@ private:
     base::intrusive_ptr<core::MemoryTable> mutable_;
     core::PipelineQueue<base::intrusive_ptr<core::MemoryTable>> immutable_pipeline_;
     
+    base::SpinMutex super_version_mutex_ = RW_SPIN_LOCK_INIT;
+    SuperVersion *super_version_ = nullptr;
+    
     Error background_error_;
     std::condition_variable background_cv_;
 
     std::string compaction_point_[Config::kMaxLevel];
+    // Levels be used by running compactions.
+    bool level_compacting_[Config::kMaxLevel];
     
     // log file number
     uint64_t redo_log_number_ = 0;
@@ -0,0 +1,102 @@
+#include "db/commit-map.h"
+#include "gtest/gtest.h"
+
+namespace mai {
+
+namespace db {
+
+TEST(CommitMapTest, Sanity) {
+    CommitMap commit_map;
+    ASSERT_FALSE(commit_map.active());
+    ASSERT_TRUE(commit_map.IsVisible(100, 100));
+    ASSERT_FALSE(commit_map.IsVisible(101, 100));
+
+    // Prepared at [10, 13)
+    std::string entries("xxx");
+    commit_map.AddPrepared("txn1", 10, 3, &entries);
+    ASSERT_TRUE(commit_map.active());
+    ASSERT_TRUE(commit_map.IsPrepared("txn1"));
+    ASSERT_TRUE(commit_map.Contains(10));
+    ASSERT_TRUE(entries.empty());
+
+    ASSERT_TRUE(commit_map.IsVisible(9, 100));
+    ASSERT_FALSE(commit_map.IsVisible(10, 100));
+    ASSERT_FALSE(commit_map.IsVisible(12, 100));
+    ASSERT_TRUE(commit_map.IsVisible(13, 100));
+
+    ASSERT_TRUE(commit_map.Commit("txn1", 20));
+    ASSERT_FALSE(commit_map.IsPrepared("txn1"));
+    ASSERT_FALSE(commit_map.Commit("txn1", 21));
+    ASSERT_EQ(1, commit_map.n_decided());
+    ASSERT_FALSE(commit_map.IsVisible(11, 19));
+    ASSERT_TRUE(commit_map.IsVisible(11, 20));
+
+    std::vector<CommitMap::Prepared> prepared;
+    commit_map.GetAllPrepared(&prepared);
+    ASSERT_TRUE(prepared.empty());
+}
+
+TEST(CommitMapTest, Rollback) {
+    CommitMap commit_map;
+    std::string entries("xx");
+    commit_map.AddPrepared("txn1", 10, 2, &entries);
+    entries = "yy";
+    commit_map.AddPrepared("txn2", 12, 2, &entries);
+
+    std::vector<CommitMap::Prepared> prepared;
+    commit_map.GetAllPrepared(&prepared);
+    ASSERT_EQ(2, prepared.size());
+    ASSERT_EQ("txn1", prepared[0].name);
+    ASSERT_EQ("xx", prepared[0].entries);
+    ASSERT_EQ(12, prepared[1].seq);
+
+    ASSERT_TRUE(commit_map.Rollback("txn1", 16));
+    ASSERT_FALSE(commit_map.IsVisible(10, 100));
+    ASSERT_FALSE(commit_map.IsVisible(12, 100));
+
+    CommitMap::Prepared txn;
+    ASSERT_FALSE(commit_map.GetPrepared("txn1", &txn));
+    ASSERT_TRUE(commit_map.GetPrepared("txn2", &txn));
+    ASSERT_EQ("yy", txn.entries);
+    ASSERT_EQ(2, txn.n_entries);
+}
+
+TEST(CommitMapTest, Retire) {
+    CommitMap commit_map;
+    std::string entries;
+    commit_map.AddPrepared("txn1", 10, 2, &entries);
+    commit_map.AddPrepared("txn2", 12, 2, &entries);
+    ASSERT_TRUE(commit_map.Commit("txn1", 14));
+
+    // The snapshot 13 can not see txn1.
+    commit_map.Retire(13);
+    ASSERT_TRUE(commit_map.Contains(10));
+    ASSERT_EQ(0, commit_map.max_retired_seq());
+
+    commit_map.Retire(14);
+    ASSERT_FALSE(commit_map.Contains(10));
+    ASSERT_EQ(14, commit_map.max_retired_seq());
+    ASSERT_EQ(0, commit_map.n_decided());
+    // Not decided one must be kept.
+    ASSERT_TRUE(commit_map.Contains(12));
+    ASSERT_TRUE(commit_map.IsVisible(10, 100));
+    ASSERT_FALSE(commit_map.IsVisible(12, 100));
+}
+
+TEST(CommitMapTest, AdjustSmallestSnapshot) {
+    CommitMap commit_map;
+    ASSERT_EQ(100, commit_map.AdjustSmallestSnapshot(100));
+
+    std::string entries;
+    commit_map.AddPrepared("txn1", 10, 2, &entries);
+    ASSERT_EQ(9, commit_map.AdjustSmallestSnapshot(100));
+    ASSERT_EQ(5, commit_map.AdjustSmallestSnapshot(5));
+
+    ASSERT_TRUE(commit_map.Commit("txn1", 20));
+    ASSERT_EQ(9, commit_map.AdjustSmallestSnapshot(19));
+    ASSERT_EQ(20, commit_map.AdjustSmallestSnapshot(20));
+}
+
+} // namespace db
+
+} // namespace mai
@@ -0,0 +1,135 @@
+#include "db/commit-map.h"
+#include "glog/logging.h"
+#include <algorithm>
+#include <mutex>
+
+namespace mai {
+
+namespace db {
+
+void CommitMap::AddPrepared(std::string_view name, core::SequenceNumber seq,
+                            uint32_t n_entries, std::string *entries) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    DCHECK(names_.find(std::string(name)) == names_.end());
+    DCHECK(states_.find(seq) == states_.end());
+
+    State *state = &states_[seq];
+    state->prepared.name = name;
+    state->prepared.seq = seq;
+    state->prepared.n_entries = n_entries;
+    state->prepared.entries.swap(*entries);
+    names_[state->prepared.name] = seq;
+    UpdateMinSequence();
+    active_.store(true, std::memory_order_release);
+}
+
+bool CommitMap::Contains(core::SequenceNumber seq) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return states_.find(seq) != states_.end();
+}
+
+bool CommitMap::IsPrepared(std::string_view name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return names_.find(std::string(name)) != names_.end();
+}
+
+bool CommitMap::GetPrepared(std::string_view name, Prepared *result) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto iter = names_.find(std::string(name));
+    if (iter == names_.end()) {
+        return false;
+    }
+    // Only the names of not decided transactions be in names_.
+    *result = states_.find(iter->second)->second.prepared;
+    return true;
+}
+
+void CommitMap::GetAllPrepared(std::vector<Prepared> *result) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    result->clear();
+    for (const auto &pair : states_) {
+        if (pair.second.decided_seq == 0) {
+            result->push_back(pair.second.prepared);
+        }
+    }
+}
+
+void CommitMap::Retire(core::SequenceNumber oldest_snapshot) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    core::SequenceNumber max_retired_seq = max_retired_seq_.load();
+    auto iter = states_.begin();
+    while (iter != states_.end()) {
+        const State &state = iter->second;
+        if (state.decided_seq == 0 || state.decided_seq > oldest_snapshot) {
+            ++iter;
+            continue;
+        }
+        max_retired_seq = std::max(max_retired_seq, state.decided_seq);
+        n_decided_.fetch_sub(1);
+        iter = states_.erase(iter);
+    }
+    // Publish the retired sequence number before the minimum sequence number,
+    // the readers on fast path must see it.
+    max_retired_seq_.store(max_retired_seq, std::memory_order_release);
+    UpdateMinSequence();
+}
+
+core::SequenceNumber
+CommitMap::AdjustSmallestSnapshot(core::SequenceNumber smallest_snapshot) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const auto &pair : states_) {
+        if (pair.first > smallest_snapshot) {
+            break;
+        }
+        const State &state = pair.second;
+        if (state.decided_seq == 0 || state.decided_seq > smallest_snapshot) {
+            // Some snapshots can not see this transaction.
+            return pair.first - 1;
+        }
+    }
+    return smallest_snapshot;
+}
+
+bool CommitMap::Decide(std::string_view name, core::SequenceNumber seq,
+                       bool aborted) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto iter = names_.find(std::string(name));
+    if (iter == names_.end()) {
+        return false;
+    }
+    State *state = &states_.find(iter->second)->second;
+    names_.erase(iter);
+    DCHECK_EQ(0, state->decided_seq);
+    DCHECK_GT(seq, state->prepared.seq);
+    state->decided_seq = seq;
+    state->aborted = aborted;
+    state->prepared.entries.clear();
+    state->prepared.entries.shrink_to_fit();
+    n_decided_.fetch_add(1);
+    return true;
+}
+
+bool CommitMap::IsCommitted(core::SequenceNumber seq,
+                            core::SequenceNumber snapshot) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto iter = states_.upper_bound(seq);
+    if (iter == states_.begin()) {
+        return true;
+    }
+    const State &state = (--iter)->second;
+    if (seq >= state.prepared.seq + state.prepared.n_entries) {
+        return true; // Not in this prepared transaction.
+    }
+    return !state.aborted && state.decided_seq != 0 &&
+           state.decided_seq <= snapshot;
+}
+
+// REQUIRES: mutex_.lock()
+void CommitMap::UpdateMinSequence() {
+    min_seq_.store(states_.empty() ? core::Tag::kMaxSequenceNumber :
+                   states_.begin()->first, std::memory_order_release);
+}
+
+} // namespace db
+
+} // namespace mai
@@ -0,0 +1,119 @@
+#ifndef MAI_DB_COMMIT_MAP_H_
+#define MAI_DB_COMMIT_MAP_H_
+
+#include "core/key-boundle.h"
+#include "base/base.h"
+#include <atomic>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mai {
+
+namespace db {
+
+// The states of prepared transactions, by prepare sequence number.
+//
+// A prepared transaction has been written into memory tables by its prepare
+// sequence numbers, but it's invisible until be committed. The commit uses
+// one new sequence number, so the readers can see it only if their snapshot
+// is not older than the commit sequence number.
+//
+// The decided transactions be retired once no snapshot can distinguish them,
+// the readers only compare sequence numbers then.
+class CommitMap final {
+public:
+    struct Prepared {
+        std::string name;
+        core::SequenceNumber seq;
+        uint32_t n_entries;
+        std::string entries; // Redo entries of the prepared batch.
+    }; // struct Prepared
+
+    CommitMap() {}
+
+    // Has ever been any prepared transaction.
+    bool active() const { return active_.load(std::memory_order_acquire); }
+
+    // The newest decided sequence number of retired transactions.
+    core::SequenceNumber max_retired_seq() const {
+        return max_retired_seq_.load(std::memory_order_acquire);
+    }
+
+    size_t n_decided() const { return n_decided_.load(std::memory_order_acquire); }
+
+    // Add a prepared transaction, the entries will be swapped.
+    void AddPrepared(std::string_view name, core::SequenceNumber seq,
+                     uint32_t n_entries, std::string *entries);
+
+    // Returns false if the transaction is not prepared.
+    bool Commit(std::string_view name, core::SequenceNumber commit_seq) {
+        return Decide(name, commit_seq, false);
+    }
+
+    // The rollback sequence number must be newer than the entries that
+    // restore the old values, those entries hide the prepared ones.
+    bool Rollback(std::string_view name, core::SequenceNumber rollback_seq) {
+        return Decide(name, rollback_seq, true);
+    }
+
+    bool Contains(core::SequenceNumber seq) const;
+
+    // The transaction is prepared but not decided?
+    bool IsPrepared(std::string_view name) const;
+
+    // Find a prepared but not decided transaction.
+    bool GetPrepared(std::string_view name, Prepared *result) const;
+
+    // All prepared but not decided transactions, ordered by sequence number.
+    void GetAllPrepared(std::vector<Prepared> *result) const;
+
+    // The entry with seq is visible to the snapshot?
+    bool IsVisible(core::SequenceNumber seq, core::SequenceNumber snapshot) const {
+        if (seq > snapshot) {
+            return false;
+        }
+        if (seq < min_seq_.load(std::memory_order_acquire)) {
+            return true; // Fast path: older than all prepared transactions.
+        }
+        return IsCommitted(seq, snapshot);
+    }
+
+    // Remove the decided transactions which decided sequence numbers are not
+    // newer than oldest snapshot.
+    void Retire(core::SequenceNumber oldest_snapshot);
+
+    // The compaction can drop the old versions of keys by returned sequence
+    // number, the prepared entries can not hide the old versions.
+    core::SequenceNumber
+    AdjustSmallestSnapshot(core::SequenceNumber smallest_snapshot) const;
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(CommitMap);
+private:
+    struct State {
+        Prepared prepared;
+        core::SequenceNumber decided_seq = 0; // 0 is not decided
+        bool aborted = false;
+    }; // struct State
+
+    bool Decide(std::string_view name, core::SequenceNumber seq, bool aborted);
+    bool IsCommitted(core::SequenceNumber seq, core::SequenceNumber snapshot) const;
+    void UpdateMinSequence();
+
+    mutable std::shared_mutex mutex_;
+    std::map<core::SequenceNumber, State> states_;
+    std::unordered_map<std::string, core::SequenceNumber> names_;
+    std::atomic<core::SequenceNumber> min_seq_{core::Tag::kMaxSequenceNumber};
+    std::atomic<core::SequenceNumber> max_retired_seq_{0};
+    std::atomic<size_t> n_decided_{0};
+    std::atomic<bool> active_{false};
+}; // class CommitMap
+
+} // namespace db
+
+} // namespace mai
+
+#endif // MAI_DB_COMMIT_MAP_H_
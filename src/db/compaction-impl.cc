@@ -49,15 +49,24 @@ CompactionImpl::CompactionImpl(const std::string abs_db_path,
         return merger->error();
     }
     mutable_original_input()->clear();
-    merger->SeekToFirst();
+    if (begin_key().empty()) {
+        merger->SeekToFirst();
+    } else {
+        merger->Seek(KeyBoundle::MakeKey(begin_key(), Tag::kMaxSequenceNumber,
+                                         Tag::kFlagValueForSeek));
+    }
 
-    bool to_last_level = (target_level() == (Config::kMaxLevel - 1));
+    bool to_last_level = (target_level() == (cfd()->options().num_levels - 1));
     std::string current_user_key;
     bool has_current_user_key = false;
     SequenceNumber last_sequence_for_key = Tag::kMaxSequenceNumber;
     ParsedTaggedKey ikey;
     for (;merger->Valid(); merger->Next()) {
         KeyBoundle::ParseTaggedKey(merger->key(), &ikey);
+        if (!end_key().empty() &&
+            ikcmp_->ucmp()->Compare(ikey.user_key, end_key()) >= 0) {
+            break; // Out of this compaction's range.
+        }
         
         bool drop = false;
 
@@ -95,6 +104,12 @@ CompactionImpl::CompactionImpl(const std::string abs_db_path,
                 result->deletion_keys++;
                 result->deletion_size += merger->key().size();
                 result->deletion_size += merger->value().size();
+            } else if (ikey.tag.sequence_number() > smallest_snapshot()) {
+                // Some snapshots or not committed transactions need the
+                // sequence number.
+                builder->Add(merger->key(), merger->value());
+                result->compacted_size += (merger->key().size() +
+                                           merger->value().size());
             } else {
                 std::string key = KeyBoundle::MakeKey(ikey.user_key, 0,
                                                       Tag::kFlagValue);
@@ -110,6 +125,9 @@ CompactionImpl::CompactionImpl(const std::string abs_db_path,
                 builder->Add(merger->key(), merger->value());
                 result->compacted_size += (merger->key().size() +
                                            merger->value().size());
+                if (ikey.tag.flag() == Tag::kFlagDeletion) {
+                    result->tombstone_keys++;
+                }
             }
         }
         
@@ -125,6 +143,12 @@ CompactionImpl::CompactionImpl(const std::string abs_db_path,
         }
     }
     result->compacted_n_entries = builder->NumEntries();
+    if (builder->NumEntries() == 0) {
+        // All keys be dropped or out of range, the table builder can not
+        // finish an empty table.
+        builder->Abandon();
+        return Error::OK();
+    }
 
     Error rs = builder->Finish();
     if (!rs) {
@@ -137,7 +161,7 @@ Error CompactionImpl::IsBaseLevelForKey(int start_level, std::string_view key,
                                         bool *may_exists) {
     *may_exists = false;
     
-    if (start_level == Config::kMaxLevel - 1) {
+    if (start_level == cfd()->options().num_levels - 1) {
         return Error::OK();
     }
     for (int i = start_level; i < Config::kMaxLevel; ++i) {
@@ -147,13 +171,14 @@ Error CompactionImpl::IsBaseLevelForKey(int start_level, std::string_view key,
                 continue;
             }
             
-            base::intrusive_ptr<core::KeyFilter> filter;
-            Error rs = table_cache_->GetKeyFilter(cfd(), fmd->number, &filter);
+            bool may_exists_in_file = true;
+            Error rs = table_cache_->KeyMayExists(cfd(), fmd->number, key,
+                                                  &may_exists_in_file);
             if (!rs) {
                 *may_exists = true;
                 return rs;
             }
-            if (filter->MayExists(key)) {
+            if (may_exists_in_file) {
                 *may_exists = true;
                 Error::OK();
             }
@@ -164,7 +189,8 @@ Error CompactionImpl::IsBaseLevelForKey(int start_level, std::string_view key,
     
 bool CompactionImpl::IsBaseMemoryForKey(std::string_view key) const {
     for (const auto &table : in_mem_) {
-        if (table->KeyExists(key, Tag::kMaxSequenceNumber)) {
+        // Only the versions visible to all snapshots can hide older ones.
+        if (table->KeyExists(key, smallest_snapshot())) {
             return true;
         }
     }
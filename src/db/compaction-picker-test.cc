@@ -0,0 +1,181 @@
+#include "db/compaction-picker.h"
+#include "db/version.h"
+#include "db/column-family.h"
+#include "db/table-cache.h"
+#include "db/factory.h"
+#include "db/compaction.h"
+#include "mai/options.h"
+#include "mai/env.h"
+#include "gtest/gtest.h"
+
+namespace mai {
+
+namespace db {
+
+class CompactionPickerTest : public ::testing::Test {
+public:
+    CompactionPickerTest()
+        : abs_db_path_(env_->GetAbsolutePath("tests/cp-tmp"))
+        , factory_(Factory::NewDefault())
+        , table_cache_(new TableCache(abs_db_path_, Options{}, factory_.get())) {
+        int i = 0;
+        while (tmp_dirs[i]) {
+            env_->MakeDirectory(tmp_dirs[i++], false);
+        }
+    }
+
+    virtual ~CompactionPickerTest() {
+        int i = 0;
+        while (tmp_dirs[i]) {
+            env_->DeleteFile(tmp_dirs[i++], true);
+        }
+    }
+
+    static std::string Key(const char *key, core::SequenceNumber sn) {
+        return core::KeyBoundle::MakeKey(key, sn, core::Tag::kFlagValue);
+    }
+
+    static FileMetaData *NewFile(uint64_t number, const char *smallest,
+                                 const char *largest, uint64_t size) {
+        FileMetaData *fmd = new FileMetaData(number);
+        fmd->smallest_key = Key(smallest, number);
+        fmd->largest_key  = Key(largest, number);
+        fmd->size         = size;
+        return fmd;
+    }
+
+    Env *const env_ = Env::Default();
+    std::string abs_db_path_;
+    std::unique_ptr<Factory> factory_;
+    std::unique_ptr<TableCache> table_cache_;
+
+    static const char *tmp_dirs[];
+}; // class CompactionPickerTest
+
+const char *CompactionPickerTest::tmp_dirs[] = {
+    "tests/cp-00-static-targets",
+    "tests/cp-01-dynamic-targets",
+    "tests/cp-02-tombstone-density",
+    "tests/cp-tmp",
+    nullptr,
+};
+
+TEST_F(CompactionPickerTest, StaticTargets) {
+    VersionSet vets(tmp_dirs[0], Options{}, table_cache_.get());
+    ColumnFamilyOptions opts;
+    opts.num_levels = 5;
+    opts.max_bytes_for_level_base = 100 * base::kMB;
+
+    VersionPatch patch;
+    patch.AddColumnFamily(kDefaultColumnFamilyName, 0, "cc");
+    patch.CreaetFile(0, 0, NewFile(1, "aaaa", "bbbb", base::kMB));
+    patch.CreaetFile(0, 1, NewFile(2, "aaaa", "cccc", 80 * base::kMB));
+    patch.CreaetFile(0, 1, NewFile(3, "dddd", "eeee", 70 * base::kMB));
+    Error rs = vets.LogAndApply(opts, &patch, nullptr);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+
+    auto cfd = vets.column_families()->GetDefault();
+    Version *current = cfd->current();
+    ASSERT_EQ(1, current->base_level());
+    ASSERT_EQ(100 * base::kMB, current->level_max_bytes(1));
+    ASSERT_EQ(1000ULL * base::kMB, current->level_max_bytes(2));
+    ASSERT_EQ(100000ULL * base::kMB, current->level_max_bytes(4));
+    ASSERT_NEAR(1.5, current->level_compaction_score(1), 0.001);
+    ASSERT_EQ(1, current->compaction_level());
+
+    CompactionContext ctx;
+    ASSERT_TRUE(cfd->NeedsCompaction());
+    ASSERT_TRUE(cfd->PickCompaction(&ctx));
+    ASSERT_EQ(1, ctx.level);
+    ASSERT_EQ(2, ctx.output_level);
+    ASSERT_EQ(1, ctx.inputs[0].size());
+    ASSERT_EQ(2, ctx.inputs[0][0]->number);
+
+    // Level 1 and 2 are used.
+    ASSERT_FALSE(cfd->NeedsCompaction());
+    cfd->ReleaseCompaction(ctx);
+    ASSERT_TRUE(cfd->NeedsCompaction());
+}
+
+TEST_F(CompactionPickerTest, DynamicTargets) {
+    VersionSet vets(tmp_dirs[1], Options{}, table_cache_.get());
+    ColumnFamilyOptions opts;
+    opts.num_levels = 5;
+    opts.max_bytes_for_level_base = 100 * base::kMB;
+    opts.level_compaction_dynamic_level_bytes = true;
+
+    VersionPatch patch;
+    patch.AddColumnFamily(kDefaultColumnFamilyName, 0, "cc");
+    for (int i = 0; i < 10; ++i) {
+        patch.CreaetFile(0, 0, NewFile(i + 1, "aaaa", "bbbb", base::kMB));
+    }
+    patch.CreaetFile(0, 4, NewFile(20, "aaaa", "zzzz", 40000ULL * base::kMB));
+    Error rs = vets.LogAndApply(opts, &patch, nullptr);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+
+    // L4: 40000MB, L3: 4000MB, L2: 400MB, L1: 40MB < 100MB
+    auto cfd = vets.column_families()->GetDefault();
+    Version *current = cfd->current();
+    ASSERT_EQ(2, current->base_level());
+    ASSERT_EQ(0, current->level_max_bytes(1));
+    ASSERT_EQ(400 * base::kMB, current->level_max_bytes(2));
+    ASSERT_EQ(4000ULL * base::kMB, current->level_max_bytes(3));
+
+    CompactionContext ctx;
+    ASSERT_TRUE(cfd->PickCompaction(&ctx));
+    ASSERT_EQ(0, ctx.level);
+    ASSERT_EQ(2, ctx.output_level); // Skip the empty level 1.
+    ASSERT_EQ(10, ctx.inputs[0].size());
+    cfd->ReleaseCompaction(ctx);
+
+    // Level 1 has files, level 0 can not be compacted under it.
+    patch.Reset();
+    patch.CreaetFile(0, 1, NewFile(21, "aaaa", "bbbb", base::kMB));
+    rs = vets.LogAndApply(opts, &patch, nullptr);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    CompactionContext ctx2;
+    ASSERT_TRUE(cfd->PickCompaction(&ctx2));
+    ASSERT_EQ(1, ctx2.level);
+    ASSERT_EQ(2, ctx2.output_level);
+    ASSERT_FALSE(cfd->NeedsCompaction()); // Level 0 be blocked by level 1.
+    cfd->ReleaseCompaction(ctx2);
+}
+
+TEST_F(CompactionPickerTest, TombstoneDensity) {
+    VersionSet vets(tmp_dirs[2], Options{}, table_cache_.get());
+    ColumnFamilyOptions opts;
+    opts.max_bytes_for_level_base = 100 * base::kMB;
+
+    VersionPatch patch;
+    patch.AddColumnFamily(kDefaultColumnFamilyName, 0, "cc");
+    patch.CreaetFile(0, 1, NewFile(1, "aaaa", "bbbb", 40 * base::kMB));
+    patch.CreaetFile(0, 1, NewFile(2, "cccc", "dddd", 40 * base::kMB));
+    Error rs = vets.LogAndApply(opts, &patch, nullptr);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    auto cfd = vets.column_families()->GetDefault();
+    ASSERT_FALSE(cfd->NeedsCompaction());
+
+    // Deletions make level 1 exceed its target.
+    FileMetaData *fmd = NewFile(3, "eeee", "ffff", 20 * base::kMB);
+    fmd->num_entries   = 100;
+    fmd->num_deletions = 100;
+    patch.Reset();
+    patch.CreaetFile(0, 1, fmd);
+    rs = vets.LogAndApply(opts, &patch, nullptr);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(120 * base::kMB,
+              LevelCompactionPicker::CompensatedSize(cfd->current(), 1));
+    ASSERT_TRUE(cfd->NeedsCompaction());
+
+    // The file has most deletions be picked first.
+    CompactionContext ctx;
+    ASSERT_TRUE(cfd->PickCompaction(&ctx));
+    ASSERT_EQ(1, ctx.level);
+    ASSERT_EQ(1, ctx.inputs[0].size());
+    ASSERT_EQ(3, ctx.inputs[0][0]->number);
+    cfd->ReleaseCompaction(ctx);
+}
+
+} // namespace db
+
+} // namespace mai
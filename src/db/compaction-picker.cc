@@ -0,0 +1,255 @@
+#include "db/compaction-picker.h"
+#include "db/column-family.h"
+#include "db/compaction.h"
+#include "db/version.h"
+#include "glog/logging.h"
+#include <algorithm>
+
+namespace mai {
+
+namespace db {
+
+// Stores the minimal range that covers all entries in inputs in
+// *smallest, *largest.
+// REQUIRES: inputs is not empty
+static void GetRange(const std::vector<base::intrusive_ptr<FileMetaData>> &inputs,
+                     const core::InternalKeyComparator *ikcmp,
+                     std::string *smallest, std::string *largest) {
+    DCHECK(!inputs.empty());
+    smallest->clear();
+    largest->clear();
+    for (size_t i = 0; i < inputs.size(); i++) {
+        base::intrusive_ptr<FileMetaData> fmd = inputs[i];
+        if (i == 0) {
+            *smallest = fmd->smallest_key;
+            *largest = fmd->largest_key;
+        } else {
+            if (ikcmp->Compare(fmd->smallest_key, *smallest) < 0) {
+                *smallest = fmd->smallest_key;
+            }
+            if (ikcmp->Compare(fmd->largest_key, *largest) > 0) {
+                *largest = fmd->largest_key;
+            }
+        }
+    }
+}
+
+/*static*/
+CompactionPicker *CompactionPicker::New(const ColumnFamilyOptions &options) {
+    switch (options.compaction_style) {
+        case kCompactionStyleLevel:
+            return new LevelCompactionPicker(options);
+        default:
+            NOREACHED();
+            break;
+    }
+    return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// class LevelCompactionPicker
+////////////////////////////////////////////////////////////////////////////////
+
+LevelCompactionPicker::LevelCompactionPicker(const ColumnFamilyOptions &options)
+    : CompactionPicker(options)
+    , num_levels_(options.num_levels < 2 ? 2 :
+                  (options.num_levels > Config::kMaxLevel ? Config::kMaxLevel :
+                   options.num_levels)) {
+}
+
+/*virtual*/ void LevelCompactionPicker::ComputeScores(Version *version) const {
+    ComputeTargets(version);
+
+    const int l0_trigger = std::max(1, options().level0_file_num_compaction_trigger);
+    const uint64_t base_bytes = std::max<uint64_t>(1, options().max_bytes_for_level_base);
+    int best_level = -1;
+    double best_score = -1;
+    for (int level = 0; level < num_levels_ - 1; level++) {
+        double score;
+        if (level == 0) {
+            // We treat level-0 specially by bounding the number of files
+            // instead of number of bytes for two reasons:
+            //
+            // (1) With larger write-buffer sizes, it is nice not to do too
+            // many level-0 compactions.
+            //
+            // (2) The files in level-0 are merged on every read and
+            // therefore we wish to avoid too many files when the individual
+            // file size is small (perhaps because of a small write-buffer
+            // setting, or very high compression ratios, or lots of
+            // overwrites/deletions).
+            score = version->NumberLevelFiles(0) / static_cast<double>(l0_trigger);
+            if (options().level_compaction_dynamic_level_bytes) {
+                // Level 0 be compacted to base level directly, don't let it
+                // be too large.
+                score = std::max(score, static_cast<double>(CompensatedSize(version, 0)) /
+                                        base_bytes);
+            }
+        } else if (version->level_max_bytes(level) == 0) {
+            // The level upper than base level should be empty, move its files
+            // to the next level.
+            score = version->NumberLevelFiles(level) == 0 ? 0 :
+                    std::max(1.0, static_cast<double>(version->SizeLevelFiles(level)) /
+                                  base_bytes);
+        } else {
+            // Compute the ratio of current size to size limit.
+            score = static_cast<double>(CompensatedSize(version, level)) /
+                    version->level_max_bytes(level);
+        }
+        version->set_level_compaction_score(level, score);
+        if (score > best_score) {
+            best_level = level;
+            best_score = score;
+        }
+    }
+
+    version->set_compaction_level(best_level);
+    version->set_compaction_score(best_score);
+}
+
+/*virtual*/
+bool LevelCompactionPicker::NeedsCompaction(const ColumnFamilyImpl *cfd) const {
+    int output_level;
+    return PickLevel(cfd, &output_level) >= 0;
+}
+
+/*virtual*/ bool LevelCompactionPicker::PickCompaction(ColumnFamilyImpl *cfd,
+                                                       CompactionContext *ctx) const {
+    DCHECK(ctx != nullptr);
+    ctx->level = PickLevel(cfd, &ctx->output_level);
+    if (ctx->level < 0) {
+        return false;
+    }
+    DCHECK_LT(ctx->output_level, num_levels_);
+
+    Version *current = cfd->current();
+    const core::InternalKeyComparator *ikcmp = cfd->ikcmp();
+    const auto &files = current->level_files(ctx->level);
+    if (ctx->level > 0) {
+        // Compact the file has most deletions first, it frees more space.
+        double max_density = Config::kTombstoneDensityToCompact;
+        for (auto fmd : files) {
+            if (fmd->tombstone_density() > max_density) {
+                max_density = fmd->tombstone_density();
+                ctx->inputs[0].assign({fmd});
+            }
+        }
+    }
+    if (ctx->inputs[0].empty()) {
+        const std::string point = cfd->compaction_point(ctx->level);
+        for (auto fmd : files) {
+            if (point.empty() || ikcmp->Compare(point, fmd->largest_key) < 0) {
+                ctx->inputs[0].push_back(fmd);
+                break;
+            }
+        }
+    }
+    if (ctx->inputs[0].empty()) {
+        ctx->inputs[0].push_back(files[0]);
+    }
+
+    ctx->input_version = current;
+
+    std::string smallest, largest;
+    // Files in level 0 may overlap each other, so pick up all overlapping ones
+    if (ctx->level == 0) {
+        GetRange(ctx->inputs[0], ikcmp, &smallest, &largest);
+        // Note that the next call will discard the file we placed in
+        // c->inputs_[0] earlier and replace it with an overlapping set
+        // which will include the picked file.
+        current->GetOverlappingInputs(0, smallest, largest, &ctx->inputs[0]);
+        DCHECK(!ctx->inputs[0].empty());
+    }
+
+    GetRange(ctx->inputs[0], ikcmp, &smallest, &largest);
+    current->GetOverlappingInputs(ctx->output_level, smallest, largest,
+                                  &ctx->inputs[1]);
+
+    // Update the place where we will do the next compaction for this level.
+    // We update this immediately instead of waiting for the VersionEdit
+    // to be applied so that if the compaction fails, we will try a different
+    // key range next time.
+    cfd->set_compaction_point(ctx->level, largest);
+    ctx->patch.SetCompactionPoint(cfd->id(), ctx->level, largest);
+    return true;
+}
+
+/*static*/ uint64_t LevelCompactionPicker::CompensatedSize(Version *version,
+                                                           int level) {
+    uint64_t size = 0;
+    for (const auto &fmd : version->level_files(level)) {
+        // The deletions will free the space of overwritten keys in lower
+        // levels, so they are worth more than their own size.
+        size += static_cast<uint64_t>(fmd->size * (1 + fmd->tombstone_density()));
+    }
+    return size;
+}
+
+void LevelCompactionPicker::ComputeTargets(Version *version) const {
+    const uint64_t base_bytes = options().max_bytes_for_level_base;
+    const double multiplier = std::max(1.0, options().max_bytes_for_level_multiplier);
+    const int last_level = num_levels_ - 1;
+
+    for (int level = 0; level < Config::kMaxLevel; ++level) {
+        version->set_level_max_bytes(level, 0);
+    }
+    if (!options().level_compaction_dynamic_level_bytes) {
+        double target = base_bytes;
+        for (int level = 1; level <= last_level; ++level) {
+            version->set_level_max_bytes(level, static_cast<uint64_t>(target));
+            target *= multiplier;
+        }
+        version->set_base_level(1);
+        return;
+    }
+
+    double target = std::max<uint64_t>(version->SizeLevelFiles(last_level),
+                                       base_bytes);
+    int base_level = last_level;
+    version->set_level_max_bytes(last_level, static_cast<uint64_t>(target));
+    while (base_level > 1 && target / multiplier >= base_bytes) {
+        target /= multiplier;
+        version->set_level_max_bytes(--base_level, static_cast<uint64_t>(target));
+    }
+    version->set_base_level(base_level);
+}
+
+int LevelCompactionPicker::OutputLevel(Version *version, int level) const {
+    if (level > 0) {
+        return level + 1;
+    }
+    // Level 0 be compacted to base level, but if some upper levels still have
+    // files, the newer keys can not be put under them.
+    for (int i = 1; i < version->base_level(); ++i) {
+        if (version->NumberLevelFiles(i) > 0) {
+            return i;
+        }
+    }
+    return version->base_level();
+}
+
+// Pick the best level which is not used by other running compactions.
+// Compactions on disjoint level ranges can run in parallel.
+int LevelCompactionPicker::PickLevel(const ColumnFamilyImpl *cfd,
+                                     int *output_level) const {
+    Version *current = cfd->current();
+    int best_level = -1;
+    double best_score = 1.0;
+    for (int level = 0; level < num_levels_ - 1; level++) {
+        const int output = OutputLevel(current, level);
+        if (cfd->level_compacting(level) || cfd->level_compacting(output)) {
+            continue;
+        }
+        double score = current->level_compaction_score(level);
+        if (score >= best_score) {
+            best_level = level;
+            best_score = score;
+            *output_level = output;
+        }
+    }
+    return best_level;
+}
+
+} // namespace db
+
+} // namespace mai
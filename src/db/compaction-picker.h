@@ -0,0 +1,89 @@
+#ifndef MAI_DB_COMPACTION_PICKER_H_
+#define MAI_DB_COMPACTION_PICKER_H_
+
+#include "db/config.h"
+#include "base/base.h"
+#include "mai/options.h"
+
+namespace mai {
+
+namespace db {
+
+class Version;
+class ColumnFamilyImpl;
+struct CompactionContext;
+
+// The strategy of compaction: which levels need compaction and which files
+// be compacted. Every column family has its own picker, it be selected by
+// ColumnFamilyOptions::compaction_style.
+class CompactionPicker {
+public:
+    explicit CompactionPicker(const ColumnFamilyOptions &options)
+        : options_(options) {}
+    virtual ~CompactionPicker() {}
+
+    static CompactionPicker *New(const ColumnFamilyOptions &options);
+
+    DEF_VAL_GETTER(ColumnFamilyOptions, options);
+
+    // Compute the compaction scores of a new built version, score >= 1 means
+    // the level needs compaction.
+    virtual void ComputeScores(Version *version) const = 0;
+
+    // Has any compaction can run with the running compactions?
+    // REQUIRES: db mutex_.lock()
+    virtual bool NeedsCompaction(const ColumnFamilyImpl *cfd) const = 0;
+
+    // Pick the inputs of the next compaction from current version of cfd.
+    // REQUIRES: db mutex_.lock()
+    virtual bool PickCompaction(ColumnFamilyImpl *cfd,
+                                CompactionContext *ctx) const = 0;
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(CompactionPicker);
+private:
+    const ColumnFamilyOptions options_;
+}; // class CompactionPicker
+
+// Level 0 be scored by number of files, others by their sizes with targets.
+//
+// The static targets: level 1 is max_bytes_for_level_base and every next
+// level is multiplier times of its upper level.
+//
+// The dynamic targets: the last level's target is its size, every upper
+// level is 1/multiplier of its next level, until the base level whose target
+// not less than max_bytes_for_level_base. Level 0 be compacted to the base
+// level directly.
+//
+// The file with many deletions be weighted more, and be picked first.
+class LevelCompactionPicker final : public CompactionPicker {
+public:
+    explicit LevelCompactionPicker(const ColumnFamilyOptions &options);
+    virtual ~LevelCompactionPicker() override {}
+
+    virtual void ComputeScores(Version *version) const override;
+    virtual bool NeedsCompaction(const ColumnFamilyImpl *cfd) const override;
+    virtual bool PickCompaction(ColumnFamilyImpl *cfd,
+                                CompactionContext *ctx) const override;
+
+    // Size of level, the deletions be weighted by tombstone density.
+    static uint64_t CompensatedSize(Version *version, int level);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(LevelCompactionPicker);
+private:
+    void ComputeTargets(Version *version) const;
+
+    // The target level of level compaction.
+    int OutputLevel(Version *version, int level) const;
+
+    // The best level not used by running compactions, -1 if no one needs
+    // compaction.
+    int PickLevel(const ColumnFamilyImpl *cfd, int *output_level) const;
+
+    const int num_levels_;
+}; // class LevelCompactionPicker
+
+} // namespace db
+
+} // namespace mai
+
+#endif // MAI_DB_COMPACTION_PICKER_H_
@@ -68,7 +68,9 @@ public:
     
     void Compact(const std::vector<uint64_t> &inputs, int target_level,
                  core::SequenceNumber smallest_snapshot,
-                 uint64_t *target_file_number, CompactionResult *result) {
+                 uint64_t *target_file_number, CompactionResult *result,
+                 const std::string &begin_key = "",
+                 const std::string &end_key = "") {
         std::unique_ptr<Compaction>
         job(factory_->NewCompaction(abs_db_path_, &ikcmp_,
                                     table_cache_.get(), cfd_));
@@ -77,6 +79,8 @@ public:
         job->set_target_level(target_level);
         job->set_input_version(cfd_->current());
         job->set_smallest_snapshot(smallest_snapshot);
+        job->set_begin_key(begin_key);
+        job->set_end_key(end_key);
         job->set_target_file_number(versions_->GenerateFileNumber());
         if (target_file_number) {
             *target_file_number = job->target_file_number();
@@ -152,6 +156,94 @@ TEST_F(CompactionImplTest, Sanity) {
     ASSERT_TRUE(rs.IsNotFound());
 }
     
+TEST_F(CompactionImplTest, KeyRangeShards) {
+    auto fid = versions_->GenerateFileNumber();
+    auto name = cfd_->GetTableFileName(fid);
+    BuildTable({
+        "k1", "v1", "1",
+        "k2", "v2", "2",
+        "k3", "v4", "4",
+        "k3", "v3", "3",
+        "k4", "v5", "5",
+        "k5", "v6", "6",
+    }, name, default_tb_factory_);
+    AppendFile(fid, 0);
+    
+    uint64_t fid1, fid2;
+    CompactionResult result1, result2;
+    Compact({fid}, 1, 7, &fid1, &result1, "", "k3");
+    Compact({fid}, 1, 7, &fid2, &result2, "k3", "");
+    EXPECT_EQ(2, result1.compacted_n_entries);
+    EXPECT_EQ(3, result2.compacted_n_entries);
+    EXPECT_EQ(1, result2.deletion_keys);
+    
+    std::unique_ptr<RandomAccessFile> file;
+    std::unique_ptr<table::TableReader> reader;
+    NewReader(cfd_->GetTableFileName(fid1), &file, &reader, default_tr_factory_);
+    Error rs = static_cast<table::SstTableReader *>(reader.get())->Prepare();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    std::string value;
+    rs = Get(reader.get(), "k2", 7, &value, nullptr);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("v2", value);
+    rs = Get(reader.get(), "k3", 7, &value, nullptr);
+    ASSERT_TRUE(rs.IsNotFound());
+    
+    NewReader(cfd_->GetTableFileName(fid2), &file, &reader, default_tr_factory_);
+    rs = static_cast<table::SstTableReader *>(reader.get())->Prepare();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = Get(reader.get(), "k3", 7, &value, nullptr);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("v4", value);
+    rs = Get(reader.get(), "k1", 7, &value, nullptr);
+    ASSERT_TRUE(rs.IsNotFound());
+}
+    
+TEST_F(CompactionImplTest, EmptyShard) {
+    auto fid = versions_->GenerateFileNumber();
+    auto name = cfd_->GetTableFileName(fid);
+    BuildTable({
+        "k1", "v1", "1",
+        "k2", "v2", "2",
+        "k5", "v5", "5",
+    }, name, default_tb_factory_);
+    AppendFile(fid, 0);
+    
+    // No keys in range ["k3", "k4").
+    CompactionResult result;
+    Compact({fid}, 1, 7, nullptr, &result, "k3", "k4");
+    EXPECT_EQ(0, result.compacted_n_entries);
+}
+    
+TEST_F(CompactionImplTest, SplitCompaction) {
+    CompactionContext ctx;
+    ctx.level = 1;
+    const char *keys[] = {"e", "a", "g", "c"};
+    for (size_t i = 0; i < arraysize(keys); ++i) {
+        auto fmd = new FileMetaData(i + 1);
+        fmd->smallest_key = core::KeyBoundle::MakeKey(keys[i], 1,
+                                                      core::Tag::kFlagValue);
+        fmd->largest_key  = fmd->smallest_key;
+        ctx.inputs[i % 2].push_back(fmd);
+    }
+    
+    std::vector<std::string> boundaries;
+    cfd_->SplitCompaction(ctx, 1, &boundaries);
+    EXPECT_TRUE(boundaries.empty());
+    
+    cfd_->SplitCompaction(ctx, 3, &boundaries);
+    ASSERT_EQ(2, boundaries.size());
+    EXPECT_EQ("c", boundaries[0]);
+    EXPECT_EQ("e", boundaries[1]);
+    
+    cfd_->SplitCompaction(ctx, 10, &boundaries);
+    ASSERT_EQ(3, boundaries.size());
+    EXPECT_EQ("a", boundaries[0]);
+    EXPECT_EQ("c", boundaries[1]);
+    EXPECT_EQ("e", boundaries[2]);
+}
+    
 } // namespace db
     
 } // namespace mai
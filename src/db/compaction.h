@@ -29,6 +29,10 @@ public:
     DEF_VAL_PROP_RW(uint64_t, target_file_number);
     DEF_VAL_PROP_RW(core::SequenceNumber, smallest_snapshot);
     DEF_VAL_PROP_RW(std::string, compaction_point)
+    // The user key range [begin_key, end_key) of this compaction.
+    // Empty key means no limit.
+    DEF_VAL_PROP_RW(std::string, begin_key);
+    DEF_VAL_PROP_RW(std::string, end_key);
     DEF_VAL_GETTER(std::vector<Iterator *>, original_input);
     DEF_VAL_MUTABLE_GETTER(std::vector<Iterator *>, original_input);
     DEF_PTR_PROP_RW_NOTNULL2(Version, input_version);
@@ -44,6 +48,8 @@ private:
     uint64_t target_file_number_;
     core::SequenceNumber smallest_snapshot_;
     std::string compaction_point_;
+    std::string begin_key_;
+    std::string end_key_;
     std::vector<Iterator *> original_input_;
     Version *input_version_;
 }; // class Compaction
@@ -51,7 +57,8 @@ private:
 struct CompactionResult {
     std::string smallest_key;
     std::string largest_key;
-    size_t      deletion_keys = 0;
+    size_t      deletion_keys = 0;  // Dropped keys
+    size_t      tombstone_keys = 0; // Deletions be kept in output
     uint64_t    deletion_size = 0;
     uint64_t    compacted_size = 0;
     size_t      compacted_n_entries = 0;
@@ -59,6 +66,7 @@ struct CompactionResult {
     
 struct CompactionContext {
     int level = -1;
+    int output_level = -1; // inputs[1] are in this level.
     Version *input_version = nullptr;
     VersionPatch patch;
     std::vector<base::intrusive_ptr<FileMetaData>> inputs[2];
@@ -2,6 +2,7 @@
 #include "glog/logging.h"
 #include <stdlib.h>
 #include <limits>
+#include <algorithm>
 
 
 namespace mai {
@@ -12,6 +13,7 @@ namespace db {
                                           float conflict_factor,
                                           size_t limit_min_num_slots) {
     DCHECK_GE(conflict_factor, 0.0);
+    level = std::min(level, 3); // Deeper levels use the same factor.
     if (conflict_factor <= std::numeric_limits<float>::epsilon()) {
         return old_num_slots;
     }
@@ -38,6 +40,7 @@ namespace db {
         return 0;
     }
     DCHECK_GT(limit_min_num_slots, 0);
+    level = std::min(level, 3); // Deeper levels use the same factor.
     
     const float adjust_factor = 0.978f - (level * 0.212f);
     size_t result = n_entries * adjust_factor;
@@ -8,18 +8,28 @@ namespace mai {
 namespace db {
     
 struct Config final {
-    // lv0 : ...
-    // lv1 : 10GB
-    // lv2 : 100GB
-    // lv3 : no-limit
-    static const int kMaxLevel = 4;
-    static const int kMaxNumberLevel0File = 10; // the max of level0 file num
+    // The max number of levels, see ColumnFamilyOptions::num_levels.
+    static const int kMaxLevel = 7;
     static const int kMaxSizeLevel0File   = 400 * base::kMB;
     
+    // The file with more deletions than this ratio be picked first in
+    // its level, and its size be weighted more when computing level scores.
+    static constexpr double kTombstoneDensityToCompact = 0.5;
+    
     static const int kLimitMinNumberSlots = 17;
     
     static const int kMaxWalSyncMills = 1000; // 1 seconds
     
+    // The max bytes of a group commit write batch.
+    static const int kMaxWriteGroupSize   = 1 * base::kMB;
+    // If leader's batch is small, limit the group growth, avoid slow down
+    // the small write too much.
+    static const int kSmallWriteGroupSize = 128 * base::kKB;
+    
+    // All keys of external sst file be tagged by this sequence number. Not 0,
+    // because the sst table builder treats sequence 0 as last level format.
+    static const uint64_t kExternalFileSequenceNumber = 1;
+    
     static size_t ComputeNumSlots(int level, size_t old_num_slots,
                                   float conflict_factor,
                                   size_t limit_min_num_slots);
@@ -1,13 +1,24 @@
 #include "db/db-impl.h"
 #include "db/column-family.h"
 #include "db/table-cache.h"
+#include "db/version.h"
+#include "db/files.h"
+#include "table/block-cache.h"
 #include "base/slice.h"
+#include "base/thread-pool.h"
 #include "mai/iterator.h"
 #include "mai/env.h"
 #include "mai/helper.h"
+#include "mai/prefix-extractor.h"
+#include "mai/rate-limiter.h"
+#include "mai/perf-context.h"
+#include "mai/sst-file-writer.h"
 #include "gtest/gtest.h"
 #include <vector>
 #include <thread>
+#include <set>
+#include <mutex>
+#include <condition_variable>
 
 namespace mai {
     
@@ -64,6 +75,23 @@ const char *DBImplTest::tmp_dirs[] = {
     "tests/17-db-concurrent-get",
     "tests/18-db-get-properties",
     "tests/19-db-deletion",
+    "tests/20-db-group-commit",
+    "tests/21-db-bkg-jobs",
+    "tests/22-db-multi-get",
+    "tests/23-db-super-version",
+    "tests/24-db-pinned-get",
+    "tests/25-db-prefix-iterator",
+    "tests/26-db-parallel-memtable-write",
+    "tests/27-db-rate-limited-write",
+    "tests/28-db-perf-context",
+    "tests/29-db-recycle-wal",
+    "tests/30-db-ingest-files",
+    "tests/31-db-parallel-flush",
+    "tests/32-db-latest-sequence-for-keys",
+    "tests/33-db-subcompaction",
+    "tests/34-db-queued-immutable-logs",
+    "tests/35-db-latest-sequence-queued-tables",
+    "tests/36-db-reads-in-busy-background",
     nullptr,
 };
     
@@ -887,6 +915,1055 @@ TEST_F(DBImplTest, Deletion) {
     }
 }
 
+TEST_F(DBImplTest, GroupCommit) {
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[20], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    static const int kN = 1000;
+    static const int kThreads = 8;
+    auto cf0 = impl->DefaultColumnFamily();
+    std::thread thrds[kThreads];
+    for (int i = 0; i < kThreads; ++i) {
+        thrds[i] = std::thread([&](int slot) {
+            WriteOptions wr_opts;
+            wr_opts.sync = (slot % 2 == 0);
+            for (int j = 0; j < kN; ++j) {
+                std::string key = base::Sprintf("k.%d.%d", slot, j);
+                std::string val = base::Sprintf("v.%d.%d", slot, j);
+                Error rs = impl->Put(wr_opts, cf0, key, val);
+                ASSERT_TRUE(rs.ok()) << rs.ToString();
+            }
+        }, i);
+    }
+    for (int i = 0; i < kThreads; ++i) {
+        thrds[i].join();
+    }
+    
+    std::string value;
+    for (int i = 0; i < kThreads; ++i) {
+        for (int j = 0; j < kN; ++j) {
+            std::string key = base::Sprintf("k.%d.%d", i, j);
+            rs = impl->Get(ReadOptions{}, cf0, key, &value);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+            ASSERT_EQ(base::Sprintf("v.%d.%d", i, j), value);
+        }
+    }
+    
+    rs = impl->GetProperty("db.write.group-writers", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(std::to_string(kN * kThreads), value);
+    
+    rs = impl->GetProperty("db.write.group-count", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_LE(std::stoull(value), kN * kThreads);
+    EXPECT_EQ(kN * kThreads + 1, impl->GetLatestSequenceNumber());
+}
+    
+TEST_F(DBImplTest, ParallelMemoryTableWrite) {
+    options_.allow_concurrent_memtable_write = true;
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[26], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    static const int kN = 1000;
+    static const int kThreads = 8;
+    auto cf0 = impl->DefaultColumnFamily();
+    std::thread thrds[kThreads];
+    for (int i = 0; i < kThreads; ++i) {
+        thrds[i] = std::thread([&](int slot) {
+            for (int j = 0; j < kN; ++j) {
+                WriteBatch batch;
+                batch.Put(cf0, base::Sprintf("k.%d.%d", slot, j),
+                          base::Sprintf("v.%d.%d", slot, j));
+                batch.Put(cf0, base::Sprintf("k.%d.%d", slot, j), "v");
+                batch.Delete(cf0, base::Sprintf("k.%d.%d", slot, j - 1));
+                Error rs = impl->Write(WriteOptions{}, &batch);
+                ASSERT_TRUE(rs.ok()) << rs.ToString();
+            }
+        }, i);
+    }
+    for (int i = 0; i < kThreads; ++i) {
+        thrds[i].join();
+    }
+    
+    std::string value;
+    for (int i = 0; i < kThreads; ++i) {
+        for (int j = 0; j < kN - 1; ++j) {
+            rs = impl->Get(ReadOptions{}, cf0, base::Sprintf("k.%d.%d", i, j),
+                           &value);
+            ASSERT_TRUE(rs.IsNotFound()) << rs.ToString();
+        }
+        rs = impl->Get(ReadOptions{}, cf0, base::Sprintf("k.%d.%d", i, kN - 1),
+                       &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ("v", value);
+    }
+    EXPECT_EQ(kN * kThreads * 3 + 1, impl->GetLatestSequenceNumber());
+    
+    std::unique_ptr<Iterator> iter(impl->NewIterator(ReadOptions{}, cf0));
+    int n = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        n++;
+    }
+    ASSERT_TRUE(iter->error().ok()) << iter->error().ToString();
+    ASSERT_EQ(kThreads, n);
+}
+    
+TEST_F(DBImplTest, BackgroundJobs) {
+    Options options = options_;
+    options.max_background_jobs = 2;
+    
+    std::vector<ColumnFamilyDescriptor> descs = descs_;
+    descs[0].options.write_buffer_size = 256 * base::kKB;
+    
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[21], options));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    static const int kN = 100000;
+    auto cf0 = impl->DefaultColumnFamily();
+    std::string val(100, 'B');
+    for (int i = 0; i < kN; ++i) {
+        rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%d", i), val);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    
+    std::string value;
+    rs = impl->GetProperty("db.bkg.queue-depth", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = impl->GetProperty("db.bkg.running-flushes", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_LE(std::stoi(value), 1);
+    rs = impl->GetProperty("db.bkg.running-compactions", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_LE(std::stoi(value), descs[0].options.max_concurrent_compactions);
+    
+    // Waiting for all background jobs done.
+    while (true) {
+        rs = impl->GetProperty("db.bkg.jobs", &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        if (value == "0") {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    rs = impl->GetProperty("db.bkg.queue-depth", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("0", value);
+    PrintFiles(impl.get(), cf0);
+    
+    for (int i = 0; i < kN; i += 7) {
+        rs = impl->Get(ReadOptions{}, cf0, base::Sprintf("k.%d", i), &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ(val, value);
+    }
+}
+
+TEST_F(DBImplTest, MultiGet) {
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[22], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    static const int kN = 10000;
+    auto cf0 = impl->DefaultColumnFamily();
+    for (int i = 0; i < kN; ++i) {
+        rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%d", i),
+                       base::Sprintf("v.%d", i));
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    // Half keys in table files, the others in memory table.
+    rs = impl->TEST_ForceDumpImmutableTable(cf0, true);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    for (int i = 0; i < kN; i += 2) {
+        rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%d", i),
+                       base::Sprintf("u.%d", i));
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    for (int i = 0; i < kN; i += 3) {
+        rs = impl->Delete(WriteOptions{}, cf0, base::Sprintf("k.%d", i));
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    
+    std::vector<std::string> keys;
+    for (int i = kN + 100; i >= 0; --i) {
+        keys.push_back(base::Sprintf("k.%d", i));
+    }
+    keys.push_back("k.1");
+    keys.push_back("k.2");
+    std::vector<std::string_view> batch(keys.begin(), keys.end());
+    std::vector<std::string> values;
+    std::vector<Error> errors;
+    rs = impl->MultiGet(ReadOptions{}, cf0, batch, &values, &errors);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(keys.size(), values.size());
+    ASSERT_EQ(keys.size(), errors.size());
+    
+    std::string value;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        rs = impl->Get(ReadOptions{}, cf0, keys[i], &value);
+        ASSERT_EQ(rs.ok(), errors[i].ok()) << keys[i];
+        if (rs.ok()) {
+            ASSERT_EQ(value, values[i]) << keys[i];
+        } else {
+            ASSERT_TRUE(errors[i].IsNotFound()) << errors[i].ToString();
+        }
+    }
+    EXPECT_EQ("v.1", values[keys.size() - 2]);
+    EXPECT_EQ("u.2", values[keys.size() - 1]);
+}
+
+TEST_F(DBImplTest, SuperVersion) {
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[23], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    auto cf0 = impl->DefaultColumnFamily();
+    auto cfd = ColumnFamilyHandle::Cast(cf0)->impl();
+    rs = impl->Put(WriteOptions{}, cf0, "k.0", "v.0");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    auto sv0 = cfd->AcquireSuperVersion();
+    rs = impl->TEST_ForceDumpImmutableTable(cf0, true);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    auto sv1 = cfd->AcquireSuperVersion();
+    ASSERT_NE(sv0.get(), sv1.get());
+    EXPECT_TRUE(sv0->current->level_files(0).empty());
+    EXPECT_FALSE(sv1->current->level_files(0).empty());
+    EXPECT_TRUE(sv1->immutable_tables.empty());
+    
+    // The pinned memory table is still readable.
+    std::string value;
+    core::Tag tag;
+    rs = sv0->mutable_table->Get("k.0", impl->GetLatestSequenceNumber(), &tag,
+                                 &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("v.0", value);
+    
+    // Readers never miss the keys written before, during flushing.
+    static const int kN = 20000;
+    std::atomic<int> written(1);
+    std::thread writer([&]() {
+        for (int i = 1; i < kN; ++i) {
+            Error rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%d", i),
+                                 base::Sprintf("v.%d", i));
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+            written.store(i + 1);
+            if (i % 5000 == 0) {
+                rs = impl->TEST_ForceDumpImmutableTable(cf0, false);
+                ASSERT_TRUE(rs.ok()) << rs.ToString();
+            }
+        }
+    });
+    std::thread readers[4];
+    for (auto &reader : readers) {
+        reader = std::thread([&]() {
+            std::string value;
+            while (written.load() < kN) {
+                int i = written.load() - 1;
+                Error rs = impl->Get(ReadOptions{}, cf0,
+                                     base::Sprintf("k.%d", i), &value);
+                ASSERT_TRUE(rs.ok()) << rs.ToString() << " k." << i;
+                ASSERT_EQ(base::Sprintf("v.%d", i), value);
+            }
+        });
+    }
+    writer.join();
+    for (auto &reader : readers) {
+        reader.join();
+    }
+}
+
+TEST_F(DBImplTest, PinnedGet) {
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[24], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    static const int kN = 1000;
+    const std::string padding(4096, 'x');
+    auto cf0 = impl->DefaultColumnFamily();
+    for (int i = 0; i < kN; ++i) {
+        if (i == kN / 2) {
+            // Half keys in table files, the others in memory table.
+            rs = impl->TEST_ForceDumpImmutableTable(cf0, true);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+        rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%04d", i),
+                       base::Sprintf("v.%d.", i) + padding);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    
+    PinnableValue value;
+    for (int i = 0; i < kN; ++i) {
+        rs = impl->Get(ReadOptions{}, cf0, base::Sprintf("k.%04d", i), &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_TRUE(value.pinned());
+        ASSERT_EQ(base::Sprintf("v.%d.", i) + padding, value.value());
+    }
+    
+    // Pinned values still can be read after memory table dumped and the keys
+    // be overwritten.
+    PinnableValue in_file, in_mem;
+    rs = impl->Get(ReadOptions{}, cf0, "k.0000", &in_file);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = impl->Get(ReadOptions{}, cf0, base::Sprintf("k.%04d", kN - 1), &in_mem);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = impl->TEST_ForceDumpImmutableTable(cf0, true);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = impl->Put(WriteOptions{}, cf0, "k.0000", "new");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%04d", kN - 1), "new");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("v.0." + padding, in_file.value());
+    ASSERT_EQ(base::Sprintf("v.%d.", kN - 1) + padding, in_mem.value());
+    
+    std::string copied;
+    rs = impl->Get(ReadOptions{}, cf0, "k.0000", &copied);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("new", copied);
+    
+    // Reserve iterating pins values too.
+    std::unique_ptr<Iterator> iter(impl->NewIterator(ReadOptions{}, cf0));
+    int i = kN - 2;
+    for (iter->Seek("k.0998"); i > 0; iter->Prev()) {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(base::Sprintf("k.%04d", i), iter->key());
+        ASSERT_EQ(base::Sprintf("v.%d.", i) + padding, iter->value());
+        if (i < kN - 2) { // Not reserve direction before the first Prev().
+            iter->PinValue(&value);
+            ASSERT_TRUE(value.pinned());
+        }
+        i--;
+    }
+    // The pinned value is kept after iterator moved.
+    ASSERT_EQ("v.1." + padding, value.value());
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ("k.0000", iter->key());
+    ASSERT_EQ("new", iter->value());
+}
+
+TEST_F(DBImplTest, PrefixIterator) {
+    std::unique_ptr<PrefixExtractor> extractor(PrefixExtractor::NewFixed(4));
+    descs_[0].options.prefix_extractor = extractor.get();
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[25], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    static const int kN = 100;
+    static const char *kPrefixes[] = {"aaaa", "bbbb", "cccc"};
+    auto cf0 = impl->DefaultColumnFamily();
+    // One table file for every prefix.
+    for (auto prefix : kPrefixes) {
+        for (int i = 0; i < kN; ++i) {
+            rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("%s.%03d", prefix, i),
+                           base::Sprintf("v.%d", i));
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+        rs = impl->TEST_ForceDumpImmutableTable(cf0, true);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    rs = impl->Put(WriteOptions{}, cf0, "bbbb.100", "v.100");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    for (auto prefix : kPrefixes) {
+        const int n = ::strcmp(prefix, "bbbb") == 0 ? kN + 1 : kN;
+        ReadOptions rd_opts;
+        rd_opts.prefix = prefix;
+        std::unique_ptr<Iterator> iter(impl->NewIterator(rd_opts, cf0));
+        int i = 0;
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            ASSERT_EQ(base::Sprintf("%s.%03d", prefix, i), iter->key());
+            ASSERT_EQ(base::Sprintf("v.%d", i), iter->value());
+            i++;
+        }
+        ASSERT_EQ(n, i);
+        
+        for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+            i--;
+            ASSERT_EQ(base::Sprintf("%s.%03d", prefix, i), iter->key());
+        }
+        ASSERT_EQ(0, i);
+    }
+    
+    ReadOptions rd_opts;
+    rd_opts.prefix = "dddd";
+    std::unique_ptr<Iterator> iter(impl->NewIterator(rd_opts, cf0));
+    iter->SeekToFirst();
+    ASSERT_FALSE(iter->Valid());
+    iter->SeekToLast();
+    ASSERT_FALSE(iter->Valid());
+}
+
+TEST_F(DBImplTest, RateLimitedWrite) {
+    std::unique_ptr<RateLimiter> limiter(RateLimiter::NewGeneric(10 * base::kMB,
+                                                                 10 * 1000));
+    options_.rate_limiter = limiter.get();
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[27], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    static const int kN = 10000;
+    auto cf0 = impl->DefaultColumnFamily();
+    for (int i = 0; i < kN; ++i) {
+        rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%05d", i),
+                       base::Sprintf("v.%d", i));
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    rs = impl->TEST_ForceDumpImmutableTable(cf0, true);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    for (int i = 0; i < kN; i += 97) {
+        std::string value;
+        rs = impl->Get(ReadOptions{}, cf0, base::Sprintf("k.%05d", i), &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ(base::Sprintf("v.%d", i), value);
+    }
+    
+    ASSERT_GT(limiter->GetTotalBytes(RateLimiter::kIOPriorityWAL), 0);
+    ASSERT_GT(limiter->GetTotalBytes(RateLimiter::kIOPriorityFlush), 0);
+    ASSERT_EQ(0, limiter->GetTotalBytes(RateLimiter::kIOPriorityCompaction));
+    
+    std::string value;
+    rs = impl->GetProperty("db.rate-limiter.stats", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_NE(std::string::npos, value.find("flush: bytes="));
+    rs = impl->GetProperty("db.rate-limiter.bytes-per-sec", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(base::Sprintf("%d", 10 * base::kMB), value);
+}
+
+TEST_F(DBImplTest, PerfContextAndStatistics) {
+    options_.enable_statistics = true;
+    descs_[0].options.filter_partition_size = 0;
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[28], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    static const int kN = 1000;
+    auto cf0 = impl->DefaultColumnFamily();
+    // Two table files: [0, kN) and [kN, 2 * kN)
+    for (int i = 0; i < 2 * kN; ++i) {
+        rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%05d", i),
+                       base::Sprintf("v.%d", i));
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        if (i == kN - 1) {
+            rs = impl->TEST_ForceDumpImmutableTable(cf0, true);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+    }
+    rs = impl->TEST_ForceDumpImmutableTable(cf0, true);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    PerfContext::SetLevel(kPerfEnableTime);
+    PerfContext *ctx = PerfContext::Current();
+    ctx->Reset();
+    std::string value;
+    rs = impl->Get(ReadOptions{}, cf0, "k.00001", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    // The newer file be skipped by bloom filter.
+    ASSERT_GE(ctx->memtable_probes, 1);
+    ASSERT_EQ(2, ctx->sst_files_touched);
+    ASSERT_EQ(1, ctx->bloom_filter_useful);
+    ASSERT_EQ(0, ctx->bloom_filter_useless);
+    ASSERT_GE(ctx->block_cache_misses, 1);
+    ASSERT_GT(ctx->block_read_bytes, 0);
+    
+    ctx->Reset();
+    rs = impl->Get(ReadOptions{}, cf0, "k.00001", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_GE(ctx->block_cache_hits, 1);
+    ASSERT_EQ(0, ctx->block_cache_misses);
+    ASSERT_EQ(0, ctx->block_read_bytes);
+    
+    ctx->Reset();
+    WriteOptions wr_opts;
+    wr_opts.sync = true;
+    rs = impl->Put(wr_opts, cf0, "k.00001", "v.1");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_GT(ctx->wal_write_bytes, 0);
+    ASSERT_GT(ctx->wal_sync_nanos, 0);
+    ASSERT_NE(std::string::npos, ctx->ToString().find("wal_write_bytes = "));
+    
+    PerfContext::SetLevel(kPerfDisable);
+    ctx->Reset();
+    rs = impl->Get(ReadOptions{}, cf0, "k.00002", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("", ctx->ToString());
+    
+    std::unique_ptr<Iterator> iter(impl->NewIterator(ReadOptions{}, cf0));
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    }
+    rs = impl->Delete(WriteOptions{}, cf0, "k.00001");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    rs = impl->GetProperty("db.stats", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_NE(std::string::npos, value.find("db.get (micros): count=3 "));
+    ASSERT_NE(std::string::npos, value.find("db.put (micros): count=2001 "));
+    ASSERT_NE(std::string::npos, value.find("db.delete (micros): count=1 "));
+    ASSERT_NE(std::string::npos, value.find("db.seek (micros): count=1 "));
+    ASSERT_NE(std::string::npos, value.find("db.next (micros): count=2000 "));
+    ASSERT_NE(std::string::npos, value.find("db.flush (micros): count=2 "));
+    ASSERT_NE(std::string::npos, value.find("p999="));
+}
+
+TEST_F(DBImplTest, RecycleAndCompressWal) {
+    options_.recycle_log_file_num = 2;
+    options_.wal_compression = kLZ4Compression;
+    options_.wal_preallocate_size = 64 * base::kKB;
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[29], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    static const int kN = 100;
+    auto cf0 = impl->DefaultColumnFamily();
+    for (int round = 0; round < 4; ++round) {
+        for (int i = 0; i < kN; ++i) {
+            std::string value(base::Sprintf("v.%d.%d.", round, i));
+            value.resize(2000, 'v');
+            rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%05d", i), value);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+        rs = impl->TEST_ForceDumpImmutableTable(cf0, true);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    // These keys only in the recycled log file, and the stale records of
+    // previous log follow them.
+    for (int i = 0; i < 10; ++i) {
+        rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%05d", i),
+                       base::Sprintf("new.%d", i));
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    
+    std::vector<std::string> children;
+    rs = env_->GetChildren(tmp_dirs[29], &children);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    int n_logs = 0;
+    for (const auto &name : children) {
+        if (std::get<0>(Files::ParseName(name)) == Files::kLog) {
+            n_logs++;
+        }
+    }
+    // The current log and recycled logs.
+    ASSERT_LE(n_logs, 1 + 2);
+    
+    scope.ReleaseAll();
+    impl.reset(new DBImpl(tmp_dirs[29], options_));
+    scope.Attach(impl.get());
+    rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    cf0 = impl->DefaultColumnFamily();
+    for (int i = 0; i < kN; ++i) {
+        std::string value;
+        rs = impl->Get(ReadOptions{}, cf0, base::Sprintf("k.%05d", i), &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        if (i < 10) {
+            ASSERT_EQ(base::Sprintf("new.%d", i), value);
+        } else {
+            ASSERT_EQ(0, value.find(base::Sprintf("v.3.%d.", i)));
+        }
+    }
+    
+    // Append after the last good record of recovered log.
+    rs = impl->Put(WriteOptions{}, cf0, "k.00000", "newer");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    scope.ReleaseAll();
+    impl.reset(new DBImpl(tmp_dirs[29], options_));
+    scope.Attach(impl.get());
+    rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    std::string value;
+    rs = impl->Get(ReadOptions{}, impl->DefaultColumnFamily(), "k.00000", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("newer", value);
+    rs = impl->Get(ReadOptions{}, impl->DefaultColumnFamily(), "k.00009", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("new.9", value);
+}
+
+TEST_F(DBImplTest, IngestExternalFiles) {
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[30], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    static const int kN = 1000;
+    std::string file1 = std::string(tmp_dirs[30]) + "/ingest-1.sst";
+    std::unique_ptr<SstFileWriter> writer(SstFileWriter::New(ColumnFamilyOptions{},
+                                                             env_, kN));
+    rs = writer->Open(file1);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    for (int i = 0; i < kN; ++i) {
+        rs = writer->Put(base::Sprintf("k.%05d", i), base::Sprintf("v.%d", i));
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    rs = writer->Put("k.00000", "v");
+    ASSERT_TRUE(rs.fail());
+    rs = writer->Finish();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(kN, writer->NumEntries());
+    
+    // No overlapping, so be placed at the last level.
+    auto cf0 = impl->DefaultColumnFamily();
+    rs = impl->IngestExternalFiles(IngestExternalFileOptions{}, cf0, {file1});
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    auto cfd = ColumnFamilyHandle::Cast(cf0)->impl();
+    ASSERT_EQ(1, cfd->current()->level_files(cfd->options().num_levels - 1).size());
+    std::string value;
+    
+    rs = impl->Put(WriteOptions{}, cf0, "k.00001", "old");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = impl->Put(WriteOptions{}, cf0, "k.00003", "old");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    // Overlap with the memory table and file1.
+    std::string file2 = std::string(tmp_dirs[30]) + "/ingest-2.sst";
+    rs = writer->Open(file2);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = writer->Put("k.00001", "ingested");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = writer->Delete("k.00002");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = writer->Finish();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    IngestExternalFileOptions opts;
+    opts.move_files = true;
+    rs = impl->IngestExternalFiles(opts, cf0, {file2});
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_TRUE(env_->FileExists(file2).fail());
+    
+    for (int pass = 0; pass < 2; ++pass) {
+        rs = impl->Get(ReadOptions{}, cf0, "k.00000", &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ("v.0", value);
+        rs = impl->Get(ReadOptions{}, cf0, "k.00001", &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ("ingested", value);
+        rs = impl->Get(ReadOptions{}, cf0, "k.00002", &value);
+        ASSERT_TRUE(rs.IsNotFound()) << rs.ToString();
+        rs = impl->Get(ReadOptions{}, cf0, "k.00003", &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ("old", value);
+        rs = impl->Get(ReadOptions{}, cf0, "k.00999", &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ("v.999", value);
+        
+        scope.ReleaseAll();
+        impl.reset(new DBImpl(tmp_dirs[30], options_));
+        scope.Attach(impl.get());
+        rs = impl->Open(descs_, scope.ReceiveAll());
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        cf0 = impl->DefaultColumnFamily();
+    }
+    
+    // The snapshot taken before ingesting can not see the ingested keys.
+    const Snapshot *snapshot = impl->GetSnapshot();
+    std::string file3 = std::string(tmp_dirs[30]) + "/ingest-3.sst";
+    rs = writer->Open(file3);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = writer->Put("k.00005", "ingested");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = writer->Finish();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = impl->IngestExternalFiles(IngestExternalFileOptions{}, cf0, {file3});
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ReadOptions rd_opts;
+    rd_opts.snapshot = snapshot;
+    rs = impl->Get(rd_opts, cf0, "k.00005", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("v.5", value);
+    rs = impl->Get(ReadOptions{}, cf0, "k.00005", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("ingested", value);
+    {
+        std::unique_ptr<Iterator> iter(impl->NewIterator(rd_opts, cf0));
+        iter->Seek("k.00005");
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ("k.00005", iter->key());
+        ASSERT_EQ("v.5", iter->value());
+        
+        iter.reset(impl->NewIterator(ReadOptions{}, cf0));
+        iter->Seek("k.00005");
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ("k.00005", iter->key());
+        ASSERT_EQ("ingested", iter->value());
+        iter->Prev();
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ("k.00004", iter->key());
+        iter->Next();
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ("ingested", iter->value());
+    }
+    impl->ReleaseSnapshot(snapshot);
+    
+    // The file be not rewritten, its global sequence number must be
+    // recovered from manifest.
+    scope.ReleaseAll();
+    impl.reset(new DBImpl(tmp_dirs[30], options_));
+    scope.Attach(impl.get());
+    rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    cf0 = impl->DefaultColumnFamily();
+    rs = impl->Get(ReadOptions{}, cf0, "k.00005", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("ingested", value);
+    rs = impl->Put(WriteOptions{}, cf0, "k.00005", "newer");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = impl->Get(ReadOptions{}, cf0, "k.00005", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("newer", value);
+    
+    // The file be not built by SstFileWriter.
+    rs = impl->IngestExternalFiles(IngestExternalFileOptions{}, cf0,
+                                   {std::string(tmp_dirs[30]) + "/not-exists"});
+    ASSERT_TRUE(rs.fail());
+    
+    // The rejected files be not moved.
+    std::vector<std::string> overlapped;
+    for (int i = 4; i < 6; ++i) {
+        overlapped.push_back(base::Sprintf("%s/ingest-%d.sst", tmp_dirs[30], i));
+        rs = writer->Open(overlapped.back());
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        rs = writer->Put("k.00007", "ingested");
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        rs = writer->Finish();
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    rs = impl->IngestExternalFiles(opts, cf0, overlapped);
+    ASSERT_TRUE(rs.fail());
+    for (const auto &file : overlapped) {
+        ASSERT_TRUE(env_->FileExists(file).ok()) << file;
+    }
+}
+    
+TEST_F(DBImplTest, ParallelFlush) {
+    Options options = options_;
+    options.max_parallel_flushes = 4;
+    std::vector<ColumnFamilyDescriptor> descs = descs_;
+    descs[0].options.write_buffer_size = 64 * base::kKB;
+    
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[31], options));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    // Every round overwrites all keys, the newer memory tables must win
+    // even if they are flushed at the same time.
+    static const int kN = 2000;
+    static const int kRounds = 5;
+    auto cf0 = impl->DefaultColumnFamily();
+    for (int round = 0; round < kRounds; ++round) {
+        for (int i = 0; i < kN; ++i) {
+            std::string value(base::Sprintf("v.%d.%d.", round, i));
+            value.resize(100, 'v');
+            rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%05d", i), value);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+    }
+    rs = impl->TEST_ForceDumpImmutableTable(cf0, true);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    for (int pass = 0; pass < 2; ++pass) {
+        std::string value;
+        for (int i = 0; i < kN; ++i) {
+            rs = impl->Get(ReadOptions{}, cf0, base::Sprintf("k.%05d", i), &value);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+            ASSERT_EQ(0, value.find(base::Sprintf("v.%d.%d.", kRounds - 1, i)));
+        }
+        
+        scope.ReleaseAll();
+        impl.reset(new DBImpl(tmp_dirs[31], options));
+        scope.Attach(impl.get());
+        rs = impl->Open(descs, scope.ReceiveAll());
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        cf0 = impl->DefaultColumnFamily();
+    }
+}
+    
+TEST_F(DBImplTest, GetLatestSequenceForKeys) {
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[32], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    auto cf0 = impl->DefaultColumnFamily();
+    WriteOptions wr_opts;
+    ASSERT_TRUE(impl->Put(wr_opts, cf0, "k.1", "v").ok());
+    core::SequenceNumber seq1 = impl->GetLatestSequenceNumber();
+    ASSERT_TRUE(impl->Put(wr_opts, cf0, "k.2", "v").ok());
+    rs = impl->TEST_ForceDumpImmutableTable(cf0, true);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_TRUE(impl->Put(wr_opts, cf0, "k.2", "v").ok());
+    core::SequenceNumber seq2 = impl->GetLatestSequenceNumber();
+    ASSERT_TRUE(impl->Put(wr_opts, cf0, "k.3", "v").ok());
+    core::SequenceNumber seq3 = impl->GetLatestSequenceNumber();
+    
+    auto cfd = ColumnFamilyHandle::Cast(cf0)->impl();
+    std::vector<core::SequenceNumber> seqs;
+    rs = impl->GetLatestSequenceForKeys(cfd, {"k.0", "k.1", "k.2", "k.3"}, &seqs);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(4, seqs.size());
+    EXPECT_EQ(core::Tag::kMaxSequenceNumber, seqs[0]);
+    EXPECT_GE(seq1, seqs[1]); // In SST file
+    EXPECT_GE(seq2, seqs[2]);
+    EXPECT_LT(seq1, seqs[2]);
+    EXPECT_GE(seq3, seqs[3]);
+    EXPECT_LT(seq2, seqs[3]);
+}
+    
+TEST_F(DBImplTest, Subcompaction) {
+    Options options = options_;
+    options.max_subcompactions = 4;
+    options.min_subcompaction_size = 1; // Split every compaction.
+    std::vector<ColumnFamilyDescriptor> descs = descs_;
+    descs[0].options.write_buffer_size = 64 * base::kKB;
+    
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[33], options));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    // Deleted keys make some shards empty.
+    static const int kN = 20000;
+    auto cf0 = impl->DefaultColumnFamily();
+    std::string val(100, 'S');
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < kN; ++i) {
+            std::string key(base::Sprintf("k.%05d", i));
+            if (round > 0 && (i / 1000) % 2) {
+                rs = impl->Delete(WriteOptions{}, cf0, key);
+            } else {
+                rs = impl->Put(WriteOptions{}, cf0, key, val);
+            }
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+    }
+    
+    std::string value;
+    while (true) {
+        rs = impl->GetProperty("db.bkg.jobs", &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        if (value == "0") {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    
+    for (int i = 0; i < kN; i += 7) {
+        rs = impl->Get(ReadOptions{}, cf0, base::Sprintf("k.%05d", i), &value);
+        if ((i / 1000) % 2) {
+            ASSERT_TRUE(rs.IsNotFound()) << i;
+        } else {
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+            ASSERT_EQ(val, value);
+        }
+    }
+}
+
+TEST_F(DBImplTest, QueuedImmutableLogs) {
+    options_.max_parallel_flushes = 4;
+    options_.recycle_log_file_num = 2;
+    // Declare before DB, the blocking jobs use them until DB closed.
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool release = false;
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[34], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    // Block all background threads, so the immutable tables stay in queue.
+    base::ThreadPool *pool = impl->TEST_GetBackgroundPool();
+    for (int i = 0; i < pool->n_threads(); ++i) {
+        pool->Schedule(base::ThreadPool::kHigh, [&] () {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] () { return release; });
+        });
+    }
+    
+    auto log_numbers = [this] () {
+        std::vector<std::string> children;
+        Error rs = env_->GetChildren(tmp_dirs[34], &children);
+        EXPECT_TRUE(rs.ok()) << rs.ToString();
+        std::set<uint64_t> numbers;
+        for (const auto &name : children) {
+            auto parsed = Files::ParseName(name);
+            if (std::get<0>(parsed) == Files::kLog) {
+                numbers.insert(std::get<1>(parsed));
+            }
+        }
+        return numbers;
+    };
+    
+    static const int kRounds = 3;
+    auto cf0 = impl->DefaultColumnFamily();
+    for (int round = 0; round < kRounds; ++round) {
+        rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%d", round), "v");
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        rs = impl->TEST_ForceDumpImmutableTable(cf0, false);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    std::set<uint64_t> live = log_numbers();
+    
+    // The cleanup of compaction must keep the logs of queued tables, and not
+    // recycle them for the next log.
+    impl->TEST_DeleteObsoleteFiles(cf0);
+    rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%d", kRounds), "v");
+    if (rs.ok()) {
+        rs = impl->TEST_ForceDumpImmutableTable(cf0, false);
+    }
+    std::set<uint64_t> numbers = log_numbers();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(kRounds + 1, live.size());
+    for (auto number : live) {
+        ASSERT_EQ(1, numbers.count(number)) << number;
+    }
+    
+    scope.ReleaseAll();
+    impl.reset(new DBImpl(tmp_dirs[34], options_));
+    scope.Attach(impl.get());
+    rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    cf0 = impl->DefaultColumnFamily();
+    for (int round = 0; round <= kRounds; ++round) {
+        std::string value;
+        rs = impl->Get(ReadOptions{}, cf0, base::Sprintf("k.%d", round), &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ("v", value);
+    }
+}
+
+TEST_F(DBImplTest, LatestSequenceInQueuedTables) {
+    options_.max_parallel_flushes = 4;
+    // Declare before DB, the blocking jobs use them until DB closed.
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool release = false;
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[35], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    // Block all background threads, so the immutable tables stay in queue.
+    base::ThreadPool *pool = impl->TEST_GetBackgroundPool();
+    for (int i = 0; i < pool->n_threads(); ++i) {
+        pool->Schedule(base::ThreadPool::kHigh, [&] () {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] () { return release; });
+        });
+    }
+    
+    auto cf0 = impl->DefaultColumnFamily();
+    auto cfd = ColumnFamilyHandle::Cast(cf0)->impl();
+    core::SequenceNumber latest = 0, single = 0;
+    size_t n_queued = 0;
+    std::vector<core::SequenceNumber> seqs;
+    for (int i = 0; i < 2; ++i) {
+        rs = impl->Put(WriteOptions{}, cf0, "k.1", base::Sprintf("v.%d", i));
+        if (rs.ok()) {
+            latest = impl->GetLatestSequenceNumber();
+            rs = impl->TEST_ForceDumpImmutableTable(cf0, false);
+        }
+    }
+    if (rs.ok()) {
+        rs = impl->GetLatestSequenceForKey(cfd, true, "k.1", &single);
+    }
+    if (rs.ok()) {
+        rs = impl->GetLatestSequenceForKeys(cfd, {"k.1"}, &seqs);
+    }
+    if (rs.ok()) {
+        n_queued = cfd->immutable_pipeline()->size();
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(2, n_queued);
+    // The newer immutable table wins.
+    ASSERT_EQ(latest, single);
+    ASSERT_EQ(1, seqs.size());
+    ASSERT_EQ(latest, seqs[0]);
+}
+    
+TEST_F(DBImplTest, ReadsInBusyBackground) {
+    // Declare before DB, the blocking jobs use them until DB closed.
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool release = false;
+    std::unique_ptr<DBImpl> impl(new DBImpl(tmp_dirs[36], options_));
+    ColumnFamilyCollection scope(impl.get());
+    auto rs = impl->Open(descs_, scope.ReceiveAll());
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    static const int kN = 10000;
+    auto cf0 = impl->DefaultColumnFamily();
+    for (int i = 0; i < kN; ++i) {
+        rs = impl->Put(WriteOptions{}, cf0, base::Sprintf("k.%05d", i),
+                       base::Sprintf("v.%d", i));
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    rs = impl->TEST_ForceDumpImmutableTable(cf0, true);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    // The reads use their own pool, not the threads of flush jobs.
+    base::ThreadPool *pool = impl->TEST_GetBackgroundPool();
+    ASSERT_NE(pool, impl->TEST_GetTableCache()->block_cache()->io_pool());
+    // Block all background threads, the reads still be done.
+    for (int i = 0; i < pool->n_threads(); ++i) {
+        pool->Schedule(base::ThreadPool::kHigh, [&] () {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] () { return release; });
+        });
+    }
+    
+    int n_iterated = 0;
+    std::unique_ptr<Iterator> iter(impl->NewIterator(ReadOptions{}, cf0));
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        n_iterated++;
+    }
+    iter.reset();
+    
+    std::vector<std::string> keys;
+    for (int i = 0; i < kN; i += 7) {
+        keys.push_back(base::Sprintf("k.%05d", i));
+    }
+    std::vector<std::string_view> batch(keys.begin(), keys.end());
+    std::vector<std::string> values;
+    std::vector<Error> errors;
+    rs = impl->MultiGet(ReadOptions{}, cf0, batch, &values, &errors);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(kN, n_iterated);
+    ASSERT_EQ(keys.size(), values.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_TRUE(errors[i].ok()) << errors[i].ToString();
+        ASSERT_EQ(base::Sprintf("v.%d", static_cast<int>(i) * 7), values[i]);
+    }
+}
+
 } // namespace db
     
 } // namespace mai
@@ -10,29 +10,51 @@
 #include "db/compaction.h"
 #include "db/snapshot-impl.h"
 #include "db/db-iterator.h"
+#include "db/statistics.h"
+#include "db/recent-writes.h"
+#include "db/commit-map.h"
 #include "table/table-builder.h"
 #include "table/table.h"
 #include "table/block-cache.h"
 #include "core/key-boundle.h"
 #include "core/memory-table.h"
 #include "core/merging.h"
+#include "core/perf-context-impl.h"
 #include "base/slice.h"
+#include "base/io-utils.h"
 #include "mai/env.h"
 #include "mai/iterator.h"
 #include "glog/logging.h"
 #include <thread>
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
 
 namespace mai {
     
 namespace db {
     
+// Memory tables of column families, by column family id.
+using MemoryTableMap =
+    std::unordered_map<uint32_t, base::intrusive_ptr<core::MemoryTable>>;
+    
 class WritingHandler final : public WriteBatch::Stub {
 public:
     WritingHandler(uint64_t redo_log_number, bool filter,
-                   ColumnFamilySet *column_families)
+                   ColumnFamilySet *column_families, CommitMap *commit_map)
         : redo_log_number_(redo_log_number)
         , filter_(filter)
-        , column_families_(DCHECK_NOTNULL(column_families)) {}
+        , column_families_(DCHECK_NOTNULL(column_families))
+        , commit_map_(DCHECK_NOTNULL(commit_map)) {}
+    
+    // Put into the tables by ConcurrentPut(), the tables be got by leader
+    // of write group, so no need DB lock.
+    WritingHandler(const MemoryTableMap *tables, CommitMap *commit_map)
+        : redo_log_number_(0)
+        , filter_(false)
+        , column_families_(nullptr)
+        , tables_(DCHECK_NOTNULL(tables))
+        , commit_map_(DCHECK_NOTNULL(commit_map)) {}
     
     virtual ~WritingHandler() {}
     
@@ -40,9 +62,18 @@ public:
                      std::string_view value) override {
         base::intrusive_ptr<core::MemoryTable> table;
         EnsureGetTable(cfid, &table);
+        if (preparing_) {
+            core::KeyBoundle::MakeRedo(key, value, cfid, core::Tag::kFlagValue,
+                                       &prepared_entries_);
+        }
         
         if (!table.is_null()) {
-            table->Put(key, value, sequence_number(), core::Tag::kFlagValue);
+            if (tables_) {
+                table->ConcurrentPut(key, value, sequence_number(),
+                                     core::Tag::kFlagValue);
+            } else {
+                table->Put(key, value, sequence_number(), core::Tag::kFlagValue);
+            }
             
             size_count_ += key.size() + sizeof(uint32_t) + sizeof(uint64_t);
             size_count_ += value.size();
@@ -53,22 +84,70 @@ public:
     virtual void Delete(uint32_t cfid, std::string_view key) override {
         base::intrusive_ptr<core::MemoryTable> table;
         EnsureGetTable(cfid, &table);
+        if (preparing_) {
+            core::KeyBoundle::MakeRedo(key, "", cfid, core::Tag::kFlagDeletion,
+                                       &prepared_entries_);
+        }
 
         if (!table.is_null()) {
-            table->Put(key, "", sequence_number(), core::Tag::kFlagDeletion);
+            if (tables_) {
+                table->ConcurrentPut(key, "", sequence_number(),
+                                     core::Tag::kFlagDeletion);
+            } else {
+                table->Put(key, "", sequence_number(), core::Tag::kFlagDeletion);
+            }
             size_count_ += key.size() + sizeof(uint32_t) + sizeof(uint64_t);
         }
         sequence_number_count_ ++;
     }
     
+    virtual void MarkBeginPrepare() override {
+        DCHECK(!preparing_);
+        preparing_ = true;
+        prepared_seq_ = sequence_number();
+        prepared_entries_.clear();
+        // The prepared batch may be written again by renewed log file.
+        replayed_ = commit_map_->Contains(prepared_seq_);
+    }
+    
+    virtual void MarkEndPrepare(std::string_view name) override {
+        DCHECK(preparing_);
+        if (!replayed_) {
+            commit_map_->AddPrepared(name, prepared_seq_,
+                                     static_cast<uint32_t>(sequence_number() -
+                                                           prepared_seq_),
+                                     &prepared_entries_);
+        }
+        preparing_ = false;
+        replayed_  = false;
+    }
+    
+    virtual void MarkCommit(std::string_view name) override {
+        commit_map_->Commit(name, sequence_number());
+        sequence_number_count_ ++;
+    }
+    
+    virtual void MarkRollback(std::string_view name) override {
+        commit_map_->Rollback(name, sequence_number());
+        sequence_number_count_ ++;
+    }
+    
     core::SequenceNumber sequence_number() const {
         return last_sequence_number_ + sequence_number_count_;
     }
     
     bool EnsureGetTable(uint32_t cfid, base::intrusive_ptr<core::MemoryTable> *table) {
+        if (tables_) {
+            auto iter = tables_->find(cfid);
+            DCHECK(iter != tables_->end());
+            *table = iter->second;
+            return true;
+        }
         ColumnFamilyImpl *impl = (cfid == 0) ? column_families_->GetDefault() :
             EnsureGetColumnFamily(cfid);
-        if (filter_ && impl->redo_log_number() < redo_log_number_) {
+        if (replayed_) {
+            *table = nullptr; // Has been inserted by the first one.
+        } else if (filter_ && impl->redo_log_number() < redo_log_number_) {
             *table = nullptr;
         } else {
             *table = impl->mutable_table();
@@ -96,10 +175,16 @@ private:
     const uint64_t redo_log_number_;
     const bool filter_;
     ColumnFamilySet *const column_families_;
+    const MemoryTableMap *const tables_ = nullptr;
+    CommitMap *const commit_map_;
     
     core::SequenceNumber last_sequence_number_;
     uint64_t size_count_ = 0;
     uint64_t sequence_number_count_ = 0;
+    bool preparing_ = false;
+    bool replayed_ = false;
+    core::SequenceNumber prepared_seq_ = 0;
+    std::string prepared_entries_;
 }; // class WritingHnalder
     
 
@@ -107,8 +192,112 @@ struct GetContext {
     std::vector<base::intrusive_ptr<core::MemoryTable>> in_mem;
     core::SequenceNumber                  last_sequence_number;
     base::intrusive_ptr<ColumnFamilyImpl> cfd;
+    base::intrusive_ptr<SuperVersion>     super_version;
     Version                              *current;
 }; // struct ReadContext
+    
+static void MemoryTableCleanup(void *arg1, void */*arg2*/) {
+    static_cast<core::MemoryTable *>(arg1)->ReleaseRef();
+}
+    
+static void SnapshotCleanup(void *arg1, void *arg2) {
+    static_cast<DBImpl *>(arg1)->ReleaseSnapshot(static_cast<Snapshot *>(arg2));
+}
+    
+// If the found version is not visible, the older versions should be looked
+// up by the next sequence number.
+static inline bool IsVisible(const CommitMap *commit_map,
+                             core::SequenceNumber snapshot, core::Tag tag,
+                             core::SequenceNumber *next) {
+    if (commit_map->IsVisible(tag.sequence_number(), snapshot)) {
+        return true;
+    }
+    DCHECK_GT(tag.sequence_number(), 0);
+    *next = tag.sequence_number() - 1;
+    return false;
+}
+    
+// The batch with markers of two-phase commit.
+class TwoPhaseBatch final : public WriteBatch {
+public:
+    TwoPhaseBatch() {}
+    
+    void BeginPrepare() { AddMarker(kMarkBeginPrepare, ""); }
+    void EndPrepare(std::string_view name) { AddMarker(kMarkEndPrepare, name); }
+    void Commit(std::string_view name) { AddMarker(kMarkCommit, name); }
+    void Rollback(std::string_view name) { AddMarker(kMarkRollback, name); }
+    
+    void AddEntry(uint32_t cfid, uint8_t flag, std::string_view key,
+                  std::string_view value) {
+        core::KeyBoundle::MakeRedo(key, value, cfid, flag, mutable_raw_buf());
+        set_n_entries(n_entries() + 1);
+    }
+    
+    void AddEntries(std::string_view entries, uint32_t n) {
+        mutable_raw_buf()->append(entries);
+        set_n_entries(n_entries() + n);
+    }
+}; // class TwoPhaseBatch
+    
+class KeysCollector final : public WriteBatch::Stub {
+public:
+    KeysCollector() {}
+    
+    virtual void Put(uint32_t cfid, std::string_view key,
+                     std::string_view /*value*/) override {
+        keys_.emplace_back(cfid, key);
+    }
+    
+    virtual void Delete(uint32_t cfid, std::string_view key) override {
+        keys_.emplace_back(cfid, key);
+    }
+    
+    const std::vector<std::pair<uint32_t, std::string>> &keys() const {
+        return keys_;
+    }
+private:
+    std::vector<std::pair<uint32_t, std::string>> keys_;
+}; // class KeysCollector
+    
+struct DBImpl::Writer {
+    Writer(WriteBatch *b, bool s, WriteCallback *cb)
+        : batch(b)
+        , callback(cb)
+        , sync(s) {}
+    
+    WriteBatch    *batch;
+    WriteCallback *callback;
+    bool           sync;
+    bool           done = false;
+    Error          rs;
+    std::condition_variable cv;
+    // Not null if this writer inserts its batch in parallel.
+    ParallelGroup *group = nullptr;
+    core::SequenceNumber sequence = 0; // The first sequence of batch.
+}; // struct DBImpl::Writer
+    
+// The writers of a group insert into memory tables in parallel, the leader
+// waits all of them done.
+struct DBImpl::ParallelGroup {
+    MemoryTableMap tables;
+    size_t running = 0; // Number of writers still inserting.
+    std::mutex mutex;
+    std::condition_variable cv;
+    
+    void Done() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--running == 0) {
+            cv.notify_one();
+        }
+    }
+    
+    void Wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running > 0) {
+            cv.wait(lock);
+        }
+    }
+}; // struct DBImpl::ParallelGroup
 
 
 static inline void MakeRedo(std::string *buf, core::SequenceNumber sn,
@@ -116,6 +305,16 @@ static inline void MakeRedo(std::string *buf, core::SequenceNumber sn,
     buf->append(reinterpret_cast<const char *>(&sn), sizeof(sn));
     buf->append(reinterpret_cast<const char *>(&n_entries), sizeof(n_entries));
 }
+    
+static Error CheckColumnFamilyOptions(const ColumnFamilyOptions &options) {
+    if (options.num_levels < 2 || options.num_levels > Config::kMaxLevel) {
+        return MAI_NOT_SUPPORTED(base::Sprintf("Incorrect num_levels: %d, "
+                                               "it should be in [2, %d].",
+                                               options.num_levels,
+                                               Config::kMaxLevel));
+    }
+    return Error::OK();
+}
 
 DBImpl::DBImpl(const std::string &db_name, const Options &opts)
     : db_name_(db_name)
@@ -125,10 +324,18 @@ DBImpl::DBImpl(const std::string &db_name, const Options &opts)
     , factory_(Factory::NewDefault())
     , bkg_active_(0)
     , shutting_down_(false)
-    , table_cache_(new TableCache(abs_db_path_, opts, factory_.get()))
+    , bkg_pool_(new base::ThreadPool(opts.max_background_jobs))
+    , io_pool_(new base::ThreadPool(opts.max_io_threads))
+    , table_cache_(new TableCache(abs_db_path_, opts, factory_.get(),
+                                  io_pool_.get()))
     , versions_(new VersionSet(abs_db_path_, opts, table_cache_.get()))
+    , stats_(opts.enable_statistics ? new Statistics() : nullptr)
+    , commit_map_(new CommitMap())
     , flush_request_(0)
-    , total_wal_size_(0) {
+    , total_wal_size_(0)
+    , n_write_groups_(0)
+    , n_group_writers_(0)
+    , write_wait_micros_(0) {
 }
 
 DBImpl::~DBImpl() {
@@ -149,6 +356,7 @@ DBImpl::~DBImpl() {
         }
     }
     
+    bkg_pool_->Shutdown();
     bkg_cv_.notify_all();
     flush_worker_.join();
 
@@ -302,10 +510,11 @@ Error DBImpl::Recovery(const std::vector<ColumnFamilyDescriptor> &desc) {
     
     DCHECK_GE(history.size(), numbers.size());
     core::SequenceNumber last = 0, update = 0;
+    uint64_t log_size = 0;
     for (uint64_t number: numbers) {
         //last = history[number];
         // The newest redo log file filter is not need.
-        rs = Redo(number, last, &update, max_number != number);
+        rs = Redo(number, last, &update, max_number != number, &log_size);
         if (!rs) {
             return rs;
         }
@@ -319,12 +528,25 @@ Error DBImpl::Recovery(const std::vector<ColumnFamilyDescriptor> &desc) {
     versions_->UpdateSequenceNumber(update);
     DLOG(INFO) << "Replay ok, last version: "
                << versions_->last_sequence_number();
+    // Only the not decided transactions be kept, there is no any snapshot.
+    commit_map_->Retire(versions_->last_sequence_number());
 
-    rs = env_->NewWritableFile(Files::LogFileName(abs_db_path_, log_file_number_), true, &log_file_);
+    rs = NewWritableFile(Files::LogFileName(abs_db_path_, log_file_number_), true,
+                         RateLimiter::kIOPriorityWAL, &log_file_);
+    if (!rs) {
+        return rs;
+    }
+    // Drop the broken tail or the stale records of recycled file, the new
+    // records must follow the last good one.
+    uint64_t file_size = 0;
+    rs = log_file_->GetFileSize(&file_size);
+    if (rs.ok() && file_size > log_size) {
+        rs = log_file_->Truncate(log_size);
+    }
     if (!rs) {
         return rs;
     }
-    logger_.reset(new LogWriter(log_file_.get(), WAL::kDefaultBlockSize));
+    NewLogger(log_size);
     
     uint64_t wal_size = 0;
     rs = GetTotalWalSize(&wal_size);
@@ -338,10 +560,14 @@ Error DBImpl::Recovery(const std::vector<ColumnFamilyDescriptor> &desc) {
 /*virtual*/ Error DBImpl::NewColumnFamily(const std::string &name,
                                           const ColumnFamilyOptions &options,
                                           ColumnFamily **result) {
+    Error rs = CheckColumnFamilyOptions(options);
+    if (!rs) {
+        return rs;
+    }
     // Locking versions-----------------------------------------------------------------------------
     std::unique_lock<std::mutex> lock(mutex_);
     uint32_t cfid;
-    Error rs = InternalNewColumnFamily(name, options, &cfid);
+    rs = InternalNewColumnFamily(name, options, &cfid);
     if (!rs) {
         return rs;
     }
@@ -424,67 +650,259 @@ DBImpl::GetAllColumnFamilies(std::vector<ColumnFamily *> *result) {
     
 /*virtual*/ Error DBImpl::Put(const WriteOptions &opts, ColumnFamily *cf,
                   std::string_view key, std::string_view value) {
+    StopWatch watch(stats_.get(), kHistogramPut);
     WriteBatch batch;
     batch.Put(cf, key, value);
-    return Write(opts, &batch);
+    return WriteImpl(opts, &batch, nullptr);
     //return Write(opts, cf, key, value, core::Tag::kFlagValue);
 }
     
 /*virtual*/ Error DBImpl::Delete(const WriteOptions &opts, ColumnFamily *cf,
                      std::string_view key) {
+    StopWatch watch(stats_.get(), kHistogramDelete);
     WriteBatch batch;
     batch.Delete(cf, key);
-    return Write(opts, &batch);
+    return WriteImpl(opts, &batch, nullptr);
     //return Write(opts, cf, key, "", core::Tag::kFlagDeletion);
 }
     
 /*virtual*/ Error DBImpl::Write(const WriteOptions& opts, WriteBatch* updates) {
+    StopWatch watch(stats_.get(), kHistogramWrite);
     return WriteImpl(opts, updates, nullptr);
 }
     
+Error DBImpl::Prepare(const WriteOptions &opts, std::string_view name,
+                      WriteBatch *updates) {
+    if (name.empty()) {
+        return MAI_CORRUPTION("Empty prepared transaction name.");
+    }
+    if (updates->n_entries() == 0) {
+        return MAI_CORRUPTION("Empty prepared transaction.");
+    }
+    if (commit_map_->IsPrepared(name)) {
+        return MAI_CORRUPTION("Duplicated prepared transaction name.");
+    }
+    StopWatch watch(stats_.get(), kHistogramWrite);
+    TwoPhaseBatch batch;
+    batch.BeginPrepare();
+    batch.Append(*updates);
+    batch.EndPrepare(name);
+    return WriteImpl(opts, &batch, nullptr);
+}
+    
+Error DBImpl::CommitPrepared(const WriteOptions &opts, std::string_view name) {
+    if (!commit_map_->IsPrepared(name)) {
+        return MAI_NOT_FOUND("Transaction not prepared.");
+    }
+    // Only a marker, the entries has been written by Prepare().
+    TwoPhaseBatch batch;
+    batch.Commit(name);
+    return WriteImpl(opts, &batch, nullptr);
+}
+    
+Error DBImpl::RollbackPrepared(const WriteOptions &opts, std::string_view name) {
+    CommitMap::Prepared prepared;
+    if (!commit_map_->GetPrepared(name, &prepared)) {
+        return MAI_NOT_FOUND("Transaction not prepared.");
+    }
+    KeysCollector collector;
+    Error rs = WriteBatch::Iterate(prepared.entries.data(),
+                                   prepared.entries.size(), &collector);
+    if (!rs) {
+        return rs;
+    }
+    
+    // The prepared entries has been in memory tables, so write the old
+    // versions again to hide them. The keys are locked by the transaction.
+    TwoPhaseBatch batch;
+    ReadOptions read_opts;
+    for (const auto &pair : collector.keys()) {
+        base::intrusive_ptr<ColumnFamilyImpl> cfd;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            rs = GetColumnFamilyImpl(pair.first, &cfd);
+        }
+        if (!rs || cfd->dropped()) {
+            continue; // Column family has been dropped.
+        }
+        GetContext ctx;
+        rs = PrepareForGet(read_opts, cfd.get(), &ctx);
+        if (!rs) {
+            return rs;
+        }
+        PinnableValue value;
+        rs = GetImpl(read_opts, ctx, pair.second, &value);
+        if (rs.ok()) {
+            batch.AddEntry(pair.first, core::Tag::kFlagValue, pair.second,
+                           std::string_view(value.data(), value.size()));
+        } else if (rs.IsNotFound()) {
+            batch.AddEntry(pair.first, core::Tag::kFlagDeletion, pair.second, "");
+        } else {
+            return rs;
+        }
+    }
+    batch.Rollback(name);
+    return WriteImpl(opts, &batch, nullptr);
+}
+    
 /*virtual*/ Error DBImpl::Get(const ReadOptions &opts, ColumnFamily *cf, std::string_view key,
                               std::string *value) {
+    PinnableValue pinned;
+    Error rs = Get(opts, cf, key, &pinned);
+    if (rs.ok()) {
+        value->assign(pinned.data(), pinned.size());
+    }
+    return rs;
+}
     
-    using core::Tag;
+/*virtual*/ Error DBImpl::Get(const ReadOptions &opts, ColumnFamily *cf, std::string_view key,
+                              PinnableValue *value) {
     
+    StopWatch watch(stats_.get(), kHistogramGet);
+    GetContext ctx;
+    Error rs = PrepareForGet(opts, cf, &ctx);
+    if (!rs) {
+        return rs;
+    }
+    rs = GetImpl(opts, ctx, key, value);
+    if (!opts.snapshot &&
+        ctx.last_sequence_number < commit_map_->max_retired_seq()) {
+        // The commits newer than this reader be retired during looking up,
+        // the result may be incorrect, so read again by newer sequence number.
+        value->Reset();
+        return Get(opts, cf, key, value);
+    }
+    return rs;
+}
+    
+/*virtual*/ Error
+DBImpl::MultiGet(const ReadOptions &opts, ColumnFamily *cf,
+                 const std::vector<std::string_view> &keys,
+                 std::vector<std::string> *values, std::vector<Error> *errors) {
     GetContext ctx;
-    core::Tag tag;
     Error rs = PrepareForGet(opts, cf, &ctx);
+    if (!rs) {
+        return rs;
+    }
+    DCHECK_NOTNULL(values)->resize(keys.size());
+    DCHECK_NOTNULL(errors)->resize(keys.size());
+    
+    // Sort and dedup keys: the same keys share one slot, so every table only
+    // be probed once by a key, and the keys in same block be adjacent.
+    const Comparator *const ucmp = ctx.cfd->ikcmp()->ucmp();
+    std::vector<size_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [ucmp, &keys](size_t a, size_t b) {
+        return ucmp->Compare(keys[a], keys[b]) < 0;
+    });
+    
+    std::vector<std::string> ikeys;
+    std::vector<core::Tag> tags;
+    std::vector<table::GetSlot> slots;
+    std::vector<size_t> owners; // The first index of keys for every slot.
+    std::vector<size_t> slot_of(keys.size());
+    ikeys.reserve(keys.size());
+    tags.reserve(keys.size());
+    slots.reserve(keys.size());
+    for (size_t i : order) {
+        if (!owners.empty() && ucmp->Equals(keys[i], keys[owners.back()])) {
+            slot_of[i] = owners.size() - 1;
+            continue;
+        }
+        ikeys.push_back(core::KeyBoundle::MakeKey(keys[i],
+                                                  ctx.last_sequence_number,
+                                                  core::Tag::kFlagValueForSeek));
+        tags.emplace_back();
+        slots.push_back({ikeys.back(), &tags.back(), &(*values)[i],
+                         MAI_NOT_FOUND("Not probed.")});
+        slot_of[i] = owners.size();
+        owners.push_back(i);
+    }
+    
+    std::vector<table::GetSlot *> pending;
+    for (auto &slot : slots) {
+        pending.push_back(&slot);
+    }
     for (const auto &table : ctx.in_mem) {
-        rs = table->Get(key, ctx.last_sequence_number, &tag, value);
-        if (rs.ok()) {
-            if (tag.flag() == core::Tag::kFlagDeletion) {
-                rs = MAI_NOT_FOUND("Deleted.");
+        auto iter = pending.begin();
+        for (auto slot : pending) {
+            slot->rs = table->Get(core::KeyBoundle::ExtractUserKey(slot->key),
+                                  ctx.last_sequence_number, slot->tag,
+                                  slot->value);
+            if (slot->rs.IsNotFound()) {
+                *iter++ = slot;
             }
-            return rs;
+        }
+        pending.erase(iter, pending.end());
+    }
+    if (!pending.empty()) {
+        ctx.current->MultiGet(opts, pending);
+    }
+    
+    for (auto &slot : slots) {
+        if (slot.rs.ok() && !commit_map_->IsVisible(slot.tag->sequence_number(),
+                                                    ctx.last_sequence_number)) {
+            // Found a not committed version, look up the older ones.
+            PinnableValue pinned;
+            slot.rs = GetImpl(opts, ctx,
+                              core::KeyBoundle::ExtractUserKey(slot.key),
+                              &pinned);
+            if (slot.rs.ok()) {
+                slot.value->assign(pinned.data(), pinned.size());
+            }
+        } else if (slot.rs.ok() &&
+                   slot.tag->flag() == core::Tag::kFlagDeletion) {
+            slot.rs = MAI_NOT_FOUND("Deleted.");
         }
     }
-    rs = ctx.current->Get(opts, key, ctx.last_sequence_number, &tag, value);
-    if (!rs) {
-        return rs;
+    if (!opts.snapshot &&
+        ctx.last_sequence_number < commit_map_->max_retired_seq()) {
+        return MultiGet(opts, cf, keys, values, errors); // See Get()
     }
-    if (tag.flag() == core::Tag::kFlagDeletion) {
-        return MAI_NOT_FOUND("Deleted.");
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const table::GetSlot &slot = slots[slot_of[i]];
+        (*errors)[i] = slot.rs;
+        if (owners[slot_of[i]] != i && slot.rs.ok()) {
+            (*values)[i] = *slot.value;
+        }
     }
-    return rs;
+    return Error::OK();
 }
     
 /*virtual*/ Iterator *
 DBImpl::NewIterator(const ReadOptions &opts, ColumnFamily *cf) {
+    // The transactions committed during iterating must be invisible, but
+    // their decisions can be retired without any snapshot, so hold one.
+    ReadOptions read_opts(opts);
+    const bool implicit_snapshot = !opts.snapshot && commit_map_->active();
+    if (implicit_snapshot) {
+        read_opts.snapshot = GetSnapshot();
+    }
+    
     GetContext ctx;
-    Error rs = PrepareForGet(opts, cf, &ctx);
+    Error rs = PrepareForGet(read_opts, cf, &ctx);
+    std::unique_ptr<Iterator> internal;
+    if (rs.ok()) {
+        internal.reset(NewInternalIterator(read_opts, ctx));
+        rs = internal->error();
+    }
     if (!rs) {
+        if (implicit_snapshot) {
+            ReleaseSnapshot(read_opts.snapshot);
+        }
         return Iterator::AsError(rs);
     }
     
-    std::unique_lock<std::mutex> lock(mutex_);
-    std::unique_ptr<Iterator> internal(NewInternalIterator(opts, ctx.cfd.get()));
-    if (internal->error().fail()) {
-        return internal.release();
+    Iterator *iter = new DBIterator(ctx.cfd->ikcmp()->ucmp(),
+                                    internal.release(),
+                                    ctx.last_sequence_number, opts.prefix,
+                                    stats_.get(), commit_map_->active() ?
+                                    commit_map_.get() : nullptr);
+    if (implicit_snapshot) {
+        iter->RegisterCleanup(&SnapshotCleanup, this,
+                              const_cast<Snapshot *>(read_opts.snapshot));
     }
-    
-    return new DBIterator(ctx.cfd->ikcmp()->ucmp(), internal.release(),
-                          ctx.last_sequence_number);
+    return iter;
 }
     
 /*virtual*/ const Snapshot *DBImpl::GetSnapshot() {
@@ -497,6 +915,9 @@ DBImpl::NewIterator(const ReadOptions &opts, ColumnFamily *cf) {
     std::unique_lock<std::mutex> lock(mutex_);
     const SnapshotImpl *impl = SnapshotImpl::Cast(snapshot);
     snapshots_.DeleteSnapshot(const_cast<SnapshotImpl *>(impl));
+    if (commit_map_->n_decided() > 0) {
+        commit_map_->Retire(GetSmallestSnapshot());
+    }
 }
     
 /*virtual*/ ColumnFamily *DBImpl::DefaultColumnFamily() { return default_cf_.get(); }
@@ -528,10 +949,75 @@ DBImpl::NewIterator(const ReadOptions &opts, ColumnFamily *cf) {
     } else if (property == "db.bkg.jobs") {
         
         *value = base::Sprintf("%d", bkg_active_.load());
+    } else if (property == "db.bkg.queue-depth") {
+        
+        *value = base::Sprintf("%d", bkg_pool_->queued(base::ThreadPool::kHigh) +
+                               bkg_pool_->queued(base::ThreadPool::kLow));
+    } else if (property == "db.bkg.running-flushes") {
+        
+        *value = base::Sprintf("%d", bkg_pool_->running(base::ThreadPool::kHigh));
+    } else if (property == "db.bkg.running-compactions") {
+        
+        *value = base::Sprintf("%d", bkg_pool_->running(base::ThreadPool::kLow));
+    } else if (property == "db.write.group-count") {
+        
+        *value = base::Sprintf("%" PRIu64, n_write_groups_.load());
+    } else if (property == "db.write.group-writers") {
+        
+        *value = base::Sprintf("%" PRIu64, n_group_writers_.load());
+    } else if (property == "db.write.group-size") {
+        
+        uint64_t n_groups = n_write_groups_.load();
+        *value = base::Sprintf("%.2f", n_groups == 0 ? 0.0 :
+                               n_group_writers_.load() / static_cast<double>(n_groups));
+    } else if (property == "db.write.wait-micros") {
+        
+        *value = base::Sprintf("%" PRIu64, write_wait_micros_.load());
     } else if (property == "db.versions.last-sequence-number") {
         
         std::unique_lock<std::mutex> lock(mutex_);
         *value = base::Sprintf("%" PRIu64, versions_->last_sequence_number());
+    } else if (property == "db.block-cache.capacity") {
+        
+        *value = base::Sprintf("%zd", table_cache_->block_cache()->capacity());
+    } else if (property == "db.block-cache.usage") {
+        
+        *value = base::Sprintf("%zd", table_cache_->block_cache()->ApproximateUsage());
+    } else if (property == "db.block-cache.stats") {
+        
+        table::BlockCache *cache = table_cache_->block_cache();
+        for (int i = 0; i < cache->n_shards(); ++i) {
+            table::BlockCache::Stats stats;
+            cache->GetShardStats(i, &stats);
+            value->append(base::Sprintf("shard[%d]: hits=%" PRIu64 " misses=%"
+                                        PRIu64 " evictions=%" PRIu64
+                                        " usage=%zd entries=%zd\n", i,
+                                        stats.hits, stats.misses,
+                                        stats.evictions, stats.usage,
+                                        stats.n_entries));
+        }
+    } else if (property == "db.stats") {
+        
+        *value = stats_ ? stats_->ToString() : "";
+    } else if (property == "db.rate-limiter.bytes-per-sec") {
+        
+        RateLimiter *limiter = options_.rate_limiter;
+        *value = base::Sprintf("%" PRIu64, limiter ? limiter->GetBytesPerSecond() : 0);
+    } else if (property == "db.rate-limiter.stats") {
+        
+        static const char *kPriorityNames[RateLimiter::kNumIOPriorities] = {
+            "wal", "flush", "compaction",
+        };
+        RateLimiter *limiter = options_.rate_limiter;
+        for (int i = 0; limiter && i < RateLimiter::kNumIOPriorities; ++i) {
+            auto pri = static_cast<RateLimiter::IOPriority>(i);
+            value->append(base::Sprintf("%s: bytes=%" PRIu64 " throttled-bytes=%"
+                                        PRIu64 " wait-micros=%" PRIu64 "\n",
+                                        kPriorityNames[i],
+                                        limiter->GetTotalBytes(pri),
+                                        limiter->GetTotalBytesThrottled(pri),
+                                        limiter->GetTotalWaitMicros(pri)));
+        }
     } else if (property.find("db.cf.") == 0) {
         std::unique_lock<std::mutex> lock(mutex_);
         
@@ -569,78 +1055,500 @@ DBImpl::NewIterator(const ReadOptions &opts, ColumnFamily *cf) {
     return Error::OK();
 }
     
-Error DBImpl::WriteImpl(const WriteOptions& opts, WriteBatch* batch,
-                        WriteCallback *callback) {
+struct DBImpl::ExternalFile {
+    uint64_t    number = 0;
+    uint64_t    size = 0;
+    uint64_t    num_entries = 0;
+    std::string smallest_key;
+    std::string largest_key;
+    int         level = 0;
+    // Keys be tagged by Config::kExternalFileSequenceNumber, only can be
+    // placed at the last level if no snapshot. Otherwise assign a global
+    // sequence number to it, the readers apply it to the keys.
+    bool        need_global_sequence = false;
+}; // struct DBImpl::ExternalFile
+    
+/*virtual*/ Error
+DBImpl::IngestExternalFiles(const IngestExternalFileOptions &opts,
+                            ColumnFamily *cf,
+                            const std::vector<std::string> &files) {
+    if (cf == nullptr) {
+        return MAI_CORRUPTION("NULL column family.");
+    }
+    ColumnFamilyHandle *handle = ColumnFamilyHandle::Cast(cf);
+    if (this != handle->db()) {
+        return MAI_CORRUPTION("Use difference db column family.");
+    }
+    ColumnFamilyImpl *cfd = handle->impl();
+    if (cfd->dropped()) {
+        return MAI_CORRUPTION("Column family has been dropped.");
+    }
+    if (files.empty()) {
+        return Error::OK();
+    }
+    
+    // Copy or move the files into db without DB lock.
+    std::vector<ExternalFile> ingested;
+    Error rs = PrepareExternalFiles(opts, cfd, files, &ingested);
+    
     std::unique_lock<std::mutex> lock(mutex_);
+    if (rs.ok()) {
+        // Enqueue as a writer without batch, when it be the head of queue, no
+        // one can write WAL or allocate sequence numbers.
+        Writer w(nullptr, false, nullptr);
+        writers_.push_back(&w);
+        while (&w != writers_.front()) {
+            w.cv.wait(lock);
+        }
+        rs = InstallExternalFiles(cfd, &ingested, &lock);
+        writers_.pop_front();
+        if (!writers_.empty()) {
+            writers_.front()->cv.notify_one();
+        }
+    }
+    for (const auto &file : ingested) {
+        if (rs.fail()) {
+            table_cache_->Invalidate(file.number);
+            env_->DeleteFile(cfd->GetTableFileName(file.number), false);
+        }
+        pending_outputs_.erase(file.number);
+    }
+    if (rs.ok() && opts.move_files) {
+        for (const auto &file_name : files) {
+            env_->DeleteFile(file_name, false);
+        }
+    }
+    return rs;
+}
     
-    core::SequenceNumber last_version = versions_->last_sequence_number();
-    Error rs;
-    for (auto cfd : *versions_->column_families()) {
-        rs = MakeRoomForWrite(cfd, &lock);
+Error DBImpl::PrepareExternalFiles(const IngestExternalFileOptions &opts,
+                                   ColumnFamilyImpl *cfd,
+                                   const std::vector<std::string> &files,
+                                   std::vector<ExternalFile> *result) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < files.size(); ++i) {
+            result->push_back(ExternalFile{});
+            result->back().number = versions_->GenerateFileNumber();
+            pending_outputs_.insert(result->back().number);
+        }
+    }
+    
+    for (size_t i = 0; i < files.size(); ++i) {
+        ExternalFile *file = &(*result)[i];
+        std::string file_name = cfd->GetTableFileName(file->number);
+        Error rs;
+        // Link instead of rename for moving, the source file must be kept
+        // until ingestion succeeded.
+        if (!opts.move_files || env_->LinkFile(files[i], file_name).fail()) {
+            rs = CopyFile(files[i], file_name);
+        }
         if (!rs) {
             return rs;
         }
-    }
-    if (callback) {
-        rs = callback->Prepare(this);
+        rs = env_->GetFileSize(file_name, &file->size);
+        if (!rs) {
+            return rs;
+        }
+        
+        base::intrusive_ptr<table::TablePropsBoundle> props;
+        rs = table_cache_->GetTableProperties(cfd, file->number, &props);
         if (!rs) {
             return rs;
         }
+        if (props->data().last_version != Config::kExternalFileSequenceNumber ||
+            props->data().num_entries == 0) {
+            return MAI_CORRUPTION("Not a file built by SstFileWriter: " + files[i]);
+        }
+        file->num_entries  = props->data().num_entries;
+        file->smallest_key = props->data().smallest_key;
+        file->largest_key  = props->data().largest_key;
+    }
+    
+    const core::InternalKeyComparator *ikcmp = cfd->ikcmp();
+    std::vector<const ExternalFile *> sorted;
+    for (const auto &file : *result) {
+        sorted.push_back(&file);
+    }
+    std::sort(sorted.begin(), sorted.end(), [ikcmp](auto a, auto b) {
+        return ikcmp->Compare(a->smallest_key, b->smallest_key) < 0;
+    });
+    for (size_t i = 1; i < sorted.size(); ++i) {
+        if (ikcmp->ucmp()->Compare(
+                core::KeyBoundle::ExtractUserKey(sorted[i - 1]->largest_key),
+                core::KeyBoundle::ExtractUserKey(sorted[i]->smallest_key)) >= 0) {
+            return MAI_CORRUPTION("Key ranges of external files overlap.");
+        }
     }
+    return Error::OK();
+}
     
-    rs = logger_->Append(batch->redo(last_version + 1));
-    if (!rs) {
-        return rs;
+// REQUIRES: mutex_.lock()
+// REQUIRES: The writer of caller is the head of writers_
+Error DBImpl::InstallExternalFiles(ColumnFamilyImpl *cfd,
+                                   std::vector<ExternalFile> *files,
+                                   std::unique_lock<std::mutex> *lock) {
+    Error rs;
+    if (cfd->dropped()) {
+        return MAI_CORRUPTION("Column family has been dropped.");
     }
-    flush_request_.fetch_add(1);
-    
-    if (opts.sync) {
-        rs = logger_->Flush();
+    // The memory tables must be newer than all tables, so dump them first
+    // if they have any key in the files.
+    if (MemoryTablesOverlap(cfd, *files)) {
+        while (parallel_inserting_) {
+            parallel_cv_.wait(*lock);
+        }
+        rs = RenewLogger();
         if (!rs) {
             return rs;
         }
-        rs = logger_->Sync(true);
+        VersionPatch patch;
+        patch.SetRedoLogNumber(log_file_number_);
+        rs = versions_->LogAndApply(options_, &patch, &mutex_);
         if (!rs) {
             return rs;
         }
+        cfd->MakeImmutablePipeline(factory_.get(), log_file_number_);
+        MaybeScheduleCompaction(cfd);
+        while ((cfd->flush_scheduled() || cfd->immutable_pipeline()->InProgress()) &&
+               cfd->background_error().ok()) {
+            cfd->mutable_background_cv()->wait(*lock);
+        }
+        if (cfd->background_error().fail()) {
+            return cfd->background_error();
+        }
     }
-    if (callback) {
-        callback->WALDone(this);
-    }
-    
-    WritingHandler handler(0, false, versions_->column_families());
-    handler.ResetLastSequenceNumber(last_version + 1);
-    batch->Iterate(&handler);
     
-    versions_->AddSequenceNumber(handler.sequence_number_count());
+    const int last_level = cfd->options().num_levels < 2 ? 1 :
+        (cfd->options().num_levels > Config::kMaxLevel ? Config::kMaxLevel - 1 :
+         cfd->options().num_levels - 1);
+    // Make the keys of external files be visible in a empty db.
+    versions_->UpdateSequenceNumber(Config::kExternalFileSequenceNumber);
+    // The caller is the head of writers_, no one can take this sequence
+    // number. It be published after files installed, so the readers can not
+    // see it before.
+    const core::SequenceNumber sequence = versions_->last_sequence_number() + 1;
+    bool need_global_sequence = false;
+    Version *current = cfd->current();
+    for (auto &file : *files) {
+        // The lowest level which this level and all upper levels have no
+        // overlapping file and no compaction running.
+        std::vector<base::intrusive_ptr<FileMetaData>> inputs;
+        file.level = 0;
+        for (int level = 0; level <= last_level; ++level) {
+            if (cfd->level_compacting(level)) {
+                break;
+            }
+            current->GetOverlappingInputs(level, file.smallest_key,
+                                          file.largest_key, &inputs);
+            if (!inputs.empty()) {
+                break;
+            }
+            file.level = level;
+        }
+        // The external sequence number is older than all keys in DB, it
+        // is right only if no key be under the file and no snapshot can
+        // see the difference.
+        file.need_global_sequence = file.level != last_level ||
+                                    !snapshots_.empty();
+        need_global_sequence = need_global_sequence ||
+                               file.need_global_sequence;
+    }
+    if (need_global_sequence) {
+        versions_->AddSequenceNumber(1);
+        if (recent_writes_) {
+            // The ingested keys be written at sequence, all older reads
+            // must be checked by lookup.
+            recent_writes_->Trim(sequence);
+        }
+    }
     
-    if (callback) {
-        callback->Done(this);
+    VersionPatch patch;
+    for (const auto &file : *files) {
+        FileMetaData *fmd = new FileMetaData(file.number);
+        fmd->ctime        = env_->CurrentTimeMicros();
+        fmd->size         = file.size;
+        fmd->smallest_key = file.smallest_key;
+        fmd->largest_key  = file.largest_key;
+        fmd->num_entries  = file.num_entries;
+        if (file.need_global_sequence) {
+            // Do not rewrite the file, the readers replace sequence numbers
+            // of its keys by the global one.
+            fmd->global_sequence = sequence;
+            core::ParsedTaggedKey ikey;
+            core::KeyBoundle::ParseTaggedKey(file.smallest_key, &ikey);
+            fmd->smallest_key = core::KeyBoundle::MakeKey(ikey.user_key,
+                                                          sequence,
+                                                          ikey.tag.flag());
+            core::KeyBoundle::ParseTaggedKey(file.largest_key, &ikey);
+            fmd->largest_key  = core::KeyBoundle::MakeKey(ikey.user_key,
+                                                          sequence,
+                                                          ikey.tag.flag());
+        }
+        patch.CreaetFile(cfd->id(), file.level, fmd);
+        DLOG(INFO) << "Ingest file: " << file.number << " to level: "
+                   << file.level;
+    }
+    rs = versions_->LogAndApply(ColumnFamilyOptions{}, &patch, &mutex_);
+    if (!rs) {
+        return rs;
     }
+    MaybeScheduleCompaction(cfd);
     return Error::OK();
 }
     
-Iterator *DBImpl::NewInternalIterator(const ReadOptions &opts,
-                                      ColumnFamilyImpl *cfd) {
-    std::vector<Iterator *> iters;
-    iters.push_back(cfd->mutable_table()->NewIterator());
+// REQUIRES: mutex_.lock()
+bool DBImpl::MemoryTablesOverlap(ColumnFamilyImpl *cfd,
+                                 const std::vector<ExternalFile> &files) {
+    std::vector<base::intrusive_ptr<core::MemoryTable>> tables;
+    cfd->immutable_pipeline()->PeekAll(&tables);
+    tables.push_back(base::MakeRef(cfd->mutable_table()));
+    
+    const Comparator *ucmp = cfd->ikcmp()->ucmp();
+    for (const auto &table : tables) {
+        if (table->NumEntries() == 0) {
+            continue;
+        }
+        if (cfd->options().use_unordered_table) {
+            return true; // Can not seek unordered table.
+        }
+        std::unique_ptr<Iterator> iter(table->NewIterator());
+        for (const auto &file : files) {
+            std::string_view smallest =
+                core::KeyBoundle::ExtractUserKey(file.smallest_key);
+            iter->Seek(core::KeyBoundle::MakeKey(smallest,
+                                                 core::Tag::kMaxSequenceNumber,
+                                                 core::Tag::kFlagValueForSeek));
+            if (iter->Valid() &&
+                ucmp->Compare(core::KeyBoundle::ExtractUserKey(iter->key()),
+                              core::KeyBoundle::ExtractUserKey(file.largest_key)) <= 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
     
-    std::vector<base::intrusive_ptr<core::MemoryTable>> in_mem;
-    cfd->immutable_pipeline()->PeekAll(&in_mem);
-    for (auto memtable : in_mem) {
-        iters.push_back(memtable->NewIterator());
+Error DBImpl::CopyFile(const std::string &from, const std::string &to) {
+    std::unique_ptr<SequentialFile> src;
+    Error rs = env_->NewSequentialFile(from, &src, false);
+    if (!rs) {
+        return rs;
     }
-
-    Error rs = cfd->AddIterators(opts, &iters);
+    std::unique_ptr<WritableFile> dst;
+    rs = NewWritableFile(to, false, RateLimiter::kIOPriorityFlush, &dst);
     if (!rs) {
-        for (auto clean : iters) {
-            delete clean;
+        return rs;
+    }
+    std::string scratch;
+    while (true) {
+        std::string_view buf;
+        rs = src->Read(base::kMB, &buf, &scratch);
+        if (rs.IsEof() || (rs.ok() && buf.empty())) {
+            break;
+        }
+        if (!rs) {
+            return rs;
+        }
+        rs = dst->Append(buf);
+        if (!rs) {
+            return rs;
         }
-        return Iterator::AsError(rs);
     }
-
-    Iterator *internal = core::Merging::NewMergingIterator(cfd->ikcmp(), &iters[0], iters.size());
-    // No need register cleanup:
+    rs = dst->Flush();
+    if (!rs) {
+        return rs;
+    }
+    return dst->Sync();
+}
+    
+Error DBImpl::WriteImpl(const WriteOptions& opts, WriteBatch* batch,
+                        WriteCallback *callback) {
+    Writer w(batch, opts.sync, callback);
+    const uint64_t jiffy = env_->CurrentTimeMicros();
+    
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    {
+        PERF_TIMER_GUARD(db_mutex_wait_nanos);
+        lock.lock();
+    }
+    writers_.push_back(&w);
+    while (!w.done && !w.group && &w != writers_.front()) {
+        w.cv.wait(lock);
+    }
+    write_wait_micros_.fetch_add(env_->CurrentTimeMicros() - jiffy);
+    if (w.group && !w.done) {
+        // The leader has written WAL, insert own batch with other writers.
+        lock.unlock();
+        InsertConcurrently(&w);
+        lock.lock();
+        while (!w.done) {
+            w.cv.wait(lock);
+        }
+    }
+    if (w.done) {
+        return w.rs; // Has been written by the leader.
+    }
+    
+    // This writer is the leader of group now.
+    Error rs;
+    for (auto cfd : *versions_->column_families()) {
+        rs = MakeRoomForWrite(cfd, &lock);
+        if (!rs) {
+            break;
+        }
+    }
+    if (rs.ok() && callback) {
+        rs = callback->Prepare(this);
+    }
+    
+    Writer *last_writer = &w;
+    if (rs.ok()) {
+        core::SequenceNumber last_version = versions_->last_sequence_number();
+        size_t n_writers = 0;
+        WriteBatch *updates = BuildWriteGroup(&last_writer, &n_writers);
+        n_write_groups_.fetch_add(1);
+        n_group_writers_.fetch_add(n_writers);
+        
+        // Only the leader can write the WAL, so it is safe to unlock the DB
+        // during writing and the followers can enqueue in parallel.
+        lock.unlock();
+        log_mutex_.lock();
+        std::string_view redo = updates->redo(last_version + 1);
+        PERF_COUNTER_ADD(wal_write_bytes, redo.size());
+        rs = logger_->Append(redo);
+        if (rs.ok() && w.sync) {
+            PERF_TIMER_GUARD(wal_sync_nanos);
+            rs = logger_->Flush();
+            if (rs.ok()) {
+                rs = logger_->Sync(true);
+            }
+        }
+        log_mutex_.unlock();
+        {
+            PERF_TIMER_GUARD(db_mutex_wait_nanos);
+            lock.lock();
+        }
+        
+        if (rs.ok()) {
+            flush_request_.fetch_add(1);
+            if (callback) {
+                callback->WALDone(this);
+            }
+            
+            if (n_writers > 1 && CanInsertConcurrently()) {
+                ParallelInsert(&w, last_writer, last_version + 1, &lock);
+                versions_->AddSequenceNumber(updates->n_entries());
+            } else {
+                WritingHandler handler(0, false, versions_->column_families(),
+                                       commit_map_.get());
+                handler.ResetLastSequenceNumber(last_version + 1);
+                updates->Iterate(&handler);
+                versions_->AddSequenceNumber(handler.sequence_number_count());
+            }
+            if (recent_writes_) {
+                recent_writes_->AddBatch(*updates, last_version + 1);
+            }
+            if (commit_map_->n_decided() > 0) {
+                commit_map_->Retire(GetSmallestSnapshot());
+            }
+            
+            if (callback) {
+                callback->Done(this);
+            }
+        }
+        if (updates == &group_batch_) {
+            group_batch_.Clear();
+        }
+    }
+    
+    while (true) {
+        Writer *ready = writers_.front();
+        writers_.pop_front();
+        if (ready != &w) {
+            ready->rs   = rs;
+            ready->done = true;
+            ready->cv.notify_one();
+        }
+        if (ready == last_writer) {
+            break;
+        }
+    }
+    // Notify the new head of write queue.
+    if (!writers_.empty()) {
+        writers_.front()->cv.notify_one();
+    }
+    return rs;
+}
+    
+// REQUIRES: mutex_.lock()
+bool DBImpl::CanInsertConcurrently() const {
+    if (!options_.allow_concurrent_memtable_write) {
+        return false;
+    }
+    for (auto cfd : *versions_->column_families()) {
+        if (!cfd->mutable_table()->concurrent_put_supported()) {
+            return false;
+        }
+    }
+    return true;
+}
+    
+// REQUIRES: mutex_.lock()
+void DBImpl::ParallelInsert(Writer *leader, Writer *last_writer,
+                            core::SequenceNumber sequence,
+                            std::unique_lock<std::mutex> *lock) {
+    ParallelGroup group;
+    for (auto cfd : *versions_->column_families()) {
+        group.tables[cfd->id()] = cfd->mutable_table();
+    }
+    for (Writer *w : writers_) {
+        w->group    = &group;
+        w->sequence = sequence;
+        sequence += w->batch->n_entries();
+        group.running++;
+        if (w != leader) {
+            w->cv.notify_one();
+        }
+        if (w == last_writer) {
+            break;
+        }
+    }
+    
+    // The memory tables can not be switched until all writers done.
+    parallel_inserting_ = true;
+    lock->unlock();
+    InsertConcurrently(leader);
+    group.Wait();
+    lock->lock();
+    parallel_inserting_ = false;
+    parallel_cv_.notify_all();
+}
+    
+void DBImpl::InsertConcurrently(Writer *w) {
+    WritingHandler handler(&w->group->tables, commit_map_.get());
+    handler.ResetLastSequenceNumber(w->sequence);
+    w->batch->Iterate(&handler);
+    w->group->Done();
+}
+    
+Iterator *DBImpl::NewInternalIterator(const ReadOptions &opts,
+                                      const GetContext &ctx) {
+    std::vector<Iterator *> iters;
+    for (const auto &memtable : ctx.in_mem) {
+        iters.push_back(memtable->NewIterator());
+    }
+
+    Error rs = ctx.cfd->AddIterators(opts, ctx.current, &iters);
+    if (!rs) {
+        for (auto clean : iters) {
+            delete clean;
+        }
+        return Iterator::AsError(rs);
+    }
+
+    Iterator *internal = core::Merging::NewMergingIterator(ctx.cfd->ikcmp(), &iters[0], iters.size());
+    // No need register cleanup:
     // Memory table's iterator can cleanup itself reference count.
     return internal;
 }
@@ -665,28 +1573,27 @@ Error DBImpl::GetLatestSequenceForKey(ColumnFamilyImpl *impl, bool cache_only,
     auto curr_seq = versions_->last_sequence_number();
     *seq = core::Tag::kMaxSequenceNumber;
     
-    std::string value;
+    // The immutable tables of super version are newest first.
+    base::intrusive_ptr<SuperVersion> super_version = impl->AcquireSuperVersion();
+    std::string_view value;
     core::Tag tag;
-    Error rs = impl->mutable_table()->Get(key, curr_seq, &tag, &value);
+    Error rs = super_version->mutable_table->Get(key, curr_seq, &tag, &value);
+    for (size_t i = 0; rs.fail() &&
+         i < super_version->immutable_tables.size(); ++i) {
+        rs = super_version->immutable_tables[i]->Get(key, curr_seq, &tag,
+                                                     &value);
+    }
     if (rs.ok()) {
         *seq = tag.sequence_number();
         return Error::OK();
     }
-    
-    std::vector<base::intrusive_ptr<core::MemoryTable>> imm;
-    impl->immutable_pipeline()->PeekAll(&imm);
-    for (const auto &table : imm) {
-        rs = table->Get(key, curr_seq, &tag, &value);
-        if (rs.ok()) {
-            *seq = tag.sequence_number();
-            return Error::OK();
-        }
-    }
     if (cache_only) {
         return MAI_NOT_FOUND("No any key in memory tables!");
     }
     
-    rs = impl->current()->Get(ReadOptions{}, key, curr_seq, &tag, &value);
+    PinnableValue pinned;
+    rs = super_version->current->Get(ReadOptions{}, key, curr_seq, &tag,
+                                     &pinned);
     if (rs.ok()) {
         *seq = tag.sequence_number();
         return Error::OK();
@@ -694,8 +1601,57 @@ Error DBImpl::GetLatestSequenceForKey(ColumnFamilyImpl *impl, bool cache_only,
     return rs;
 }
 
+Error DBImpl::GetLatestSequenceForKeys(ColumnFamilyImpl *impl,
+                                       const std::vector<std::string_view> &keys,
+                                       std::vector<core::SequenceNumber> *seqs) {
+    auto curr_seq = versions_->last_sequence_number();
+    seqs->assign(keys.size(), core::Tag::kMaxSequenceNumber);
+    
+    // All keys be looked up in the same tables.
+    base::intrusive_ptr<SuperVersion> super_version = impl->AcquireSuperVersion();
+    std::string_view value;
+    core::Tag tag;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        Error rs = super_version->mutable_table->Get(keys[i], curr_seq, &tag,
+                                                     &value);
+        for (size_t j = 0; rs.fail() &&
+             j < super_version->immutable_tables.size(); ++j) {
+            rs = super_version->immutable_tables[j]->Get(keys[i], curr_seq,
+                                                         &tag, &value);
+        }
+        if (rs.fail()) {
+            PinnableValue pinned;
+            rs = super_version->current->Get(ReadOptions{}, keys[i], curr_seq,
+                                             &tag, &pinned);
+        }
+        if (rs.ok()) {
+            (*seqs)[i] = tag.sequence_number();
+        } else if (!rs.IsNotFound()) {
+            return rs;
+        }
+    }
+    return Error::OK();
+}
+    
+void DBImpl::EnableRecentWrites(size_t n_slots) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DCHECK(!recent_writes_);
+    recent_writes_.reset(new RecentWrites(n_slots,
+                                          versions_->last_sequence_number()));
+}
+    
+void DBImpl::TEST_DeleteObsoleteFiles(ColumnFamily *cf) {
+    ColumnFamilyImpl *cfd = DCHECK_NOTNULL(ColumnFamilyHandle::Cast(cf)->impl());
+    std::unique_lock<std::mutex> lock(mutex_);
+    DeleteObsoleteFiles(cfd);
+}
+    
 Error DBImpl::TEST_ForceDumpImmutableTable(ColumnFamily *cf, bool sync) {
     ColumnFamilyImpl *cfd = DCHECK_NOTNULL(ColumnFamilyHandle::Cast(cf)->impl());
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (parallel_inserting_) {
+        parallel_cv_.wait(lock);
+    }
     DCHECK_EQ(0, versions_->prev_log_number());
     Error rs = RenewLogger();
     if (!rs) {
@@ -710,15 +1666,65 @@ Error DBImpl::TEST_ForceDumpImmutableTable(ColumnFamily *cf, bool sync) {
     cfd->MakeImmutablePipeline(factory_.get(), log_file_number_);
     MaybeScheduleCompaction(cfd);
     
-    std::unique_lock<std::mutex> lock(mutex_);
-    if (sync && cfd->background_progress()) {
+    while (sync && cfd->flush_scheduled()) {
         cfd->mutable_background_cv()->wait(lock);
     }
     return Error::OK();
 }
 
+// REQUIRES: mutex_.lock()
+// REQUIRES: writers_ is not empty
+WriteBatch *DBImpl::BuildWriteGroup(Writer **last_writer, size_t *n_writers) {
+    DCHECK(!writers_.empty());
+    Writer *first = writers_.front();
+    WriteBatch *result = first->batch;
+    
+    *last_writer = first;
+    *n_writers   = 1;
+    if (first->callback) {
+        // The callback must check conflicts with all committed writes,
+        // so do not merge any other writer into it.
+        return result;
+    }
+    
+    size_t size = first->batch->ApproximateSize();
+    size_t max_size = Config::kMaxWriteGroupSize;
+    if (size <= Config::kSmallWriteGroupSize) {
+        max_size = size + Config::kSmallWriteGroupSize;
+    }
+    
+    auto iter = writers_.begin();
+    for (++iter; iter != writers_.end(); ++iter) {
+        Writer *w = *iter;
+        if (w->sync && !first->sync) {
+            // Do not include a sync write into a batch handled by a non-sync
+            // write.
+            break;
+        }
+        if (w->callback || !w->batch) {
+            break; // Not merge the writers with callback and the ingestion.
+        }
+        size += (w->batch->ApproximateSize() - WriteBatch::kHeaderSize);
+        if (size > max_size) {
+            break; // Do not make batch too big
+        }
+        
+        if (result == first->batch) {
+            // Switch to temporary batch instead of disturbing caller's batch
+            result = &group_batch_;
+            DCHECK_EQ(0, result->n_entries());
+            result->Append(*first->batch);
+        }
+        result->Append(*w->batch);
+        *last_writer = w;
+        (*n_writers)++;
+    }
+    return result;
+}
+
 // REQUIRES: mutex_.lock()
 Error DBImpl::RenewLogger() {
+    std::lock_guard<std::mutex> log_lock(log_mutex_);
     if (log_file_) {
         log_file_->Flush();
         log_file_->Sync();
@@ -727,20 +1733,61 @@ Error DBImpl::RenewLogger() {
     uint64_t new_log_number = versions_->GenerateFileNumber();
     std::string log_file_name = Files::LogFileName(abs_db_path_,
                                                    new_log_number);
-    Error rs = env_->NewWritableFile(log_file_name, false, &log_file_);
+    if (options_.recycle_log_file_num > 0 && min_recyclable_log_number_ == 0) {
+        min_recyclable_log_number_ = new_log_number;
+    }
+    while (!recycle_logs_.empty()) {
+        std::string old_name = Files::LogFileName(abs_db_path_,
+                                                  recycle_logs_.front());
+        recycle_logs_.pop_front();
+        // Overwrite the old file from begin, the reader can find the stale
+        // records by log number.
+        Error rs = env_->RenameFile(old_name, log_file_name);
+        if (rs.ok()) {
+            break;
+        }
+        DLOG(ERROR) << "Recycle log file: " << old_name << " fail! cause: "
+                    << rs.ToString();
+    }
+    Error rs = NewWritableFile(log_file_name, false, RateLimiter::kIOPriorityWAL,
+                               &log_file_);
     if (!rs) {
         versions_->ReuseFileNumber(new_log_number);
         return rs;
     }
     log_file_number_ = new_log_number;
-    logger_.reset(new LogWriter(log_file_.get(), WAL::kDefaultBlockSize));
+    NewLogger(0);
+    
+    // The prepared transactions must survive after the old log files be
+    // deleted, write them again.
+    std::vector<CommitMap::Prepared> prepared;
+    commit_map_->GetAllPrepared(&prepared);
+    for (const auto &txn : prepared) {
+        TwoPhaseBatch batch;
+        batch.BeginPrepare();
+        batch.AddEntries(txn.entries, txn.n_entries);
+        batch.EndPrepare(txn.name);
+        rs = logger_->Append(batch.redo(txn.seq));
+        if (!rs) {
+            return rs;
+        }
+    }
     return Error::OK();
 }
     
+// REQUIRES: log_file_ is ready
+void DBImpl::NewLogger(uint64_t offset) {
+    const uint64_t log_number =
+        options_.recycle_log_file_num > 0 ? log_file_number_ : 0;
+    logger_.reset(new LogWriter(log_file_.get(), WAL::kDefaultBlockSize,
+                                log_number, options_.wal_compression,
+                                options_.wal_preallocate_size, offset));
+}
+    
 Error DBImpl::Redo(uint64_t log_file_number,
                    core::SequenceNumber last_sequence_number,
                    core::SequenceNumber *update_sequence_number,
-                   bool filter) {
+                   bool filter, uint64_t *log_size) {
     std::unique_ptr<SequentialFile> file;
     std::string log_file_name = Files::LogFileName(abs_db_path_, log_file_number);
     Error rs = env_->NewSequentialFile(log_file_name, &file,
@@ -748,11 +1795,12 @@ Error DBImpl::Redo(uint64_t log_file_number,
     if (!rs) {
         return rs;
     }
-    LogReader logger(file.get(), true, WAL::kDefaultBlockSize);
+    LogReader logger(file.get(), true, WAL::kDefaultBlockSize, log_file_number);
     
     std::string_view result;
     std::string scatch;
-    WritingHandler handler(log_file_number, filter, versions_->column_families());
+    WritingHandler handler(log_file_number, filter, versions_->column_families(),
+                           commit_map_.get());
     while (logger.Read(&result, &scatch)) {
         core::SequenceNumber sn = base::Slice::SetFixed64(result.substr(0, 8));
         uint32_t n_entries = base::Slice::SetFixed32(result.substr(8, 4));
@@ -764,11 +1812,14 @@ Error DBImpl::Redo(uint64_t log_file_number,
             return rs;
         }
         DCHECK_EQ(n_entries, handler.sequence_number_count());
-        *update_sequence_number = sn + handler.sequence_number_count();
+        // The prepared batches written again by renewed log file be older.
+        *update_sequence_number = std::max(*update_sequence_number,
+                                           sn + handler.sequence_number_count());
     }
     if (!logger.error().ok() && !logger.error().IsEof()) {
         return logger.error();
     }
+    *log_size = logger.last_record_end();
     return Error::OK();
 }
     
@@ -781,29 +1832,86 @@ Error DBImpl::PrepareForGet(const ReadOptions &opts, ColumnFamily *cf,
     if (this != handle->db()) {
         return MAI_CORRUPTION("Use difference db column family.");
     }
-    ctx->cfd = handle->impl();
+    return PrepareForGet(opts, handle->impl(), ctx);
+}
+    
+Error DBImpl::PrepareForGet(const ReadOptions &opts, ColumnFamilyImpl *cfd,
+                            GetContext *ctx) {
+    ctx->cfd = cfd;
     if (ctx->cfd->dropped()) {
         return MAI_CORRUPTION("Column family has been dropped.");
     }
     
-    ctx->last_sequence_number = 0;
-    mutex_.lock(); // Locking versions------------------------------------------
     if (opts.snapshot) {
         ctx->last_sequence_number =
             SnapshotImpl::Cast(opts.snapshot)->sequence_number();
     } else {
         ctx->last_sequence_number = versions_->last_sequence_number();
     }
+    // Must acquire super version after loading the sequence number: all keys
+    // before this sequence number can be found in its tables.
+    ctx->super_version = ctx->cfd->AcquireSuperVersion();
     
     ctx->in_mem.clear();
-    ctx->in_mem.push_back(base::MakeRef(ctx->cfd->mutable_table()));
-    ctx->cfd->immutable_pipeline()->PeekAll(&ctx->in_mem);
-    ctx->current = ctx->cfd->current();
-    mutex_.unlock(); // Unlocking versions--------------------------------------
-    
+    ctx->in_mem.push_back(ctx->super_version->mutable_table);
+    ctx->in_mem.insert(ctx->in_mem.end(),
+                       ctx->super_version->immutable_tables.begin(),
+                       ctx->super_version->immutable_tables.end());
+    ctx->current = ctx->super_version->current;
     return Error::OK();
 }
     
+// Look up the newest version that visible to the context, the versions of
+// not committed transactions be skipped.
+Error DBImpl::GetImpl(const ReadOptions &opts, const GetContext &ctx,
+                      std::string_view key, PinnableValue *value) {
+    core::Tag tag;
+    Error rs;
+    for (const auto &table : ctx.in_mem) {
+        std::string_view result;
+        core::SequenceNumber seq = ctx.last_sequence_number;
+        do {
+            PERF_COUNTER_ADD(memtable_probes, 1);
+            rs = table->Get(key, seq, &tag, &result);
+        } while (rs.ok() && !IsVisible(commit_map_.get(),
+                                       ctx.last_sequence_number, tag, &seq));
+        if (rs.ok()) {
+            if (tag.flag() == core::Tag::kFlagDeletion) {
+                return MAI_NOT_FOUND("Deleted.");
+            }
+            // The value lives in memory table, so pin the table by value.
+            table->AddRef();
+            value->Pin(result, &MemoryTableCleanup, table.get());
+            return rs;
+        }
+    }
+    const uint64_t jiffies = options_.rate_limiter ? env_->CurrentTimeMicros() : 0;
+    core::SequenceNumber seq = ctx.last_sequence_number;
+    do {
+        rs = ctx.current->Get(opts, key, seq, &tag, value);
+    } while (rs.ok() && !IsVisible(commit_map_.get(), ctx.last_sequence_number,
+                                   tag, &seq));
+    if (options_.rate_limiter) {
+        options_.rate_limiter->ReportLatency(env_->CurrentTimeMicros() - jiffies);
+    }
+    if (!rs) {
+        return rs;
+    }
+    if (tag.flag() == core::Tag::kFlagDeletion) {
+        value->Reset();
+        return MAI_NOT_FOUND("Deleted.");
+    }
+    return rs;
+}
+    
+// REQUIRES: mutex_.lock()
+core::SequenceNumber DBImpl::GetSmallestSnapshot() const {
+    if (snapshots_.empty()) {
+        return versions_->last_sequence_number();
+    }
+    return snapshots_.oldest()->sequence_number();
+}
+    
 Error DBImpl::Write(const WriteOptions &opts, ColumnFamily *cf,
                     std::string_view key, std::string_view value, uint8_t flag) {
     using core::Tag;
@@ -845,6 +1953,9 @@ Error DBImpl::Write(const WriteOptions &opts, ColumnFamily *cf,
     
     // TODO: thiny locking
     cfd->mutable_table()->Put(key, value, last_sequence_number, flag);
+    if (recent_writes_) {
+        recent_writes_->Add(cfd->id(), key, last_sequence_number);
+    }
     
     versions_->AddSequenceNumber(1);
     return Error::OK();
@@ -879,6 +1990,11 @@ Error DBImpl::GetTotalWalSize(uint64_t *size) {
         Files::Kind kind;
         uint64_t number;
         std::tie(kind, number) = Files::ParseName(name);
+        if (kind == Files::kLog &&
+            std::find(recycle_logs_.begin(), recycle_logs_.end(), number) !=
+            recycle_logs_.end()) {
+            continue; // Recycled log files are not WAL.
+        }
         
         uint64_t file_size = 0;
         rs = env_->GetFileSize(abs_db_path_ + "/" + name, &file_size);
@@ -890,6 +2006,20 @@ Error DBImpl::GetTotalWalSize(uint64_t *size) {
     *size = new_total_size;
     return Error::OK();
 }
+
+Error DBImpl::NewWritableFile(const std::string &file_name, bool append,
+                              RateLimiter::IOPriority pri,
+                              std::unique_ptr<WritableFile> *file) {
+    Error rs = env_->NewWritableFile(file_name, append, file);
+    if (!rs) {
+        return rs;
+    }
+    if (options_.rate_limiter) {
+        file->reset(new base::RateLimitedWritableFile(file->release(), true,
+                                                      options_.rate_limiter, pri));
+    }
+    return Error::OK();
+}
     
 // REQUIRES mutex_.lock()
 Error DBImpl::MakeRoomForWrite(ColumnFamilyImpl *cfd,
@@ -912,13 +2042,15 @@ Error DBImpl::MakeRoomForWrite(ColumnFamilyImpl *cfd,
             // Memory table usage samll than write buffer. Ignore it.
             // Memory table conflict-factor too small. Ignore it.
             break;
-        } else if (cfd->immutable_pipeline()->InProgress()) {
-            // Immutable table pipeline in progress.
+        } else if (cfd->immutable_pipeline()->size() >=
+                   static_cast<size_t>(std::max(options_.max_parallel_flushes, 1))) {
+            // Immutable table pipeline is full, they will be flushed in
+            // parallel.
             //cfd->mutable_background_cv()->wait(*lock);
             break;
         } else if (cfd->background_progress() &&
                    cfd->current()->level_files(0).size() >
-                   Config::kMaxNumberLevel0File) {
+                   cfd->options().level0_file_num_compaction_trigger) {
             cfd->mutable_background_cv()->wait(*lock);
             break;
         } else {
@@ -956,16 +2088,17 @@ void DBImpl::FlushWork() {
             (env_->CurrentTimeMicros() - last_sync_jiffy) / 1000 >
             Config::kMaxWalSyncMills) {
 
-            mutex_.lock();
+            // The leader of write group appends WAL without DB lock.
+            log_mutex_.lock();
             bkg_error_ = log_file_->Flush();
             if (bkg_error_.ok()) {
                 bkg_error_ = log_file_->Sync();
             }
             if (bkg_error_.fail()) {
-                mutex_.unlock();
+                log_mutex_.unlock();
                 continue;
             }
-            mutex_.unlock();
+            log_mutex_.unlock();
             DLOG(INFO) << "Flush ok.";
             last_sync_jiffy = env_->CurrentTimeMicros();
             flush_request_.store(0);
@@ -985,44 +2118,59 @@ void DBImpl::FlushWork() {
 
 // REQUIRES mutex_.lock()
 void DBImpl::MaybeScheduleCompaction(ColumnFamilyImpl *cfd) {
-    if (bkg_active_.load() > 0) {
-        return; // Compaction is running.
-    }
-    
     if (shutting_down_.load()) {
         return; // Is shutting down, ignore schedule
     }
     
-    if (!cfd->immutable_pipeline()->InProgress() &&
-        !cfd->NeedsCompaction()) {
-        return; // Compaction is no need
+    if (cfd->immutable_pipeline()->InProgress() && !cfd->flush_scheduled()) {
+        cfd->set_flush_scheduled(true);
+        cfd->AddBackgroundJob();
+        bkg_active_.fetch_add(1);
+        bkg_pool_->Schedule(base::ThreadPool::kHigh, [this, cfd] () {
+            this->BackgroundWork(cfd, true);
+        });
     }
     
-    bkg_active_.fetch_add(1);
-    cfd->set_background_progress(true);
-    std::thread([this](auto cfd) {
-        this->BackgroundWork(cfd);
-    }, cfd).detach();
+    // Only schedule one compaction at once, the job will schedule next one
+    // after it picked the inputs, so the next job can pick other levels.
+    if (cfd->compaction_scheduled() < cfd->options().max_concurrent_compactions &&
+        cfd->NeedsCompaction()) {
+        cfd->set_compaction_scheduled(cfd->compaction_scheduled() + 1);
+        cfd->AddBackgroundJob();
+        bkg_active_.fetch_add(1);
+        bkg_pool_->Schedule(base::ThreadPool::kLow, [this, cfd] () {
+            this->BackgroundWork(cfd, false);
+        });
+    }
 }
     
-void DBImpl::BackgroundWork(ColumnFamilyImpl *cfd) {
-    DLOG(INFO) << "Background work on. " << cfd->name();
+void DBImpl::BackgroundWork(ColumnFamilyImpl *cfd, bool flush) {
+    DLOG(INFO) << "Background " << (flush ? "flush" : "compaction")
+               << " work on. " << cfd->name();
     
     DCHECK_GT(bkg_active_.load(), 0);
+    std::unique_lock<std::mutex> lock(mutex_);
     if (!shutting_down_.load()) {
-        std::unique_lock<std::mutex> lock(mutex_);
-        BackgroundCompaction(cfd);
+        if (flush) {
+            BackgroundFlush(cfd);
+        } else {
+            BackgroundCompaction(cfd);
+        }
+    }
+    if (flush) {
+        cfd->set_flush_scheduled(false);
+    } else {
+        cfd->set_compaction_scheduled(cfd->compaction_scheduled() - 1);
     }
     bkg_active_.fetch_sub(1);
-    cfd->set_background_progress(false);
+    cfd->RemoveBackgroundJob();
     
     MaybeScheduleCompaction(cfd);
     cfd->mutable_background_cv()->notify_all();
 }
 
 // REQUIRES mutex_.lock()
-void DBImpl::BackgroundCompaction(ColumnFamilyImpl *cfd) {
-    
+void DBImpl::BackgroundFlush(ColumnFamilyImpl *cfd) {
     if (cfd->immutable_pipeline()->InProgress()) {
         Error rs = CompactMemoryTable(cfd);
         if (rs.fail()) {
@@ -1032,25 +2180,9 @@ void DBImpl::BackgroundCompaction(ColumnFamilyImpl *cfd) {
             return;
         }
     }
-
-    CompactionContext ctx;
-    if (cfd->PickCompaction(&ctx)) {
-        Error rs = CompactFileTable(cfd, &ctx);
-        if (rs.fail()) {
-            DLOG(INFO) << "Compact file table fail! column family: "
-                       << cfd->name() << " cause: " << rs.ToString();
-            cfd->set_background_error(rs);
-            return;
-        }
-        rs = versions_->LogAndApply(ColumnFamilyOptions{}, &ctx.patch, &mutex_);
-        if (!rs) {
-            cfd->set_background_error(rs);
-            return;
-        }
-    }
     
     DeleteObsoleteFiles(cfd);
-
+    
     uint64_t wal_size = 0;
     bkg_error_ = GetTotalWalSize(&wal_size);
     if (bkg_error_.ok()) {
@@ -1058,203 +2190,379 @@ void DBImpl::BackgroundCompaction(ColumnFamilyImpl *cfd) {
     }
 }
 
+// REQUIRES mutex_.lock()
+void DBImpl::BackgroundCompaction(ColumnFamilyImpl *cfd) {
+    CompactionContext ctx;
+    if (!cfd->PickCompaction(&ctx)) {
+        return;
+    }
+    // Levels has been picked, try to start other compaction on rest levels.
+    MaybeScheduleCompaction(cfd);
+    
+    Error rs = CompactFileTable(cfd, &ctx);
+    if (rs.ok()) {
+        rs = versions_->LogAndApply(ColumnFamilyOptions{}, &ctx.patch, &mutex_);
+    }
+    cfd->ReleaseCompaction(ctx);
+    if (rs.fail()) {
+        DLOG(INFO) << "Compact file table fail! column family: "
+                   << cfd->name() << " cause: " << rs.ToString();
+        cfd->set_background_error(rs);
+        return;
+    }
+    
+    DeleteObsoleteFiles(cfd);
+}
+
+struct DBImpl::FlushJob {
+    base::intrusive_ptr<core::MemoryTable> table;
+    std::unique_ptr<WritableFile> file;
+    std::unique_ptr<table::TableBuilder> builder;
+    uint64_t file_number = 0;
+    std::string smallest_key;
+    std::string largest_key;
+    uint64_t num_deletions = 0;
+    Error rs;
+    bool done = false; // Builder be finished.
+}; // struct DBImpl::FlushJob
+
 // REQUIRES mutex_.lock()
 Error DBImpl::CompactMemoryTable(ColumnFamilyImpl *cfd) {
     DCHECK(cfd->immutable_pipeline()->InProgress());
     
     Error rs;
-    VersionPatch patch;
-    base::intrusive_ptr<core::MemoryTable> imm;
-    while (cfd->immutable_pipeline()->Peek(&imm)) {
-        DCHECK(!imm.is_null());
-        rs = WriteLevel0Table(cfd->current(), &patch, imm.get());
-        if (!rs) {
-            return rs;
+    while (cfd->immutable_pipeline()->InProgress()) {
+        // All waiting tables be flushed in parallel, in this thread and
+        // background threads.
+        std::vector<base::intrusive_ptr<core::MemoryTable>> tables;
+        cfd->immutable_pipeline()->PeekAll(&tables);
+        const size_t max_jobs = std::max(options_.max_parallel_flushes, 1);
+        if (tables.size() > max_jobs) {
+            tables.resize(max_jobs);
+        }
+        std::vector<FlushJob> jobs(tables.size());
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            jobs[i].table = tables[i];
+            rs = PrepareFlushJob(cfd, &jobs[i]);
+            if (!rs) {
+                break;
+            }
+        }
+        if (rs.ok()) {
+            mutex_.unlock(); // Do not need DB lock ---------------------------
+            bkg_pool_->ParallelRun(base::ThreadPool::kHigh, jobs.size(),
+                                   [this, cfd, &jobs] (size_t i) {
+                jobs[i].rs = WriteLevel0Table(cfd, &jobs[i]);
+            });
+            mutex_.lock();
+            
+            for (const auto &job : jobs) {
+                if (job.rs.fail()) {
+                    rs = job.rs;
+                    break;
+                }
+            }
+        }
+        if (rs.ok() && shutting_down_.load()) {
+            rs = MAI_IO_ERROR("Deleting DB during memtable compaction");
+        }
+        
+        if (rs.ok()) {
+            VersionPatch patch;
+            // Keep the order of tables, the newer level-0 file must be
+            // looked up first.
+            const uint64_t ctime = env_->CurrentTimeMicros();
+            for (size_t i = 0; i < jobs.size(); ++i) {
+                FileMetaData *fmd = new FileMetaData(jobs[i].file_number);
+                fmd->ctime         = ctime + i;
+                fmd->size          = jobs[i].builder->FileSize();
+                fmd->largest_key   = jobs[i].largest_key;
+                fmd->smallest_key  = jobs[i].smallest_key;
+                fmd->num_entries   = jobs[i].builder->NumEntries();
+                fmd->num_deletions = jobs[i].num_deletions;
+                patch.CreaetFile(cfd->id(), 0, fmd);
+            }
+            patch.SetPrevLogNumber(0);
+            patch.SetRedoLog(cfd->id(), jobs.back().table->associated_file_number());
+            rs = versions_->LogAndApply(ColumnFamilyOptions{}, &patch, &mutex_);
         }
-        if (shutting_down_.load()) {
-            return MAI_IO_ERROR("Deleting DB during memtable compaction");
+        
+        for (auto &job : jobs) {
+            if (job.file_number != 0) {
+                pending_outputs_.erase(job.file_number);
+            }
+            if (rs.fail() && job.builder && !job.done) {
+                job.builder->Abandon();
+            }
         }
-        patch.SetPrevLogNumber(0);
-        patch.SetRedoLog(cfd->id(), imm->associated_file_number());
-        rs = versions_->LogAndApply(ColumnFamilyOptions{}, &patch, &mutex_);
         if (!rs) {
             return rs;
         }
-
-        cfd->immutable_pipeline()->Take(&imm);
-        patch.Reset();
+        base::intrusive_ptr<core::MemoryTable> imm;
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            cfd->immutable_pipeline()->Take(&imm);
+            DCHECK_EQ(imm.get(), jobs[i].table.get());
+        }
+        cfd->InstallSuperVersion();
     }
     return Error::OK();
 }
 
+struct DBImpl::Subcompaction {
+    std::string begin_key;
+    std::string end_key;
+    std::unique_ptr<Compaction> job;
+    std::unique_ptr<WritableFile> file;
+    std::unique_ptr<table::TableBuilder> builder;
+    CompactionResult result;
+    Error rs;
+    bool done = false; // Builder be finished or abandoned by job.
+}; // struct DBImpl::Subcompaction
+
 // REQUIRES mutex_.lock()
 Error DBImpl::CompactFileTable(ColumnFamilyImpl *cfd, CompactionContext *ctx) {
     DCHECK_GE(ctx->level, 0);
-    DCHECK_LT(ctx->level, Config::kMaxLevel - 1);
+    DCHECK_LT(ctx->level, ctx->output_level);
+    StopWatch watch(stats_.get(), kHistogramCompaction);
     
     base::intrusive_ptr<table::TablePropsBoundle> boundle;
     size_t n_entries = 0;
-    for (auto fmd : ctx->inputs[0]) {
-        Error rs = table_cache_->GetTableProperties(cfd, fmd->number, &boundle);
-        if (!rs) {
-            return rs;
+    uint64_t input_size = 0;
+    for (const auto &inputs : ctx->inputs) {
+        for (auto fmd : inputs) {
+            Error rs = table_cache_->GetTableProperties(cfd, fmd->number,
+                                                        &boundle);
+            if (!rs) {
+                return rs;
+            }
+            n_entries  += boundle->data().num_entries;
+            input_size += fmd->size;
         }
-        n_entries += boundle->data().num_entries;
     }
-    for (auto fmd : ctx->inputs[1]) {
-        Error rs = table_cache_->GetTableProperties(cfd, fmd->number, &boundle);
-        if (!rs) {
-            return rs;
-        }
-        n_entries += boundle->data().num_entries;
+    
+    std::vector<std::string> boundaries;
+    if (!cfd->options().use_unordered_table) {
+        // Only ordered table can be split by key range, and shards can not
+        // be more than background threads.
+        uint64_t max_shards = std::min<uint64_t>(options_.max_subcompactions,
+                                                 bkg_pool_->n_threads());
+        max_shards = std::min<uint64_t>(max_shards, input_size /
+            std::max<uint64_t>(options_.min_subcompaction_size, 1));
+        cfd->SplitCompaction(*ctx, max_shards, &boundaries);
+    }
+    std::vector<Subcompaction> shards(boundaries.size() + 1);
+    for (size_t i = 0; i < boundaries.size(); ++i) {
+        shards[i].end_key         = boundaries[i];
+        shards[i + 1].begin_key   = boundaries[i];
     }
-    size_t new_num_slots = Config::ComputeNumSlots(ctx->level + 1, n_entries,
+    size_t new_num_slots = Config::ComputeNumSlots(ctx->output_level,
+                                                   n_entries / shards.size(),
                                                    Config::kLimitMinNumberSlots);
+    // The prepared but not committed versions can not hide older ones.
+    core::SequenceNumber smallest_snapshot =
+        commit_map_->AdjustSmallestSnapshot(GetSmallestSnapshot());
     
-    std::unique_ptr<Compaction>
-    job(factory_->NewCompaction(abs_db_path_, cfd->ikcmp(),
-                                table_cache_.get(), cfd));
-    job->set_target_level(ctx->level + 1);
-    job->set_compaction_point(cfd->compaction_point(ctx->level));
-    job->set_input_version(ctx->input_version);
-    job->set_target_file_number(versions_->GenerateFileNumber());
+    Error rs;
+    for (auto &shard : shards) {
+        rs = PrepareSubcompaction(cfd, *ctx, smallest_snapshot, new_num_slots,
+                                  n_entries / shards.size(), &shard);
+        if (!rs) {
+            break;
+        }
+    }
+    if (rs.ok()) {
+        for (auto fmd : ctx->inputs[0]) {
+            ctx->patch.DeleteFile(cfd->id(), ctx->level, fmd->number);
+        }
+        for (auto fmd : ctx->inputs[1]) {
+            ctx->patch.DeleteFile(cfd->id(), ctx->output_level, fmd->number);
+        }
+        
+        mutex_.unlock();
+        // This thread also runs shards, others run in background threads.
+        bkg_pool_->ParallelRun(base::ThreadPool::kLow, shards.size(),
+                               [&shards] (size_t i) {
+            Subcompaction *shard = &shards[i];
+            shard->rs = shard->job->Run(shard->builder.get(), &shard->result);
+            shard->done = shard->rs.ok();
+        });
+        mutex_.lock();
+        
+        for (const auto &shard : shards) {
+            if (shard.rs.fail()) {
+                rs = shard.rs;
+                break;
+            }
+        }
+    }
     
-    if (snapshots_.empty()) {
-        job->set_smallest_snapshot(versions_->last_sequence_number());
-    } else {
-        job->set_smallest_snapshot(snapshots_.oldest()->sequence_number());
+    for (auto &shard : shards) {
+        if (shard.job) {
+            pending_outputs_.erase(shard.job->target_file_number());
+        }
+        if (rs.fail() && shard.builder && !shard.done) {
+            shard.builder->Abandon();
+        }
+    }
+    if (!rs) {
+        return rs;
     }
     
-    for (auto fmd : ctx->inputs[0]) {
-        Iterator *iter = table_cache_->NewIterator(ReadOptions{}, cfd,
-                                                   fmd->number, fmd->size);
-        Error rs = iter->error();
-        if (!rs) {
-            delete iter;
-            return rs;
+    for (const auto &shard : shards) {
+        if (shard.builder->NumEntries() == 0) {
+            // All keys in this shard were dropped, the builder was abandoned,
+            // DeleteObsoleteFiles() will remove the empty file.
+            continue;
         }
-        job->AddInput(iter);
-        ctx->patch.DeleteFile(cfd->id(), ctx->level, fmd->number);
+        FileMetaData *fmd = new FileMetaData(shard.job->target_file_number());
+        fmd->ctime        = env_->CurrentTimeMicros();
+        fmd->size         = shard.builder->FileSize();
+        fmd->largest_key  = shard.result.largest_key;
+        fmd->smallest_key = shard.result.smallest_key;
+        fmd->num_entries   = shard.builder->NumEntries();
+        fmd->num_deletions = shard.result.tombstone_keys;
+        ctx->patch.CreaetFile(cfd->id(), shard.job->target_level(), fmd);
     }
-    for (auto fmd : ctx->inputs[1]) {
-        Iterator *iter = table_cache_->NewIterator(ReadOptions{}, cfd,
-                                                   fmd->number, fmd->size);
-        Error rs = iter->error();
-        if (!rs) {
-            delete iter;
-            return rs;
+    return Error::OK();
+}
+    
+// REQUIRES mutex_.lock()
+Error DBImpl::PrepareSubcompaction(ColumnFamilyImpl *cfd,
+                                   const CompactionContext &ctx,
+                                   core::SequenceNumber smallest_snapshot,
+                                   size_t num_slots, size_t n_entries,
+                                   Subcompaction *shard) {
+    std::unique_ptr<Compaction>
+    job(factory_->NewCompaction(abs_db_path_, cfd->ikcmp(),
+                                table_cache_.get(), cfd));
+    job->set_target_level(ctx.output_level);
+    job->set_compaction_point(cfd->compaction_point(ctx.level));
+    job->set_input_version(ctx.input_version);
+    job->set_smallest_snapshot(smallest_snapshot);
+    job->set_begin_key(shard->begin_key);
+    job->set_end_key(shard->end_key);
+    
+    // Compaction reads every input block once, don't let it flush the hot
+    // blocks out of block cache.
+    ReadOptions read_opts;
+    read_opts.fill_cache = false;
+    for (const auto &inputs : ctx.inputs) {
+        for (auto fmd : inputs) {
+            Iterator *iter = table_cache_->NewIterator(read_opts, cfd,
+                                                       fmd->number, fmd->size,
+                                                       fmd->global_sequence);
+            Error rs = iter->error();
+            if (!rs) {
+                delete iter;
+                return rs;
+            }
+            job->AddInput(iter);
         }
-        job->AddInput(iter);
-        ctx->patch.DeleteFile(cfd->id(), ctx->level + 1, fmd->number);
     }
     
-    std::unique_ptr<WritableFile> file;
+    job->set_target_file_number(versions_->GenerateFileNumber());
     Error rs =
-        env_->NewWritableFile(cfd->GetTableFileName(job->target_file_number()),
-                              false, &file);
+        NewWritableFile(cfd->GetTableFileName(job->target_file_number()), false,
+                        RateLimiter::kIOPriorityCompaction, &shard->file);
     if (!rs) {
         versions_->ReuseFileNumber(job->target_file_number());
         return rs;
     }
-    std::unique_ptr<table::TableBuilder>
-    builder(factory_->NewTableBuilder(cfd->options().use_unordered_table ?
-                                      "s1t" : "sst",
-                                      cfd->ikcmp(),
-                                      file.get(),
-                                      cfd->options().block_size,
-                                      cfd->options().block_restart_interval,
-                                      new_num_slots,
-                                      n_entries));
-    CompactionResult result;
-    mutex_.unlock();
-    rs = job->Run(builder.get(), &result); // FIXME:
-    mutex_.lock();
+    shard->builder.reset(factory_->NewTableBuilder(cfd->options().use_unordered_table ?
+                                                   "s1t" : "sst",
+                                                   cfd->ikcmp(),
+                                                   shard->file.get(),
+                                                   cfd->options().block_size,
+                                                   cfd->options().block_restart_interval,
+                                                   num_slots,
+                                                   n_entries,
+                                                   cfd->options().prefix_extractor,
+                                                   cfd->options().filter_partition_size,
+                                                   cfd->options().blocked_bloom_filter,
+                                                   cfd->options().compression));
+    pending_outputs_.insert(job->target_file_number());
+    shard->job = std::move(job);
+    return Error::OK();
+}
+    
+// REQUIRES mutex_.lock()
+Error DBImpl::PrepareFlushJob(ColumnFamilyImpl *cfd, FlushJob *job) {
+    job->file_number = versions_->GenerateFileNumber();
+    LOG(INFO) << "Level0 table compaction start, target file number: "
+        << job->file_number;
+    Error rs = NewWritableFile(cfd->GetTableFileName(job->file_number), false,
+                               RateLimiter::kIOPriorityFlush, &job->file);
     if (!rs) {
-        builder->Abandon();
+        versions_->ReuseFileNumber(job->file_number);
+        job->file_number = 0;
         return rs;
     }
-    DCHECK_GT(builder->NumEntries(), 0) << "Empty compaction!";
+    pending_outputs_.insert(job->file_number);
+    // The blocks be built in this thread, and be written in another thread.
+    job->file.reset(new base::AsyncWritableFile(job->file.release(), true,
+                                                bkg_pool_.get()));
     
-    FileMetaData *fmd = new FileMetaData(job->target_file_number());
-    fmd->ctime        = env_->CurrentTimeMicros();
-    fmd->size         = builder->FileSize();
-    fmd->largest_key  = result.largest_key;
-    fmd->smallest_key = result.smallest_key;
-    ctx->patch.CreaetFile(cfd->id(), job->target_level(), fmd);
+    size_t new_num_slots = Config::ComputeNumSlots(0, job->table->NumEntries(),
+                                                   Config::kLimitMinNumberSlots);
+    job->builder.reset(factory_->NewTableBuilder(cfd->options().use_unordered_table ?
+                                                 "s1t" : "sst",
+                                                 cfd->ikcmp(),
+                                                 job->file.get(),
+                                                 cfd->options().block_size,
+                                                 cfd->options().block_restart_interval,
+                                                 new_num_slots,
+                                                 job->table->NumEntries(),
+                                                 cfd->options().prefix_extractor,
+                                                 cfd->options().filter_partition_size,
+                                                 cfd->options().blocked_bloom_filter,
+                                                 cfd->options().compression));
     return Error::OK();
 }
     
-Error DBImpl::WriteLevel0Table(Version *current, VersionPatch *patch,
-                               core::MemoryTable *table) {
+// Run without DB lock, the file will be installed by caller under DB lock.
+Error DBImpl::WriteLevel0Table(ColumnFamilyImpl *cfd, FlushJob *job) {
+    StopWatch watch(stats_.get(), kHistogramFlush);
+    uint64_t jiffies = env_->CurrentTimeMicros();
     
-    std::unique_ptr<Iterator> iter(table->NewIterator());
+    std::unique_ptr<Iterator> iter(job->table->NewIterator());
     if (iter->error().fail()) {
         return iter->error();
     }
-    uint64_t file_number = versions_->GenerateFileNumber();
-    LOG(INFO) << "Level0 table compaction start, target file number: "
-        << file_number;
-    mutex_.unlock(); // Do not need DB lock -------------------------------------
-    
-    uint64_t jiffies = env_->CurrentTimeMicros();
-    
-    std::unique_ptr<WritableFile> file;
-    std::string table_file_name = current->owns()->GetTableFileName(file_number);
-    Error rs = env_->NewWritableFile(table_file_name, false, &file);
-    if (!rs) {
-        versions_->ReuseFileNumber(file_number);
-        mutex_.lock();
-        return rs;
-    }
-    
-    ColumnFamilyImpl *cfd = current->owns();
-    size_t new_num_slots = Config::ComputeNumSlots(0, table->NumEntries(),
-                                                   Config::kLimitMinNumberSlots);
-
-    std::unique_ptr<table::TableBuilder>
-        builder(factory_->NewTableBuilder(cfd->options().use_unordered_table ?
-                                          "s1t" : "sst",
-                                          cfd->ikcmp(),
-                                          file.get(), cfd->options().block_size,
-                                          cfd->options().block_restart_interval,
-                                          new_num_slots,
-                                          table->NumEntries()));
-    std::string largest_key, smallest_key;
+    Error rs;
     for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
-        builder->Add(iter->key(), iter->value());
-        rs = builder->error();
+        job->builder->Add(iter->key(), iter->value());
+        if (core::KeyBoundle::ExtractTag(iter->key()).flag() ==
+            core::Tag::kFlagDeletion) {
+            job->num_deletions++;
+        }
+        rs = job->builder->error();
         if (!rs) {
-            builder->Abandon();
-            mutex_.lock();
             return rs;
         }
-        if (largest_key.empty() ||
-            cfd->ikcmp()->Compare(iter->key(), largest_key) > 0) {
-            largest_key = iter->key();
+        if (job->largest_key.empty() ||
+            cfd->ikcmp()->Compare(iter->key(), job->largest_key) > 0) {
+            job->largest_key = iter->key();
         }
-        if (smallest_key.empty() ||
-            cfd->ikcmp()->Compare(iter->key(), smallest_key) < 0) {
-            smallest_key = iter->key();
+        if (job->smallest_key.empty() ||
+            cfd->ikcmp()->Compare(iter->key(), job->smallest_key) < 0) {
+            job->smallest_key = iter->key();
         }
     }
-    rs = builder->Finish();
+    rs = job->builder->Finish();
+    if (!rs) {
+        return rs;
+    }
+    job->done = true;
+    // Wait for the writing job.
+    rs = job->file->Flush();
     if (!rs) {
-        mutex_.lock();
         return rs;
     }
-    
-    FileMetaData *fmd = new FileMetaData(file_number);
-    fmd->ctime        = env_->CurrentTimeMicros();
-    fmd->size         = builder->FileSize();
-    fmd->largest_key  = largest_key;
-    fmd->smallest_key = smallest_key;
-    patch->CreaetFile(cfd->id(), 0, fmd);
     
     DLOG(INFO) << "Cost: " << (env_->CurrentTimeMicros() - jiffies) / 1000.0 << " ms "
-               << "[" << core::KeyBoundle::ExtractUserKey(fmd->smallest_key)
-               << "," << core::KeyBoundle::ExtractUserKey(fmd->largest_key)
+               << "[" << core::KeyBoundle::ExtractUserKey(job->smallest_key)
+               << "," << core::KeyBoundle::ExtractUserKey(job->largest_key)
                << "]";
-    mutex_.lock();
     return Error::OK();
 }
     
@@ -1268,12 +2576,16 @@ void DBImpl::DeleteObsoleteFiles(ColumnFamilyImpl *cfd) {
     }
     
     std::map<uint64_t, std::string> cleanup;
+    std::set<uint64_t> logs;
     for (const auto &name : children) {
         uint64_t number;
         Files::Kind kind;
         std::tie(kind, number) = Files::ParseName(name);
         switch (kind) {
             case Files::kLog:
+                logs.insert(number);
+                cleanup[number] = abs_db_path_ + "/" + name;
+                break;
             case Files::kManifest:
                 cleanup[number] = abs_db_path_ + "/" + name;
                 break;
@@ -1282,11 +2594,39 @@ void DBImpl::DeleteObsoleteFiles(ColumnFamilyImpl *cfd) {
                 break;
         }
     }
-    cleanup.erase(log_file_number_);
     cleanup.erase(versions_->manifest_file_number());
     
+    // The logs after the oldest not flushed one are all alive, every immutable
+    // table waiting for flush is backed by its own log. They can not be
+    // deleted or recycled.
+    uint64_t min_live_log = log_file_number_;
     for (ColumnFamilyImpl *cfd : *versions_->column_families()) {
-        cleanup.erase(cfd->redo_log_number());
+        min_live_log = std::min(min_live_log, cfd->redo_log_number());
+        base::intrusive_ptr<core::MemoryTable> oldest;
+        if (cfd->immutable_pipeline()->Peek(&oldest)) {
+            min_live_log = std::min(min_live_log,
+                                    oldest->associated_file_number());
+        }
+    }
+    for (auto number : logs) {
+        if (number >= min_live_log) {
+            cleanup.erase(number);
+        }
+    }
+    for (auto number : recycle_logs_) {
+        cleanup.erase(number);
+    }
+    // Keep the obsolete log files for recycling.
+    for (auto number : logs) {
+        if (recycle_logs_.size() >= options_.recycle_log_file_num) {
+            break;
+        }
+        auto iter = cleanup.find(number);
+        if (iter != cleanup.end() && min_recyclable_log_number_ > 0 &&
+            number >= min_recyclable_log_number_) {
+            recycle_logs_.push_back(number);
+            cleanup.erase(iter);
+        }
     }
     
     rs = env_->GetChildren(cfd->GetDir(), &children);
@@ -1305,10 +2645,13 @@ void DBImpl::DeleteObsoleteFiles(ColumnFamilyImpl *cfd) {
                 break;
         }
     }
-    for (int i = 0; i < Config::kMaxLevel; ++i) {
-        for (auto fmd : cfd->current()->level_files(i)) {
-            cleanup.erase(fmd->number);
-        }
+    std::set<uint64_t> live;
+    cfd->AddLiveFiles(&live);
+    for (auto number : live) {
+        cleanup.erase(number);
+    }
+    for (auto number : pending_outputs_) {
+        cleanup.erase(number);
     }
     
     for (const auto &pair : cleanup) {
@@ -1347,6 +2690,35 @@ DB::NewColumnFamilies(const std::vector<std::string> &names,
     return rs;
 }
     
+/*virtual*/ Error DB::Get(const ReadOptions &opts, ColumnFamily *cf,
+                          std::string_view key, PinnableValue *value) {
+    std::string result;
+    Error rs = Get(opts, cf, key, &result);
+    if (rs.ok()) {
+        value->Assign(result);
+    }
+    return rs;
+}
+    
+/*virtual*/ Error
+DB::MultiGet(const ReadOptions &opts, ColumnFamily *cf,
+             const std::vector<std::string_view> &keys,
+             std::vector<std::string> *values, std::vector<Error> *errors) {
+    DCHECK_NOTNULL(values)->resize(keys.size());
+    DCHECK_NOTNULL(errors)->resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        (*errors)[i] = Get(opts, cf, keys[i], &(*values)[i]);
+    }
+    return Error::OK();
+}
+    
+/*virtual*/ Error
+DB::IngestExternalFiles(const IngestExternalFileOptions &/*opts*/,
+                        ColumnFamily */*cf*/,
+                        const std::vector<std::string> &/*files*/) {
+    return MAI_NOT_SUPPORTED("IngestExternalFiles()");
+}
+    
 /*virtual*/ Error
 DB::DropColumnFamilies(const std::vector<ColumnFamily *> &column_families) {
     Error rs;
@@ -1366,8 +2738,15 @@ Error DB::Open(const Options &opts, const std::string &name,
     if (name.empty()) {
         return MAI_CORRUPTION("Empty db name.");
     }
+    Error rs = db::CheckColumnFamilyOptions(opts);
+    for (size_t i = 0; rs.ok() && i < descriptors.size(); ++i) {
+        rs = db::CheckColumnFamilyOptions(descriptors[i].options);
+    }
+    if (!rs) {
+        return rs;
+    }
     db::DBImpl *impl = new db::DBImpl(name, opts);
-    Error rs = impl->Open(descriptors, column_families);
+    rs = impl->Open(descriptors, column_families);
     if (!rs) {
         return rs;
     }
@@ -3,12 +3,15 @@
 
 #include "db/snapshot-impl.h"
 #include "base/reference-count.h"
+#include "base/thread-pool.h"
 #include "base/base.h"
 #include "mai/db.h"
 #include "mai/options.h"
 #include "mai/write-batch.h"
 #include <thread>
 #include <mutex>
+#include <deque>
+#include <set>
 
 namespace mai {
 class WritableFile;
@@ -28,6 +31,9 @@ class VersionPatch;
 class Factory;
 class ColumnFamilyImpl;
 struct CompactionContext;
+class Statistics;
+class RecentWrites;
+class CommitMap;
 class DBImpl;
 struct GetContext;
     
@@ -68,8 +74,17 @@ public:
     virtual Error Write(const WriteOptions& opts, WriteBatch* updates) override;
     virtual Error Get(const ReadOptions &opts, ColumnFamily *cf,
                       std::string_view key, std::string *value) override;
+    virtual Error Get(const ReadOptions &opts, ColumnFamily *cf,
+                      std::string_view key, PinnableValue *value) override;
+    virtual Error MultiGet(const ReadOptions &opts, ColumnFamily *cf,
+                           const std::vector<std::string_view> &keys,
+                           std::vector<std::string> *values,
+                           std::vector<Error> *errors) override;
     virtual Iterator *
     NewIterator(const ReadOptions &opts, ColumnFamily *cf) override;
+    virtual Error IngestExternalFiles(const IngestExternalFileOptions &opts,
+                                      ColumnFamily *cf,
+                                      const std::vector<std::string> &files) override;
     virtual const Snapshot *GetSnapshot() override;
     virtual void ReleaseSnapshot(const Snapshot *snapshot) override;
     virtual ColumnFamily *DefaultColumnFamily() override;
@@ -78,7 +93,7 @@ public:
     
     Error WriteImpl(const WriteOptions& opts, WriteBatch* batch,
                     WriteCallback *callback);
-    Iterator *NewInternalIterator(const ReadOptions &opts, ColumnFamilyImpl *cfd);
+    Iterator *NewInternalIterator(const ReadOptions &opts, const GetContext &ctx);
     core::SequenceNumber GetLatestSequenceNumber();
 
     Error GetColumnFamilyImpl(uint32_t cfid,
@@ -87,37 +102,98 @@ public:
                                    bool cache_only,
                                    std::string_view key,
                                    core::SequenceNumber *seq);
+    // Lookup all keys in one pinned super version, the keys should be
+    // sorted. The sequence number of not found key is kMaxSequenceNumber.
+    Error GetLatestSequenceForKeys(ColumnFamilyImpl *impl,
+                                   const std::vector<std::string_view> &keys,
+                                   std::vector<core::SequenceNumber> *seqs);
+    
+    // Record the sequence numbers of all writes from now on.
+    void EnableRecentWrites(size_t n_slots);
+    // Null if recent writes be not enabled.
+    // REQUIRES: mutex_.lock()
+    const RecentWrites *recent_writes() const { return recent_writes_.get(); }
+    
+    // Two-phase commit: The prepared batch be written into WAL and memory
+    // tables, but it's invisible until be committed by name.
+    Error Prepare(const WriteOptions &opts, std::string_view name,
+                  WriteBatch *updates);
+    // Only write a commit marker.
+    Error CommitPrepared(const WriteOptions &opts, std::string_view name);
+    // Write the old values of prepared keys, they hide the prepared ones.
+    Error RollbackPrepared(const WriteOptions &opts, std::string_view name);
+    // The prepared transactions, include the recovered ones.
+    const CommitMap *commit_map() const { return commit_map_.get(); }
 
     //void TEST_PrintFiles(ColumnFamily *cf);
     Error TEST_ForceDumpImmutableTable(ColumnFamily *cf, bool sync);
     TableCache *TEST_GetTableCache() { return table_cache_.get(); }
+    base::ThreadPool *TEST_GetBackgroundPool() { return bkg_pool_.get(); }
+    void TEST_DeleteObsoleteFiles(ColumnFamily *cf);
     
     DISALLOW_IMPLICIT_CONSTRUCTORS(DBImpl);
 private:
+    struct Writer;
+    struct ParallelGroup;
+    struct Subcompaction;
+    struct FlushJob;
+    struct ExternalFile;
+    
+    WriteBatch *BuildWriteGroup(Writer **last_writer, size_t *n_writers);
+    bool CanInsertConcurrently() const;
+    void ParallelInsert(Writer *leader, Writer *last_writer,
+                        core::SequenceNumber sequence,
+                        std::unique_lock<std::mutex> *lock);
+    void InsertConcurrently(Writer *w);
     Error RenewLogger();
+    void NewLogger(uint64_t offset);
     Error Redo(uint64_t log_file_number,
                core::SequenceNumber last_sequence_number,
                core::SequenceNumber *update_sequence_number,
-               bool filter);
+               bool filter, uint64_t *log_size);
     Error PrepareForGet(const ReadOptions &opts, ColumnFamily *cf,
                         GetContext *ctx);
+    Error PrepareForGet(const ReadOptions &opts, ColumnFamilyImpl *cfd,
+                        GetContext *ctx);
+    Error GetImpl(const ReadOptions &opts, const GetContext &ctx,
+                  std::string_view key, PinnableValue *value);
+    core::SequenceNumber GetSmallestSnapshot() const;
     Error Write(const WriteOptions &opts, ColumnFamily *cf,
                 std::string_view key, std::string_view value, uint8_t flag);
     Error MakeRoomForWrite(ColumnFamilyImpl *cfd,
                            std::unique_lock<std::mutex> *lock);
     void MaybeScheduleCompaction(ColumnFamilyImpl *cfd);
-    void BackgroundWork(ColumnFamilyImpl *cfd);
+    void BackgroundWork(ColumnFamilyImpl *cfd, bool flush);
+    void BackgroundFlush(ColumnFamilyImpl *cfd);
     void BackgroundCompaction(ColumnFamilyImpl *cfd);
     void FlushWork();
     Error CompactMemoryTable(ColumnFamilyImpl *cfd);
     Error CompactFileTable(ColumnFamilyImpl *cfd, CompactionContext *ctx);
-    Error WriteLevel0Table(Version *current, VersionPatch *patch,
-                           core::MemoryTable *imm);
+    Error PrepareSubcompaction(ColumnFamilyImpl *cfd,
+                               const CompactionContext &ctx,
+                               core::SequenceNumber smallest_snapshot,
+                               size_t num_slots, size_t n_entries,
+                               Subcompaction *shard);
+    Error PrepareFlushJob(ColumnFamilyImpl *cfd, FlushJob *job);
+    Error WriteLevel0Table(ColumnFamilyImpl *cfd, FlushJob *job);
     void DeleteObsoleteFiles(ColumnFamilyImpl *cfd);
     Error InternalNewColumnFamily(const std::string &name,
                                   const ColumnFamilyOptions &opts,
                                   uint32_t *cfid);
     Error GetTotalWalSize(uint64_t *size);
+    Error NewWritableFile(const std::string &file_name, bool append,
+                          RateLimiter::IOPriority pri,
+                          std::unique_ptr<WritableFile> *file);
+    Error PrepareExternalFiles(const IngestExternalFileOptions &opts,
+                               ColumnFamilyImpl *cfd,
+                               const std::vector<std::string> &files,
+                               std::vector<ExternalFile> *result);
+    Error InstallExternalFiles(ColumnFamilyImpl *cfd,
+                               std::vector<ExternalFile> *files,
+                               std::unique_lock<std::mutex> *lock);
+    bool MemoryTablesOverlap(ColumnFamilyImpl *cfd,
+                             const std::vector<ExternalFile> &files);
+    Error CopyFile(const std::string &from, const std::string &to);
     
     const std::string db_name_;
     const Options options_;
@@ -126,9 +202,15 @@ private:
     std::unique_ptr<Factory> factory_;
     std::atomic<int> bkg_active_;
     std::atomic<bool> shutting_down_;
+    std::unique_ptr<base::ThreadPool> bkg_pool_; // Flush and compaction jobs
+    std::unique_ptr<base::ThreadPool> io_pool_; // Reading blocks in parallel
+    std::set<uint64_t> pending_outputs_; // Table files being written by jobs
     //std::unique_ptr<table::BlockCache> block_cache_;
     std::unique_ptr<TableCache> table_cache_;
     std::unique_ptr<VersionSet> versions_;
+    std::unique_ptr<Statistics> stats_; // Null if statistics be disabled
+    std::unique_ptr<RecentWrites> recent_writes_;
+    std::unique_ptr<CommitMap> commit_map_; // States of prepared transactions
     std::atomic<uint64_t> total_wal_size_;
     
     SnapshotList snapshots_;
@@ -136,12 +218,24 @@ private:
     std::unique_ptr<WritableFile> log_file_;
     std::unique_ptr<LogWriter> logger_;
     uint64_t log_file_number_ = 0;
+    // Obsolete log files to be reused by RenewLogger(). Only the files have
+    // number >= min_recyclable_log_number_ are recyclable format.
+    std::deque<uint64_t> recycle_logs_;
+    uint64_t min_recyclable_log_number_ = 0;
     std::atomic<int> flush_request_;
     std::thread flush_worker_;
     Error bkg_error_;
+    std::deque<Writer *> writers_; // Group commit writers queue
+    bool parallel_inserting_ = false; // Writers are inserting memory tables.
+    std::condition_variable parallel_cv_; // For parallel_inserting_
+    WriteBatch group_batch_; // Only for leader writer
+    std::atomic<uint64_t> n_write_groups_;
+    std::atomic<uint64_t> n_group_writers_;
+    std::atomic<uint64_t> write_wait_micros_;
     std::condition_variable bkg_cv_;
     std::mutex bkg_mutex_; // Only for bkg_cv_
     std::mutex mutex_; // DB lock
+    std::mutex log_mutex_; // Only for log_file_ and logger_ writing
 }; // class DBImpl
 
 } // namespace db
@@ -1,4 +1,5 @@
 #include "db/db-iterator.h"
+#include "db/statistics.h"
 #include "core/key-boundle.h"
 #include "mai/comparator.h"
 
@@ -6,6 +7,10 @@ namespace mai {
     
 namespace db {
     
+static void SharedValueCleanup(void *arg1, void */*arg2*/) {
+    delete static_cast<std::shared_ptr<PinnableValue> *>(arg1);
+}
+    
 /*virtual*/ DBIterator::~DBIterator() {}
 
 /*virtual*/ bool DBIterator::Valid() const {
@@ -13,6 +18,11 @@ namespace db {
 }
 
 /*virtual*/ void DBIterator::SeekToFirst() {
+    if (!prefix_.empty()) {
+        Seek(prefix_);
+        return;
+    }
+    StopWatch watch(stats_, kHistogramSeek);
     direction_ = kForward;
     ClearSavedValue();
     iter_->SeekToFirst();
@@ -24,13 +34,29 @@ namespace db {
 }
 
 /*virtual*/ void DBIterator::SeekToLast() {
+    StopWatch watch(stats_, kHistogramSeek);
     direction_ = kReserve;
     ClearSavedValue();
-    iter_->SeekToLast();
+    std::string limit(prefix_);
+    ucmp_->FindShortSuccessor(&limit);
+    if (!prefix_.empty() && limit != prefix_) {
+        // Seek to the first key after prefix, then step back.
+        iter_->Seek(core::KeyBoundle::MakeKey(limit, core::Tag::kMaxSequenceNumber,
+                                              core::Tag::kFlagValueForSeek));
+        if (iter_->Valid()) {
+            iter_->Prev();
+        } else {
+            iter_->SeekToLast();
+        }
+    } else {
+        iter_->SeekToLast();
+    }
     FindPrevUserEntry();
+    CheckPrefix();
 }
 
 /*virtual*/ void DBIterator::Seek(std::string_view target) {
+    StopWatch watch(stats_, kHistogramSeek);
     direction_ = kForward;
     ClearSavedValue();
     saved_key_.clear();
@@ -43,10 +69,12 @@ namespace db {
     } else {
         valid_ = false;
     }
+    CheckPrefix();
 }
 
 /*virtual*/ void DBIterator::Next() {
     DCHECK(Valid());
+    StopWatch watch(stats_, kHistogramNext);
     
     if (direction_ == kReserve) {  // Switch directions?
         direction_ = kForward;
@@ -69,6 +97,7 @@ namespace db {
         SaveKey(core::KeyBoundle::ExtractUserKey(iter_->key()), &saved_key_);
     }
     FindNextUserEntry(true, &saved_key_);
+    CheckPrefix();
 }
     
 /*virtual*/ void DBIterator::Prev() {
@@ -96,6 +125,7 @@ namespace db {
     }
     
     FindPrevUserEntry();
+    CheckPrefix();
 }
 
 /*virtual*/ std::string_view DBIterator::key() const {
@@ -106,7 +136,18 @@ namespace db {
 
 /*virtual*/ std::string_view DBIterator::value() const {
     DCHECK(Valid());
-    return direction_ == kForward ? iter_->value() : saved_value_;
+    return direction_ == kForward ? iter_->value() : saved_value_->value();
+}
+
+/*virtual*/ void DBIterator::PinValue(PinnableValue *result) const {
+    DCHECK(Valid());
+    if (direction_ == kForward) {
+        iter_->PinValue(result);
+    } else {
+        // Share the saved value, it be released by the last owner.
+        result->Pin(saved_value_->value(), SharedValueCleanup,
+                    new std::shared_ptr<PinnableValue>(saved_value_));
+    }
 }
 
 /*virtual*/ Error DBIterator::error() const {
@@ -123,7 +164,7 @@ void DBIterator::FindNextUserEntry(bool skipping, std::string *skip) {
         bool ok = core::KeyBoundle::ParseTaggedKey(iter_->key(), &ikey);
         DCHECK(ok) << "Incorrect internal key."; (void)ok;
         
-        if (ikey.tag.sequence_number() <= last_sequence_number_) {
+        if (IsVisible(ikey.tag.sequence_number())) {
             switch (ikey.tag.flag()) {
                 case core::Tag::kFlagDeletion:
                     // Arrange to skip all upcoming entries for this key since
@@ -163,7 +204,7 @@ void DBIterator::FindPrevUserEntry() {
         do {
             core::KeyBoundle::ParseTaggedKey(iter_->key(), &ikey);
             
-            if (ikey.tag.sequence_number() <= last_sequence_number_) {
+            if (IsVisible(ikey.tag.sequence_number())) {
                 if ((value_type != core::Tag::kFlagDeletion) &&
                     ucmp_->Compare(ikey.user_key, saved_key_) < 0) {
                     // We encountered a non-deleted value in entries for previous keys,
@@ -174,14 +215,10 @@ void DBIterator::FindPrevUserEntry() {
                     saved_key_.clear();
                     ClearSavedValue();
                 } else {
-                    std::string_view raw_value = iter_->value();
-                    if (saved_value_.capacity() > raw_value.size() + 1048576) {
-                        std::string empty;
-                        swap(empty, saved_value_);
-                    }
                     SaveKey(core::KeyBoundle::ExtractUserKey(iter_->key()),
                             &saved_key_);
-                    saved_value_.assign(raw_value.data(), raw_value.size());
+                    // Pin value instead of copying, iter_ will move away.
+                    iter_->PinValue(MutableSavedValue());
                 }
             }
             iter_->Prev();
@@ -199,6 +236,13 @@ void DBIterator::FindPrevUserEntry() {
     }
 }
 
+void DBIterator::CheckPrefix() {
+    if (valid_ && !prefix_.empty() &&
+        key().substr(0, prefix_.size()).compare(prefix_) != 0) {
+        valid_ = false;
+    }
+}
+
 } // namespace db
     
 } // namespace mai
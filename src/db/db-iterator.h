@@ -1,21 +1,36 @@
 #ifndef MAI_DB_DB_ITERATOR_H_
 #define MAI_DB_DB_ITERATOR_H_
 
+#include "db/commit-map.h"
 #include "core/key-boundle.h"
 #include "mai/iterator.h"
+#include "mai/pinnable-value.h"
 #include "glog/logging.h"
+#include <memory>
 
 namespace mai {
 class Comparator;
 namespace db {
     
+class Statistics;
+    
 class DBIterator final : public Iterator {
 public:
+    // If prefix is not empty, only iterate the keys with this prefix.
+    // The seeking and nexting be measured by stats, if it's not null.
+    // The entries of not committed transactions be skipped by commit_map, if
+    // it's not null.
     DBIterator(const Comparator *ucmp, Iterator *iter,
-               core::SequenceNumber last_sequence_number)
+               core::SequenceNumber last_sequence_number,
+               std::string_view prefix = "", Statistics *stats = nullptr,
+               const CommitMap *commit_map = nullptr)
         : ucmp_(DCHECK_NOTNULL(ucmp))
         , iter_(DCHECK_NOTNULL(iter))
-        , last_sequence_number_(last_sequence_number) {}
+        , last_sequence_number_(last_sequence_number)
+        , prefix_(prefix)
+        , stats_(stats)
+        , commit_map_(commit_map)
+        , saved_value_(new PinnableValue) {}
     
     virtual ~DBIterator();
 
@@ -27,16 +42,10 @@ public:
     virtual void Prev() override;
     virtual std::string_view key() const override;
     virtual std::string_view value() const override;
+    virtual void PinValue(PinnableValue *result) const override;
     virtual Error error() const override;
     
-    void ClearSavedValue() {
-        if (saved_value_.capacity() > 1048576) {
-            std::string empty;
-            swap(empty, saved_value_);
-        } else {
-            saved_value_.clear();
-        }
-    }
+    void ClearSavedValue() { MutableSavedValue()->Reset(); }
 
     static void SaveKey(std::string_view raw, std::string *key) {
         key->assign(raw.data(), raw.size());
@@ -45,14 +54,35 @@ public:
 private:
     void FindNextUserEntry(bool skipping, std::string *skip);
     void FindPrevUserEntry();
+    void CheckPrefix();
+    
+    // The saved value may be shared by the values pinned by PinValue(), so
+    // make a new one for changing.
+    PinnableValue *MutableSavedValue() {
+        if (saved_value_.use_count() > 1) {
+            saved_value_.reset(new PinnableValue);
+        }
+        return saved_value_.get();
+    }
+    
+    bool IsVisible(core::SequenceNumber seq) const {
+        if (commit_map_) {
+            return commit_map_->IsVisible(seq, last_sequence_number_);
+        }
+        return seq <= last_sequence_number_;
+    }
     
     const Comparator *const ucmp_;
     std::unique_ptr<Iterator> iter_;
     const core::SequenceNumber last_sequence_number_;
+    const std::string prefix_;
+    Statistics *const stats_;
+    const CommitMap *const commit_map_;
     
     Error error_;
     std::string saved_key_;
-    std::string saved_value_;
+    // Pinned value for reserve direction, shared with the pinned results.
+    std::shared_ptr<PinnableValue> saved_value_;
     Direction direction_ = kForward;
     bool valid_ = false;
 }; // class DBIterator
@@ -21,11 +21,11 @@ public:
     
     virtual core::MemoryTable *
     NewMemoryTable(const core::InternalKeyComparator *ikcmp, bool unordered,
-                   size_t initial_slots) override {
+                   size_t initial_slots, size_t hash_index_slots) override {
         if (unordered) {
             return new core::UnorderedMemoryTable(ikcmp, static_cast<int>(initial_slots));
         } else {
-            return new core::OrderedMemoryTable(ikcmp);
+            return new core::OrderedMemoryTable(ikcmp, hash_index_slots);
         }
     }
     
@@ -70,14 +70,23 @@ public:
                     const core::InternalKeyComparator *ikcmp,
                     WritableFile *file, uint64_t block_size, int n_restart,
                     size_t max_hash_slots,
-                    size_t approximated_n_entries) override {
+                    size_t approximated_n_entries,
+                    const PrefixExtractor *prefix_extractor,
+                    size_t filter_partition_size,
+                    bool blocked_bloom_filter,
+                    CompressionType compression) override {
         if (name.compare("s1t") == 0) {
             return new table::S1TableBuilder(ikcmp, file, max_hash_slots,
                                              static_cast<uint32_t>(block_size),
-                                             approximated_n_entries);
+                                             approximated_n_entries,
+                                             compression);
         } else if (name.compare("sst") == 0) {
             return new table::SstTableBuilder(ikcmp, file, block_size, n_restart,
-                                              approximated_n_entries);
+                                              approximated_n_entries,
+                                              prefix_extractor,
+                                              filter_partition_size,
+                                              blocked_bloom_filter,
+                                              compression);
         }
         return nullptr;
     }
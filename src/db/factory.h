@@ -4,9 +4,11 @@
 #include "base/hash.h"
 #include "base/base.h"
 #include "mai/error.h"
+#include "mai/options.h"
 
 namespace mai {
 class RandomAccessFile;
+class PrefixExtractor;
 class WritableFile;
 class Allocator;
 namespace core {
@@ -30,7 +32,7 @@ public:
     
     virtual core::MemoryTable *
     NewMemoryTable(const core::InternalKeyComparator *ikcmp, bool unordered,
-                   size_t initial_slots) = 0;
+                   size_t initial_slots, size_t hash_index_slots) = 0;
     
     virtual Error
     NewTableReader(const std::string &name,
@@ -47,7 +49,11 @@ public:
                     const core::InternalKeyComparator *ikcmp,
                     WritableFile *file, uint64_t block_size, int n_restart,
                     size_t max_hash_slots,
-                    size_t approximated_n_entries) = 0;
+                    size_t approximated_n_entries,
+                    const PrefixExtractor *prefix_extractor,
+                    size_t filter_partition_size,
+                    bool blocked_bloom_filter,
+                    CompressionType compression) = 0;
     
     virtual Compaction *
     NewCompaction(const std::string &abs_db_path,
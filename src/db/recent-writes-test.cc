@@ -0,0 +1,76 @@
+#include "db/recent-writes.h"
+#include "base/slice.h"
+#include "mai/write-batch.h"
+#include "mai/db.h"
+#include "gtest/gtest.h"
+
+namespace mai {
+
+namespace db {
+
+class DummyColumnFamily final : public ColumnFamily {
+public:
+    DummyColumnFamily(uint32_t id) : id_(id) {}
+    virtual std::string name() const override { return "dummy"; }
+    virtual uint32_t id() const override { return id_; }
+    virtual const Comparator *comparator() const override {
+        return Comparator::Bytewise();
+    }
+    virtual Error GetDescriptor(ColumnFamilyDescriptor *) const override {
+        return MAI_NOT_SUPPORTED("Dummy column family.");
+    }
+private:
+    uint32_t id_;
+}; // class DummyColumnFamily
+
+TEST(RecentWritesTest, Sanity) {
+    RecentWrites recent_writes(1000, 100);
+    ASSERT_EQ(1024, recent_writes.n_slots());
+    ASSERT_EQ(100, recent_writes.earliest_seq());
+
+    ASSERT_EQ(RecentWrites::kTrimmed, recent_writes.Check(0, "aaa", 99));
+    ASSERT_EQ(RecentWrites::kNotWritten, recent_writes.Check(0, "aaa", 100));
+
+    recent_writes.Add(0, "aaa", 101);
+    ASSERT_EQ(RecentWrites::kMaybeWritten, recent_writes.Check(0, "aaa", 100));
+    ASSERT_EQ(RecentWrites::kNotWritten, recent_writes.Check(0, "aaa", 101));
+    ASSERT_EQ(RecentWrites::kTrimmed, recent_writes.Check(0, "aaa", 99));
+
+    // The older write can not overwrite newer one.
+    recent_writes.Add(0, "aaa", 100);
+    ASSERT_EQ(RecentWrites::kMaybeWritten, recent_writes.Check(0, "aaa", 100));
+}
+
+TEST(RecentWritesTest, AddBatch) {
+    RecentWrites recent_writes(1 << 16, 0);
+    DummyColumnFamily cf0(0), cf1(1);
+
+    WriteBatch batch;
+    for (int i = 0; i < 100; ++i) {
+        batch.Put(&cf0, base::Sprintf("k.%d", i), "v");
+    }
+    batch.Delete(&cf0, "k.0");
+    recent_writes.AddBatch(batch, 10);
+
+    for (int i = 1; i < 100; ++i) {
+        auto key = base::Sprintf("k.%d", i);
+        ASSERT_EQ(RecentWrites::kMaybeWritten,
+                  recent_writes.Check(0, key, 10 + i - 1));
+        ASSERT_EQ(RecentWrites::kNotWritten,
+                  recent_writes.Check(0, key, 10 + i));
+    }
+    // Deleted at the last sequence.
+    ASSERT_EQ(RecentWrites::kMaybeWritten, recent_writes.Check(0, "k.0", 100));
+    ASSERT_EQ(RecentWrites::kNotWritten, recent_writes.Check(0, "k.0", 110));
+
+    // Same key in other column family.
+    batch.Clear();
+    batch.Put(&cf1, "k.1", "v");
+    recent_writes.AddBatch(batch, 200);
+    ASSERT_EQ(RecentWrites::kMaybeWritten, recent_writes.Check(1, "k.1", 110));
+    ASSERT_EQ(RecentWrites::kNotWritten, recent_writes.Check(0, "k.1", 110));
+}
+
+} // namespace db
+
+} // namespace mai
@@ -0,0 +1,67 @@
+#include "db/recent-writes.h"
+#include "base/hash.h"
+#include "mai/write-batch.h"
+#include "glog/logging.h"
+
+namespace mai {
+
+namespace db {
+
+namespace {
+
+class AddingHandler final : public WriteBatch::Stub {
+public:
+    AddingHandler(RecentWrites *owns, core::SequenceNumber seq)
+        : owns_(owns)
+        , seq_(seq) {}
+
+    virtual void Put(uint32_t cfid, std::string_view key,
+                     std::string_view /*value*/) override {
+        owns_->Add(cfid, key, seq_++);
+    }
+
+    virtual void Delete(uint32_t cfid, std::string_view key) override {
+        owns_->Add(cfid, key, seq_++);
+    }
+    
+    virtual void MarkCommit(std::string_view /*name*/) override { seq_++; }
+    
+    virtual void MarkRollback(std::string_view /*name*/) override { seq_++; }
+
+private:
+    RecentWrites *const owns_;
+    core::SequenceNumber seq_;
+}; // class AddingHandler
+
+size_t AlignSlots(size_t n_slots) {
+    size_t n = 1;
+    while (n < n_slots) {
+        n <<= 1;
+    }
+    return n;
+}
+
+} // namespace
+
+RecentWrites::RecentWrites(size_t n_slots, core::SequenceNumber earliest_seq)
+    : earliest_seq_(earliest_seq)
+    , mask_(AlignSlots(n_slots) - 1)
+    , slots_(new core::SequenceNumber[mask_ + 1]) {
+    DCHECK_GT(n_slots, 0);
+    for (size_t i = 0; i < mask_ + 1; ++i) {
+        slots_[i] = 0;
+    }
+}
+
+void RecentWrites::AddBatch(const WriteBatch &batch, core::SequenceNumber seq) {
+    AddingHandler handler(this, seq);
+    batch.Iterate(&handler);
+}
+
+/*static*/ uint64_t RecentWrites::Hash(uint32_t cfid, std::string_view key) {
+    return base::Hash::Murmur64(key.data(), key.size(), cfid);
+}
+
+} // namespace db
+
+} // namespace mai
@@ -0,0 +1,74 @@
+#ifndef MAI_DB_RECENT_WRITES_H_
+#define MAI_DB_RECENT_WRITES_H_
+
+#include "core/key-boundle.h"
+#include "base/base.h"
+#include <string_view>
+#include <memory>
+
+namespace mai {
+class WriteBatch;
+namespace db {
+
+// Bounded index of the newest sequence numbers written, by hash of column
+// family id and key. The sequence number of a slot is the newest one of all
+// keys in this slot, so it can prove a key has not been written after a
+// sequence number without any memory table or SST file lookup.
+//
+// It only knows the writes after it was enabled, the older history has been
+// trimmed.
+// REQUIRES: db mutex_.lock() for all methods.
+class RecentWrites final {
+public:
+    enum Result {
+        kNotWritten,   // The key has not been written after sequence number.
+        kMaybeWritten, // The key or another key in the same slot be written.
+        kTrimmed,      // The sequence number is older than the history.
+    }; // enum Result
+
+    // n_slots will be aligned to power of 2.
+    RecentWrites(size_t n_slots, core::SequenceNumber earliest_seq);
+
+    DEF_VAL_GETTER(core::SequenceNumber, earliest_seq);
+    size_t n_slots() const { return mask_ + 1; }
+
+    void Add(uint32_t cfid, std::string_view key, core::SequenceNumber seq) {
+        core::SequenceNumber *slot = &slots_[Hash(cfid, key) & mask_];
+        if (seq > *slot) {
+            *slot = seq;
+        }
+    }
+
+    // Add all keys of batch, first key is written at sequence number seq.
+    void AddBatch(const WriteBatch &batch, core::SequenceNumber seq);
+    
+    // Drop the history older than seq, for the writes can not be added one
+    // by one, e.g. ingested files.
+    void Trim(core::SequenceNumber seq) {
+        if (seq > earliest_seq_) {
+            earliest_seq_ = seq;
+        }
+    }
+
+    Result Check(uint32_t cfid, std::string_view key,
+                 core::SequenceNumber seq) const {
+        if (seq < earliest_seq_) {
+            return kTrimmed;
+        }
+        return slots_[Hash(cfid, key) & mask_] > seq ? kMaybeWritten : kNotWritten;
+    }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(RecentWrites);
+private:
+    static uint64_t Hash(uint32_t cfid, std::string_view key);
+
+    core::SequenceNumber earliest_seq_;
+    const size_t mask_;
+    std::unique_ptr<core::SequenceNumber[]> slots_;
+}; // class RecentWrites
+
+} // namespace db
+
+} // namespace mai
+
+#endif // MAI_DB_RECENT_WRITES_H_
@@ -0,0 +1,141 @@
+#include "mai/sst-file-writer.h"
+#include "db/factory.h"
+#include "db/config.h"
+#include "table/table-builder.h"
+#include "core/internal-key-comparator.h"
+#include "core/key-boundle.h"
+#include "mai/env.h"
+#include "glog/logging.h"
+#include <memory>
+
+namespace mai {
+    
+namespace db {
+    
+// All keys be tagged by Config::kExternalFileSequenceNumber,
+// DB::IngestExternalFiles() assigns a global sequence number to the file if
+// it needs.
+class SstFileWriterImpl final : public SstFileWriter {
+public:
+    SstFileWriterImpl(const ColumnFamilyOptions &options, Env *env,
+                      size_t approximated_n_entries)
+        : options_(options)
+        , env_(DCHECK_NOTNULL(env))
+        , approximated_n_entries_(approximated_n_entries)
+        , ikcmp_(options.comparator)
+        , factory_(Factory::NewDefault()) {}
+    
+    virtual ~SstFileWriterImpl() override {
+        if (builder_) {
+            builder_->Abandon();
+        }
+    }
+    
+    virtual Error Open(const std::string &file_name) override {
+        if (file_) {
+            return MAI_CORRUPTION("Writer has been opened.");
+        }
+        Error rs = env_->NewWritableFile(file_name, false, &file_);
+        if (!rs) {
+            return rs;
+        }
+        rs = file_->Truncate(0);
+        if (!rs) {
+            return rs;
+        }
+        size_t num_slots = Config::ComputeNumSlots(0, approximated_n_entries_,
+                                                   Config::kLimitMinNumberSlots);
+        builder_.reset(factory_->NewTableBuilder(options_.use_unordered_table ?
+                                                 "s1t" : "sst",
+                                                 &ikcmp_, file_.get(),
+                                                 options_.block_size,
+                                                 options_.block_restart_interval,
+                                                 num_slots,
+                                                 approximated_n_entries_,
+                                                 options_.prefix_extractor,
+                                                 options_.filter_partition_size,
+                                                 options_.blocked_bloom_filter,
+                                                 options_.compression));
+        return Error::OK();
+    }
+    
+    virtual Error Put(std::string_view key, std::string_view value) override {
+        return Add(key, value, core::Tag::kFlagValue);
+    }
+    
+    virtual Error Delete(std::string_view key) override {
+        return Add(key, "", core::Tag::kFlagDeletion);
+    }
+    
+    virtual Error Finish() override {
+        if (!builder_) {
+            return MAI_CORRUPTION("Writer not open.");
+        }
+        if (builder_->NumEntries() == 0) {
+            return MAI_CORRUPTION("Empty file can not be ingested.");
+        }
+        Error rs = builder_->Finish();
+        if (!rs) {
+            return rs;
+        }
+        file_size_   = builder_->FileSize();
+        num_entries_ = builder_->NumEntries();
+        builder_.reset();
+        rs = file_->Flush();
+        if (!rs) {
+            return rs;
+        }
+        rs = file_->Sync();
+        file_.reset();
+        return rs;
+    }
+    
+    virtual uint64_t FileSize() const override {
+        return builder_ ? builder_->FileSize() : file_size_;
+    }
+    
+    virtual uint64_t NumEntries() const override {
+        return builder_ ? builder_->NumEntries() : num_entries_;
+    }
+    
+private:
+    Error Add(std::string_view key, std::string_view value, uint8_t flag) {
+        if (!builder_) {
+            return MAI_CORRUPTION("Writer not open.");
+        }
+        if (builder_->NumEntries() > 0 &&
+            options_.comparator->Compare(key, last_key_) <= 0) {
+            return MAI_CORRUPTION("Keys must be added in ascending order.");
+        }
+        builder_->Add(core::KeyBoundle::MakeKey(key,
+                                                Config::kExternalFileSequenceNumber,
+                                                flag), value);
+        Error rs = builder_->error();
+        if (!rs) {
+            return rs;
+        }
+        last_key_.assign(key);
+        return Error::OK();
+    }
+    
+    const ColumnFamilyOptions options_;
+    Env *const env_;
+    const size_t approximated_n_entries_;
+    const core::InternalKeyComparator ikcmp_;
+    std::unique_ptr<Factory> factory_;
+    std::unique_ptr<WritableFile> file_;
+    std::unique_ptr<table::TableBuilder> builder_;
+    std::string last_key_;
+    uint64_t file_size_ = 0;
+    uint64_t num_entries_ = 0;
+}; // class SstFileWriterImpl
+    
+} // namespace db
+    
+/*static*/ SstFileWriter *SstFileWriter::New(const ColumnFamilyOptions &options,
+                                             Env *env,
+                                             size_t approximated_n_entries) {
+    return new db::SstFileWriterImpl(options, env, approximated_n_entries);
+}
+    
+} // namespace mai
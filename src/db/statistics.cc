@@ -0,0 +1,25 @@
+#include "db/statistics.h"
+
+namespace mai {
+
+namespace db {
+
+std::string Statistics::ToString() const {
+    static const char *kNames[] = {
+#define DEFINE_NAME(name, text) text,
+        DECL_DB_HISTOGRAMS(DEFINE_NAME)
+#undef DEFINE_NAME
+    };
+    std::string buf;
+    for (int i = 0; i < kNumHistograms; ++i) {
+        buf.append(kNames[i]);
+        buf.append(" (micros): ");
+        buf.append(histograms_[i].ToString(1000));
+        buf.append("\n");
+    }
+    return buf;
+}
+
+} // namespace db
+
+} // namespace mai
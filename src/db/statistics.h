@@ -0,0 +1,74 @@
+#ifndef MAI_DB_STATISTICS_H_
+#define MAI_DB_STATISTICS_H_
+
+#include "base/histogram.h"
+#include "base/base.h"
+#include "core/perf-context-impl.h"
+#include "glog/logging.h"
+#include <string>
+
+namespace mai {
+
+namespace db {
+
+#define DECL_DB_HISTOGRAMS(V) \
+    V(Get,        "db.get") \
+    V(Put,        "db.put") \
+    V(Delete,     "db.delete") \
+    V(Write,      "db.write") \
+    V(Seek,       "db.seek") \
+    V(Next,       "db.next") \
+    V(Flush,      "db.flush") \
+    V(Compaction, "db.compaction")
+
+enum HistogramType : int {
+#define DEFINE_ENUM(name, text) kHistogram##name,
+    DECL_DB_HISTOGRAMS(DEFINE_ENUM)
+#undef DEFINE_ENUM
+    kNumHistograms,
+}; // enum HistogramType
+
+// DB wide histograms of operation nanos, they can be updated by many threads
+// without locking.
+class Statistics final {
+public:
+    Statistics() {}
+
+    base::Histogram *histogram(HistogramType type) {
+        DCHECK_GE(type, 0);
+        DCHECK_LT(type, kNumHistograms);
+        return &histograms_[type];
+    }
+
+    // Every histogram in one line, in micros.
+    std::string ToString() const;
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(Statistics);
+private:
+    base::Histogram histograms_[kNumHistograms];
+}; // class Statistics
+
+// Add the elapsed nanos of scope to histogram. Do nothing if no statistics.
+class StopWatch final {
+public:
+    StopWatch(Statistics *stats, HistogramType type)
+        : histogram_(stats ? stats->histogram(type) : nullptr)
+        , start_(histogram_ ? core::NowNanos() : 0) {}
+
+    ~StopWatch() {
+        if (histogram_) {
+            histogram_->Add(core::NowNanos() - start_);
+        }
+    }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(StopWatch);
+private:
+    base::Histogram *const histogram_;
+    const uint64_t start_;
+}; // class StopWatch
+
+} // namespace db
+
+} // namespace mai
+
+#endif // MAI_DB_STATISTICS_H_
@@ -5,6 +5,8 @@
 #include "table/table.h"
 #include "table/block-cache.h"
 #include "core/key-filter.h"
+#include "core/key-boundle.h"
+#include "core/internal-key-comparator.h"
 #include "mai/iterator.h"
 #include "mai/options.h"
 #include <tuple>
@@ -48,52 +50,162 @@ static void HandleCleanup(void *arg1, void *arg2) {
     static_cast<core::LRUHandle *>(arg1)->ReleaseRef();
 }
     
+// Tag all keys of ingested file by its global sequence number. Every user key
+// appears once in the file, so the keys are still in order.
+class GlobalSequenceIterator final : public Iterator {
+public:
+    GlobalSequenceIterator(Iterator *iter,
+                           const core::InternalKeyComparator *ikcmp,
+                           core::SequenceNumber sequence)
+        : iter_(DCHECK_NOTNULL(iter))
+        , ikcmp_(DCHECK_NOTNULL(ikcmp))
+        , sequence_(sequence) {}
+    
+    virtual ~GlobalSequenceIterator() override {}
+    
+    virtual bool Valid() const override { return iter_->Valid(); }
+    
+    virtual void SeekToFirst() override {
+        iter_->SeekToFirst();
+        Update();
+    }
+    
+    virtual void SeekToLast() override {
+        iter_->SeekToLast();
+        Update();
+    }
+    
+    virtual void Seek(std::string_view target) override {
+        iter_->Seek(target);
+        Update();
+        // The key has same user key with target but it is newer than target.
+        if (iter_->Valid() && ikcmp_->Compare(key_, target) < 0) {
+            iter_->Next();
+            Update();
+        }
+    }
+    
+    virtual void Next() override {
+        iter_->Next();
+        Update();
+    }
+    
+    virtual void Prev() override {
+        iter_->Prev();
+        Update();
+    }
+    
+    virtual std::string_view key() const override { return key_; }
+    
+    virtual std::string_view value() const override { return iter_->value(); }
+    
+    virtual void PinValue(PinnableValue *result) const override {
+        iter_->PinValue(result);
+    }
+    
+    virtual Error error() const override { return iter_->error(); }
+    
+private:
+    void Update() {
+        if (iter_->Valid()) {
+            core::ParsedTaggedKey ikey;
+            core::KeyBoundle::ParseTaggedKey(iter_->key(), &ikey);
+            key_ = core::KeyBoundle::MakeKey(ikey.user_key, sequence_,
+                                             ikey.tag.flag());
+        }
+    }
+    
+    std::unique_ptr<Iterator> iter_;
+    const core::InternalKeyComparator *const ikcmp_;
+    const core::SequenceNumber sequence_;
+    std::string key_;
+}; // class GlobalSequenceIterator
+    
 TableCache::TableCache(const std::string &abs_db_path, const Options &opts,
-                       Factory *factory)
+                       Factory *factory, base::ThreadPool *io_pool)
     : abs_db_path_(abs_db_path)
     , env_(DCHECK_NOTNULL(opts.env))
-    , block_cache_(new table::BlockCache(opts.env->GetLowLevelAllocator(),
-                                         opts.block_cache_capacity))
+    , block_cache_(new table::BlockCache(opts.block_cache_capacity,
+                                         table::BlockCache::kDefaultShardBits,
+                                         opts.compressed_block_cache_capacity,
+                                         io_pool))
     , factory_(DCHECK_NOTNULL(factory))
     , allow_mmap_reads_(opts.allow_mmap_reads)
+    , use_direct_reads_(opts.use_direct_reads)
     , cache_(env_->GetLowLevelAllocator(), opts.max_open_files) {}
     
 TableCache::~TableCache() {}
 
 Iterator *TableCache::NewIterator(const ReadOptions &read_opts,
                                   const ColumnFamilyImpl *cfd,
-                                  uint64_t file_number, uint64_t file_size) {
+                                  uint64_t file_number, uint64_t file_size,
+                                  core::SequenceNumber global_sequence) {
     base::intrusive_ptr<core::LRUHandle> handle;
     Error rs = GetOrLoadTable(cfd, file_number, file_size, &handle);
     if (!rs) {
         return Iterator::AsError(rs);
     }
     
-    Iterator *iter = GetEntry(handle.get())->table->NewIterator(read_opts,
-                                                                cfd->ikcmp());
+    table::TableReader *table = GetEntry(handle.get())->table.get();
+    if (!read_opts.prefix.empty() &&
+        !table->PrefixMayExists(cfd->options().prefix_extractor,
+                                read_opts.prefix)) {
+        return Iterator::AsEmpty(); // Skip whole table.
+    }
+    Iterator *iter = table->NewIterator(read_opts, cfd->ikcmp());
     if (iter->error().ok()) {
         handle->AddRef();
         iter->RegisterCleanup(&HandleCleanup, handle.get());
+    } else {
+        return iter;
+    }
+    if (global_sequence != 0) {
+        iter = new GlobalSequenceIterator(iter, cfd->ikcmp(), global_sequence);
     }
     return iter;
 }
     
 Error TableCache::Get(const ReadOptions &read_opts, const ColumnFamilyImpl *cfd,
                       uint64_t file_number, std::string_view key, core::Tag *tag,
-                      std::string *value) {
+                      PinnableValue *value,
+                      core::SequenceNumber global_sequence) {
     base::intrusive_ptr<core::LRUHandle> handle;
     Error rs = GetOrLoadTable(cfd, file_number, 0, &handle);
     if (!rs) {
         return rs;
     }
-    std::string_view result;
-    std::string scatch;
     rs = GetEntry(handle.get())->table->Get(read_opts, cfd->ikcmp(), key, tag,
-                                            &result, &scatch);
+                                            value);
+    if (rs.ok() && global_sequence != 0) {
+        rs = ApplyGlobalSequence(key, global_sequence, tag);
+        if (!rs) {
+            value->Reset();
+        }
+    }
+    return rs;
+}
+    
+Error TableCache::MultiGet(const ReadOptions &read_opts,
+                           const ColumnFamilyImpl *cfd, uint64_t file_number,
+                           const std::vector<table::GetSlot *> &slots,
+                           core::SequenceNumber global_sequence) {
+    base::intrusive_ptr<core::LRUHandle> handle;
+    Error rs = GetOrLoadTable(cfd, file_number, 0, &handle);
     if (!rs) {
         return rs;
     }
-    value->assign(result.data(), result.size());
+    GetEntry(handle.get())->table->MultiGet(read_opts, cfd->ikcmp(), slots);
+    if (global_sequence != 0) {
+        for (auto slot : slots) {
+            if (slot->rs.ok()) {
+                slot->rs = ApplyGlobalSequence(slot->key, global_sequence,
+                                               slot->tag);
+                if (!slot->rs) {
+                    slot->value->clear();
+                }
+            }
+        }
+    }
     return Error::OK();
 }
     
@@ -109,14 +221,15 @@ TableCache::GetTableProperties(const ColumnFamilyImpl *cfd, uint64_t file_number
     return Error::OK();
 }
 
-Error TableCache::GetKeyFilter(const ColumnFamilyImpl *cfd, uint64_t file_number,
-                               base::intrusive_ptr<core::KeyFilter> *filter) {
+Error TableCache::KeyMayExists(const ColumnFamilyImpl *cfd, uint64_t file_number,
+                               std::string_view user_key, bool *may_exists) {
     base::intrusive_ptr<core::LRUHandle> handle;
     Error rs = GetOrLoadTable(cfd, file_number, 0, &handle);
     if (!rs) {
         return rs;
     }
-    *filter = GetEntry(handle.get())->table->GetKeyFilter();
+    *may_exists = GetEntry(handle.get())->table->KeyMayExists(cfd->ikcmp(),
+                                                              user_key);
     return Error::OK();
 }
     
@@ -133,8 +246,13 @@ Error TableCache::LoadTable(const ColumnFamilyImpl *cfd,
                             Entry *result) {
     
     result->file_name = cfd->GetTableFileName(file_number);
-    Error rs = env_->NewRandomAccessFile(result->file_name, &result->file,
-                                         allow_mmap_reads_);
+    Error rs;
+    if (use_direct_reads_ && !allow_mmap_reads_) {
+        rs = env_->NewDirectRandomAccessFile(result->file_name, &result->file);
+    } else {
+        rs = env_->NewRandomAccessFile(result->file_name, &result->file,
+                                       allow_mmap_reads_);
+    }
     if (!rs) {
         return rs;
     }
@@ -160,6 +278,18 @@ Error TableCache::LoadTable(const ColumnFamilyImpl *cfd,
     return Error::OK();
 }
     
+/*static*/ Error
+TableCache::ApplyGlobalSequence(std::string_view key,
+                                core::SequenceNumber global_sequence,
+                                core::Tag *tag) {
+    DCHECK_NOTNULL(tag);
+    if (global_sequence > core::KeyBoundle::ExtractTag(key).sequence_number()) {
+        return MAI_NOT_FOUND("Ingested after the seeking key.");
+    }
+    *tag = core::Tag(global_sequence, tag->flag());
+    return Error::OK();
+}
+    
 } // namespace db
     
 } // namespace mai
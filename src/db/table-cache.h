@@ -2,6 +2,7 @@
 #define MAI_DB_TABLE_CACHE_H_
 
 #include "table/table-reader.h"
+#include "core/key-boundle.h"
 #include "core/lru-cache-v1.h"
 #include "base/reference-count.h"
 #include "mai/options.h"
@@ -9,21 +10,23 @@
 #include "glog/logging.h"
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace mai {
 class Env;
 class RandomAccessFile;
 class Iterator;
 class ReadOptions;
+class PinnableValue;
 namespace table {
 class TableReader;
 struct TableProperties;
 class TablePropsBoundle;
 class BlockCache;
 } // namespace table
-namespace core {
-class KeyFilter;
-} // namespace core
+namespace base {
+class ThreadPool;
+} // namespace base
 namespace db {
 class ColumnFamilyImpl;
 class FileMetaData;
@@ -31,23 +34,38 @@ class Factory;
     
 class TableCache final {
 public:
+    // The io_pool be used for reading blocks in parallel, can be null.
     TableCache(const std::string &abs_db_path, const Options &opts,
-               Factory *factory);
+               Factory *factory, base::ThreadPool *io_pool = nullptr);
     ~TableCache();
     
+    // The global_sequence of ingested file replaces sequence numbers of all
+    // keys in it, 0 means no replacing.
     Iterator *NewIterator(const ReadOptions &read_opts,
                           const ColumnFamilyImpl *cfd, uint64_t file_number,
-                          uint64_t file_size);
+                          uint64_t file_size,
+                          core::SequenceNumber global_sequence = 0);
     
+    // The value pins the block it points to.
     Error Get(const ReadOptions &read_opts, const ColumnFamilyImpl *cfd,
               uint64_t file_number, std::string_view key, core::Tag *tag,
-              std::string *value);
+              PinnableValue *value, core::SequenceNumber global_sequence = 0);
+    
+    // Load table once, then probe all slots in it.
+    Error MultiGet(const ReadOptions &read_opts, const ColumnFamilyImpl *cfd,
+                   uint64_t file_number,
+                   const std::vector<table::GetSlot *> &slots,
+                   core::SequenceNumber global_sequence = 0);
     
     Error GetTableProperties(const ColumnFamilyImpl *cfd, uint64_t file_number,
                              base::intrusive_ptr<table::TablePropsBoundle> *props);
     
-    Error GetKeyFilter(const ColumnFamilyImpl *cfd, uint64_t file_number,
-                       base::intrusive_ptr<core::KeyFilter> *filter);
+    // Test user key by the key filter of table, the filter partition will be
+    // loaded if need.
+    Error KeyMayExists(const ColumnFamilyImpl *cfd, uint64_t file_number,
+                       std::string_view user_key, bool *may_exists);
+    
+    table::BlockCache *block_cache() const { return block_cache_.get(); }
     
     void Invalidate(uint64_t file_number) {
         cache_.Remove(GetKey(&file_number));
@@ -75,6 +93,12 @@ private:
                                 sizeof(*file_number));
     }
     
+    // Replace the sequence number of found key by global_sequence, the key
+    // is not found if global_sequence is newer than the seeking key.
+    static Error ApplyGlobalSequence(std::string_view key,
+                                     core::SequenceNumber global_sequence,
+                                     core::Tag *tag);
+    
     static Entry *GetEntry(core::LRUHandle *handle) {
         return static_cast<Entry *>(DCHECK_NOTNULL(handle->value));
     }
@@ -88,6 +112,7 @@ private:
     std::unique_ptr<table::BlockCache> block_cache_;
     Factory *const factory_;
     const bool allow_mmap_reads_;
+    const bool use_direct_reads_;
     core::LRUCacheShard cache_;
 }; // class TableCache
     
@@ -54,6 +54,8 @@ public:
     std::unique_ptr<TableCache> table_cache_;
     std::unique_ptr<VersionSet> versions_;
     
+    static constexpr int kNumL0Files = 10; // level0_file_num_compaction_trigger
+    
     static std::string l0_range_v1[];
     static std::string l1_range_v1[];
     static const char *tmp_dirs[];
@@ -67,7 +69,7 @@ const char *VersionTest::tmp_dirs[] = {
     nullptr,
 };
     
-std::string VersionTest::l0_range_v1[Config::kMaxNumberLevel0File * 2] = {
+std::string VersionTest::l0_range_v1[kNumL0Files * 2] = {
     core::KeyBoundle::MakeKey("aaaa", 1, core::Tag::kFlagValue),
     core::KeyBoundle::MakeKey("aaab", 2, core::Tag::kFlagValue),
     core::KeyBoundle::MakeKey("aaac", 3, core::Tag::kFlagValue),
@@ -155,6 +157,29 @@ TEST_F(VersionTest, VersionPatchEncodeDecode3) {
     EXPECT_EQ(1, restore.file_deletion().size());
 }
     
+TEST_F(VersionTest, VersionPatchEncodeDecodeGlobalSequence) {
+    VersionPatch patch;
+    
+    patch.CreateFile(0, 1, 1, "aaaa", "bbbb", 14, 1999);
+    FileMetaData *fmd = new FileMetaData(2);
+    fmd->smallest_key = "cccc";
+    fmd->largest_key  = "dddd";
+    fmd->global_sequence = 100;
+    patch.CreaetFile(0, 2, fmd);
+    ASSERT_TRUE(patch.has_global_sequence());
+    
+    std::string buf;
+    patch.Encode(&buf);
+    
+    VersionPatch restore;
+    restore.Decode(buf);
+    ASSERT_TRUE(restore.has_global_sequence());
+    ASSERT_EQ(2, restore.file_creation().size());
+    EXPECT_EQ(0, restore.file_creation()[0].file_metadata->global_sequence);
+    EXPECT_EQ(2, restore.file_creation()[1].file_metadata->number);
+    EXPECT_EQ(100, restore.file_creation()[1].file_metadata->global_sequence);
+}
+    
 TEST_F(VersionTest, LogAndApply) {
     VersionPatch patch;
     
@@ -187,7 +212,7 @@ TEST_F(VersionTest, PickCompactionL0) {
     patch.AddColumnFamily(kDefaultColumnFamilyName, 0, "cc");
     auto smallest = core::KeyBoundle::MakeKey("aaaa", 1, core::Tag::kFlagValue);
     auto largest  = core::KeyBoundle::MakeKey("bbbb", 2, core::Tag::kFlagValue);
-    for (int i = 0; i < Config::kMaxNumberLevel0File; ++i) {
+    for (int i = 0; i < kNumL0Files; ++i) {
         patch.CreateFile(0, 0, i + 1, smallest, largest, 40 * base::kMB,
                          env_->CurrentTimeMicros());
         
@@ -210,7 +235,7 @@ TEST_F(VersionTest, PickCompactionL0_V2) {
 
     VersionPatch patch;
     patch.AddColumnFamily(kDefaultColumnFamilyName, 0, "cc");
-    for (int i = 0; i < Config::kMaxNumberLevel0File; ++i) {
+    for (int i = 0; i < kNumL0Files; ++i) {
         patch.CreateFile(0, 0, i + 1, l0_range_v1[i * 2], l0_range_v1[i * 2 + 1],
                          80 * base::kMB,
                          env_->CurrentTimeMicros());
@@ -235,7 +260,7 @@ TEST_F(VersionTest, PickCompactionL0L1) {
     
     VersionPatch patch;
     patch.AddColumnFamily(kDefaultColumnFamilyName, 0, "cc");
-    for (int i = 0; i < Config::kMaxNumberLevel0File; ++i) {
+    for (int i = 0; i < kNumL0Files; ++i) {
         patch.CreateFile(0, 0, i + 1, l0_range_v1[i * 2], l0_range_v1[i * 2 + 1],
                          80 * base::kMB,
                          env_->CurrentTimeMicros());
@@ -1,9 +1,11 @@
 #include "db/version.h"
 #include "db/column-family.h"
+#include "db/compaction-picker.h"
 #include "db/files.h"
 #include "db/write-ahead-log.h"
 #include "db/table-cache.h"
 #include "core/merging.h"
+#include "core/perf-context-impl.h"
 #include "base/io-utils.h"
 #include "mai/iterator.h"
 
@@ -11,17 +13,6 @@ namespace mai {
     
 namespace db {
     
-uint64_t MaxSizeForLevel(int level) {
-    DCHECK_GT(level, 0);
-    DCHECK_LT(level, Config::kMaxLevel);
-    
-    uint64_t size = 10 * static_cast<uint64_t>(base::kGB);
-    for (int i = 1; i < level + 1; ++i) {
-        size = size * 10;
-    }
-    return size;
-}
-
 ////////////////////////////////////////////////////////////////////////////////
 /// class VersionBuilder
 ////////////////////////////////////////////////////////////////////////////////
@@ -174,6 +165,12 @@ void VersionPatch::Encode(std::string *buf) const {
             buf->append(Slice::GetString(c.file_metadata->smallest_key, &scope));
             buf->append(Slice::GetV64(c.file_metadata->size, &scope));
             buf->append(Slice::GetV64(c.file_metadata->ctime, &scope));
+            // Follows the file creation it belongs to.
+            if (c.file_metadata->global_sequence != 0) {
+                buf->append(Slice::GetByte(kGlobalSequence, &scope));
+                buf->append(Slice::GetV64(c.file_metadata->global_sequence,
+                                          &scope));
+            }
         }
     }
     if (has_deletion()) {
@@ -261,6 +258,13 @@ void VersionPatch::Decode(std::string_view buf) {
                 CreaetFile(cfid, level, fmd);
             } break;
                 
+            case kGlobalSequence: {
+                uint64_t sequence = reader.ReadVarint64();
+                DCHECK(!file_creation_.empty());
+                file_creation_.back().file_metadata->global_sequence = sequence;
+                set_field(kGlobalSequence);
+            } break;
+                
             default:
                 DLOG(FATAL) << "Noreaced!";
                 break;
@@ -273,7 +277,7 @@ void VersionPatch::Decode(std::string_view buf) {
 ////////////////////////////////////////////////////////////////////////////////
 Error Version::Get(const ReadOptions &opts, std::string_view key,
                    core::SequenceNumber version, core::Tag *tag,
-                   std::string *value) {
+                   PinnableValue *value) {
     const core::InternalKeyComparator *const ikcmp = owns_->ikcmp();
     std::string ikey = core::KeyBoundle::MakeKey(key, version,
                                                  core::Tag::kFlagValueForSeek);
@@ -293,7 +297,9 @@ Error Version::Get(const ReadOptions &opts, std::string_view key,
     
     TableCache *const table_cache = owns_->owns()->table_cache();
     for (const auto &fmd : l0_files) {
-        Error rs = table_cache->Get(opts, owns_, fmd->number, ikey, tag, value);
+        PERF_COUNTER_ADD(sst_files_touched, 1);
+        Error rs = table_cache->Get(opts, owns_, fmd->number, ikey, tag, value,
+                                    fmd->global_sequence);
         if (rs.ok()) {
             return rs;
         } else if (!rs.IsNotFound()) {
@@ -308,8 +314,9 @@ Error Version::Get(const ReadOptions &opts, std::string_view key,
         for (const auto &fmd : level_files(i)) {
             if (ikcmp->Compare(ikey, fmd->smallest_key) >= 0 ||
                 ikcmp->Compare(ikey, fmd->largest_key) <= 0) {
+                PERF_COUNTER_ADD(sst_files_touched, 1);
                 Error rs = table_cache->Get(opts, owns_, fmd->number, ikey, tag,
-                                            value);
+                                            value, fmd->global_sequence);
                 if (rs.ok()) {
                     return rs;
                 } else if (!rs.IsNotFound()) {
@@ -321,6 +328,74 @@ Error Version::Get(const ReadOptions &opts, std::string_view key,
     return MAI_NOT_FOUND("No any file has key.");
 }
     
+void Version::MultiGet(const ReadOptions &opts,
+                       const std::vector<table::GetSlot *> &slots) {
+    const Comparator *const ucmp = owns_->ikcmp()->ucmp();
+    TableCache *const table_cache = owns_->owns()->table_cache();
+    
+    std::vector<table::GetSlot *> pending(slots);
+    for (auto slot : pending) {
+        slot->rs = MAI_NOT_FOUND("No any file has key.");
+    }
+    
+    std::vector<base::intrusive_ptr<FileMetaData>> files;
+    std::vector<table::GetSlot *> batch;
+    for (int i = 0; i < Config::kMaxLevel && !pending.empty(); ++i) {
+        files = level_files(i);
+        if (i == 0) {
+            // The newest file should be first.
+            std::sort(files.begin(), files.end(),
+                      [](const auto &a, const auto &b) {
+                          return a->ctime > b->ctime;
+                      });
+        }
+        
+        for (const auto &fmd : files) {
+            const std::string_view smallest =
+                core::KeyBoundle::ExtractUserKey(fmd->smallest_key);
+            const std::string_view largest =
+                core::KeyBoundle::ExtractUserKey(fmd->largest_key);
+            auto iter = std::lower_bound(pending.begin(), pending.end(),
+                                         smallest,
+                                         [ucmp](table::GetSlot *slot,
+                                                std::string_view key) {
+                std::string_view user_key =
+                    core::KeyBoundle::ExtractUserKey(slot->key);
+                return ucmp->Compare(user_key, key) < 0;
+            });
+            batch.clear();
+            for (; iter != pending.end(); ++iter) {
+                std::string_view user_key =
+                    core::KeyBoundle::ExtractUserKey((*iter)->key);
+                if (ucmp->Compare(user_key, largest) > 0) {
+                    break;
+                }
+                batch.push_back(*iter);
+            }
+            if (batch.empty()) {
+                continue;
+            }
+            
+            PERF_COUNTER_ADD(sst_files_touched, 1);
+            Error rs = table_cache->MultiGet(opts, owns_, fmd->number, batch,
+                                             fmd->global_sequence);
+            if (!rs) {
+                for (auto slot : batch) {
+                    slot->rs = rs;
+                }
+            }
+            // Found or fail, no more probing.
+            pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                         [](table::GetSlot *slot) {
+                                             return !slot->rs.IsNotFound();
+                                         }), pending.end());
+            if (pending.empty()) {
+                break;
+            }
+        }
+    }
+}
+    
 void
 Version::GetOverlappingInputs(int level, std::string_view begin,
                               std::string_view end,
@@ -333,8 +408,9 @@ Version::GetOverlappingInputs(int level, std::string_view begin,
     
     DCHECK_NOTNULL(inputs)->clear();
     const Comparator *ucmp = owns_->ikcmp()->ucmp();
-    for (size_t i = 0; i < files_[level].size(); ++i) {
-        base::intrusive_ptr<FileMetaData> fmd = files_[level][i];
+    size_t i = 0;
+    while (i < files_[level].size()) {
+        base::intrusive_ptr<FileMetaData> fmd = files_[level][i++];
         const std::string_view file_start =
             core::KeyBoundle::ExtractUserKey(fmd->smallest_key);
         const std::string_view file_limit =
@@ -598,39 +674,7 @@ Error VersionSet::WritePatch(const VersionPatch &patch) {
 }
 
 void VersionSet::Finalize(Version *version) {
-    // Precomputed best level for next compaction
-    int best_level = -1;
-    double best_score = -1;
-    
-    for (int level = 0; level < Config::kMaxLevel - 1; level++) {
-        double score;
-        if (level == 0) {
-            // We treat level-0 specially by bounding the number of files
-            // instead of number of bytes for two reasons:
-            //
-            // (1) With larger write-buffer sizes, it is nice not to do too
-            // many level-0 compactions.
-            //
-            // (2) The files in level-0 are merged on every read and
-            // therefore we wish to avoid too many files when the individual
-            // file size is small (perhaps because of a small write-buffer
-            // setting, or very high compression ratios, or lots of
-            // overwrites/deletions).
-            score = version->files_[level].size() /
-                static_cast<double>(Config::kMaxNumberLevel0File);
-        } else {
-            // Compute the ratio of current size to size limit.
-            const uint64_t level_size = version->SizeLevelFiles(level);
-            score = static_cast<double>(level_size) / MaxSizeForLevel(level);
-        }
-        if (score > best_score) {
-            best_level = level;
-            best_score = score;
-        }
-    }
-
-    version->compaction_level_ = best_level;
-    version->compaction_score_ = best_score;
+    version->owns()->compaction_picker()->ComputeScores(version);
 }
     
 } // namespace db
@@ -13,11 +13,16 @@
 #include <mutex>
 #include <map>
 #include <numeric>
+#include <atomic>
 
 namespace mai {
 class Env;
 class SequentialFile;
 class WritableFile;
+class PinnableValue;
+namespace table {
+struct GetSlot;
+} // namespace table
 namespace db {
     
 struct FileMetaData;
@@ -40,7 +45,22 @@ struct FileMetaData final : public base::ReferenceCounted<FileMetaData> {
     uint64_t size = 0;
     uint64_t ctime = 0;
     
+    // The ingested file's keys be tagged by
+    // Config::kExternalFileSequenceNumber, readers replace it by this
+    // sequence number. 0 means no global sequence number.
+    uint64_t global_sequence = 0;
+    
+    // For tombstone density of file. They are not persistent, 0 means
+    // unknown.
+    uint64_t num_entries = 0;
+    uint64_t num_deletions = 0;
+    
     FileMetaData(uint64_t file_number) : number(file_number) {}
+    
+    double tombstone_density() const {
+        return num_entries == 0 ? 0 :
+               static_cast<double>(num_deletions) / num_entries;
+    }
 }; // struct FileMetadata
     
 #define VERSION_FIELDS(V) \
@@ -54,7 +74,8 @@ struct FileMetaData final : public base::ReferenceCounted<FileMetaData> {
     V(Creation, creation) \
     V(MaxColumnFamily, max_column_family) \
     V(AddColumnFamily, add_column_family) \
-    V(DropColumnFamily, drop_column_family)
+    V(DropColumnFamily, drop_column_family) \
+    V(GlobalSequence, global_sequence)
     
 class VersionPatch final {
 public:
@@ -124,6 +145,9 @@ public:
     
     void CreaetFile(uint32_t cfid, int level, FileMetaData *fmd) {
         set_field(kCreation);
+        if (fmd->global_sequence != 0) {
+            set_field(kGlobalSequence);
+        }
         file_creation_.push_back({cfid, level, base::MakeRef(fmd)});
     }
     
@@ -238,7 +262,14 @@ private:
     
 class Version final {
 public:
-    explicit Version(ColumnFamilyImpl *owner) : owns_(owner) {}
+    explicit Version(ColumnFamilyImpl *owner) : owns_(owner) {
+        for (int i = 0; i < Config::kMaxLevel - 1; ++i) {
+            level_compaction_score_[i] = -1;
+        }
+        for (int i = 0; i < Config::kMaxLevel; ++i) {
+            level_max_bytes_[i] = 0;
+        }
+    }
     
     size_t NumberLevelFiles(int level) {
         DCHECK_GE(level, 0);
@@ -263,8 +294,35 @@ public:
     DEF_PTR_GETTER_NOTNULL(ColumnFamilyImpl, owns);
     DEF_PTR_GETTER(Version, next);
     DEF_PTR_GETTER(Version, prev);
-    DEF_VAL_GETTER(int, compaction_level);
-    DEF_VAL_GETTER(double, compaction_score);
+    DEF_VAL_PROP_RW(int, compaction_level);
+    DEF_VAL_PROP_RW(double, compaction_score);
+    // The level which level 0 be compacted to.
+    DEF_VAL_PROP_RW(int, base_level);
+    
+    double level_compaction_score(int level) const {
+        DCHECK_GE(level, 0);
+        DCHECK_LT(level, Config::kMaxLevel - 1);
+        return level_compaction_score_[level];
+    }
+    
+    void set_level_compaction_score(int level, double score) {
+        DCHECK_GE(level, 0);
+        DCHECK_LT(level, Config::kMaxLevel - 1);
+        level_compaction_score_[level] = score;
+    }
+    
+    // Target size of level, 0 means the level should be empty.
+    uint64_t level_max_bytes(int level) const {
+        DCHECK_GE(level, 0);
+        DCHECK_LT(level, Config::kMaxLevel);
+        return level_max_bytes_[level];
+    }
+    
+    void set_level_max_bytes(int level, uint64_t size) {
+        DCHECK_GE(level, 0);
+        DCHECK_LT(level, Config::kMaxLevel);
+        level_max_bytes_[level] = size;
+    }
     
     const std::vector<base::intrusive_ptr<FileMetaData>> &level_files(int level) {
         DCHECK_GE(level, 0);
@@ -273,7 +331,23 @@ public:
     }
     
     Error Get(const ReadOptions &opts, std::string_view key,
-              core::SequenceNumber version, core::Tag *tag, std::string *value);
+              core::SequenceNumber version, core::Tag *tag, PinnableValue *value);
+    
+    // Pinned by super versions. The files of pinned version can not be deleted,
+    // readers may be still reading them.
+    void Pin() { pinned_.fetch_add(1); }
+    
+    void Unpin() {
+        int old_val = pinned_.fetch_sub(1);
+        DCHECK_GT(old_val, 0);
+    }
+    
+    bool pinned() const { return pinned_.load() > 0; }
+    
+    // Get a batch of keys, slots must be sorted by internal key. Every file
+    // be probed once by all slots in its range.
+    void MultiGet(const ReadOptions &opts,
+                  const std::vector<table::GetSlot *> &slots);
     
     friend class ColumnFamilyImpl;
     friend class VersionSet;
@@ -285,6 +359,10 @@ private:
     Version *prev_ = nullptr;
     int      compaction_level_ = -1;
     double   compaction_score_ = -1;
+    int      base_level_ = 1;
+    double   level_compaction_score_[Config::kMaxLevel - 1];
+    uint64_t level_max_bytes_[Config::kMaxLevel];
+    std::atomic<int> pinned_ = 0;
     std::vector<base::intrusive_ptr<FileMetaData>> files_[Config::kMaxLevel];
 }; // class Version
     
@@ -297,20 +375,26 @@ public:
     
     DEF_VAL_GETTER(std::string, abs_db_path);
     DEF_PTR_GETTER_NOTNULL(Env, env);
-    DEF_VAL_GETTER(core::SequenceNumber, last_sequence_number);
     DEF_VAL_GETTER(uint64_t, next_file_number);
     DEF_VAL_GETTER(uint64_t, prev_log_number);
     DEF_VAL_GETTER(uint64_t, redo_log_number);
     DEF_VAL_GETTER(uint64_t, manifest_file_number);
     
+    // Readers load it without db mutex.
+    core::SequenceNumber last_sequence_number() const {
+        return last_sequence_number_.load(std::memory_order_acquire);
+    }
+    
+    // REQUIRES: db mutex_.lock()
     core::SequenceNumber AddSequenceNumber(core::SequenceNumber add) {
-        last_sequence_number_ += add;
-        return last_sequence_number_;
+        return last_sequence_number_.fetch_add(add, std::memory_order_release)
+            + add;
     }
     
+    // REQUIRES: db mutex_.lock()
     void UpdateSequenceNumber(core::SequenceNumber val) {
-        if (val > last_sequence_number_) {
-            last_sequence_number_ = val;
+        if (val > last_sequence_number()) {
+            last_sequence_number_.store(val, std::memory_order_release);
         }
     }
     
@@ -345,7 +429,7 @@ private:
     std::unique_ptr<ColumnFamilySet> column_families_;
     const uint64_t block_size_;
 
-    core::SequenceNumber last_sequence_number_ = 0;
+    std::atomic<core::SequenceNumber> last_sequence_number_ = 0;
     uint64_t next_file_number_ = 0;
     uint64_t prev_log_number_ = 0;
     uint64_t redo_log_number_ = 0;
@@ -0,0 +1,158 @@
+#include "db/write-ahead-log.h"
+#include "mai/env.h"
+#include "base/base.h"
+#include "gtest/gtest.h"
+#include <vector>
+#include <string.h>
+
+namespace mai {
+
+namespace db {
+
+class WriteAheadLogTest : public ::testing::Test {
+public:
+    ~WriteAheadLogTest() override { env_->DeleteFile(kFileName, false); }
+
+    void WriteRecords(uint64_t log_number, CompressionType compression,
+                      const std::vector<std::string> &records) {
+        std::unique_ptr<WritableFile> file;
+        Error rs = env_->NewWritableFile(kFileName, false, &file);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        LogWriter writer(file.get(), WAL::kDefaultBlockSize, log_number,
+                         compression, 64 * base::kKB);
+        for (const auto &record : records) {
+            rs = writer.Append(record);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+        rs = writer.Flush();
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+
+    void ReadRecords(uint64_t log_number, std::vector<std::string> *records,
+                     uint64_t *last_record_end) {
+        std::unique_ptr<SequentialFile> file;
+        Error rs = env_->NewSequentialFile(kFileName, &file, false);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        LogReader reader(file.get(), true, WAL::kDefaultBlockSize, log_number);
+        std::string_view record;
+        std::string scratch;
+        while (reader.Read(&record, &scratch)) {
+            records->push_back(std::string(record));
+        }
+        ASSERT_TRUE(reader.error().IsEof()) << reader.error().ToString();
+        *last_record_end = reader.last_record_end();
+    }
+
+    static std::vector<std::string> MakeRecords(int n, int seed) {
+        std::vector<std::string> records;
+        for (int i = 0; i < n; ++i) {
+            // Small, large compressible and large fragmented records.
+            size_t size = (i % 3 == 0) ? 17 : (i % 3 == 1) ? 4000 : 70000;
+            std::string record(base::Sprintf("%d.%d.", seed, i));
+            record.resize(size, 'a' + (i + seed) % 26);
+            records.push_back(record);
+        }
+        return records;
+    }
+
+    static const char kFileName[];
+    Env *env_ = Env::Default();
+}; // class WriteAheadLogTest
+
+const char WriteAheadLogTest::kFileName[] = "tests/35-write-ahead-log.tmp";
+
+TEST_F(WriteAheadLogTest, LegacyRecords) {
+    auto records = MakeRecords(30, 0);
+    WriteRecords(0, kNoCompression, records);
+
+    std::vector<std::string> result;
+    uint64_t end = 0;
+    ReadRecords(0, &result, &end);
+    ASSERT_EQ(records, result);
+
+    uint64_t file_size = 0;
+    ASSERT_TRUE(env_->GetFileSize(kFileName, &file_size).ok());
+    ASSERT_EQ(file_size, end);
+}
+
+TEST_F(WriteAheadLogTest, CompressedRecords) {
+    auto records = MakeRecords(30, 1);
+    WriteRecords(7, kLZ4Compression, records);
+
+    uint64_t file_size = 0;
+    ASSERT_TRUE(env_->GetFileSize(kFileName, &file_size).ok());
+    size_t raw_size = 0;
+    for (const auto &record : records) {
+        raw_size += record.size();
+    }
+    ASSERT_LT(file_size, raw_size / 8);
+
+    std::vector<std::string> result;
+    uint64_t end = 0;
+    ReadRecords(7, &result, &end);
+    ASSERT_EQ(records, result);
+    ASSERT_EQ(file_size, end);
+}
+
+TEST_F(WriteAheadLogTest, RecycledFile) {
+    auto old_records = MakeRecords(60, 2);
+    WriteRecords(1, kNoCompression, old_records);
+    uint64_t old_size = 0;
+    ASSERT_TRUE(env_->GetFileSize(kFileName, &old_size).ok());
+
+    // Overwrite the old log from begin, the size of file not be changed.
+    auto new_records = MakeRecords(10, 3);
+    WriteRecords(2, kNoCompression, new_records);
+    uint64_t file_size = 0;
+    ASSERT_TRUE(env_->GetFileSize(kFileName, &file_size).ok());
+    ASSERT_EQ(old_size, file_size);
+
+    std::vector<std::string> result;
+    uint64_t end = 0;
+    ReadRecords(2, &result, &end);
+    ASSERT_EQ(new_records, result);
+    ASSERT_LT(end, file_size);
+
+    // All records of old log are stale.
+    result.clear();
+    ReadRecords(3, &result, &end);
+    ASSERT_TRUE(result.empty());
+    ASSERT_EQ(0, end);
+}
+
+TEST_F(WriteAheadLogTest, BadCompressedRecords) {
+    // The size of record not ends in the record, or it is too large to be
+    // uncompressed from the record.
+    const std::string payloads[] = {
+        std::string("\xff\xff\xff", 3),
+        std::string("\xff\xff\xff\xff\x0f" "abcd", 9),
+    };
+    for (const auto &payload : payloads) {
+        std::string header(WAL::kHeaderSize, 0);
+        uint16_t len = static_cast<uint16_t>(payload.size());
+        ::memcpy(&header[4], &len, sizeof(len));
+        header[6] = static_cast<char>(WAL::kFullType | WAL::kCompressedFlag);
+        
+        std::unique_ptr<WritableFile> file;
+        Error rs = env_->NewWritableFile(kFileName, false, &file);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        rs = file->Append(header + payload);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        rs = file->Flush();
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        file.reset();
+        
+        std::unique_ptr<SequentialFile> input;
+        rs = env_->NewSequentialFile(kFileName, &input, false);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        LogReader reader(input.get(), false, WAL::kDefaultBlockSize);
+        std::string_view record;
+        std::string scratch;
+        ASSERT_FALSE(reader.Read(&record, &scratch));
+        ASSERT_TRUE(reader.error().IsCorruption()) << reader.error().ToString();
+    }
+}
+
+} // namespace db
+
+} // namespace mai
@@ -1,13 +1,24 @@
 #include "db/write-ahead-log.h"
+#include "base/varint-encoding.h"
 #include "base/hash.h"
+#include "base/lz4.h"
 
 namespace mai {
     
 namespace db {
     
-LogWriter::LogWriter(WritableFile *file, size_t block_size)
+LogWriter::LogWriter(WritableFile *file, size_t block_size, uint64_t log_number,
+                     CompressionType compression, size_t preallocate_size,
+                     uint64_t offset)
     : writer_(file, false)
-    , block_size_(block_size) {
+    , block_size_(block_size)
+    , log_number_(log_number)
+    , compression_(compression)
+    , preallocate_size_(preallocate_size)
+    , header_size_(log_number ? WAL::kRecyclableHeaderSize : WAL::kHeaderSize)
+    , block_offset_(static_cast<int>(offset % block_size))
+    , offset_(offset)
+    , allocated_(offset) {
     for (auto i = 0; i <= WAL::kMaxRecordType; i++) {
         uint8_t c = static_cast<uint8_t>(i);
         typed_checksums_[i] = ::crc32(0, &c, 1);
@@ -17,35 +28,56 @@ LogWriter::LogWriter(WritableFile *file, size_t block_size)
 #define TRY_RUN(expr) \
     rs = (expr); \
     if (rs.fail()) { \
-        rs; \
+        return rs; \
     } (void)0
     
 LogWriter::~LogWriter() {}
 
 Error LogWriter::Append(std::string_view record) {
+    uint8_t flags = 0;
+    if (compression_ == kLZ4Compression &&
+        record.size() >= WAL::kMinCompressionSize) {
+        compressed_.resize(base::Varint32::kMaxLen +
+                           base::Lz4::MaxCompressedSize(record.size()));
+        char *buf = &compressed_[0];
+        size_t n = base::Varint32::Encode(buf, static_cast<uint32_t>(record.size()));
+        n += base::Lz4::Compress(record.data(), record.size(), buf + n);
+        // Store uncompressed if compression can not save 1/8 space at least.
+        if (n < record.size() - record.size() / 8) {
+            record = std::string_view(buf, n);
+            flags = WAL::kCompressedFlag;
+        }
+    }
+    
     size_t left = record.size();
     const char *p = record.data();
-    Error rs;
+    Error rs = MaybePreallocate(left);
+    if (!rs) {
+        return rs;
+    }
     
+    const WAL::RecordType base_type = log_number_ ? WAL::kRecyclableFullType
+                                                  : WAL::kFullType;
     auto begin = true;
     do {
         size_t left_over = block_size_ - block_offset_;
         DCHECK_GE(left_over, 0);
         
-        if (left_over < WAL::kHeaderSize) {
+        if (left_over < header_size_) {
             if (left_over > 0) {
-                TRY_RUN(writer_.Write("\x00\x00\x00\x00\x00\x00\x00",
-                                       left_over));
+                static const char kZeros[WAL::kRecyclableHeaderSize] = {0};
+                TRY_RUN(writer_.Write(kZeros, left_over));
+                offset_ += left_over;
             }
             block_offset_ = 0;
         }
         
-        DCHECK_GE(block_size_ - block_offset_ - WAL::kHeaderSize, 0);
+        DCHECK_GE(block_size_ - block_offset_ - header_size_, 0);
         
-        const size_t avail = block_size_ - block_offset_ - WAL::kHeaderSize;
+        const size_t avail = block_size_ - block_offset_ - header_size_;
         const size_t fragment_length = (left < avail) ? left : avail;
         
-        WAL::RecordType type;
+        int type;
         const bool end = (left == fragment_length);
         if (begin && end) {
             type = WAL::kFullType;
@@ -56,8 +88,10 @@ Error LogWriter::Append(std::string_view record) {
         } else {
             type = WAL::kMiddleType;
         }
+        type += (base_type - WAL::kFullType);
         
-        rs = EmitPhysicalRecord(p, fragment_length, type);
+        rs = EmitPhysicalRecord(p, fragment_length,
+                                static_cast<uint8_t>(type | flags));
         p += fragment_length;
         left -= fragment_length;
         begin = false;
@@ -67,44 +101,156 @@ Error LogWriter::Append(std::string_view record) {
 }
 
 Error LogWriter::EmitPhysicalRecord(const void *data, size_t len,
-                                    WAL::RecordType type) {
+                                    uint8_t type) {
     using ::mai::base::Slice;
     using ::mai::base::ScopedMemory;
     
     DCHECK_LE(len, UINT16_MAX);
-    DCHECK_LE(block_offset_ + WAL::kHeaderSize + len, block_size_);
+    DCHECK_LE(block_offset_ + header_size_ + len, block_size_);
     Error rs;
     
-    uint32_t checksum = ::crc32(typed_checksums_[type], data, len);
+    uint32_t checksum;
+    if (type & WAL::kCompressedFlag) {
+        checksum = ::crc32(0, &type, 1);
+    } else {
+        checksum = typed_checksums_[type];
+    }
+    ScopedMemory scope;
+    std::string_view number;
+    if (log_number_) {
+        number = Slice::GetU32(static_cast<uint32_t>(log_number_), &scope);
+        checksum = ::crc32(checksum, number.data(), number.size());
+    }
+    checksum = ::crc32(checksum, data, len);
     
     TRY_RUN(writer_.WriteFixed32(checksum));
     TRY_RUN(writer_.WriteFixed16(static_cast<uint16_t>(len)));
-    TRY_RUN(writer_.WriteByte(static_cast<uint8_t>(type)));
+    TRY_RUN(writer_.WriteByte(static_cast<char>(type)));
+    if (log_number_) {
+        TRY_RUN(writer_.Write(number));
+    }
     TRY_RUN(writer_.Write(data, len));
 
-    block_offset_ += (WAL::kHeaderSize + len);
+    block_offset_ += (header_size_ + len);
+    offset_ += (header_size_ + len);
     return Error::OK();
 }
 
 #undef TRY_RUN
     
-LogReader::LogReader(SequentialFile *file, bool verify_checksum, size_t block_size)
+Error LogWriter::MaybePreallocate(size_t len) {
+    if (preallocate_size_ == 0) {
+        return Error::OK();
+    }
+    // The headers and padding of every block.
+    const uint64_t need = offset_ + len +
+        (len / block_size_ + 2) * WAL::kRecyclableHeaderSize;
+    while (allocated_ < need) {
+        Error rs = writer_.file()->Allocate(allocated_, preallocate_size_);
+        if (!rs) {
+            return rs;
+        }
+        allocated_ += preallocate_size_;
+    }
+    return Error::OK();
+}
+    
+LogReader::LogReader(SequentialFile *file, bool verify_checksum, size_t block_size,
+                     uint64_t log_number)
     : reader_(file)
     , verify_checksum_(verify_checksum)
-    , block_size_(block_size) {}
+    , block_size_(block_size)
+    , log_number_(log_number) {}
 
 LogReader::~LogReader() {}
     
 bool LogReader::Read(std::string_view *result, std::string* scratch) {
-    if (reader_.error().IsEof()) {
+    if (eof_) {
         return false;
     }
     
-    std::string buf;
-    auto fail = 0, segment = 0;
-    WAL::RecordType type = WAL::kZeroType;
-    do {
-        auto left_over = block_size_ - block_offset_;
+    bool in_fragmented_record = false;
+    std::string_view fragment;
+    while (true) {
+        int type = ReadPhysicalRecord(&fragment);
+        if (type == kEof) {
+            eof_ = true;
+            return false;
+        } else if (type == kStaleRecord) {
+            // The rest of recycled file are records of old log.
+            eof_ = true;
+            error_ = MAI_EOF("Stale record.");
+            return false;
+        } else if (type == kBadRecord) {
+            return false;
+        }
+        
+        const bool compressed = (type & WAL::kCompressedFlag) != 0;
+        switch (type & ~WAL::kCompressedFlag) {
+            case WAL::kFullType:
+            case WAL::kRecyclableFullType:
+                if (in_fragmented_record) {
+                    return ReportBadRecord("Partial record without end.");
+                }
+                *result = fragment;
+                break;
+                
+            case WAL::kFirstType:
+            case WAL::kRecyclableFirstType:
+                if (in_fragmented_record) {
+                    return ReportBadRecord("Partial record without end.");
+                }
+                scratch->assign(fragment);
+                in_fragmented_record = true;
+                continue;
+                
+            case WAL::kMiddleType:
+            case WAL::kRecyclableMiddleType:
+                if (!in_fragmented_record) {
+                    return ReportBadRecord("Missing start of fragmented record.");
+                }
+                scratch->append(fragment);
+                continue;
+                
+            case WAL::kLastType:
+            case WAL::kRecyclableLastType:
+                if (!in_fragmented_record) {
+                    return ReportBadRecord("Missing start of fragmented record.");
+                }
+                scratch->append(fragment);
+                *result = *scratch;
+                break;
+                
+            default:
+                return ReportBadRecord("Unknown record type.");
+        }
+        
+        if (compressed) {
+            size_t n = 0;
+            uint32_t size = 0;
+            if (!base::Varint32::Decode(result->data(), result->size(), &size,
+                                        &n) ||
+                size > base::Lz4::MaxUncompressedSize(result->size() - n)) {
+                return ReportBadRecord("Bad compressed record.");
+            }
+            uncompressed_.resize(size);
+            if (!base::Lz4::Uncompress(result->data() + n, result->size() - n,
+                                       &uncompressed_[0], size)) {
+                return ReportBadRecord("Bad compressed record.");
+            }
+            *result = uncompressed_;
+        }
+        last_record_end_ = block_start_ + block_offset_;
+        error_ = Error::OK();
+        return true;
+    }
+}
+    
+int LogReader::ReadPhysicalRecord(std::string_view *result) {
+    using ::mai::base::Slice;
+    
+    while (true) {
+        size_t left_over = block_size_ - block_offset_;
         DCHECK_GE(left_over, 0);
         
         if (left_over < WAL::kHeaderSize) {
@@ -112,66 +258,94 @@ bool LogReader::Read(std::string_view *result, std::string* scratch) {
                 reader_.Skip(left_over);
             }
             block_offset_ = 0;
+            block_start_ += block_size_;
+        }
+        
+        std::string_view header = reader_.Read(WAL::kHeaderSize);
+        if (reader_.error().fail() || header.size() < WAL::kHeaderSize) {
+            error_ = reader_.error().fail() ? reader_.error() : MAI_EOF("Log");
+            return kEof;
         }
+        const uint32_t record_checksum = Slice::SetFixed32(header.substr(0, 4));
+        const uint16_t len = Slice::SetFixed16(header.substr(4, 2));
+        const uint8_t type = static_cast<uint8_t>(header[6]);
+        block_offset_ += WAL::kHeaderSize;
         
-        if (segment > 0) {
-            if (segment == 1) {
-                scratch->clear();
+        if (type == WAL::kZeroType && len == 0) {
+            // Padding of block, skip to next block.
+            left_over = block_size_ - block_offset_;
+            if (left_over > 0) {
+                reader_.Skip(left_over);
             }
-            scratch->append(result->data(), result->size());
-            //scratch->append(buf);
+            block_offset_ = 0;
+            block_start_ += block_size_;
+            continue;
         }
         
-        type = ReadPhysicalRecord(result, &fail);
-        segment++;
-    } while (type == WAL::kMiddleType || type == WAL::kFirstType);
-    
-    if (fail > 0) {
-        if (reader_.error().fail()) {
-            error_ = reader_.error();
-        } else {
-            error_ = MAI_IO_ERROR("crc32 checksum fail.");
+        const uint8_t real_type = type & ~WAL::kCompressedFlag;
+        const bool recyclable = real_type >= WAL::kRecyclableFullType &&
+                                real_type <= WAL::kRecyclableLastType;
+        uint32_t number = 0;
+        std::string number_buf;
+        if (recyclable) {
+            std::string_view buf = reader_.Read(4);
+            if (reader_.error().fail() || buf.size() < 4) {
+                error_ = reader_.error().fail() ? reader_.error() : MAI_EOF("Log");
+                return kEof;
+            }
+            number_buf.assign(buf);
+            number = Slice::SetFixed32(number_buf);
+            block_offset_ += 4;
         }
-    } else {
-        error_ = Error::OK();
-    }
-    
-    if (segment > 1) {
-        scratch->append(result->data(), result->size());
-        *result = *scratch;
+        if (block_offset_ + len > block_size_) {
+            if (has_recyclable_ || recyclable) {
+                return kStaleRecord;
+            }
+            error_ = MAI_CORRUPTION("Bad record length.");
+            return kBadRecord;
+        }
+        
+        *result = reader_.Read(len);
+        if (reader_.error().fail() || result->size() < len) {
+            error_ = reader_.error().fail() ? reader_.error() : MAI_EOF("Log");
+            return kEof;
+        }
+        block_offset_ += len;
+        
+        if (verify_checksum_) {
+            uint32_t checksum = ::crc32(0, &type, 1);
+            checksum = ::crc32(checksum, number_buf.data(), number_buf.size());
+            checksum = ::crc32(checksum, result->data(), result->size());
+            if (record_checksum != checksum) {
+                // Must be a partial written record of recycled file.
+                if (has_recyclable_ || recyclable) {
+                    return kStaleRecord;
+                }
+                error_ = MAI_IO_ERROR("crc32 checksum fail.");
+                return kBadRecord;
+            }
+        }
+        if (recyclable) {
+            if (number != static_cast<uint32_t>(log_number_)) {
+                return kStaleRecord;
+            }
+            has_recyclable_ = true;
+        } else if (has_recyclable_) {
+            // Legacy records can not follow the recyclable records.
+            return kStaleRecord;
+        }
+        return type;
     }
-    return error_.ok();
 }
     
-#define TRY_RUN(expr) \
-    (expr); \
-    if (reader_.error().fail()) { \
-        (*fail)++; \
-        return static_cast<WAL::RecordType>(0); \
-    }(void)0
-
-WAL::RecordType LogReader::ReadPhysicalRecord(std::string_view *result,
-                                              int *fail) {
-    uint32_t record_checksum;
-    uint16_t len;
-    uint8_t type;
-    
-    TRY_RUN(record_checksum = reader_.ReadFixed32());
-    TRY_RUN(len = reader_.ReadFixed16());
-    TRY_RUN(type = reader_.ReadByte());
-    
-    TRY_RUN(*result = reader_.Read(len));
-    
-    if (verify_checksum_) {
-        uint32_t checksum = ::crc32(0, &type, 1);
-        checksum = ::crc32(checksum, result->data(), result->size());
-        
-        if (record_checksum != checksum) {
-            (*fail)++;
-        }
+bool LogReader::ReportBadRecord(const char *message) {
+    if (has_recyclable_) {
+        eof_ = true;
+        error_ = MAI_EOF(message);
+    } else {
+        error_ = MAI_CORRUPTION(message);
     }
-    block_offset_ += (WAL::kHeaderSize + len);
-    return static_cast<WAL::RecordType>(type);
+    return false;
 }
     
 } // namespace db
@@ -2,6 +2,7 @@
 #define MAI_DB_WRITE_AHEAD_LOG_H_
 
 #include "base/io-utils.h"
+#include "mai/options.h"
 
 namespace mai {
 class WritableFile;
@@ -17,30 +18,55 @@ struct WAL {
         // For fragments
         kFirstType = 2,
         kMiddleType = 3,
-        kLastType = 4
+        kLastType = 4,
+        
+        // For recycled log files, the header has log number.
+        kRecyclableFullType = 5,
+        kRecyclableFirstType = 6,
+        kRecyclableMiddleType = 7,
+        kRecyclableLastType = 8,
     };
     
-    static const int kMaxRecordType = kLastType;
+    static const int kMaxRecordType = kRecyclableLastType;
     static const int kHeaderSize = 4 + 2 + 1;
+    static const int kRecyclableHeaderSize = kHeaderSize + 4;
     static const int kDefaultBlockSize = 32768;
+    
+    // Set in type of every fragment of compressed record. The payload of
+    // compressed record: varint32 of uncompressed size + LZ4 data.
+    static const uint8_t kCompressedFlag = 0x80;
+    
+    // The small records not be compressed.
+    static const size_t kMinCompressionSize = 1024;
 
     DISALLOW_ALL_CONSTRUCTORS(WAL);
 }; // class WAL
     
 /*
- * +---------+-------+
- * |         | crc32 | 4 bytes
- * |         +-------+
- * | header  | len   | 2 bytes
- * |         +-------+
- * |         | type  | 1 bytes
- * +---------+-------+
- * | payload | data  | len bytes
- * +---------+-------+
+ * +---------+------------+
+ * |         | crc32      | 4 bytes
+ * |         +------------+
+ * |         | len        | 2 bytes
+ * | header  +------------+
+ * |         | type       | 1 bytes
+ * |         +------------+
+ * |         | log number | 4 bytes (only recyclable types)
+ * +---------+------------+
+ * | payload | data       | len bytes
+ * +---------+------------+
+ *
+ * The crc32 covers type, log number and data.
  */
 class LogWriter {
 public:
-    LogWriter(WritableFile *file, size_t block_size);
+    // log_number: If not zero, write recyclable records with it, so the reader
+    //             can reject the stale records of recycled log file.
+    // compression: Compress the large records.
+    // preallocate_size: Preallocate file space by this size of chunk.
+    // offset: The current size of file for appending.
+    LogWriter(WritableFile *file, size_t block_size, uint64_t log_number = 0,
+              CompressionType compression = kNoCompression,
+              size_t preallocate_size = 0, uint64_t offset = 0);
     ~LogWriter();
     
     Error Append(std::string_view data);
@@ -50,33 +76,63 @@ public:
     
     DISALLOW_IMPLICIT_CONSTRUCTORS(LogWriter);
 private:
-    Error EmitPhysicalRecord(const void *buf, size_t len, WAL::RecordType type);
+    Error EmitPhysicalRecord(const void *buf, size_t len, uint8_t type);
+    
+    Error MaybePreallocate(size_t len);
     
     const size_t block_size_;
+    const uint64_t log_number_;
+    const CompressionType compression_;
+    const size_t preallocate_size_;
+    const int header_size_;
     int block_offset_ = 0;
+    uint64_t offset_ = 0;
+    uint64_t allocated_ = 0;
     
     uint32_t typed_checksums_[WAL::kMaxRecordType + 1];
+    std::string compressed_;
     base::FileWriter writer_;
 }; // class LogWriter
     
     
 class LogReader {
 public:
-    LogReader(SequentialFile *file, bool verify_checksum, size_t block_size);
+    // log_number: Only the recyclable records with this log number be
+    //             accepted, the others are stale data of recycled log file.
+    LogReader(SequentialFile *file, bool verify_checksum, size_t block_size,
+              uint64_t log_number = 0);
     ~LogReader();
     
     bool Read(std::string_view *result, std::string* scratch);
     
     Error error() const { return error_; }
+    
+    // The file offset after last good record, the data after it can be
+    // dropped.
+    uint64_t last_record_end() const { return last_record_end_; }
 private:
-    WAL::RecordType ReadPhysicalRecord(std::string_view *result, int *fail);
+    enum {
+        kEof = -1,
+        kBadRecord = -2,
+        kStaleRecord = -3,
+    };
+    
+    int ReadPhysicalRecord(std::string_view *result);
+    
+    bool ReportBadRecord(const char *message);
     
     base::FileReader reader_;
     bool verify_checksum_;
     const size_t block_size_;
+    const uint64_t log_number_;
     
     Error error_;
     int block_offset_ = 0;
+    uint64_t block_start_ = 0;
+    uint64_t last_record_end_ = 0;
+    bool has_recyclable_ = false;
+    bool eof_ = false;
+    std::string uncompressed_;
 }; // class LogReader
     
 } // namespace db
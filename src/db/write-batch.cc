@@ -26,6 +26,17 @@ void WriteBatch::Delete(ColumnFamily *cf, std::string_view key) {
     KeyBoundle::MakeRedo(key, "", cf->id(), Tag::kFlagDeletion, &redo_);
     ++n_entries_;
 }
+    
+void WriteBatch::AddMarker(Marker marker, std::string_view name) {
+    // The same format as deletion: cfid(0) + marker + name
+    Slice::WriteVarint32(&redo_, 0);
+    redo_.append(1, static_cast<char>(marker));
+    Slice::WriteVarint64(&redo_, name.size());
+    redo_.append(name);
+    if (marker == kMarkCommit || marker == kMarkRollback) {
+        ++n_entries_;
+    }
+}
 
 /*static*/ Error WriteBatch::Iterate(const char *buf, size_t len, Stub *handler) {
     if (len == 0) {
@@ -34,7 +45,7 @@ void WriteBatch::Delete(ColumnFamily *cf, std::string_view key) {
     BufferReader rd(std::string_view(buf, len));
     while (!rd.Eof()) {
         uint32_t cfid = rd.ReadVarint32();
-        Tag::Flag flag = static_cast<Tag::Flag>(rd.ReadByte());
+        uint8_t flag = rd.ReadByte();
         std::string_view key = rd.ReadString();
         switch (flag) {
             case Tag::kFlagValue:
@@ -44,6 +55,22 @@ void WriteBatch::Delete(ColumnFamily *cf, std::string_view key) {
             case Tag::kFlagDeletion:
                 handler->Delete(cfid, key);
                 break;
+                
+            case kMarkBeginPrepare:
+                handler->MarkBeginPrepare();
+                break;
+                
+            case kMarkEndPrepare:
+                handler->MarkEndPrepare(key);
+                break;
+                
+            case kMarkCommit:
+                handler->MarkCommit(key);
+                break;
+                
+            case kMarkRollback:
+                handler->MarkRollback(key);
+                break;
 
             default:
                 NOREACHED();
@@ -168,6 +168,12 @@ public:
         }
     }
     
+    virtual Error
+    NewDirectRandomAccessFile(const std::string &file_name,
+                              std::unique_ptr<RandomAccessFile> *file) override {
+        return PosixRandomAccessFile::Open(file_name, file, true);
+    }
+    
     virtual Error MakeDirectory(const std::string &name,
                                 bool create_if_missing) override {
         int rv = ::mkdir(name.c_str(), S_IRUSR|S_IWUSR|S_IXUSR|
@@ -274,6 +280,22 @@ public:
         return Error::OK();
     }
     
+    virtual Error RenameFile(const std::string &from,
+                             const std::string &to) override {
+        if (::rename(from.c_str(), to.c_str()) < 0) {
+            return MAI_IO_ERROR(strerror(errno));
+        }
+        return Error::OK();
+    }
+    
+    virtual Error LinkFile(const std::string &from,
+                           const std::string &to) override {
+        if (::link(from.c_str(), to.c_str()) < 0) {
+            return MAI_IO_ERROR(strerror(errno));
+        }
+        return Error::OK();
+    }
+    
     virtual std::string GetWorkDirectory() override {
         char dir[MAXPATHLEN];
         return ::getcwd(dir, arraysize(dir));
@@ -1,4 +1,5 @@
 #include "port/file-posix.h"
+#include "port/io-uring-linux.h"
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -238,7 +239,12 @@ PosixWritableFile::Open(const std::string &file_name, bool append,
 }
     
 /*virtual*/ Error PosixWritableFile::Sync() {
+#if defined(__linux__)
+    // Only data and size be flushed, no need to update other metadata.
+    if (::fdatasync(fd_) < 0) {
+#else
     if (::fsync(fd_) < 0) {
+#endif
         return MAI_IO_ERROR(strerror(errno));
     }
     return Error::OK();
@@ -260,6 +266,19 @@ PosixWritableFile::Open(const std::string &file_name, bool append,
     return Error::OK();
 }
     
+/*virtual*/ Error PosixWritableFile::Allocate(uint64_t offset, uint64_t len) {
+#if defined(__linux__)
+    if (::fallocate(fd_, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset),
+                    static_cast<off_t>(len)) < 0) {
+        if (errno == EOPNOTSUPP) {
+            return Error::OK(); // File system not support it, just ignore.
+        }
+        return MAI_IO_ERROR(strerror(errno));
+    }
+#endif
+    return Error::OK();
+}
+    
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 /// class MemPosixRandomAccessFile
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -336,46 +355,196 @@ Error MemPosixRandomAccessFile::Read(uint64_t offset, size_t n, std::string_view
 
 /*static*/ Error
 PosixRandomAccessFile::Open(const std::string &file_name,
-                            std::unique_ptr<RandomAccessFile> *file) {
-    int fd = ::open(file_name.c_str(), O_RDONLY);
+                            std::unique_ptr<RandomAccessFile> *file,
+                            bool direct_io) {
+    int flags = O_RDONLY;
+#if defined(O_DIRECT)
+    flags |= (direct_io ? O_DIRECT : 0);
+#endif
+    int fd = ::open(file_name.c_str(), flags);
+    if (fd < 0 && direct_io && errno == EINVAL) {
+        // The file system does not support O_DIRECT.
+        LOG(WARNING) << "O_DIRECT not supported: " << file_name;
+        direct_io = false;
+        fd = ::open(file_name.c_str(), O_RDONLY);
+    }
     if (fd < 0) {
         return MAI_IO_ERROR(strerror(errno));
     }
-    file->reset(new PosixRandomAccessFile(fd));
+#if defined(MAI_OS_DARWIN)
+    if (direct_io && ::fcntl(fd, F_NOCACHE, 1) < 0) {
+        ::close(fd);
+        return MAI_IO_ERROR(strerror(errno));
+    }
+#endif
+    file->reset(new PosixRandomAccessFile(fd, direct_io));
+    return Error::OK();
+}
+    
+// Read until n bytes be read or end of file. The O_DIRECT reading can not
+// continue from a unaligned offset, so stop at the first short reading.
+static Error PreadFully(int fd, char *dst, size_t n, uint64_t offset,
+                        bool stop_on_short, size_t *read_bytes) {
+    size_t left = n;
+    while (left != 0) {
+        ssize_t done = ::pread(fd, dst, left, offset);
+        if (done < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            *read_bytes = n - left;
+            return MAI_IO_ERROR(strerror(errno));
+        } else if (done == 0) {
+            break;
+        }
+        left   -= done;
+        dst    += done;
+        offset += done;
+        if (stop_on_short && left != 0) {
+            break;
+        }
+    }
+    *read_bytes = n - left;
+    return Error::OK();
+}
+    
+struct AlignedFree {
+    void operator () (char *p) const { ::free(p); }
+}; // struct AlignedFree
+
+using AlignedBuffer = std::unique_ptr<char, AlignedFree>;
+    
+static char *NewAlignedBuffer(size_t size) {
+    void *buf = nullptr;
+    if (::posix_memalign(&buf, PosixRandomAccessFile::kDirectIOAlignment,
+                         size) != 0) {
+        return nullptr;
+    }
+    return static_cast<char *>(buf);
+}
+    
+// The aligned range covers [offset, offset + n).
+struct AlignedRange {
+    AlignedRange(uint64_t offset, size_t n)
+        : offset(RoundDown(offset, PosixRandomAccessFile::kDirectIOAlignment))
+        , skip(offset - this->offset)
+        , size(RoundUp(skip + n, PosixRandomAccessFile::kDirectIOAlignment)) {}
+    
+    const uint64_t offset;
+    const size_t   skip;
+    const size_t   size;
+}; // struct AlignedRange
+    
+// Copy the wanted bytes from aligned buffer.
+static Error CopyFromAligned(const char *buf, const AlignedRange &range,
+                             size_t read_bytes, size_t n,
+                             std::string_view *result, std::string *scratch) {
+    if (read_bytes <= range.skip) {
+        *result = std::string_view{};
+        return MAI_EOF("read()");
+    }
+    scratch->assign(buf + range.skip, std::min(n, read_bytes - range.skip));
+    *result = std::string_view(scratch->data(), scratch->size());
     return Error::OK();
 }
 
 /*virtual*/
 Error PosixRandomAccessFile::Read(uint64_t offset, size_t n, std::string_view *result,
                                   std::string *scratch) {
+    return direct_io_ ? DirectRead(offset, n, result, scratch) :
+                        BufferedRead(offset, n, result, scratch);
+}
+    
+Error PosixRandomAccessFile::BufferedRead(uint64_t offset, size_t n,
+                                          std::string_view *result,
+                                          std::string *scratch) {
 #if defined(DEBUG) || defined(_DEBUG)
     scratch->resize(n, 0xcc);
 #else
     scratch->resize(n);
 #endif
-    Error rs;
-    char *dst = &(*scratch)[0];
-    size_t left = n;
-    while (left != 0) {
-        ssize_t done = ::pread(fd_, dst, left, offset);
-        if (done < 0) {
-            if (errno == EINTR) {
-                continue;
+    size_t read_bytes = 0;
+    Error rs = PreadFully(fd_, &(*scratch)[0], n, offset, false, &read_bytes);
+    *result = std::string_view(scratch->data(), read_bytes);
+    if (rs.ok() && result->empty() && n > 0) {
+        rs = MAI_EOF("read()");
+    }
+    return rs;
+}
+    
+Error PosixRandomAccessFile::DirectRead(uint64_t offset, size_t n,
+                                        std::string_view *result,
+                                        std::string *scratch) {
+    AlignedRange range(offset, n);
+    AlignedBuffer buf(NewAlignedBuffer(range.size));
+    if (!buf) {
+        return MAI_CORRUPTION("Out of memory!");
+    }
+    size_t read_bytes = 0;
+    Error rs = PreadFully(fd_, buf.get(), range.size, range.offset, true,
+                          &read_bytes);
+    if (!rs) {
+        return rs;
+    }
+    return CopyFromAligned(buf.get(), range, read_bytes, n, result, scratch);
+}
+    
+/*virtual*/ void PosixRandomAccessFile::MultiRead(ReadRequest *reqs, size_t n,
+                                                  const ParallelRunner &runner) {
+    IoUring *ring = n < 2 ? nullptr : IoUring::Current();
+    if (!ring) {
+        RandomAccessFile::MultiRead(reqs, n, runner);
+        return;
+    }
+    
+    std::unique_ptr<IoUring::ReadOp[]> ops(new IoUring::ReadOp[n]);
+    std::unique_ptr<AlignedBuffer[]> bufs(direct_io_ ? new AlignedBuffer[n] : nullptr);
+    for (size_t i = 0; i < n; ++i) {
+        ops[i].fd     = fd_;
+        ops[i].result = -EIO;
+        if (direct_io_) {
+            AlignedRange range(reqs[i].offset, reqs[i].n);
+            bufs[i].reset(NewAlignedBuffer(range.size));
+            if (!bufs[i]) {
+                RandomAccessFile::MultiRead(reqs, n, runner);
+                return;
             }
-            rs = MAI_IO_ERROR(strerror(errno));
-            break;
-        } else if (done == 0) {
-            rs = MAI_EOF("read()");
-            break;
+            ops[i].buf    = bufs[i].get();
+            ops[i].n      = range.size;
+            ops[i].offset = range.offset;
+        } else {
+            reqs[i].scratch->resize(reqs[i].n);
+            ops[i].buf    = &(*reqs[i].scratch)[0];
+            ops[i].n      = reqs[i].n;
+            ops[i].offset = reqs[i].offset;
         }
-        left -= done;
-        dst  += done;
     }
-    *result = std::string_view(scratch->data(), n - left);
-    if (rs.IsEof() && !result->empty()) {
-        rs = Error::OK();
+    if (!ring->ReadAll(ops.get(), n)) {
+        RandomAccessFile::MultiRead(reqs, n, runner);
+        return;
+    }
+    
+    for (size_t i = 0; i < n; ++i) {
+        ReadRequest *req = &reqs[i];
+        if (ops[i].result < 0) {
+            req->rs = MAI_IO_ERROR(strerror(static_cast<int>(-ops[i].result)));
+            continue;
+        }
+        size_t read_bytes = static_cast<size_t>(ops[i].result);
+        if (direct_io_) {
+            req->rs = CopyFromAligned(bufs[i].get(),
+                                      AlignedRange(req->offset, req->n),
+                                      read_bytes, req->n, &req->result,
+                                      req->scratch);
+        } else if (read_bytes < req->n) {
+            // Short reading, maybe end of file, read it again by pread().
+            req->rs = BufferedRead(req->offset, req->n, &req->result,
+                                   req->scratch);
+        } else {
+            req->result = std::string_view(req->scratch->data(), read_bytes);
+            req->rs = Error::OK();
+        }
     }
-    return rs;
 }
     
 /*virtual*/ Error PosixRandomAccessFile::GetFileSize(uint64_t *size) {
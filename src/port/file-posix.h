@@ -73,6 +73,7 @@ public:
     virtual Error Sync() override;
     virtual Error GetFileSize(uint64_t *size) override;
     virtual Error Truncate(uint64_t size) override;
+    virtual Error Allocate(uint64_t offset, uint64_t len) override;
     
     DISALLOW_IMPLICIT_CONSTRUCTORS(PosixWritableFile);
 private:
@@ -113,20 +114,38 @@ private:
     
 class PosixRandomAccessFile final : public RandomAccessFile {
 public:
+    // The offset, size and buffer of O_DIRECT reading must be aligned.
+    static const size_t kDirectIOAlignment = 4096;
+    
     virtual ~PosixRandomAccessFile();
     
     static Error Open(const std::string &file_name,
-                      std::unique_ptr<RandomAccessFile> *file);
+                      std::unique_ptr<RandomAccessFile> *file,
+                      bool direct_io = false);
     
     virtual Error Read(uint64_t offset, size_t n, std::string_view *result,
                        std::string *scratch) override;
+    // Submit all requests by io_uring, if io_uring is not supported, read
+    // them by the runner.
+    virtual void MultiRead(ReadRequest *reqs, size_t n,
+                           const ParallelRunner &runner = nullptr) override;
     virtual Error GetFileSize(uint64_t *size) override;
     
+    DEF_VAL_GETTER(bool, direct_io);
+    
     DISALLOW_IMPLICIT_CONSTRUCTORS(PosixRandomAccessFile);
 private:
-    PosixRandomAccessFile(int fd) : fd_(fd) { DCHECK_GE(fd_, 0); }
+    PosixRandomAccessFile(int fd, bool direct_io)
+        : fd_(fd)
+        , direct_io_(direct_io) { DCHECK_GE(fd_, 0); }
+    
+    Error BufferedRead(uint64_t offset, size_t n, std::string_view *result,
+                       std::string *scratch);
+    Error DirectRead(uint64_t offset, size_t n, std::string_view *result,
+                     std::string *scratch);
     
     int fd_ = -1;
+    bool direct_io_ = false;
 }; // class PosixRandomAccessFile
 
 } // namespace port
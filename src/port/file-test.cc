@@ -1,5 +1,6 @@
 #include "mai/env.h"
 #include "gtest/gtest.h"
+#include <thread>
 
 namespace mai {
     
@@ -37,5 +38,68 @@ TEST(RandomAccessFileTest, Sanity) {
     rf->Read(0, 5, &data, nullptr);
     ASSERT_EQ("Hello", data);
 }
+    
+TEST(RandomAccessFileTest, MultiRead) {
+    static const char kFileName[] = "tests/02-random-access-file-multi-read.tmp";
+    std::unique_ptr<WritableFile> wf;
+    auto rv = Env::Default()->NewWritableFile(kFileName, false, &wf);
+    ASSERT_TRUE(rv.ok()) << rv.ToString();
+    std::string content;
+    for (int i = 0; i < 10000; ++i) {
+        content.append(std::to_string(i)).append(",");
+    }
+    rv = wf->Append(content);
+    ASSERT_TRUE(rv.ok()) << rv.ToString();
+    wf.reset();
+    
+    for (bool direct : {false, true}) {
+        std::unique_ptr<RandomAccessFile> rf;
+        if (direct) {
+            rv = Env::Default()->NewDirectRandomAccessFile(kFileName, &rf);
+        } else {
+            rv = Env::Default()->NewRandomAccessFile(kFileName, &rf, false);
+        }
+        ASSERT_TRUE(rv.ok()) << rv.ToString();
+        
+        std::string_view data;
+        std::string scratch;
+        rv = rf->Read(4097, 100, &data, &scratch);
+        ASSERT_TRUE(rv.ok()) << rv.ToString();
+        ASSERT_EQ(content.substr(4097, 100), data);
+        
+        // Run every job in its own thread.
+        RandomAccessFile::ParallelRunner runner =
+            [] (size_t n, const std::function<void (size_t)> &job) {
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < n; ++i) {
+                threads.emplace_back(job, i);
+            }
+            for (auto &thrd : threads) {
+                thrd.join();
+            }
+        };
+        for (bool parallel : {false, true}) {
+            static const size_t kN = 100;
+            std::string scratchs[kN];
+            RandomAccessFile::ReadRequest reqs[kN];
+            for (size_t i = 0; i < kN; ++i) {
+                reqs[i].offset  = i * 311;
+                reqs[i].n       = 1000;
+                reqs[i].scratch = &scratchs[i];
+            }
+            reqs[kN - 2].offset = content.size() - 10; // Short reading
+            reqs[kN - 1].offset = content.size() + 10; // Out of file
+            rf->MultiRead(reqs, kN, parallel ? runner : nullptr);
+            
+            for (size_t i = 0; i < kN - 1; ++i) {
+                ASSERT_TRUE(reqs[i].rs.ok()) << reqs[i].rs.ToString();
+                ASSERT_EQ(content.substr(reqs[i].offset, reqs[i].n),
+                          reqs[i].result) << i;
+            }
+            ASSERT_TRUE(reqs[kN - 1].rs.IsEof()) << reqs[kN - 1].rs.ToString();
+        }
+    }
+    Env::Default()->DeleteFile(kFileName, false);
+}
 
 } // namespace mai
@@ -0,0 +1,233 @@
+#include "port/io-uring-linux.h"
+#include "glog/logging.h"
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#if defined(MAI_USE_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif // defined(MAI_USE_IO_URING)
+
+namespace mai {
+    
+namespace port {
+    
+#if defined(MAI_USE_IO_URING)
+    
+static inline int IoUringSetup(unsigned entries, struct io_uring_params *p) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+static inline int IoUringEnter(int fd, unsigned to_submit,
+                               unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit,
+                                      min_complete, flags, nullptr, 0));
+}
+    
+IoUring::~IoUring() {
+    if (sqes_) {
+        ::munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+        ::munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_) {
+        ::munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_fd_ >= 0) {
+        ::close(ring_fd_);
+    }
+}
+    
+/*static*/ IoUring *IoUring::Current() {
+    // The ring be disabled for all threads after the first failure, the
+    // kernel or sandbox does not allow it.
+    static std::atomic<bool> unsupported(false);
+    thread_local std::unique_ptr<IoUring> ring;
+    
+    if (ring && !ring->broken_) {
+        return ring.get();
+    }
+    ring.reset(); // The broken ring may keep stale entries, never reuse it.
+    if (unsupported.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    std::unique_ptr<IoUring> new_ring(new IoUring());
+    if (!new_ring->Init()) {
+        unsupported.store(true, std::memory_order_relaxed);
+        return nullptr;
+    }
+    ring = std::move(new_ring);
+    return ring.get();
+}
+    
+bool IoUring::Init() {
+    struct io_uring_params p;
+    ::memset(&p, 0, sizeof(p));
+    ring_fd_ = IoUringSetup(kNumEntries, &p);
+    if (ring_fd_ < 0) {
+        PLOG(WARNING) << "io_uring_setup() fail, fallback to thread pool.";
+        return false;
+    }
+    sq_entries_ = p.sq_entries;
+    
+    sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    void *mem = ::mmap(nullptr, sq_ring_size_, PROT_READ|PROT_WRITE,
+                       MAP_SHARED|MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (mem == MAP_FAILED) {
+        return false;
+    }
+    sq_ring_ = mem;
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        mem = ::mmap(nullptr, cq_ring_size_, PROT_READ|PROT_WRITE,
+                     MAP_SHARED|MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+        if (mem == MAP_FAILED) {
+            return false;
+        }
+        cq_ring_ = mem;
+    }
+    sqes_size_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    mem = ::mmap(nullptr, sqes_size_, PROT_READ|PROT_WRITE,
+                 MAP_SHARED|MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (mem == MAP_FAILED) {
+        return false;
+    }
+    sqes_ = mem;
+    
+    char *sq = static_cast<char *>(sq_ring_);
+    sq_tail_  = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    sq_mask_  = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+    char *cq = static_cast<char *>(cq_ring_);
+    cq_head_  = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    cq_tail_  = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    cq_mask_  = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    cqes_     = cq + p.cq_off.cqes;
+    return true;
+}
+    
+bool IoUring::ReadAll(ReadOp *ops, size_t n) {
+    while (n > 0) {
+        size_t batch = std::min(n, static_cast<size_t>(sq_entries_));
+        if (!SubmitAndWait(ops, batch)) {
+            return false;
+        }
+        ops += batch;
+        n   -= batch;
+    }
+    return true;
+}
+    
+bool IoUring::SubmitAndWait(ReadOp *ops, size_t n) {
+    DCHECK_LE(n, sq_entries_);
+    // IORING_OP_READV is supported by all kernels have io_uring.
+    std::unique_ptr<struct iovec[]> iovs(new struct iovec[n]);
+    auto sqes = static_cast<struct io_uring_sqe *>(sqes_);
+    
+    // Only this thread produces, so the tail can be read relaxed.
+    unsigned tail = *sq_tail_;
+    const unsigned mask = *sq_mask_;
+    for (size_t i = 0; i < n; ++i) {
+        iovs[i].iov_base = ops[i].buf;
+        iovs[i].iov_len  = ops[i].n;
+        
+        unsigned index = tail & mask;
+        struct io_uring_sqe *sqe = &sqes[index];
+        ::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode    = IORING_OP_READV;
+        sqe->fd        = ops[i].fd;
+        sqe->addr      = reinterpret_cast<uint64_t>(&iovs[i]);
+        sqe->len       = 1;
+        sqe->off       = ops[i].offset;
+        sqe->user_data = i;
+        sq_array_[index] = index;
+        tail++;
+    }
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+    
+    unsigned to_submit = static_cast<unsigned>(n);
+    size_t n_done = 0;
+    while (n_done < n) {
+        int rv = IoUringEnter(ring_fd_, to_submit,
+                              static_cast<unsigned>(n - n_done),
+                              IORING_ENTER_GETEVENTS);
+        if (rv < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            PLOG(ERROR) << "io_uring_enter() fail!";
+            // The submitted reads still write to buffers of ops and iovs,
+            // wait for them before the caller frees or reuses the buffers.
+            // The unsubmitted entries be dropped with the broken ring.
+            Drain(ops, n, n - to_submit, n_done);
+            broken_ = true;
+            return false;
+        }
+        to_submit -= std::min(to_submit, static_cast<unsigned>(rv));
+        n_done += Reap(ops, n);
+    }
+    return true;
+}
+    
+size_t IoUring::Reap(ReadOp *ops, size_t n) {
+    auto cqes = static_cast<struct io_uring_cqe *>(cqes_);
+    size_t n_reaped = 0;
+    unsigned head = *cq_head_;
+    const unsigned cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != cq_tail; ++head) {
+        const struct io_uring_cqe *cqe = &cqes[head & *cq_mask_];
+        DCHECK_LT(cqe->user_data, n);
+        ops[cqe->user_data].result = cqe->res;
+        n_reaped++;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    return n_reaped;
+}
+    
+void IoUring::Drain(ReadOp *ops, size_t n, size_t n_submitted, size_t n_done) {
+    while (n_done < n_submitted) {
+        int rv = IoUringEnter(ring_fd_, 0,
+                              static_cast<unsigned>(n_submitted - n_done),
+                              IORING_ENTER_GETEVENTS);
+        if (rv < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            // The kernel still owns the buffers, can not return safely.
+            PLOG(FATAL) << "Can not wait for the submitted io_uring reads!";
+        }
+        n_done += Reap(ops, n);
+    }
+}
+    
+#else // !defined(MAI_USE_IO_URING)
+    
+IoUring::~IoUring() {}
+    
+/*static*/ IoUring *IoUring::Current() { return nullptr; }
+    
+bool IoUring::Init() { return false; }
+    
+bool IoUring::ReadAll(ReadOp */*ops*/, size_t /*n*/) { return false; }
+    
+bool IoUring::SubmitAndWait(ReadOp */*ops*/, size_t /*n*/) { return false; }
+    
+size_t IoUring::Reap(ReadOp */*ops*/, size_t /*n*/) { return 0; }
+    
+void IoUring::Drain(ReadOp */*ops*/, size_t /*n*/, size_t /*n_submitted*/,
+                    size_t /*n_done*/) {}
+    
+#endif // defined(MAI_USE_IO_URING)
+    
+} // namespace port
+    
+} // namespace mai
@@ -0,0 +1,78 @@
+#ifndef MAI_PORT_IO_URING_LINUX_H_
+#define MAI_PORT_IO_URING_LINUX_H_
+
+#include "base/base.h"
+#include <sys/types.h>
+
+#if defined(MAI_OS_LINUX) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define MAI_USE_IO_URING 1
+#endif
+#endif
+
+namespace mai {
+    
+namespace port {
+    
+// Minimal io_uring for batch reading, the syscalls be called directly, so no
+// liburing be required. Every thread has its own ring.
+class IoUring final {
+public:
+    static const unsigned kNumEntries = 64;
+    
+    struct ReadOp {
+        int     fd;
+        char   *buf;
+        size_t  n;
+        off_t   offset;
+        ssize_t result; // Read bytes or -errno
+    }; // struct ReadOp
+    
+    ~IoUring();
+    
+    // Get the ring of current thread, return null if io_uring is not
+    // supported by the kernel (or be disabled).
+    static IoUring *Current();
+    
+    // Submit all reading and wait for them done.
+    // Return false if the ring is broken, and the result of ops are undefined.
+    // No reading is running after it returns, the broken ring be replaced
+    // by Current() next time.
+    bool ReadAll(ReadOp *ops, size_t n);
+    
+    DISALLOW_IMPLICIT_CONSTRUCTORS(IoUring);
+private:
+    IoUring() {}
+    
+    bool Init();
+    bool SubmitAndWait(ReadOp *ops, size_t n);
+    // Take all completed entries, return the number of them.
+    size_t Reap(ReadOp *ops, size_t n);
+    // Wait for the submitted entries done.
+    void Drain(ReadOp *ops, size_t n, size_t n_submitted, size_t n_done);
+    
+    bool broken_ = false;
+    
+    int ring_fd_ = -1;
+    void *sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void *cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    void *sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    unsigned sq_entries_ = 0;
+    
+    unsigned *sq_tail_ = nullptr;
+    unsigned *sq_mask_ = nullptr;
+    unsigned *sq_array_ = nullptr;
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned *cq_mask_ = nullptr;
+    void *cqes_ = nullptr;
+}; // class IoUring
+    
+} // namespace port
+    
+} // namespace mai
+
+#endif // MAI_PORT_IO_URING_LINUX_H_
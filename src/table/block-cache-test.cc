@@ -0,0 +1,269 @@
+#include "table/block-cache.h"
+#include "base/slice.h"
+#include "base/hash.h"
+#include "base/thread-pool.h"
+#include "mai/env.h"
+#include "gtest/gtest.h"
+
+namespace mai {
+
+namespace table {
+
+class BlockCacheTest : public ::testing::Test {
+public:
+    static constexpr int kBlockSize = 100;
+    static constexpr int kNumBlocks = 100;
+    static constexpr size_t kCharge = sizeof(core::LRUHandle) + 16 + kBlockSize - 4;
+
+    void SetUp() override {
+        std::unique_ptr<WritableFile> file;
+        Error rs = env_->NewWritableFile(kFileName, false, &file);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+
+        for (int i = 0; i < kNumBlocks; ++i) {
+            std::string payload(kBlockSize - 4, 'a' + (i % 26));
+            std::string block;
+            base::Slice::WriteFixed32(&block,
+                                      base::Hash::Crc32(payload.data(),
+                                                        payload.size()));
+            block.append(payload);
+            rs = file->Append(block);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+        file.reset();
+        rs = env_->NewRandomAccessFile(kFileName, &file_, false);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+
+    void TearDown() override {
+        file_.reset();
+        env_->DeleteFile(kFileName, false);
+    }
+
+    Error Read(BlockCache *cache, int i, bool fill_cache,
+               base::intrusive_ptr<core::LRUHandle> *handle) {
+        return cache->GetOrLoad(file_.get(), 1, i * kBlockSize, kBlockSize,
+                                false, true, fill_cache, handle);
+    }
+
+    bool Cached(BlockCache *cache, int i) {
+        BlockCache::Stats before, after;
+        cache->GetShardStats(0, &before);
+        base::intrusive_ptr<core::LRUHandle> handle;
+        Error rs = Read(cache, i, false, &handle);
+        EXPECT_TRUE(rs.ok()) << rs.ToString();
+        cache->GetShardStats(0, &after);
+        return after.hits > before.hits;
+    }
+
+    static const char kFileName[];
+
+    Env *env_ = Env::Default();
+    std::unique_ptr<RandomAccessFile> file_;
+}; // class BlockCacheTest
+
+/*static*/ const char BlockCacheTest::kFileName[] = "tests/26-block-cache.tmp";
+
+TEST_F(BlockCacheTest, Sanity) {
+    BlockCache cache(base::kMB, 0);
+    ASSERT_EQ(1, cache.n_shards());
+
+    base::intrusive_ptr<core::LRUHandle> handle;
+    Error rs = Read(&cache, 1, true, &handle);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(std::string(kBlockSize - 4, 'b'),
+              std::string(static_cast<char *>(handle->value), kBlockSize - 4));
+
+    rs = Read(&cache, 1, true, &handle);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+
+    BlockCache::Stats stats;
+    cache.GetShardStats(0, &stats);
+    ASSERT_EQ(1, stats.hits);
+    ASSERT_EQ(1, stats.misses);
+    ASSERT_EQ(0, stats.evictions);
+    ASSERT_EQ(1, stats.n_entries);
+    ASSERT_EQ(kCharge, stats.usage);
+    ASSERT_EQ(kCharge, cache.ApproximateUsage());
+
+    cache.Purge(1);
+    cache.GetShardStats(0, &stats);
+    ASSERT_EQ(0, stats.n_entries);
+    ASSERT_EQ(0, stats.usage);
+    // Purged block still can be read by holder.
+    ASSERT_EQ('b', static_cast<char *>(handle->value)[0]);
+}
+
+TEST_F(BlockCacheTest, Capacity) {
+    BlockCache cache(kCharge * 10, 0);
+
+    base::intrusive_ptr<core::LRUHandle> pinned;
+    Error rs = Read(&cache, 0, true, &pinned);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+
+    for (int i = 1; i < kNumBlocks; ++i) {
+        base::intrusive_ptr<core::LRUHandle> handle;
+        rs = Read(&cache, i, true, &handle);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_LE(cache.ApproximateUsage(), cache.capacity());
+    }
+
+    BlockCache::Stats stats;
+    cache.GetShardStats(0, &stats);
+    ASSERT_EQ(10, stats.n_entries);
+    ASSERT_EQ(kNumBlocks - 10, stats.evictions);
+
+    // Evicted block still can be read by holder.
+    ASSERT_EQ(std::string(kBlockSize - 4, 'a'),
+              std::string(static_cast<char *>(pinned->value), kBlockSize - 4));
+}
+
+TEST_F(BlockCacheTest, ScanResistant) {
+    BlockCache cache(kCharge * 10, 0);
+
+    // Hot blocks be read twice, they should be promoted.
+    for (int n = 0; n < 2; ++n) {
+        for (int i = 0; i < 4; ++i) {
+            base::intrusive_ptr<core::LRUHandle> handle;
+            Error rs = Read(&cache, i, true, &handle);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+    }
+
+    // Scan all other blocks once.
+    for (int i = 4; i < kNumBlocks; ++i) {
+        base::intrusive_ptr<core::LRUHandle> handle;
+        Error rs = Read(&cache, i, true, &handle);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(Cached(&cache, i)) << i;
+    }
+    ASSERT_FALSE(Cached(&cache, 4));
+}
+
+TEST_F(BlockCacheTest, NoFillCache) {
+    BlockCache cache(kCharge * 10, 0);
+
+    for (int i = 0; i < kNumBlocks; ++i) {
+        base::intrusive_ptr<core::LRUHandle> handle;
+        Error rs = Read(&cache, i, false, &handle);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ('a' + (i % 26), static_cast<char *>(handle->value)[0]);
+    }
+
+    BlockCache::Stats stats;
+    cache.GetShardStats(0, &stats);
+    ASSERT_EQ(0, stats.n_entries);
+    ASSERT_EQ(0, stats.usage);
+    ASSERT_EQ(0, stats.evictions);
+    ASSERT_EQ(kNumBlocks, stats.misses);
+}
+
+TEST_F(BlockCacheTest, Prefetch) {
+    std::unique_ptr<RandomAccessFile> direct_file;
+    Error rs = env_->NewDirectRandomAccessFile(kFileName, &direct_file);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+
+    base::ThreadPool pool(4);
+    base::ThreadPool *io_pools[] = {&pool, nullptr};
+    for (RandomAccessFile *file : {file_.get(), direct_file.get()}) {
+        for (base::ThreadPool *io_pool : io_pools) {
+            BlockCache cache(base::kMB, 0, 0, io_pool);
+            base::intrusive_ptr<core::LRUHandle> handle;
+            rs = Read(&cache, 3, true, &handle);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+
+            std::vector<BlockHandle> blocks;
+            for (int i = 0; i < kNumBlocks; i += 3) {
+                blocks.push_back(BlockHandle(i * kBlockSize, kBlockSize));
+            }
+            cache.Prefetch(file, 1, blocks, false, true);
+
+            BlockCache::Stats stats;
+            cache.GetShardStats(0, &stats);
+            ASSERT_EQ(blocks.size(), stats.n_entries);
+            ASSERT_EQ(1, stats.misses);
+            // The cached block is not replaced.
+            ASSERT_EQ('d', static_cast<char *>(handle->value)[0]);
+
+            for (int i = 0; i < kNumBlocks; ++i) {
+                ASSERT_EQ(i % 3 == 0, Cached(&cache, i)) << i;
+            }
+            rs = Read(&cache, 99, true, &handle);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+            ASSERT_EQ('a' + (99 % 26), static_cast<char *>(handle->value)[0]);
+        }
+    }
+    pool.Shutdown();
+}
+
+TEST_F(BlockCacheTest, CompressedCache) {
+    static const char kCompressedFileName[] = "tests/31-block-cache-compressed.tmp";
+    static const int kRawSize = 4096;
+    
+    std::unique_ptr<WritableFile> wfile;
+    Error rs = env_->NewWritableFile(kCompressedFileName, false, &wfile);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    std::vector<BlockHandle> blocks;
+    uint64_t offset = 0;
+    for (int i = 0; i < kNumBlocks; ++i) {
+        std::string raw;
+        while (raw.size() < kRawSize) {
+            raw.append("block-" + std::to_string(i) + "-");
+        }
+        raw.resize(kRawSize);
+        std::string contents, block;
+        Table::CompressBlock(raw, kLZ4Compression, &contents);
+        ASSERT_EQ(kLZ4Compression, contents.back());
+        base::Slice::WriteFixed32(&block,
+                                  base::Hash::Crc32(contents.data(),
+                                                    contents.size()));
+        block.append(contents);
+        rs = wfile->Append(block);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        blocks.push_back(BlockHandle(offset, block.size()));
+        offset += block.size();
+    }
+    wfile.reset();
+    std::unique_ptr<RandomAccessFile> file;
+    rs = env_->NewRandomAccessFile(kCompressedFileName, &file, false);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    // Only 10 uncompressed blocks can be cached, but all compressed blocks
+    // can be kept in secondary cache.
+    size_t charge = sizeof(core::LRUHandle) + 16 + kRawSize;
+    BlockCache cache(charge * 10, 0, base::kMB);
+    ASSERT_EQ(base::kMB, cache.compressed_capacity());
+    for (int n = 0; n < 2; ++n) {
+        for (int i = 0; i < kNumBlocks; ++i) {
+            base::intrusive_ptr<core::LRUHandle> handle;
+            rs = cache.GetOrLoad(file.get(), 1, blocks[i].offset(),
+                                 blocks[i].size(), true, true, true, &handle);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+            std::string_view block = BlockCache::GetBlock(handle.get());
+            ASSERT_EQ(kRawSize, block.size());
+            ASSERT_EQ(0, block.find("block-" + std::to_string(i) + "-"));
+        }
+    }
+    
+    BlockCache::Stats stats;
+    cache.GetCompressedStats(&stats);
+    ASSERT_EQ(kNumBlocks, stats.n_entries);
+    ASSERT_EQ(kNumBlocks, stats.hits);
+    ASSERT_EQ(kNumBlocks, stats.misses);
+    ASSERT_LT(stats.usage, kNumBlocks * kRawSize / 4);
+    
+    cache.Purge(1);
+    cache.GetCompressedStats(&stats);
+    ASSERT_EQ(0, stats.n_entries);
+    ASSERT_EQ(0, stats.usage);
+    
+    file.reset();
+    env_->DeleteFile(kCompressedFileName, false);
+}
+
+} // namespace table
+
+} // namespace mai
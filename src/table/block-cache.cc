@@ -1,19 +1,324 @@
 #include "table/block-cache.h"
 #include "base/slice.h"
 #include "base/hash.h"
+#include "table/table.h"
+#include "core/perf-context-impl.h"
+#include "base/thread-pool.h"
 #include "mai/env.h"
-#include <thread>
+#include <unordered_map>
+#include <list>
+#include <mutex>
 
 namespace mai {
-    
+
 namespace table {
 
 static const size_t kKeySize = sizeof(uint64_t) + sizeof(uint64_t);
-    
-using Args = std::tuple<RandomAccessFile *, uint64_t, uint64_t, bool>;
-    
-BlockCache::BlockCache(Allocator *ll_allocator, size_t capacity)
-    : cache_(7, ll_allocator, capacity) {
+
+static const uint32_t kProtectedFlag = 0x4;
+
+// The protected segment can use 80% capacity of shard.
+static const size_t kProtectedRatio = 80;
+
+static inline uint64_t HashBlock(uint64_t file_number, uint64_t offset) {
+    uint64_t h = file_number * 0x9e3779b97f4a7c15ull + offset;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+struct BlockKey {
+    uint64_t file_number;
+    uint64_t offset;
+
+    bool operator == (const BlockKey &other) const {
+        return file_number == other.file_number && offset == other.offset;
+    }
+}; // struct BlockKey
+
+struct BlockKeyHash {
+    size_t operator () (const BlockKey &key) const {
+        return static_cast<size_t>(HashBlock(key.file_number, key.offset));
+    }
+}; // struct BlockKeyHash
+
+class BlockCache::Shard final {
+public:
+    using LRUHandle = core::LRUHandle;
+    using Key = BlockKey;
+
+    Shard() {
+        probation_->next = probation_;
+        probation_->prev = probation_;
+        protected_->next = protected_;
+        protected_->prev = protected_;
+    }
+
+    ~Shard() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (probation_->next != probation_) {
+            Detach(probation_->next);
+        }
+        while (protected_->next != protected_) {
+            Detach(protected_->next);
+        }
+    }
+
+    void set_capacity(size_t capacity) { capacity_ = capacity; }
+
+    // Return a referenced handle or null if not found.
+    LRUHandle *Lookup(uint64_t file_number, uint64_t offset, bool promote) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto iter = table_.find(Key{file_number, offset});
+        if (iter == table_.end()) {
+            misses_++;
+            return nullptr;
+        }
+        hits_++;
+        LRUHandle *handle = iter->second;
+        if (promote) {
+            Promote(handle);
+        }
+        handle->AddRef();
+        return handle;
+    }
+
+    // Return a referenced handle. If the block has been inserted by others,
+    // the new one will be freed.
+    LRUHandle *Insert(uint64_t file_number, uint64_t offset,
+                      LRUHandle *handle) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Key key{file_number, offset};
+        auto iter = table_.find(key);
+        if (iter != table_.end()) {
+            LRUHandle::Free(handle);
+            iter->second->AddRef();
+            return iter->second;
+        }
+
+        handle->refs.store(2, std::memory_order_relaxed); // cache and caller
+        table_[key] = handle;
+        Insert(probation_, handle);
+        usage_ += charge(handle);
+
+        while (usage_ > capacity_) {
+            LRUHandle *victim = probation_->next != probation_ ?
+                                probation_->next : protected_->next;
+            Detach(victim);
+            evictions_++;
+        }
+        return handle;
+    }
+
+    bool Contains(uint64_t file_number, uint64_t offset) const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return table_.find(Key{file_number, offset}) != table_.end();
+    }
+
+    void Purge(uint64_t file_number) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (auto iter = table_.begin(); iter != table_.end();) {
+            LRUHandle *handle = iter->second;
+            ++iter;
+            uint64_t number;
+            ::memcpy(&number, handle->data, sizeof(number));
+            if (number == file_number) {
+                Detach(handle);
+            }
+        }
+    }
+
+    void GetStats(Stats *stats) const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stats->hits      = hits_;
+        stats->misses    = misses_;
+        stats->evictions = evictions_;
+        stats->usage     = usage_;
+        stats->n_entries = table_.size();
+    }
+
+    size_t usage() const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return usage_;
+    }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(Shard);
+private:
+    // The charge of block be saved in handle's user defined id.
+    static size_t charge(const LRUHandle *handle) { return handle->id; }
+
+    static bool is_protected(const LRUHandle *handle) {
+        return handle->flags.load(std::memory_order_relaxed) & kProtectedFlag;
+    }
+
+    // REQUIRES: mutex_.lock()
+    void Promote(LRUHandle *handle) {
+        Remove(handle);
+        if (!is_protected(handle)) {
+            handle->set_flags(true, kProtectedFlag);
+            protected_usage_ += charge(handle);
+        }
+        Insert(protected_, handle);
+
+        // Demote the coldest protected blocks to probation segment.
+        const size_t limit = capacity_ * kProtectedRatio / 100;
+        while (protected_usage_ > limit && protected_->next != handle) {
+            LRUHandle *cold = protected_->next;
+            Remove(cold);
+            cold->set_flags(false, kProtectedFlag);
+            protected_usage_ -= charge(cold);
+            Insert(probation_, cold);
+        }
+    }
+
+    // Remove the block from cache. The block will be freed after all readers
+    // released it.
+    // REQUIRES: mutex_.lock()
+    void Detach(LRUHandle *handle) {
+        Key key;
+        ::memcpy(&key.file_number, handle->data, sizeof(key.file_number));
+        ::memcpy(&key.offset, handle->data + sizeof(key.file_number),
+                 sizeof(key.offset));
+        table_.erase(key);
+        Remove(handle);
+        usage_ -= charge(handle);
+        if (is_protected(handle)) {
+            protected_usage_ -= charge(handle);
+        }
+        handle->set_detached(true);
+        handle->ReleaseRef();
+    }
+
+    static void Remove(LRUHandle *handle) {
+        LRUHandle *prev = handle->prev;
+        LRUHandle *next = handle->next;
+        prev->next = next;
+        next->prev = prev;
+    }
+
+    // Insert to the most recently used position.
+    static void Insert(LRUHandle *list, LRUHandle *handle) {
+        handle->next = list;
+        LRUHandle *prev = list->prev;
+        handle->prev = prev;
+        prev->next = handle;
+        list->prev = handle;
+    }
+
+    size_t capacity_ = 0;
+    size_t usage_ = 0;
+    size_t protected_usage_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+    std::unordered_map<Key, LRUHandle *, BlockKeyHash> table_;
+    LRUHandle probation_dummy_{};
+    LRUHandle *probation_ = &probation_dummy_;
+    LRUHandle protected_dummy_{};
+    LRUHandle *protected_ = &protected_dummy_;
+    mutable std::mutex mutex_;
+}; // class BlockCache::Shard
+
+// The secondary cache only keeps bytes of compressed blocks, so it's a simple
+// LRU list.
+class BlockCache::CompressedShard final {
+public:
+    CompressedShard() {}
+
+    void set_capacity(size_t capacity) { capacity_ = capacity; }
+
+    bool Lookup(uint64_t file_number, uint64_t offset, std::string *block) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto iter = table_.find(BlockKey{file_number, offset});
+        if (iter == table_.end()) {
+            misses_++;
+            return false;
+        }
+        hits_++;
+        lru_.splice(lru_.end(), lru_, iter->second);
+        *block = iter->second->block;
+        return true;
+    }
+
+    void Insert(uint64_t file_number, uint64_t offset, std::string_view block) {
+        if (block.size() > capacity_) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        BlockKey key{file_number, offset};
+        if (table_.find(key) != table_.end()) {
+            return;
+        }
+        lru_.push_back({key, std::string(block)});
+        table_[key] = std::prev(lru_.end());
+        usage_ += block.size();
+        while (usage_ > capacity_) {
+            Remove(lru_.begin());
+            evictions_++;
+        }
+    }
+
+    void Purge(uint64_t file_number) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (auto iter = lru_.begin(); iter != lru_.end();) {
+            auto entry = iter++;
+            if (entry->key.file_number == file_number) {
+                Remove(entry);
+            }
+        }
+    }
+
+    void GetStats(Stats *stats) const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stats->hits      += hits_;
+        stats->misses    += misses_;
+        stats->evictions += evictions_;
+        stats->usage     += usage_;
+        stats->n_entries += table_.size();
+    }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(CompressedShard);
+private:
+    struct Entry {
+        BlockKey    key;
+        std::string block;
+    }; // struct Entry
+
+    // REQUIRES: mutex_.lock()
+    void Remove(std::list<Entry>::iterator entry) {
+        usage_ -= entry->block.size();
+        table_.erase(entry->key);
+        lru_.erase(entry);
+    }
+
+    size_t capacity_ = 0;
+    size_t usage_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+    std::list<Entry> lru_; // The front is the coldest.
+    std::unordered_map<BlockKey, std::list<Entry>::iterator, BlockKeyHash> table_;
+    mutable std::mutex mutex_;
+}; // class BlockCache::CompressedShard
+
+BlockCache::BlockCache(size_t capacity, int shard_bits,
+                       size_t compressed_capacity, base::ThreadPool *io_pool)
+    : capacity_(capacity)
+    , compressed_capacity_(compressed_capacity)
+    , shard_bits_(shard_bits)
+    , io_pool_(io_pool)
+    , shards_(new Shard[1 << shard_bits]) {
+    DCHECK_GE(shard_bits, 0);
+    for (int i = 0; i < n_shards(); ++i) {
+        shards_[i].set_capacity(capacity / n_shards());
+    }
+    if (compressed_capacity_ > 0) {
+        compressed_shards_.reset(new CompressedShard[n_shards()]);
+        for (int i = 0; i < n_shards(); ++i) {
+            compressed_shards_[i].set_capacity(compressed_capacity / n_shards());
+        }
+    }
 }
 
 BlockCache::~BlockCache() {
@@ -23,57 +328,230 @@ Error BlockCache::GetOrLoad(RandomAccessFile *file,
                             uint64_t file_number,
                             uint64_t offset,
                             uint64_t size,
+                            bool has_trailer,
                             bool checksum_verify,
+                            bool fill_cache,
                             base::intrusive_ptr<core::LRUHandle> *result) {
-    char key[kKeySize];
-    ::memcpy(key, &file_number, sizeof(file_number));
-    ::memcpy(key + sizeof(file_number), &offset, sizeof(offset));
-    
-    auto args = std::make_tuple(file, offset, size, checksum_verify);
-    return cache_.GetOrLoad(std::string_view(key, kKeySize), result, nullptr,
-                            &Loader, this, &args);
+    Shard *shard = GetShard(file_number, offset);
+    core::LRUHandle *handle = shard->Lookup(file_number, offset, fill_cache);
+    if (handle) {
+        PERF_COUNTER_ADD(block_cache_hits, 1);
+    } else {
+        PERF_COUNTER_ADD(block_cache_misses, 1);
+        // Load block without lock, the other readers can still read this shard.
+        Error rs = Load(file, file_number, offset, size, has_trailer,
+                        checksum_verify, &handle);
+        if (!rs) {
+            return rs;
+        }
+        if (fill_cache) {
+            handle = shard->Insert(file_number, offset, handle);
+        } else {
+            handle->set_detached(true);
+            handle->AddRef();
+        }
+    }
+    result->reset(handle);
+    handle->ReleaseRef();
+    return Error::OK();
+}
+
+void BlockCache::Prefetch(RandomAccessFile *file, uint64_t file_number,
+                          const std::vector<BlockHandle> &blocks,
+                          bool has_trailer, bool checksum_verify) {
+    std::vector<BlockHandle> missed;
+    std::string compressed;
+    for (const auto &bh : blocks) {
+        Shard *shard = GetShard(file_number, bh.offset());
+        if (shard->Contains(file_number, bh.offset())) {
+            continue;
+        }
+        CompressedShard *cshard = GetCompressedShard(file_number, bh.offset());
+        core::LRUHandle *handle;
+        if (has_trailer && cshard &&
+            cshard->Lookup(file_number, bh.offset(), &compressed) &&
+            NewBlock(file_number, bh.offset(), compressed, true, false,
+                     &handle).ok()) {
+            shard->Insert(file_number, bh.offset(), handle)->ReleaseRef();
+            continue;
+        }
+        missed.push_back(bh);
+    }
+    if (missed.empty()) {
+        return;
+    }
+
+    std::unique_ptr<std::string[]> scratchs(new std::string[missed.size()]);
+    std::unique_ptr<RandomAccessFile::ReadRequest[]>
+        reqs(new RandomAccessFile::ReadRequest[missed.size()]);
+    for (size_t i = 0; i < missed.size(); ++i) {
+        reqs[i].offset  = missed[i].offset();
+        reqs[i].n       = missed[i].size();
+        reqs[i].scratch = &scratchs[i];
+    }
+    RandomAccessFile::ParallelRunner runner;
+    if (io_pool_) {
+        runner = [this] (size_t n, const std::function<void (size_t)> &job) {
+            io_pool_->ParallelRun(base::ThreadPool::kHigh, n,
+                                  [&job] (size_t i) { job(i); });
+        };
+    }
+    file->MultiRead(reqs.get(), missed.size(), runner);
+
+    for (size_t i = 0; i < missed.size(); ++i) {
+        if (!reqs[i].rs || reqs[i].result.size() != missed[i].size()) {
+            continue;
+        }
+        core::LRUHandle *handle;
+        Error rs = Admit(file_number, missed[i].offset(), reqs[i].result,
+                         has_trailer, checksum_verify, &handle);
+        if (!rs) {
+            continue;
+        }
+        handle = GetShard(file_number, missed[i].offset())->
+                 Insert(file_number, missed[i].offset(), handle);
+        handle->ReleaseRef();
+    }
+}
+
+void BlockCache::Purge(uint64_t file_number) {
+    for (int i = 0; i < n_shards(); ++i) {
+        shards_[i].Purge(file_number);
+        if (compressed_shards_) {
+            compressed_shards_[i].Purge(file_number);
+        }
+    }
 }
-    
-/*static*/ void BlockCache::Deleter(std::string_view, void *) {
+
+void BlockCache::GetShardStats(int shard, Stats *stats) const {
+    DCHECK_GE(shard, 0);
+    DCHECK_LT(shard, n_shards());
+    shards_[shard].GetStats(stats);
 }
 
-/*static*/ Error BlockCache::Loader(std::string_view key,
-                                    core::LRUHandle **result, void *arg0,
-                                    void *arg1) {
-    RandomAccessFile *file;
-    uint64_t offset, size;
-    bool checksum_verify;
-    
-    std::tie(file, offset, size, checksum_verify) = *static_cast<Args *>(arg1);
+void BlockCache::GetCompressedStats(Stats *stats) const {
+    *stats = Stats{};
+    if (!compressed_shards_) {
+        return;
+    }
+    for (int i = 0; i < n_shards(); ++i) {
+        compressed_shards_[i].GetStats(stats);
+    }
+}
 
-    std::string_view buf;
+size_t BlockCache::ApproximateUsage() const {
+    size_t usage = 0;
+    for (int i = 0; i < n_shards(); ++i) {
+        usage += shards_[i].usage();
+    }
+    return usage;
+}
+
+/*static*/
+std::string_view BlockCache::GetBlock(const core::LRUHandle *handle) {
+    // See NewBlock(), the charge is the size of whole handle.
+    return std::string_view(static_cast<const char *>(handle->value),
+                            handle->id - sizeof(core::LRUHandle) - kKeySize);
+}
+
+BlockCache::Shard *BlockCache::GetShard(uint64_t file_number,
+                                        uint64_t offset) const {
+    uint64_t hash_val = HashBlock(file_number, offset);
+    return &shards_[hash_val & (n_shards() - 1)];
+}
+
+BlockCache::CompressedShard *
+BlockCache::GetCompressedShard(uint64_t file_number, uint64_t offset) const {
+    if (!compressed_shards_) {
+        return nullptr;
+    }
+    uint64_t hash_val = HashBlock(file_number, offset);
+    return &compressed_shards_[hash_val & (n_shards() - 1)];
+}
+
+Error BlockCache::Load(RandomAccessFile *file, uint64_t file_number,
+                       uint64_t offset, uint64_t size, bool has_trailer,
+                       bool checksum_verify, core::LRUHandle **result) {
     std::string scratch;
+    CompressedShard *cshard = GetCompressedShard(file_number, offset);
+    if (has_trailer && cshard && cshard->Lookup(file_number, offset, &scratch)) {
+        // It has been verified before be kept.
+        return NewBlock(file_number, offset, scratch, true, false, result);
+    }
+
+    std::string_view buf;
     Error rs = file->Read(offset, size, &buf, &scratch);
     if (!rs) {
         return rs;
     }
-    
+    PERF_COUNTER_ADD(block_read_count, 1);
+    PERF_COUNTER_ADD(block_read_bytes, buf.size());
+    return Admit(file_number, offset, buf, has_trailer, checksum_verify, result);
+}
+
+Error BlockCache::Admit(uint64_t file_number, uint64_t offset,
+                        std::string_view buf, bool has_trailer,
+                        bool checksum_verify, core::LRUHandle **result) {
+    Error rs = NewBlock(file_number, offset, buf, has_trailer, checksum_verify,
+                        result);
+    if (!rs) {
+        return rs;
+    }
+    CompressedShard *cshard = GetCompressedShard(file_number, offset);
+    if (has_trailer && cshard && buf.back() != kNoCompression) {
+        cshard->Insert(file_number, offset, buf);
+    }
+    return Error::OK();
+}
+
+/*static*/ Error BlockCache::NewBlock(uint64_t file_number, uint64_t offset,
+                                      std::string_view buf, bool has_trailer,
+                                      bool checksum_verify,
+                                      core::LRUHandle **result) {
+    if (buf.size() < 4) {
+        return MAI_CORRUPTION("Block too small!");
+    }
     if (checksum_verify) {
         auto checksum = base::Slice::SetFixed32(buf.substr(0, 4));
         if (checksum != base::Hash::Crc32(buf.data() + 4, buf.size() - 4)) {
             return MAI_IO_ERROR("Checksum fail!");
         }
     }
-    
-    // TODO: Uncompress
-    
-    auto handle = core::LRUHandle::New(key, buf.size() - 4);
-    ::memcpy(handle->value, buf.data() + 4, buf.size() - 4);
-    
+
+    CompressionType type = kNoCompression;
+    std::string_view contents = buf.substr(4);
+    size_t raw_size = contents.size();
+    if (has_trailer) {
+        Error rs = Table::ParseBlockTrailer(contents, &type, &contents,
+                                            &raw_size);
+        if (!rs) {
+            return rs;
+        }
+    }
+
+    char key[kKeySize];
+    ::memcpy(key, &file_number, sizeof(file_number));
+    ::memcpy(key + sizeof(file_number), &offset, sizeof(offset));
+
+    auto handle = core::LRUHandle::New(std::string_view(key, kKeySize),
+                                       raw_size);
+    if (!handle) {
+        return MAI_CORRUPTION("Out of memory!");
+    }
+    // Uncompress only once, before insert into cache.
+    Error rs = Table::UncompressBlock(type, contents,
+                                      static_cast<char *>(handle->value),
+                                      raw_size);
+    if (!rs) {
+        core::LRUHandle::Free(handle);
+        return rs;
+    }
+    handle->id = sizeof(core::LRUHandle) + kKeySize + raw_size;
+
     *result = handle;
     return Error::OK();
 }
-    
-size_t BlockCache::GetShardIdx(uint64_t file_number) {
-    //std::this_thread::get_id()
-    return cache_.HashNumber(file_number);
-}
-    
+
 } // namespace table
-    
+
 } // namespace mai
@@ -1,48 +1,127 @@
 #ifndef MAI_TABLE_BLOCK_CACHE_H_
 #define MAI_TABLE_BLOCK_CACHE_H_
 
+#include "table/table.h"
 #include "core/lru-cache-v1.h"
 #include "base/reference-count.h"
 #include "base/base.h"
 #include <memory>
+#include <vector>
 
 namespace mai {
 class RandomAccessFile;
+namespace base {
+class ThreadPool;
+} // namespace base
 namespace table {
 
+// Sharded data block cache. Blocks are sharded by hash of (file, offset), so
+// one hot file can spread to all shards. The capacity is total bytes of blocks.
+//
+// Every shard is a segmented LRU: a new block be inserted into the probation
+// segment, and it only be promoted to the protected segment when it be hit
+// again. So the blocks read once by a scan or compaction only can evict
+// the probation segment, the working set in protected segment is safe.
+//
+// The blocks in cache are always uncompressed. If compressed_capacity is not
+// zero, the compressed blocks read from file also be kept in a secondary
+// cache, the block evicted from cache can be restored from it without I/O.
+//
+// If io_pool is not null, the blocks of Prefetch() be read in it.
 class BlockCache final {
 public:
-    BlockCache(Allocator *ll_allocator, size_t capacity);
+    static const int kDefaultShardBits = 4;
+
+    struct Stats {
+        uint64_t hits      = 0;
+        uint64_t misses    = 0;
+        uint64_t evictions = 0;
+        size_t   usage     = 0;
+        size_t   n_entries = 0;
+    }; // struct Stats
+
+    explicit BlockCache(size_t capacity, int shard_bits = kDefaultShardBits,
+                        size_t compressed_capacity = 0,
+                        base::ThreadPool *io_pool = nullptr);
     ~BlockCache();
-    
+
+    DEF_VAL_GETTER(size_t, capacity);
+    DEF_VAL_GETTER(size_t, compressed_capacity);
+    DEF_PTR_GETTER(base::ThreadPool, io_pool);
+
+    int n_shards() const { return 1 << shard_bits_; }
+
+    // If fill_cache is false, the missed block will not be inserted into
+    // cache, and the hit block will not be promoted.
+    // If has_trailer is true, the block has compression type trailer, see
+    // Table::CompressBlock().
     Error GetOrLoad(RandomAccessFile *file,
                     uint64_t file_number,
                     uint64_t offset,
                     uint64_t size,
+                    bool has_trailer,
                     bool checksum_verify,
+                    bool fill_cache,
                     base::intrusive_ptr<core::LRUHandle> *result);
-    
-    void Purge(uint64_t file_number) {
-        cache_.Purge(GetShardIdx(file_number));
-    }
-    
-    core::LRUCacheShard *GetShard(uint64_t file_number) {
-        return cache_.GetShard(GetShardIdx(file_number));
-    }
-    
-    size_t GetShardIdx(uint64_t file_number);
+
+    // Load the missed blocks by one RandomAccessFile::MultiRead(), then insert
+    // them into cache. The blocks fail to load be ignored, they will be read
+    // again by GetOrLoad().
+    void Prefetch(RandomAccessFile *file,
+                  uint64_t file_number,
+                  const std::vector<BlockHandle> &blocks,
+                  bool has_trailer,
+                  bool checksum_verify);
+
+    // Remove all blocks of this file.
+    void Purge(uint64_t file_number);
+
+    void GetShardStats(int shard, Stats *stats) const;
+
+    // Stats of the secondary cache for compressed blocks.
+    void GetCompressedStats(Stats *stats) const;
+
+    // The uncompressed block in handle.
+    static std::string_view GetBlock(const core::LRUHandle *handle);
+
+    size_t ApproximateUsage() const;
 
     DISALLOW_IMPLICIT_CONSTRUCTORS(BlockCache);
 private:
-    static void Deleter(std::string_view, void *);
-    static Error Loader(std::string_view, core::LRUHandle **, void *, void *);
+    class Shard;
+    class CompressedShard;
+
+    Shard *GetShard(uint64_t file_number, uint64_t offset) const;
     
-    core::LRUCache cache_;
+    // Null if no secondary cache.
+    CompressedShard *GetCompressedShard(uint64_t file_number,
+                                        uint64_t offset) const;
+
+    Error Load(RandomAccessFile *file, uint64_t file_number, uint64_t offset,
+               uint64_t size, bool has_trailer, bool checksum_verify,
+               core::LRUHandle **result);
+
+    // Make a uncompressed block from buf read from file, and keep it in
+    // secondary cache if it's compressed.
+    Error Admit(uint64_t file_number, uint64_t offset, std::string_view buf,
+                bool has_trailer, bool checksum_verify,
+                core::LRUHandle **result);
+
+    static Error NewBlock(uint64_t file_number, uint64_t offset,
+                          std::string_view buf, bool has_trailer,
+                          bool checksum_verify, core::LRUHandle **result);
+
+    const size_t capacity_;
+    const size_t compressed_capacity_;
+    const int shard_bits_;
+    base::ThreadPool *const io_pool_;
+    std::unique_ptr<Shard[]> shards_;
+    std::unique_ptr<CompressedShard[]> compressed_shards_;
 }; // class BlockCache
 
-    
+
 } // namespace table
-    
+
 } // namespace mai
 
 
@@ -36,22 +36,26 @@ BlockIterator::BlockIterator(const core::InternalKeyComparator *ikcmp,
 }
 
 /*virtual*/ void BlockIterator::SeekToFirst() {
+    error_ = Error::OK();
     PrepareRead(0);
     curr_local_   = 0;
     curr_restart_ = 0;
 }
 
 /*virtual*/ void BlockIterator::SeekToLast() {
+    error_ = Error::OK();
     PrepareRead(n_restarts_ - 1);
     curr_local_   = static_cast<int64_t>(local_.size()) - 1;
     curr_restart_ = static_cast<int64_t>(n_restarts_) - 1;
 }
 
 /*virtual*/ void BlockIterator::Seek(std::string_view target) {
+    // Last seeking missed can not make this one invalid.
+    error_ = Error::OK();
     /*
     bool found = false;
     int32_t i;
-    std::tuple<std::string, std::string> kv;
+    std::tuple<std::string, std::string_view> kv;
     for (i = static_cast<int32_t>(n_restarts_) - 1; i >= 0; i--) {
         Read("", data_base_ + restarts_[i], &kv);
         if (ikcmp_->Compare(target, std::get<0>(kv)) >= 0) {
@@ -76,7 +80,7 @@ BlockIterator::BlockIterator(const core::InternalKeyComparator *ikcmp,
     error_ = MAI_NOT_FOUND("Seek()");
     */
     
-    std::tuple<std::string, std::string> kv;
+    std::tuple<std::string, std::string_view> kv;
     int rv = 0;
     int64_t count = n_restarts_, first = 0;
     while (count > 0) {
@@ -113,7 +117,7 @@ BlockIterator::BlockIterator(const core::InternalKeyComparator *ikcmp,
         if (iter != local_.end()) {
             
             curr_local_   = std::distance(local_.begin(), iter);
-            curr_restart_ = first;
+            curr_restart_ = i;
             return;
         }
     }
@@ -163,7 +167,7 @@ const char *BlockIterator::PrepareRead(uint64_t i) {
     const char *p   = data_base_ + restarts_[i];
     const char *end = (i == n_restarts_ - 1) ? data_end_ : data_base_ + restarts_[i + 1];
     
-    std::tuple<std::string, std::string> kv;
+    std::tuple<std::string, std::string_view> kv;
     std::string last_key;
     local_.clear();
     while (p < end) {
@@ -172,13 +176,13 @@ const char *BlockIterator::PrepareRead(uint64_t i) {
             return nullptr;
         }
         last_key = std::get<0>(kv);
-        local_.push_back(kv);
+        local_.push_back(std::move(kv));
     }
     return p;
 }
 
 const char *BlockIterator::Read(std::string_view prev_key, const char *start,
-                                std::tuple<std::string, std::string> *kv) {
+                                std::tuple<std::string, std::string_view> *kv) {
     base::BufferReader reader(std::string_view(start, data_end_ - start));
     uint64_t shared_len = reader.ReadVarint64();
     uint64_t private_len = reader.ReadVarint64();
@@ -199,7 +203,7 @@ const char *BlockIterator::Read(std::string_view prev_key, const char *start,
 //    }
     result = reader.ReadString();
     
-    *kv = std::make_tuple(key, result);
+    *kv = std::make_tuple(std::move(key), result);
     return start + reader.position();
 }
 
@@ -36,7 +36,7 @@ public:
 private:
     const char *PrepareRead(uint64_t i);
     const char *Read(std::string_view prev_key, const char *start,
-                     std::tuple<std::string, std::string> *kv);
+                     std::tuple<std::string, std::string_view> *kv);
     
     const core::InternalKeyComparator *ikcmp_;
     const char *data_base_;
@@ -45,7 +45,8 @@ private:
     size_t n_restarts_;
     int64_t curr_restart_;
     int64_t curr_local_;
-    std::vector<std::tuple<std::string, std::string>> local_;
+    // Keys be restored from prefix compression, values point to block.
+    std::vector<std::tuple<std::string, std::string_view>> local_;
     Error error_;
 }; // class BlockIterator
 
@@ -0,0 +1,96 @@
+#include "table/blocked-bloom-filter.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+namespace mai {
+    
+namespace table {
+    
+class BlockedBloomFilterTest : public ::testing::Test {
+public:
+    // Build filter for "k.0" ~ "k.(n - 1)"
+    std::string BuildFilter(int n) {
+        std::string bits(BlockedBloomFilter::ComputeSize(n), 0);
+        char key[32];
+        for (int i = 0; i < n; ++i) {
+            ::snprintf(key, sizeof(key), "k.%d", i);
+            BlockedBloomFilter::AddHash(BlockedBloomFilter::Hash(key),
+                                        &bits[0], bits.size());
+        }
+        return bits;
+    }
+};
+    
+TEST_F(BlockedBloomFilterTest, Sanity) {
+    ASSERT_EQ(64, BlockedBloomFilter::ComputeSize(0));
+    ASSERT_EQ(64, BlockedBloomFilter::ComputeSize(10));
+    ASSERT_EQ(1280, BlockedBloomFilter::ComputeSize(1000));
+    
+    std::string bits(BlockedBloomFilter::ComputeSize(3), 0);
+    for (auto key : {"aaaaa", "bbbbb", "ccccc"}) {
+        BlockedBloomFilter::AddHash(BlockedBloomFilter::Hash(key), &bits[0],
+                                    bits.size());
+    }
+    ASSERT_TRUE(BlockedBloomFilter::MayMatch("aaaaa", bits));
+    ASSERT_TRUE(BlockedBloomFilter::MayMatch("bbbbb", bits));
+    ASSERT_TRUE(BlockedBloomFilter::MayMatch("ccccc", bits));
+    ASSERT_FALSE(BlockedBloomFilter::MayMatch("d", bits));
+    
+    // Broken filter can not filter any key.
+    ASSERT_TRUE(BlockedBloomFilter::MayMatch("d", ""));
+}
+    
+TEST_F(BlockedBloomFilterTest, FalsePositiveRate) {
+    static const int kN = 10000;
+    std::string bits = BuildFilter(kN);
+    
+    char key[32];
+    for (int i = 0; i < kN; ++i) {
+        ::snprintf(key, sizeof(key), "k.%d", i);
+        ASSERT_TRUE(BlockedBloomFilter::MayMatch(key, bits)) << key;
+    }
+    int n_false_positive = 0;
+    for (int i = kN; i < kN * 2; ++i) {
+        ::snprintf(key, sizeof(key), "k.%d", i);
+        if (BlockedBloomFilter::MayMatch(key, bits)) {
+            n_false_positive++;
+        }
+    }
+    // About 10 bits per key, it should be less than 3%.
+    ASSERT_LT(n_false_positive, kN * 3 / 100);
+}
+    
+TEST_F(BlockedBloomFilterTest, MayMatchBatch) {
+    static const int kN = 1000;
+    std::string bits = BuildFilter(kN);
+    
+    std::vector<uint64_t> hash_vals;
+    char key[32];
+    for (int i = 0; i < kN * 2; ++i) {
+        ::snprintf(key, sizeof(key), "k.%d", i);
+        hash_vals.push_back(BlockedBloomFilter::Hash(key));
+    }
+    std::unique_ptr<bool[]> results(new bool[hash_vals.size()]);
+    BlockedBloomFilter::MayMatchBatch(&hash_vals[0], hash_vals.size(), bits,
+                                      results.get());
+    for (size_t i = 0; i < hash_vals.size(); ++i) {
+        ASSERT_EQ(BlockedBloomFilter::MayMatchHash(hash_vals[i], bits.data(),
+                                                   bits.size()), results[i]);
+        if (i < kN) {
+            ASSERT_TRUE(results[i]);
+        }
+    }
+}
+    
+TEST_F(BlockedBloomFilterTest, KeyFilter) {
+    base::intrusive_ptr<core::KeyFilter> filter(
+        new BlockedKeyFilter(BuildFilter(100)));
+    ASSERT_TRUE(filter->MayExists("k.0"));
+    ASSERT_TRUE(filter->MayExists("k.99"));
+    ASSERT_FALSE(filter->MayExists("k.100"));
+    ASSERT_NEAR(100, filter->ApproximateCount(), 5);
+}
+    
+} // namespace table
+    
+} // namespace mai
@@ -0,0 +1,121 @@
+#include "table/blocked-bloom-filter.h"
+#include "base/bit-ops.h"
+#include "glog/logging.h"
+#include <math.h>
+#if defined(MAI_ARCH_X64) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define MAI_BLOCKED_BLOOM_AVX2 1
+#endif
+
+namespace mai {
+
+namespace table {
+
+// Odd constants for multiplicative hashing, every word has its own one.
+alignas(32) static const uint32_t kSalts[BlockedBloomFilter::kNumProbes] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+    0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+};
+
+// The high 32 bits choose the line and half, the low 32 bits choose the bits.
+static inline const uint32_t *GetBlock(uint64_t hash_val, const char *bits,
+                                       size_t size) {
+    const uint64_t n_lines = size / BlockedBloomFilter::kLineSize;
+    const uint32_t hi = static_cast<uint32_t>(hash_val >> 32);
+    const uint64_t line = (static_cast<uint64_t>(hi) * n_lines) >> 32;
+    return reinterpret_cast<const uint32_t *>(bits +
+            line * BlockedBloomFilter::kLineSize + (hi & 1) * 32);
+}
+
+static inline bool MayMatchScalar(uint64_t hash_val, const uint32_t *block) {
+    const uint32_t lo = static_cast<uint32_t>(hash_val);
+    for (int i = 0; i < BlockedBloomFilter::kNumProbes; ++i) {
+        if (!(block[i] & (1u << ((lo * kSalts[i]) >> 27)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if defined(MAI_BLOCKED_BLOOM_AVX2)
+__attribute__((target("avx2")))
+static bool MayMatchAvx2(uint64_t hash_val, const uint32_t *block) {
+    const __m256i salts = _mm256_load_si256(reinterpret_cast<const __m256i *>(kSalts));
+    __m256i shifts = _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(hash_val)),
+                                        salts);
+    shifts = _mm256_srli_epi32(shifts, 27);
+    const __m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+    const __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+    // All bits of mask are set in words?
+    return _mm256_testc_si256(words, mask) != 0;
+}
+
+static bool HasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+#endif // defined(MAI_BLOCKED_BLOOM_AVX2)
+
+static inline bool MayMatchBlock(uint64_t hash_val, const uint32_t *block) {
+#if defined(MAI_BLOCKED_BLOOM_AVX2)
+    if (HasAvx2()) {
+        return MayMatchAvx2(hash_val, block);
+    }
+#endif
+    return MayMatchScalar(hash_val, block);
+}
+
+/*static*/ void BlockedBloomFilter::AddHash(uint64_t hash_val, char *bits,
+                                            size_t size) {
+    DCHECK_EQ(0, size % kLineSize);
+    uint32_t *block = const_cast<uint32_t *>(GetBlock(hash_val, bits, size));
+    const uint32_t lo = static_cast<uint32_t>(hash_val);
+    for (int i = 0; i < kNumProbes; ++i) {
+        block[i] |= (1u << ((lo * kSalts[i]) >> 27));
+    }
+}
+
+/*static*/ bool BlockedBloomFilter::MayMatchHash(uint64_t hash_val,
+                                                 const char *bits,
+                                                 size_t size) {
+    if (size < kLineSize) {
+        return true; // Broken filter can not filter any key.
+    }
+    return MayMatchBlock(hash_val, GetBlock(hash_val, bits, size));
+}
+
+/*static*/ void BlockedBloomFilter::MayMatchBatch(const uint64_t *hash_vals,
+                                                  size_t n,
+                                                  std::string_view bits,
+                                                  bool *results) {
+    if (bits.size() < kLineSize) {
+        for (size_t i = 0; i < n; ++i) {
+            results[i] = true;
+        }
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        __builtin_prefetch(GetBlock(hash_vals[i], bits.data(), bits.size()));
+    }
+    for (size_t i = 0; i < n; ++i) {
+        results[i] = MayMatchBlock(hash_vals[i],
+                                   GetBlock(hash_vals[i], bits.data(),
+                                            bits.size()));
+    }
+}
+
+/*virtual*/ size_t BlockedKeyFilter::ApproximateCount() const {
+    // Every key sets one bit in 8 words, so estimate keys of every word by its
+    // ones, the collisions in one word are not ignorable.
+    double count = 0;
+    const uint32_t *words = reinterpret_cast<const uint32_t *>(bits_.data());
+    for (size_t i = 0; i < bits_.size() / 4; ++i) {
+        int ones = base::Bits::CountOne32(words[i]);
+        count += ones >= 32 ? 32 * ::log(32) : -32 * ::log(1 - ones / 32.0);
+    }
+    return static_cast<size_t>(count / BlockedBloomFilter::kNumProbes + 0.5);
+}
+
+} // namespace table
+
+} // namespace mai
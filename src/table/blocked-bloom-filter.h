@@ -0,0 +1,76 @@
+#ifndef MAI_TABLE_BLOCKED_BLOOM_FILTER_H_
+#define MAI_TABLE_BLOCKED_BLOOM_FILTER_H_
+
+#include "core/key-filter.h"
+#include "base/hash.h"
+#include "base/base.h"
+#include <string>
+#include <string_view>
+
+namespace mai {
+
+namespace table {
+
+// Cache line blocked bloom filter:
+// The filter is an array of 64 bytes lines. One key only use one half (8
+// words) of one line, and set one bit in every word of it. So probing key
+// only touches one cache line, and all bits can be tested by one AVX2
+// instruction.
+struct BlockedBloomFilter final {
+    static constexpr size_t kLineSize = 64;
+    static constexpr int kNumProbes = 8;
+    static constexpr int kBitsPerKey = 10;
+
+    // Filter bytes for n keys, at least one line.
+    static size_t ComputeSize(size_t n_keys) {
+        size_t size = (n_keys * kBitsPerKey + 7) / 8;
+        return size < kLineSize ? kLineSize : RoundUp(size, kLineSize);
+    }
+
+    static uint64_t Hash(std::string_view key) {
+        return base::Hash::Murmur64(key.data(), key.size());
+    }
+
+    // REQUIRES: size % kLineSize == 0
+    static void AddHash(uint64_t hash_val, char *bits, size_t size);
+
+    static bool MayMatchHash(uint64_t hash_val, const char *bits, size_t size);
+
+    static bool MayMatch(std::string_view key, std::string_view bits) {
+        return MayMatchHash(Hash(key), bits.data(), bits.size());
+    }
+
+    // Probe a batch of keys, the lines of all keys be prefetched at first,
+    // so the cache misses are overlapped.
+    static void MayMatchBatch(const uint64_t *hash_vals, size_t n,
+                              std::string_view bits, bool *results);
+
+    DISALLOW_ALL_CONSTRUCTORS(BlockedBloomFilter);
+}; // struct BlockedBloomFilter
+
+
+class BlockedKeyFilter final : public core::KeyFilter {
+public:
+    BlockedKeyFilter(std::string_view bits) : bits_(bits) {}
+    virtual ~BlockedKeyFilter() {}
+
+    virtual bool MayExists(std::string_view key) const override {
+        return BlockedBloomFilter::MayMatch(key, bits_);
+    }
+    virtual size_t ApproximateCount() const override;
+    virtual size_t memory_usage() const override {
+        return sizeof(*this) + bits_.size();
+    }
+
+    std::string_view bits() const { return bits_; }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(BlockedKeyFilter);
+private:
+    std::string bits_;
+}; // class BlockedKeyFilter
+
+} // namespace table
+
+} // namespace mai
+
+#endif // MAI_TABLE_BLOCKED_BLOOM_FILTER_H_
@@ -4,6 +4,7 @@
 #include "base/hash.h"
 #include "base/base.h"
 #include "glog/logging.h"
+#include <memory>
 #include <string>
 #include <string_view>
 
@@ -40,6 +40,24 @@ KeyBloomFilter::KeyBloomFilter(const uint32_t *buckets, size_t n_buckets,
     return false;
 }
 
+/*static*/ bool KeyBloomFilter::MayMatch(std::string_view bits,
+                                        std::string_view key,
+                                        const base::hash_func_t *hashs,
+                                        size_t n_hashs) {
+    const uint64_t n_bits = bits.size() / 4 * 32;
+    if (n_bits == 0) {
+        return true;
+    }
+    const uint32_t *buckets = reinterpret_cast<const uint32_t *>(bits.data());
+    for (size_t i = 0; i < n_hashs; ++i) {
+        uint64_t j = hashs[i](key.data(), key.size()) % n_bits;
+        if (!(buckets[j / 32] & (1u << (j % 32)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /*virtual*/ size_t KeyBloomFilter::ApproximateCount() const {
     size_t count = 0;
     for (size_t i = 0; i < n_buckets_; ++i) {
@@ -20,6 +20,10 @@ public:
     virtual size_t ApproximateCount() const override;
     virtual size_t memory_usage() const override;
     
+    // Test key in the filter bits directly, the bits will not be copied.
+    static bool MayMatch(std::string_view bits, std::string_view key,
+                         const base::hash_func_t *hashs, size_t n_hashs);
+    
     uint64_t n_bits() const { return n_buckets_ * 32; }
     uint64_t n_bytes() const { return n_buckets_ * 4; }
 private:
@@ -0,0 +1,179 @@
+#include "table/readahead-file.h"
+#include "base/thread-pool.h"
+#include "mai/env.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace mai {
+
+namespace table {
+
+class ReadaheadFileTest : public ::testing::Test {
+public:
+    static constexpr int kBlockSize = 3000; // Not aligned to readahead size.
+    static constexpr int kNumBlocks = 1000;
+
+    class CountingFile : public RandomAccessFile {
+    public:
+        explicit CountingFile(RandomAccessFile *file) : file_(file) {}
+
+        virtual Error Read(uint64_t offset, size_t n, std::string_view *result,
+                           std::string *scratch) override {
+            n_reads_.fetch_add(1);
+            return file_->Read(offset, n, result, scratch);
+        }
+
+        virtual Error GetFileSize(uint64_t *size) override {
+            return file_->GetFileSize(size);
+        }
+
+        int n_reads() const { return n_reads_.load(); }
+
+    private:
+        RandomAccessFile *file_;
+        std::atomic<int> n_reads_ = 0;
+    }; // class CountingFile
+
+    void SetUp() override {
+        std::unique_ptr<WritableFile> file;
+        Error rs = env_->NewWritableFile(kFileName, false, &file);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+
+        for (int i = 0; i < kNumBlocks; ++i) {
+            rs = file->Append(Block(i));
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+        file.reset();
+        rs = env_->NewRandomAccessFile(kFileName, &file_, false);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        counting_.reset(new CountingFile(file_.get()));
+    }
+
+    void TearDown() override {
+        counting_.reset();
+        file_.reset();
+        env_->DeleteFile(kFileName, false);
+    }
+
+    static std::string Block(int i) {
+        std::string block(kBlockSize, 'a' + (i % 26));
+        block[0] = static_cast<char>(i);
+        return block;
+    }
+
+    void ScanAll(ReadaheadFile *file, int begin) {
+        std::string scratch;
+        std::string_view result;
+        for (int i = begin; i < kNumBlocks; ++i) {
+            Error rs = file->Read(i * kBlockSize, kBlockSize, &result, &scratch);
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+            ASSERT_EQ(Block(i), result) << i;
+        }
+    }
+
+    static const char kFileName[];
+
+    Env *env_ = Env::Default();
+    std::unique_ptr<RandomAccessFile> file_;
+    std::unique_ptr<CountingFile> counting_;
+}; // class ReadaheadFileTest
+
+const char ReadaheadFileTest::kFileName[] = "tests/32-readahead-file.tmp";
+
+TEST_F(ReadaheadFileTest, SequentialReads) {
+    ReadaheadFile file(counting_.get(), 64 * base::kKB, nullptr);
+    ASSERT_EQ(8 * base::kKB, file.readahead_size());
+
+    ScanAll(&file, 0);
+    ASSERT_EQ(64 * base::kKB, file.readahead_size());
+    // 3MB be read by about 64KB ranges.
+    ASSERT_LT(counting_->n_reads(), 60);
+}
+
+TEST_F(ReadaheadFileTest, AsyncSequentialReads) {
+    base::ThreadPool pool(2);
+    ReadaheadFile file(counting_.get(), 64 * base::kKB, &pool);
+    ScanAll(&file, 100);
+    ASSERT_LT(counting_->n_reads(), 60);
+
+    // Restart scan.
+    ScanAll(&file, 0);
+    ASSERT_LT(counting_->n_reads(), 120);
+}
+
+TEST_F(ReadaheadFileTest, AsyncReadsInBusyPool) {
+    base::ThreadPool pool(2);
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool release = false;
+    for (int i = 0; i < pool.n_threads(); ++i) {
+        pool.Schedule(base::ThreadPool::kHigh, [&] () {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] () { return release; });
+        });
+    }
+
+    // All threads be busy, the queued readahead be taken back.
+    {
+        ReadaheadFile file(counting_.get(), 64 * base::kKB, &pool);
+        ScanAll(&file, 0);
+    }
+    ASSERT_LT(counting_->n_reads(), 60);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    pool.Shutdown();
+}
+
+TEST_F(ReadaheadFileTest, TouchCachedBlocks) {
+    ReadaheadFile file(counting_.get(), 64 * base::kKB, nullptr);
+    std::string scratch;
+    std::string_view result;
+    for (int i = 0; i < kNumBlocks; ++i) {
+        if (i % 2 == 0) {
+            // Got from block cache.
+            file.Touch(i * kBlockSize, kBlockSize);
+            continue;
+        }
+        Error rs = file.Read(i * kBlockSize, kBlockSize, &result, &scratch);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ(Block(i), result) << i;
+    }
+    ASSERT_EQ(64 * base::kKB, file.readahead_size());
+    ASSERT_LT(counting_->n_reads(), 60);
+
+    // Non-sequential access resets readahead.
+    file.Touch(0, kBlockSize);
+    ASSERT_EQ(8 * base::kKB, file.readahead_size());
+}
+
+TEST_F(ReadaheadFileTest, RandomReads) {
+    base::ThreadPool pool(2);
+    ReadaheadFile file(counting_.get(), 64 * base::kKB, &pool);
+    std::string scratch;
+    std::string_view result;
+    for (int i = 0; i < 100; ++i) {
+        int k = (i * 7) % kNumBlocks;
+        Error rs = file.Read(k * kBlockSize, kBlockSize, &result, &scratch);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ(Block(k), result);
+    }
+    ASSERT_EQ(100, counting_->n_reads());
+    ASSERT_EQ(8 * base::kKB, file.readahead_size());
+}
+
+TEST_F(ReadaheadFileTest, NoReadahead) {
+    base::ThreadPool pool(2);
+    ReadaheadFile file(counting_.get(), 0, &pool);
+    ScanAll(&file, 0);
+    ASSERT_EQ(kNumBlocks, counting_->n_reads());
+}
+
+} // namespace table
+
+} // namespace mai
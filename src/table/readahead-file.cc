@@ -0,0 +1,157 @@
+#include "table/readahead-file.h"
+#include "base/thread-pool.h"
+#include "glog/logging.h"
+#include <algorithm>
+#include <limits>
+
+namespace mai {
+
+namespace table {
+
+ReadaheadFile::ReadaheadFile(RandomAccessFile *file, size_t max_readahead_size,
+                             base::ThreadPool *pool)
+    : file_(DCHECK_NOTNULL(file))
+    , max_readahead_size_(max_readahead_size)
+    , pool_(pool)
+    , readahead_size_(std::min(kInitialReadaheadSize, max_readahead_size))
+    , last_end_(std::numeric_limits<uint64_t>::max())
+    , buf_(&buffers_[0])
+    , async_buf_(&buffers_[1])
+    , async_state_(pool ? new AsyncState : nullptr) {
+}
+
+/*virtual*/ ReadaheadFile::~ReadaheadFile() {
+    WaitAsync(true);
+}
+
+/*virtual*/ Error ReadaheadFile::Read(uint64_t offset, size_t n,
+                                      std::string_view *result,
+                                      std::string *scratch) {
+    const bool sequential = (offset == last_end_);
+    last_end_ = offset + n;
+    if (!sequential || max_readahead_size_ == 0) {
+        // The readahead data is useless for random reads.
+        Reset();
+        return file_->Read(offset, n, result, scratch);
+    }
+
+    scratch->clear();
+    size_t copied = CopyFrom(*buf_, offset, n, scratch);
+    if (copied < n) {
+        WaitAsync();
+        size_t k = async_buf_->rs.ok() ?
+                   CopyFrom(*async_buf_, offset + copied, n - copied, scratch) : 0;
+        if (k > 0) {
+            copied += k;
+            std::swap(buf_, async_buf_);
+        }
+        async_buf_->Reset(0, 0);
+
+        if (copied < n) {
+            const uint64_t pos = offset + copied;
+            const size_t size = std::max(n - copied, NextReadaheadSize());
+            buf_->Reset(pos, size);
+            buf_->rs = file_->Read(pos, size, &buf_->data, &buf_->scratch);
+            if (!buf_->rs) {
+                Error rs = buf_->rs;
+                buf_->Reset(0, 0);
+                return rs;
+            }
+            copied += CopyFrom(*buf_, pos, n - copied, scratch);
+        }
+        if (pool_ && !buf_->eof()) {
+            ReadaheadAsync(buf_->end(), NextReadaheadSize());
+        }
+    }
+    *result = std::string_view(scratch->data(), copied);
+    return Error::OK();
+}
+
+void ReadaheadFile::Touch(uint64_t offset, size_t n) {
+    if (offset + n == last_end_) {
+        return; // Just be read by Read().
+    }
+    if (offset != last_end_) {
+        Reset();
+    }
+    last_end_ = offset + n;
+}
+
+/*static*/ size_t ReadaheadFile::CopyFrom(const Buffer &buf, uint64_t offset,
+                                          size_t n, std::string *dest) {
+    if (offset < buf.offset || offset >= buf.end()) {
+        return 0;
+    }
+    const size_t k = static_cast<size_t>(std::min<uint64_t>(n, buf.end() - offset));
+    dest->append(buf.data.data() + (offset - buf.offset), k);
+    return k;
+}
+
+size_t ReadaheadFile::NextReadaheadSize() {
+    size_t size = readahead_size_;
+    readahead_size_ = std::min(readahead_size_ * 2, max_readahead_size_);
+    return size;
+}
+
+void ReadaheadFile::Reset() {
+    WaitAsync(true);
+    buf_->Reset(0, 0);
+    async_buf_->Reset(0, 0);
+    readahead_size_ = std::min(kInitialReadaheadSize, max_readahead_size_);
+}
+
+void ReadaheadFile::ReadaheadAsync(uint64_t offset, size_t n) {
+    DCHECK(!async_pending_);
+    async_buf_->Reset(offset, n);
+    async_pending_ = true;
+    
+    uint64_t sequence;
+    {
+        std::unique_lock<std::mutex> lock(async_state_->mutex);
+        sequence = ++async_state_->sequence;
+        async_state_->queued = true;
+    }
+    pool_->Schedule(base::ThreadPool::kHigh,
+                    [state = async_state_, sequence, file = file_,
+                     buf = async_buf_] () {
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            if (!state->queued || state->sequence != sequence) {
+                return; // Has been taken back by the owner.
+            }
+            state->queued  = false;
+            state->running = true;
+        }
+        buf->rs = file->Read(buf->offset, buf->requested, &buf->data,
+                             &buf->scratch);
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->running = false;
+        state->cv.notify_one();
+    });
+}
+
+void ReadaheadFile::WaitAsync(bool cancel) {
+    if (!async_pending_) {
+        return;
+    }
+    async_pending_ = false;
+    
+    std::unique_lock<std::mutex> lock(async_state_->mutex);
+    if (async_state_->queued) {
+        // Not started yet, don't wait for the busy pool.
+        async_state_->queued = false;
+        lock.unlock();
+        if (!cancel) {
+            async_buf_->rs = file_->Read(async_buf_->offset,
+                                         async_buf_->requested,
+                                         &async_buf_->data,
+                                         &async_buf_->scratch);
+        }
+        return;
+    }
+    async_state_->cv.wait(lock, [this] () { return !async_state_->running; });
+}
+
+} // namespace table
+
+} // namespace mai
@@ -0,0 +1,120 @@
+#ifndef MAI_TABLE_READAHEAD_FILE_H_
+#define MAI_TABLE_READAHEAD_FILE_H_
+
+#include "base/base.h"
+#include "mai/env.h"
+#include "mai/error.h"
+#include <condition_variable>
+#include <mutex>
+#include <memory>
+#include <string>
+
+namespace mai {
+namespace base {
+class ThreadPool;
+} // namespace base
+namespace table {
+
+// Readahead for the sequential scan of one iterator.
+//
+// A read is sequential if its offset is the end of the last read. Only the
+// sequential reads be served by the readahead buffer, others be passed to the
+// file directly. The readahead size starts from kInitialReadaheadSize, and be
+// doubled on every readahead until max_readahead_size, a random read resets
+// it. The blocks got from block cache never be read from this file, call
+// Touch() for them, so they don't break the sequential reading.
+//
+// If pool is not null, the next range be read by the pool after the current
+// range be read, so the scanning thread can process the blocks of current
+// range during disk reading.
+//
+// Not thread safe, every iterator has its own one.
+class ReadaheadFile final : public RandomAccessFile {
+public:
+    static constexpr size_t kInitialReadaheadSize = 8 * base::kKB;
+
+    ReadaheadFile(RandomAccessFile *file, size_t max_readahead_size,
+                  base::ThreadPool *pool);
+    virtual ~ReadaheadFile() override;
+
+    DEF_VAL_GETTER(size_t, max_readahead_size);
+    DEF_VAL_GETTER(size_t, readahead_size);
+
+    virtual Error Read(uint64_t offset, size_t n, std::string_view *result,
+                       std::string *scratch) override;
+
+    virtual Error GetFileSize(uint64_t *size) override {
+        return file_->GetFileSize(size);
+    }
+
+    // The range [offset, offset + n) be accessed without reading this file.
+    // Only a non-sequential access resets the readahead.
+    void Touch(uint64_t offset, size_t n);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ReadaheadFile);
+private:
+    struct Buffer {
+        uint64_t offset = 0;
+        size_t requested = 0;
+        std::string_view data;
+        std::string scratch;
+        Error rs;
+
+        uint64_t end() const { return offset + data.size(); }
+
+        // Got less bytes than requested: it reached the end of file.
+        bool eof() const { return data.size() < requested; }
+
+        void Reset(uint64_t pos, size_t n) {
+            offset = pos;
+            requested = n;
+            data = std::string_view();
+            rs = Error::OK();
+        }
+    }; // struct Buffer
+
+    // Shared with the background job, the job may be run after this file
+    // be destroyed.
+    struct AsyncState {
+        std::mutex mutex;
+        std::condition_variable cv;
+        uint64_t sequence = 0; // Sequence of the last scheduled job
+        bool queued = false;   // The job of sequence is not taken yet
+        bool running = false;
+    }; // struct AsyncState
+
+    // Append bytes of [offset, offset + n) in buf to dest, from offset.
+    // Return number of appended bytes.
+    static size_t CopyFrom(const Buffer &buf, uint64_t offset, size_t n,
+                           std::string *dest);
+
+    // Get size of next readahead and grow it.
+    size_t NextReadaheadSize();
+
+    // Drop all readahead data and shrink the readahead size.
+    void Reset();
+
+    void ReadaheadAsync(uint64_t offset, size_t n);
+
+    // If the job is still in queue, take it back and read in this thread,
+    // otherwise wait for it done. The data is not needed if cancel is true,
+    // the job in queue only be taken back.
+    void WaitAsync(bool cancel = false);
+
+    RandomAccessFile *const file_;
+    const size_t max_readahead_size_;
+    base::ThreadPool *const pool_;
+    size_t readahead_size_;
+    uint64_t last_end_; // End of last read, for detecting sequential reads.
+    Buffer buffers_[2];
+    Buffer *buf_; // Current range
+    Buffer *async_buf_; // Next range, owns by background job if pending.
+    bool async_pending_ = false;
+    std::shared_ptr<AsyncState> async_state_;
+}; // class ReadaheadFile
+
+} // namespace table
+
+} // namespace mai
+
+#endif // MAI_TABLE_READAHEAD_FILE_H_
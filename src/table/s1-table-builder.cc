@@ -7,6 +7,7 @@
 #include "base/hash.h"
 #include "mai/env.h"
 #include "glog/logging.h"
+#include <chrono>
 
 namespace mai {
     
@@ -17,18 +18,21 @@ namespace table {
 S1TableBuilder::S1TableBuilder(const core::InternalKeyComparator *ikcmp,
                              WritableFile *file,
                              size_t max_hash_slots, uint32_t block_size,
-                             size_t approximated_n_entries)
+                             size_t approximated_n_entries,
+                             CompressionType compression)
     : ikcmp_(DCHECK_NOTNULL(ikcmp))
     , writer_(DCHECK_NOTNULL(file))
     , max_buckets_(max_hash_slots)
     , block_size_(block_size)
     , approximated_n_entries_(approximated_n_entries)
+    , compression_(compression)
     , buckets_(new std::vector<Index>[max_hash_slots]) {
     DCHECK_GE(block_size_, 512);
     DCHECK_EQ(0, block_size_ % 4);
 
     props_.block_size = static_cast<uint32_t>(block_size_);
     props_.unordered  = true;
+    props_.compression = compression_;
 }
 
 /*virtual*/ S1TableBuilder::~S1TableBuilder() {
@@ -149,6 +153,7 @@ void S1TableBuilder::Add(std::string_view key, std::string_view value) {
     props_ = TableProperties{};
     props_.block_size = static_cast<uint32_t>(block_size_);
     props_.unordered = true;
+    props_.compression = compression_;
     
     error_ = Error::OK();
     has_seen_first_key_ = false;
@@ -208,7 +213,19 @@ BlockHandle S1TableBuilder::FlushBlock() {
     DCHECK(!unbound_index_.empty());
 
     std::string_view block = block_builder_->Finish();
-    BlockHandle bh = WriteBlock(block);
+    BlockHandle bh;
+    if (compression_ == kNoCompression) {
+        bh = WriteBlock(block);
+    } else {
+        auto start = std::chrono::steady_clock::now();
+        Table::CompressBlock(block, compression_, &compressed_);
+        auto cost = std::chrono::steady_clock::now() - start;
+        props_.compression_micros +=
+            std::chrono::duration_cast<std::chrono::microseconds>(cost).count();
+        props_.raw_data_size        += block.size();
+        props_.compressed_data_size += compressed_.size();
+        bh = WriteBlock(compressed_);
+    }
     if (error_.fail()) {
         return BlockHandle{};
     }
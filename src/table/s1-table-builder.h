@@ -22,7 +22,8 @@ class S1TableBuilder final : public TableBuilder {
 public:
     S1TableBuilder(const core::InternalKeyComparator *ikcmp, WritableFile *file,
                   size_t max_hash_slots, uint32_t block_size,
-                  size_t approximated_n_entries = 0);
+                  size_t approximated_n_entries = 0,
+                  CompressionType compression = kNoCompression);
     virtual ~S1TableBuilder() override;
     virtual void Add(std::string_view key, std::string_view value) override;
     virtual Error error() override;
@@ -50,6 +51,7 @@ private:
     const size_t max_buckets_;
     const uint64_t block_size_;
     const uint64_t approximated_n_entries_;
+    const CompressionType compression_;
     
     Error error_;
     bool has_seen_first_key_ = false;
@@ -61,6 +63,7 @@ private:
     std::unique_ptr<FilterBlockBuilder> filter_builder_;
     std::set<uint64_t> unbound_index_;
     std::vector<BlockHandle> block_map_;
+    std::string compressed_; // Buffer for compressed block.
 }; // class S1TableReader
     
 } // namespace table
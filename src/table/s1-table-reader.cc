@@ -21,6 +21,10 @@ using ::mai::core::KeyBoundle;
 using ::mai::core::ParsedTaggedKey;
 using ::mai::base::Slice;
 
+static void LRUHandleCleanup(void *arg0, void */*arg1*/) {
+    static_cast<core::LRUHandle *>(arg0)->ReleaseRef();
+}
+    
 #define TRY_RUN0(expr) \
     (expr); \
     if (!reader.error()) { \
@@ -343,6 +347,21 @@ S1TableReader::NewIterator(const ReadOptions &read_opts,
                   core::Tag *tag,
                   std::string_view *value,
                   std::string *scratch) {
+    PinnableValue pinned;
+    Error rs = Get(read_opts, ikcmp, key, tag, &pinned);
+    if (!rs) {
+        return rs;
+    }
+    scratch->assign(pinned.data(), pinned.size());
+    *value = *scratch;
+    return Error::OK();
+}
+    
+/*virtual*/ Error S1TableReader::Get(const ReadOptions &read_opts,
+                                     const core::InternalKeyComparator *ikcmp,
+                                     std::string_view key,
+                                     core::Tag *tag,
+                                     PinnableValue *value) {
     if (!has_initialized_) {
         return MAI_CORRUPTION("Not prepare yet.");
     }
@@ -387,7 +406,11 @@ S1TableReader::NewIterator(const ReadOptions &read_opts,
             }
         }
         if (found) {
-            ReadValue(buf, value, scratch);
+            // Value points to the block, so pin the block by value.
+            base::BufferReader rd(buf);
+            std::string_view data = rd.ReadString(rd.ReadVarint64());
+            handle->AddRef();
+            value->Pin(data, LRUHandleCleanup, handle.get());
             break;
         }
     }
@@ -473,14 +496,16 @@ Error S1TableReader::PrepareRead(const Index &idx, const ReadOptions &read_opts,
     
     const auto &bh = block_map_[idx.block_idx];
     Error rs = cache_->GetOrLoad(file_, file_number_, bh.offset(), bh.size(),
-                                 read_opts.verify_checksums, handle);
+                                 table_props_->compression != kNoCompression,
+                                 read_opts.verify_checksums,
+                                 read_opts.fill_cache, handle);
     if (!rs) {
         return rs;
     }
 
-    // Ignore crc32 checksum
-    *buf = std::string_view(static_cast<char *>(handle->get()->value) + idx.offset,
-                            bh.size() - 4 - idx.offset);
+    std::string_view block = BlockCache::GetBlock(handle->get());
+    DCHECK_LE(idx.offset, block.size());
+    *buf = block.substr(idx.offset);
     return Error::OK();
 }
     
@@ -28,6 +28,11 @@ public:
                       core::Tag *tag,
                       std::string_view *value,
                       std::string *scratch) override;
+    virtual Error Get(const ReadOptions &read_opts,
+                      const core::InternalKeyComparator *ikcmp,
+                      std::string_view key,
+                      core::Tag *tag,
+                      PinnableValue *value) override;
     virtual size_t ApproximateMemoryUsage() const override;
     virtual base::intrusive_ptr<TablePropsBoundle> GetTableProperties() const override;
     virtual base::intrusive_ptr<core::KeyFilter> GetKeyFilter() const override;
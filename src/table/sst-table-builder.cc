@@ -1,29 +1,108 @@
 #include "table/sst-table-builder.h"
 #include "table/data-block-builder.h"
 #include "table/filter-block-builder.h"
+#include "table/blocked-bloom-filter.h"
 #include "core/key-boundle.h"
 #include "core/internal-key-comparator.h"
 #include "mai/env.h"
+#include "mai/prefix-extractor.h"
 #include "glog/logging.h"
+#include <chrono>
 
 namespace mai {
     
 namespace table {
     
+// The keys be added to filter later, the same keys only be added once.
+class SstTableBuilder::FilterKeys final {
+public:
+    FilterKeys(FilterFormat format) : format_(format) {}
+    
+    void Add(std::string_view key) {
+        if (size() > 0 && last_key_.compare(key) == 0) {
+            return;
+        }
+        last_key_.assign(key.data(), key.size());
+        if (format_ == kBlockedBloomFilter) {
+            hash_vals_.push_back(BlockedBloomFilter::Hash(key));
+        } else {
+            keys_.push_back(last_key_);
+        }
+    }
+    
+    size_t size() const {
+        return format_ == kBlockedBloomFilter ? hash_vals_.size() : keys_.size();
+    }
+    
+    size_t ApproximateFilterSize() const {
+        if (format_ == kBlockedBloomFilter) {
+            return BlockedBloomFilter::ComputeSize(size());
+        }
+        return FilterBlockBuilder::ComputeBoomFilterSize(size(), 4,
+                    base::Hash::kNumberBloomFilterHashs);
+    }
+    
+    // Build filter bits, then clear all keys.
+    void Finish(std::string *buf) {
+        if (format_ == kBlockedBloomFilter) {
+            buf->assign(BlockedBloomFilter::ComputeSize(size()), 0);
+            for (uint64_t hash_val : hash_vals_) {
+                BlockedBloomFilter::AddHash(hash_val, &(*buf)[0], buf->size());
+            }
+        } else {
+            FilterBlockBuilder builder(ApproximateFilterSize(),
+                                       base::Hash::kBloomFilterHashs,
+                                       base::Hash::kNumberBloomFilterHashs);
+            for (const auto &key : keys_) {
+                builder.AddKey(key);
+            }
+            std::string_view bits = builder.Finish();
+            buf->assign(bits.data(), bits.size());
+        }
+        Clear();
+    }
+    
+    void Clear() {
+        keys_.clear();
+        hash_vals_.clear();
+        last_key_.clear();
+    }
+    
+    DISALLOW_IMPLICIT_CONSTRUCTORS(FilterKeys);
+private:
+    const FilterFormat format_;
+    std::string last_key_;
+    std::vector<std::string> keys_; // For legacy format.
+    std::vector<uint64_t> hash_vals_; // For blocked format.
+}; // class SstTableBuilder::FilterKeys
+    
 SstTableBuilder::SstTableBuilder(const core::InternalKeyComparator *ikcmp,
                                  WritableFile *file, uint64_t block_size,
-                                 int n_restart, size_t approximated_n_entries)
+                                 int n_restart, size_t approximated_n_entries,
+                                 const PrefixExtractor *prefix_extractor,
+                                 size_t filter_partition_size,
+                                 bool blocked_filter,
+                                 CompressionType compression)
     : ikcmp_(DCHECK_NOTNULL(ikcmp))
     , writer_(DCHECK_NOTNULL(file))
     , block_size_(block_size)
     , n_restart_(n_restart)
-    , approximated_n_entries_(approximated_n_entries) {
+    , approximated_n_entries_(approximated_n_entries)
+    , prefix_extractor_(prefix_extractor)
+    , filter_partition_size_(filter_partition_size)
+    , filter_format_(blocked_filter ? kBlockedBloomFilter : kLegacyBloomFilter)
+    , compression_(compression)
+    , filter_keys_(new FilterKeys(filter_format_))
+    , prefixes_(new FilterKeys(filter_format_)) {
     DCHECK_GT(n_restart_, 1);
     DCHECK_GE(block_size_, 512);
     DCHECK_EQ(0, block_size_ % 4);
         
     props_.block_size = static_cast<uint32_t>(block_size_);
     props_.unordered  = false;
+    props_.partitioned_filter = is_partitioned_filter();
+    props_.filter_format = filter_format_;
+    props_.compression = compression_;
 }
 
 /*virtual*/ SstTableBuilder::~SstTableBuilder() {}
@@ -40,7 +119,11 @@ void SstTableBuilder::Add(std::string_view key, std::string_view value) {
     if (!index_builder_) {
         index_builder_.reset(new DataBlockBuilder(n_restart_));
     }
-    if (!filter_builder_) {
+    if (is_partitioned_filter()) {
+        if (!filter_index_builder_) {
+            filter_index_builder_.reset(new DataBlockBuilder(n_restart_));
+        }
+    } else if (!is_blocked_filter() && !filter_builder_) {
         size_t bloom_filter_size =
             FilterBlockBuilder::ComputeBoomFilterSize(approximated_n_entries_,
                                                       block_size_,
@@ -69,18 +152,33 @@ void SstTableBuilder::Add(std::string_view key, std::string_view value) {
     } else {
         block_builder_->Add(key, value);
     }
-    filter_builder_->AddKey(ikey.user_key);
+    if (filter_builder_) {
+        filter_builder_->AddKey(ikey.user_key);
+    } else {
+        filter_keys_->Add(ikey.user_key);
+    }
+    if (prefix_extractor_ && prefix_extractor_->InDomain(ikey.user_key)) {
+        prefixes_->Add(prefix_extractor_->Extract(ikey.user_key));
+    }
     
     if (block_builder_->CurrentSizeEstimate() >= block_size_) {
         std::string_view block = block_builder_->Finish();
-        BlockHandle handle = WriteBlock(block);
+        BlockHandle handle = WriteDataBlock(block);
         if (error_.fail()) {
             return;
         }
-        std::string buf;
-        handle.Encode(&buf);
-        index_builder_->Add(block_builder_->last_key(), buf);
+        AddIndex(handle);
         block_builder_->Reset();
+        
+        // Partitions are cut by data blocks, so the index of partitions has
+        // the same keys as data blocks index.
+        if (is_partitioned_filter() &&
+            filter_keys_->ApproximateFilterSize() >= filter_partition_size_) {
+            WriteFilterPartition();
+            if (error_.fail()) {
+                return;
+            }
+        }
     }
 
     if (ikcmp_->Compare(key, props_.smallest_key) < 0) {
@@ -104,13 +202,17 @@ void SstTableBuilder::Add(std::string_view key, std::string_view value) {
     if (block_builder_) {
         std::string_view last_block = block_builder_->Finish();
         if (!last_block.empty()) {
-            BlockHandle handle = WriteBlock(last_block);
+            BlockHandle handle = WriteDataBlock(last_block);
             if (error_.fail()) {
                 return error_;
             }
-            std::string buf;
-            handle.Encode(&buf);
-            index_builder_->Add(block_builder_->last_key(), buf);
+            AddIndex(handle);
+        }
+    }
+    if (is_partitioned_filter() && filter_keys_->size() > 0) {
+        WriteFilterPartition();
+        if (error_.fail()) {
+            return error_;
         }
     }
     
@@ -119,12 +221,17 @@ void SstTableBuilder::Add(std::string_view key, std::string_view value) {
         return error_;
     }
     
+    BlockHandle prefix_filter = WritePrefixFilter();
+    if (error_.fail()) {
+        return error_;
+    }
+    
     BlockHandle index = WriteIndexs();
     if (error_.fail()) {
         return error_;
     }
     
-    BlockHandle props = WriteProperties(index, filter);
+    BlockHandle props = WriteProperties(index, filter, prefix_filter);
     if (error_.fail()) {
         return error_;
     }
@@ -151,10 +258,17 @@ void SstTableBuilder::Add(std::string_view key, std::string_view value) {
     block_builder_.reset();
     filter_builder_.reset();
     index_builder_.reset();
+    filter_index_builder_.reset();
+    last_block_key_.clear();
+    filter_keys_->Clear();
+    prefixes_->Clear();
     
     props_ = TableProperties{};
     props_.block_size = static_cast<uint32_t>(block_size_);
     props_.unordered = false;
+    props_.partitioned_filter = is_partitioned_filter();
+    props_.filter_format = filter_format_;
+    props_.compression = compression_;
     
     has_seen_first_key_ = false;
     is_last_level_ = false;
@@ -193,9 +307,61 @@ BlockHandle SstTableBuilder::WriteBlock(std::string_view block) {
     return handle;
 }
     
+BlockHandle SstTableBuilder::WriteDataBlock(std::string_view block) {
+    using namespace std::chrono;
+    
+    if (compression_ == kNoCompression) {
+        return WriteBlock(block);
+    }
+    auto start = steady_clock::now();
+    Table::CompressBlock(block, compression_, &compressed_);
+    auto cost = duration_cast<microseconds>(steady_clock::now() - start);
+    props_.compression_micros   += cost.count();
+    props_.raw_data_size        += block.size();
+    props_.compressed_data_size += compressed_.size();
+    return WriteBlock(compressed_);
+}
+    
+void SstTableBuilder::AddIndex(BlockHandle handle) {
+    std::string buf;
+    handle.Encode(&buf);
+    last_block_key_ = block_builder_->last_key();
+    index_builder_->Add(last_block_key_, buf);
+}
+    
+void SstTableBuilder::WriteFilterPartition() {
+    DCHECK(is_partitioned_filter());
+    std::string bits;
+    filter_keys_->Finish(&bits);
+    BlockHandle handle = WriteBlock(bits);
+    if (error_.fail()) {
+        return;
+    }
+    std::string buf;
+    handle.Encode(&buf);
+    // The key of partition is the last key of its last data block.
+    filter_index_builder_->Add(last_block_key_, buf);
+}
+    
 BlockHandle SstTableBuilder::WriteFilter() {
-    std::string_view block = filter_builder_->Finish();
-    return WriteBlock(block);
+    if (is_partitioned_filter()) {
+        return WriteBlock(filter_index_builder_->Finish());
+    }
+    if (is_blocked_filter()) {
+        std::string bits;
+        filter_keys_->Finish(&bits);
+        return WriteBlock(bits);
+    }
+    return WriteBlock(filter_builder_->Finish());
+}
+    
+BlockHandle SstTableBuilder::WritePrefixFilter() {
+    if (!prefix_extractor_) {
+        return BlockHandle{};
+    }
+    std::string bits;
+    prefixes_->Finish(&bits);
+    return WriteBlock(bits);
 }
     
 BlockHandle SstTableBuilder::WriteIndexs() {
@@ -203,12 +369,19 @@ BlockHandle SstTableBuilder::WriteIndexs() {
     return WriteBlock(block);
 }
 
-BlockHandle SstTableBuilder::WriteProperties(BlockHandle indexs, BlockHandle filter) {
+BlockHandle SstTableBuilder::WriteProperties(BlockHandle indexs, BlockHandle filter,
+                                             BlockHandle prefix_filter) {
     props_.index_position  = indexs.offset();
     props_.index_size      = indexs.size();
 
     props_.filter_position = filter.offset();
     props_.filter_size     = filter.size();
+    
+    if (prefix_extractor_) {
+        props_.prefix_filter_position = prefix_filter.offset();
+        props_.prefix_filter_size     = prefix_filter.size();
+        props_.prefix_extractor       = prefix_extractor_->Name();
+    }
 
     std::string block;
     Table::WriteProperties(props_, &block);
@@ -8,6 +8,7 @@
 
 namespace mai {
 class WritableFile;
+class PrefixExtractor;
 namespace core {
 class InternalKeyComparator;
 } // namespace core
@@ -17,9 +18,16 @@ class FilterBlockBuilder;
     
 class SstTableBuilder final : public TableBuilder {
 public:
+    // filter_partition_size: 0 means one whole key filter.
+    // blocked_filter: Use cache line blocked bloom filter format.
+    // compression: The compression type of data blocks.
     SstTableBuilder(const core::InternalKeyComparator *ikcmp, WritableFile *file,
                     uint64_t block_size, int n_restart,
-                    size_t approximated_n_entries = 0);
+                    size_t approximated_n_entries = 0,
+                    const PrefixExtractor *prefix_extractor = nullptr,
+                    size_t filter_partition_size = 0,
+                    bool blocked_filter = false,
+                    CompressionType compression = kNoCompression);
     virtual ~SstTableBuilder() override;
     virtual void Add(std::string_view key, std::string_view value) override;
     virtual Error error() override;
@@ -30,16 +38,30 @@ public:
     
     DISALLOW_IMPLICIT_CONSTRUCTORS(SstTableBuilder);
 private:
+    class FilterKeys;
+    
     BlockHandle WriteBlock(std::string_view block);
+    BlockHandle WriteDataBlock(std::string_view block);
+    void AddIndex(BlockHandle handle);
+    void WriteFilterPartition();
     BlockHandle WriteFilter();
+    BlockHandle WritePrefixFilter();
     BlockHandle WriteIndexs();
-    BlockHandle WriteProperties(BlockHandle indexs, BlockHandle filter);
+    BlockHandle WriteProperties(BlockHandle indexs, BlockHandle filter,
+                                BlockHandle prefix_filter);
+    
+    bool is_partitioned_filter() const { return filter_partition_size_ > 0; }
+    bool is_blocked_filter() const { return filter_format_ == kBlockedBloomFilter; }
     
     const core::InternalKeyComparator *const ikcmp_;
     base::FileWriter writer_;
     const uint64_t block_size_;
     const int n_restart_;
     const size_t approximated_n_entries_;
+    const PrefixExtractor *const prefix_extractor_;
+    const size_t filter_partition_size_;
+    const FilterFormat filter_format_;
+    const CompressionType compression_;
     
     Error error_;
     bool has_seen_first_key_ = false;
@@ -48,6 +70,12 @@ private:
     std::unique_ptr<DataBlockBuilder> block_builder_;
     std::unique_ptr<DataBlockBuilder> index_builder_;
     std::unique_ptr<FilterBlockBuilder> filter_builder_;
+    std::unique_ptr<DataBlockBuilder> filter_index_builder_;
+    std::string last_block_key_;
+    // Keys of current partition or whole blocked filter.
+    std::unique_ptr<FilterKeys> filter_keys_;
+    std::unique_ptr<FilterKeys> prefixes_;
+    std::string compressed_; // Buffer for compressed block.
 }; // class SSTTableBuilder
     
 } // namespace table
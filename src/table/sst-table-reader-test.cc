@@ -2,7 +2,10 @@
 #include "table/sst-table-builder.h"
 #include "core/key-boundle.h"
 #include "core/key-filter.h"
+#include "base/thread-pool.h"
 #include "mai/iterator.h"
+#include "mai/options.h"
+#include "mai/prefix-extractor.h"
 #include "test/table-test.h"
 #include <map>
 
@@ -46,6 +49,13 @@ const char *SstTableReaderTest::tmp_dirs[] = {
     "tests/13-sst-table-reader-get.tmp",
     "tests/22-sst-table-reader-seq-iter.tmp",
     "tests/23-sst-table-reader-res-iter.tmp",
+    "tests/24-sst-table-reader-seek-iter.tmp",
+    "tests/25-sst-table-reader-multi-get.tmp",
+    "tests/27-sst-table-reader-part-filter.tmp",
+    "tests/28-sst-table-reader-prefix-filter.tmp",
+    "tests/29-sst-table-reader-blocked-filter.tmp",
+    "tests/30-sst-table-reader-compression.tmp",
+    "tests/33-sst-table-reader-readahead.tmp",
     nullptr,
 };
     
@@ -291,6 +301,348 @@ TEST_F(SstTableReaderTest, ReserveIterator) {
 }
 
     
+TEST_F(SstTableReaderTest, SeekIterator) {
+    static auto kFileName = tmp_dirs[5];
+    
+    std::map<std::string, std::string> kvs;
+    for (int i = 0; i < 1000; ++i) {
+        kvs[base::Sprintf("key.%d", i)] = base::Sprintf("value.%d", i);
+    }
+    std::vector<std::string> input;
+    for (const auto &pair : kvs) {
+        input.push_back(pair.first);
+        input.push_back(pair.second);
+        input.push_back("1");
+    }
+    BuildTable(input, kFileName, default_tb_factory_);
+    
+    std::unique_ptr<RandomAccessFile> file;
+    std::unique_ptr<TableReader> rd;
+    NewReader(kFileName, &file, &rd, default_tr_factory_);
+    Error rs = down_cast<SstTableReader>(rd.get())->Prepare();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    for (auto iter = kvs.begin(); iter != kvs.end(); ++iter) {
+        std::unique_ptr<Iterator> it(rd->NewIterator(ReadOptions{}, &ikcmp_));
+        it->Seek(KeyBoundle::MakeKey(iter->first, Tag::kMaxSequenceNumber,
+                                     Tag::kFlagValueForSeek));
+        ASSERT_TRUE(it->Valid()) << iter->first;
+        
+        auto expected = iter;
+        for (int i = 0; i < 40 && expected != kvs.end(); ++i, ++expected) {
+            ASSERT_TRUE(it->Valid()) << expected->first;
+            ASSERT_EQ(expected->first, KeyBoundle::ExtractUserKey(it->key()));
+            ASSERT_EQ(expected->second, it->value());
+            it->Next();
+        }
+    }
+}
+    
+TEST_F(SstTableReaderTest, MultiGet) {
+    static auto kFileName = tmp_dirs[6];
+    
+    std::map<std::string, std::string> kvs;
+    for (int i = 0; i < 1000; i += 2) {
+        kvs[base::Sprintf("key.%04d", i)] = base::Sprintf("value.%d", i);
+    }
+    std::vector<std::string> input;
+    for (const auto &pair : kvs) {
+        input.push_back(pair.first);
+        input.push_back(pair.second);
+        input.push_back("1");
+    }
+    BuildTable(input, kFileName, default_tb_factory_);
+    
+    std::unique_ptr<RandomAccessFile> file;
+    std::unique_ptr<TableReader> rd;
+    NewReader(kFileName, &file, &rd, default_tr_factory_);
+    Error rs = down_cast<SstTableReader>(rd.get())->Prepare();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    std::vector<std::string> ikeys;
+    for (int i = 0; i < 1000; ++i) {
+        ikeys.push_back(KeyBoundle::MakeKey(base::Sprintf("key.%04d", i), 100,
+                                            Tag::kFlagValueForSeek));
+    }
+    std::vector<Tag> tags(ikeys.size());
+    std::vector<std::string> values(ikeys.size());
+    std::vector<GetSlot> slots;
+    for (size_t i = 0; i < ikeys.size(); ++i) {
+        slots.push_back({ikeys[i], &tags[i], &values[i], Error::OK()});
+    }
+    std::vector<GetSlot *> batch;
+    for (auto &slot : slots) {
+        batch.push_back(&slot);
+    }
+    rd->MultiGet(ReadOptions{}, &ikcmp_, batch);
+    
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 2) {
+            EXPECT_TRUE(slots[i].rs.IsNotFound()) << slots[i].rs.ToString();
+        } else {
+            ASSERT_TRUE(slots[i].rs.ok()) << slots[i].rs.ToString();
+            EXPECT_EQ(base::Sprintf("value.%d", i), values[i]);
+            EXPECT_EQ(1, tags[i].sequence_number());
+        }
+    }
+}
+    
+TEST_F(SstTableReaderTest, PartitionedFilter) {
+    static auto kFileName = tmp_dirs[7];
+    
+    std::map<std::string, std::string> kvs;
+    for (int i = 0; i < 1000; i += 2) {
+        kvs[base::Sprintf("key.%04d", i)] = base::Sprintf("value.%d", i);
+    }
+    std::vector<std::string> input;
+    for (const auto &pair : kvs) {
+        input.push_back(pair.first);
+        input.push_back(pair.second);
+        input.push_back("1");
+    }
+    BuildTable(input, kFileName,
+               [](const core::InternalKeyComparator *ikcmp, WritableFile *file) {
+        return new SstTableBuilder(ikcmp, file, 512, 3, 0, nullptr, 64);
+    });
+    
+    std::unique_ptr<RandomAccessFile> file;
+    std::unique_ptr<TableReader> rd;
+    NewReader(kFileName, &file, &rd, default_tr_factory_);
+    Error rs = down_cast<SstTableReader>(rd.get())->Prepare();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_TRUE(rd->GetTableProperties()->data().partitioned_filter);
+    // Partitioned filter is not resident.
+    ASSERT_TRUE(rd->GetKeyFilter().is_null());
+    
+    int n_false_positive = 0;
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = base::Sprintf("key.%04d", i);
+        if (i % 2) {
+            n_false_positive += rd->KeyMayExists(&ikcmp_, key) ? 1 : 0;
+        } else {
+            ASSERT_TRUE(rd->KeyMayExists(&ikcmp_, key)) << key;
+        }
+        
+        std::string_view value;
+        std::string scratch;
+        rs = rd->Get(ReadOptions{}, &ikcmp_,
+                     KeyBoundle::MakeKey(key, 100, Tag::kFlagValueForSeek),
+                     nullptr, &value, &scratch);
+        if (i % 2) {
+            ASSERT_TRUE(rs.IsNotFound()) << rs.ToString();
+        } else {
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+            ASSERT_EQ(base::Sprintf("value.%d", i), value);
+        }
+    }
+    ASSERT_LT(n_false_positive, 50);
+    ASSERT_FALSE(rd->KeyMayExists(&ikcmp_, "zzz"));
+}
+    
+TEST_F(SstTableReaderTest, BlockedFilter) {
+    static auto kFileName = tmp_dirs[9];
+    
+    std::vector<std::string> input;
+    for (int i = 0; i < 1000; i += 2) {
+        input.push_back(base::Sprintf("key.%04d", i));
+        input.push_back(base::Sprintf("value.%d", i));
+        input.push_back("1");
+    }
+    for (size_t partition_size : {0, 64}) {
+        BuildTable(input, kFileName,
+                   [partition_size](const core::InternalKeyComparator *ikcmp,
+                                    WritableFile *file) {
+            return new SstTableBuilder(ikcmp, file, 512, 3, 0, nullptr,
+                                       partition_size, true);
+        });
+        
+        std::unique_ptr<RandomAccessFile> file;
+        std::unique_ptr<TableReader> rd;
+        NewReader(kFileName, &file, &rd, default_tr_factory_);
+        Error rs = down_cast<SstTableReader>(rd.get())->Prepare();
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ(kBlockedBloomFilter,
+                  rd->GetTableProperties()->data().filter_format);
+        
+        std::vector<std::string> ikeys;
+        for (int i = 0; i < 1000; ++i) {
+            ikeys.push_back(KeyBoundle::MakeKey(base::Sprintf("key.%04d", i),
+                                                100, Tag::kFlagValueForSeek));
+        }
+        std::vector<std::string> values(ikeys.size());
+        std::vector<GetSlot> slots;
+        for (size_t i = 0; i < ikeys.size(); ++i) {
+            slots.push_back({ikeys[i], nullptr, &values[i], Error::OK()});
+        }
+        std::vector<GetSlot *> batch;
+        for (auto &slot : slots) {
+            batch.push_back(&slot);
+        }
+        rd->MultiGet(ReadOptions{}, &ikcmp_, batch);
+        
+        int n_false_positive = 0;
+        for (int i = 0; i < 1000; ++i) {
+            std::string key = base::Sprintf("key.%04d", i);
+            if (i % 2) {
+                n_false_positive += rd->KeyMayExists(&ikcmp_, key) ? 1 : 0;
+                EXPECT_TRUE(slots[i].rs.IsNotFound()) << slots[i].rs.ToString();
+            } else {
+                ASSERT_TRUE(rd->KeyMayExists(&ikcmp_, key)) << key;
+                ASSERT_TRUE(slots[i].rs.ok()) << slots[i].rs.ToString();
+                EXPECT_EQ(base::Sprintf("value.%d", i), values[i]);
+            }
+        }
+        ASSERT_LT(n_false_positive, 50);
+    }
+}
+    
+TEST_F(SstTableReaderTest, Compression) {
+    static auto kFileName = tmp_dirs[10];
+    
+    std::vector<std::string> input;
+    for (int i = 0; i < 1000; ++i) {
+        input.push_back(base::Sprintf("key.%04d", i));
+        input.push_back(base::Sprintf("value.value.value.%d", i));
+        input.push_back("1");
+    }
+    BuildTable(input, kFileName, [](const core::InternalKeyComparator *ikcmp,
+                                    WritableFile *file) {
+        return new SstTableBuilder(ikcmp, file, 4096, 16, 0, nullptr, 0, true,
+                                   kLZ4Compression);
+    });
+    
+    std::unique_ptr<RandomAccessFile> file;
+    std::unique_ptr<TableReader> rd;
+    NewReader(kFileName, &file, &rd, default_tr_factory_);
+    Error rs = down_cast<SstTableReader>(rd.get())->Prepare();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    const TableProperties &props = rd->GetTableProperties()->data();
+    ASSERT_EQ(kLZ4Compression, props.compression);
+    ASSERT_GT(props.raw_data_size, 0);
+    ASSERT_LT(props.compressed_data_size, props.raw_data_size / 2);
+    
+    std::string_view value;
+    std::string scratch;
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = base::Sprintf("key.%04d", i);
+        rs = rd->Get(ReadOptions{}, &ikcmp_,
+                     KeyBoundle::MakeKey(key, 100, Tag::kFlagValueForSeek),
+                     nullptr, &value, &scratch);
+        ASSERT_TRUE(rs.ok()) << rs.ToString() << " key:" << key;
+        ASSERT_EQ(base::Sprintf("value.value.value.%d", i), value);
+    }
+    
+    std::unique_ptr<Iterator> iter(rd->NewIterator(ReadOptions{}, &ikcmp_));
+    int i = 999;
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+        ASSERT_EQ(base::Sprintf("key.%04d", i--),
+                  KeyBoundle::ExtractUserKey(iter->key()));
+    }
+    ASSERT_TRUE(iter->error().ok()) << iter->error().ToString();
+    ASSERT_EQ(-1, i);
+}
+    
+TEST_F(SstTableReaderTest, Readahead) {
+    static auto kFileName = tmp_dirs[11];
+    
+    std::vector<std::string> input;
+    for (int i = 0; i < 5000; ++i) {
+        input.push_back(base::Sprintf("key.%05d", i));
+        input.push_back(base::Sprintf("value.%d", i));
+        input.push_back("1");
+    }
+    BuildTable(input, kFileName, default_tb_factory_);
+    
+    // The async readahead be run in pool of block cache.
+    base::ThreadPool pool(2);
+    BlockCache cache(base::kMB, BlockCache::kDefaultShardBits, 0, &pool);
+    std::unique_ptr<RandomAccessFile> file;
+    std::unique_ptr<TableReader> rd;
+    NewReader(kFileName, &file, &rd,
+              [&cache] (RandomAccessFile *file, uint64_t file_number,
+                        uint64_t file_size, BlockCache *) {
+        return new SstTableReader(file, file_number, file_size, true, &cache);
+    });
+    Error rs = down_cast<SstTableReader>(rd.get())->Prepare();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    // The second round hits the cached blocks.
+    for (bool fill_cache : {false, true}) {
+        for (size_t readahead_size : {0, 16 * base::kKB, 2 * base::kMB}) {
+            for (bool async : {false, true}) {
+                ReadOptions read_opts;
+                read_opts.fill_cache = fill_cache;
+                read_opts.readahead_size = readahead_size;
+                read_opts.async_readahead = async;
+                std::unique_ptr<Iterator>
+                    iter(rd->NewIterator(read_opts, &ikcmp_));
+                int i = 0;
+                for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+                    ASSERT_EQ(base::Sprintf("key.%05d", i),
+                              KeyBoundle::ExtractUserKey(iter->key()));
+                    ASSERT_EQ(base::Sprintf("value.%d", i++), iter->value());
+                }
+                ASSERT_TRUE(iter->error().ok()) << iter->error().ToString();
+                ASSERT_EQ(5000, i);
+                
+                // Seek breaks the sequential reading.
+                iter->Seek(KeyBoundle::MakeKey("key.02500", 100,
+                                               Tag::kFlagValueForSeek));
+                for (i = 2500; iter->Valid(); iter->Next()) {
+                    ASSERT_EQ(base::Sprintf("key.%05d", i++),
+                              KeyBoundle::ExtractUserKey(iter->key()));
+                }
+                ASSERT_EQ(5000, i);
+            }
+        }
+    }
+}
+    
+TEST_F(SstTableReaderTest, PrefixFilter) {
+    static auto kFileName = tmp_dirs[8];
+    std::unique_ptr<PrefixExtractor> extractor(PrefixExtractor::NewFixed(4));
+    
+    std::vector<std::string> input;
+    for (int i = 0; i < 100; i += 2) {
+        for (int j = 0; j < 10; ++j) {
+            input.push_back(base::Sprintf("p%03d.%d", i, j));
+            input.push_back("v");
+            input.push_back("1");
+        }
+    }
+    BuildTable(input, kFileName,
+               [&extractor](const core::InternalKeyComparator *ikcmp,
+                            WritableFile *file) {
+        return new SstTableBuilder(ikcmp, file, 512, 3, 0, extractor.get());
+    });
+    
+    std::unique_ptr<RandomAccessFile> file;
+    std::unique_ptr<TableReader> rd;
+    NewReader(kFileName, &file, &rd, default_tr_factory_);
+    Error rs = down_cast<SstTableReader>(rd.get())->Prepare();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(extractor->Name(), rd->GetTableProperties()->data().prefix_extractor);
+    
+    int n_false_positive = 0;
+    for (int i = 0; i < 100; ++i) {
+        std::string prefix = base::Sprintf("p%03d", i);
+        if (i % 2) {
+            n_false_positive += rd->PrefixMayExists(extractor.get(), prefix) ? 1 : 0;
+        } else {
+            ASSERT_TRUE(rd->PrefixMayExists(extractor.get(), prefix)) << prefix;
+            // Longer prefix has the same extracted prefix.
+            ASSERT_TRUE(rd->PrefixMayExists(extractor.get(), prefix + ".1"));
+        }
+    }
+    ASSERT_LT(n_false_positive, 10);
+    
+    // Prefix filter can not be used by other extractor.
+    std::unique_ptr<PrefixExtractor> other(PrefixExtractor::NewFixed(3));
+    ASSERT_TRUE(rd->PrefixMayExists(other.get(), "q00"));
+    ASSERT_TRUE(rd->PrefixMayExists(nullptr, "q000"));
+}
+    
 } // namespace table
     
 } // namespace mai
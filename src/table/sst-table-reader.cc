@@ -1,14 +1,18 @@
 #include "table/sst-table-reader.h"
 #include "table/block-iterator.h"
 #include "table/key-bloom-filter.h"
+#include "table/blocked-bloom-filter.h"
 #include "table/block-cache.h"
+#include "table/readahead-file.h"
 #include "core/internal-key-comparator.h"
 #include "core/key-boundle.h"
+#include "core/perf-context-impl.h"
 #include "base/slice.h"
 #include "base/io-utils.h"
 #include "mai/env.h"
 #include "mai/iterator.h"
 #include "mai/options.h"
+#include "mai/prefix-extractor.h"
 #include "glog/logging.h"
 
 namespace mai {
@@ -26,15 +30,36 @@ static void LRUHandleCleanup(void *arg0, void */*arg1*/) {
     static_cast<core::LRUHandle *>(arg0)->ReleaseRef();
 }
     
+static core::KeyFilter *NewKeyFilter(uint32_t filter_format,
+                                     std::string_view bits) {
+    if (filter_format == kBlockedBloomFilter) {
+        return new BlockedKeyFilter(bits);
+    }
+    return new KeyBloomFilter(reinterpret_cast<const uint32_t *>(bits.data()),
+                              bits.size() / 4,
+                              base::Hash::kBloomFilterHashs,
+                              base::Hash::kNumberBloomFilterHashs);
+}
+    
 class SstTableReader::IteratorImpl : public Iterator {
 public:
     IteratorImpl(const core::InternalKeyComparator *ikcmp,
-                 Iterator *index_iter, bool checksum_verify,
+                 Iterator *index_iter, const ReadOptions &read_opts,
                  SstTableReader *owns)
         : ikcmp_(DCHECK_NOTNULL(ikcmp))
         , index_iter_(DCHECK_NOTNULL(index_iter))
-        , checksum_verify_(checksum_verify)
+        , checksum_verify_(read_opts.verify_checksums)
+        , fill_cache_(read_opts.fill_cache)
         , owns_(DCHECK_NOTNULL(owns)) {
+        if (read_opts.readahead_size > 0) {
+            base::ThreadPool *pool = nullptr;
+            if (read_opts.async_readahead && owns_->cache_) {
+                pool = owns_->cache_->io_pool();
+            }
+            readahead_.reset(new ReadaheadFile(owns_->file_,
+                                               read_opts.readahead_size,
+                                               pool));
+        }
     }
     
     virtual ~IteratorImpl() {}
@@ -45,6 +70,7 @@ public:
     }
     
     virtual void SeekToFirst() override {
+        error_ = Error::OK();
         index_iter_->SeekToFirst();
         direction_ = kForward;
         
@@ -57,6 +83,7 @@ public:
     }
     
     virtual void SeekToLast() override {
+        error_ = Error::OK();
         index_iter_->SeekToLast();
         direction_ = kReserve;
         
@@ -69,6 +96,7 @@ public:
     }
     
     virtual void Seek(std::string_view target) override {
+        error_ = Error::OK();
         direction_ = kForward;
         index_iter_->Seek(target);
         if (!index_iter_->Valid()) {
@@ -113,7 +141,7 @@ public:
             if (index_iter_->Valid()) {
                 BlockHandle bh;
                 bh.Decode(index_iter_->value());
-                Seek(bh, true);
+                Seek(bh, false);
             }
         }
         SaveKeyIfNeed();
@@ -129,14 +157,28 @@ public:
         return block_iter_->value();
     }
     
+    virtual void PinValue(PinnableValue *result) const override {
+        DCHECK(Valid());
+        block_->AddRef();
+        result->Pin(block_iter_->value(), LRUHandleCleanup, block_.get());
+    }
+    
     virtual Error error() const override { return error_; }
     
     DISALLOW_IMPLICIT_CONSTRUCTORS(IteratorImpl);
 private:
     void Seek(BlockHandle handle, bool to_first) {
+        RandomAccessFile *file = readahead_ ? readahead_.get() : owns_->file_;
         std::unique_ptr<Iterator>
-            block_iter(owns_->NewBlockIterator(ikcmp_, handle, checksum_verify_));
+            block_iter(owns_->NewIteratorForBlock(ikcmp_, file, handle,
+                                                  owns_->has_trailer(),
+                                                  checksum_verify_, fill_cache_,
+                                                  &block_));
         block_iter_.swap(block_iter);
+        if (readahead_) {
+            // The block may be got from cache, keep the sequential reading.
+            readahead_->Touch(handle.offset(), handle.size());
+        }
         
         if (to_first) {
             block_iter_->SeekToFirst();
@@ -155,9 +197,12 @@ private:
     const core::InternalKeyComparator *const ikcmp_;
     const std::unique_ptr<Iterator> index_iter_;
     const bool checksum_verify_;
+    const bool fill_cache_;
     SstTableReader *const owns_;
+    std::unique_ptr<ReadaheadFile> readahead_; // For sequential scan
     
     std::unique_ptr<Iterator> block_iter_;
+    base::intrusive_ptr<core::LRUHandle> block_; // The block of block_iter_
     std::string saved_key_; // For last level sst table.
     Error error_;
     Direction direction_ = kForward;
@@ -225,15 +270,19 @@ Error SstTableReader::Prepare() {
                             table_props_->index_size }, &result, &scatch));
     }
     
-    // Filter:
-    TRY_RUN1(ReadBlock({table_props_->filter_position,
-                        table_props_->filter_size}, &result, &scatch));
-    core::KeyFilter *filter
-        = new KeyBloomFilter(reinterpret_cast<const uint32_t *>(result.data()),
-                             result.size() / 4,
-                             base::Hash::kBloomFilterHashs,
-                             base::Hash::kNumberBloomFilterHashs);
-    bloom_filter_.reset(filter);
+    // Filter: The partitions will be loaded on demand.
+    if (!table_props_->partitioned_filter) {
+        TRY_RUN1(ReadBlock({table_props_->filter_position,
+                            table_props_->filter_size}, &result, &scatch));
+        bloom_filter_.reset(NewKeyFilter(table_props_->filter_format, result));
+    }
+    
+    // Prefix filter: It's small, so keep it in memory.
+    if (table_props_->prefix_filter_size > 0) {
+        TRY_RUN1(ReadBlock({table_props_->prefix_filter_position,
+                            table_props_->prefix_filter_size}, &result, &scatch));
+        prefix_filter_.reset(NewKeyFilter(table_props_->filter_format, result));
+    }
     return Error::OK();
 }
 
@@ -243,8 +292,7 @@ SstTableReader::NewIterator(const ReadOptions &read_opts,
     if (!table_props_) {
         return Iterator::AsError(MAI_CORRUPTION("Table reader not prepared!"));
     }
-    return new IteratorImpl(ikcmp, NewIndexIterator(ikcmp),
-                            read_opts.verify_checksums, this);
+    return new IteratorImpl(ikcmp, NewIndexIterator(ikcmp), read_opts, this);
 }
 
 /*virtual*/ Error SstTableReader::Get(const ReadOptions &read_opts,
@@ -253,23 +301,51 @@ SstTableReader::NewIterator(const ReadOptions &read_opts,
                   core::Tag *tag,
                   std::string_view *value,
                   std::string *scratch) {
+    PinnableValue pinned;
+    Error rs = Get(read_opts, ikcmp, target, tag, &pinned);
+    if (!rs) {
+        return rs;
+    }
+    scratch->assign(pinned.data(), pinned.size());
+    *value = *scratch;
+    return Error::OK();
+}
+    
+/*virtual*/ Error SstTableReader::Get(const ReadOptions &read_opts,
+                                      const core::InternalKeyComparator *ikcmp,
+                                      std::string_view target,
+                                      core::Tag *tag,
+                                      PinnableValue *value) {
     if (!table_props_) {
         return MAI_CORRUPTION("Table reader not prepared!");
     }
+    std::unique_ptr<Iterator> filter_index;
+    if (table_props_->partitioned_filter) {
+        filter_index.reset(NewFilterIndexIterator(ikcmp));
+    }
+    if (!FilterMayMatch(filter_index.get(), target, read_opts)) {
+        PERF_COUNTER_ADD(bloom_filter_useful, 1);
+        return MAI_NOT_FOUND("Filter");
+    }
     std::unique_ptr<Iterator> index_iter(NewIndexIterator(ikcmp));
     
     index_iter->Seek(target);
     if (!index_iter->Valid()) {
+        PERF_COUNTER_ADD(bloom_filter_useless, 1);
         return MAI_NOT_FOUND("Index Seek()");
     }
     
     BlockHandle bh;
     bh.Decode(index_iter->value());
 
+    base::intrusive_ptr<core::LRUHandle> block;
     std::unique_ptr<Iterator> iter(NewBlockIterator(ikcmp, bh,
-                                                    read_opts.verify_checksums));
+                                                    read_opts.verify_checksums,
+                                                    read_opts.fill_cache,
+                                                    &block));
     iter->Seek(target);
     if (!iter->Valid()) {
+        PERF_COUNTER_ADD(bloom_filter_useless, 1);
         return MAI_NOT_FOUND("Data block Seek()");
     }
 
@@ -277,21 +353,118 @@ SstTableReader::NewIterator(const ReadOptions &read_opts,
     KeyBoundle::ParseTaggedKey(iter->key(), &ikey);
     if (!ikcmp->ucmp()->Equals(ikey.user_key,
                                KeyBoundle::ExtractUserKey(target))) {
+        PERF_COUNTER_ADD(bloom_filter_useless, 1);
         return MAI_NOT_FOUND("Key not seeked!");
     }
     if (tag) {
         *tag = ikey.tag;
     }
-    *scratch = iter->value();
-    *value = *scratch;
-
+    // The block will be released by value.
+    block->AddRef();
+    value->Pin(iter->value(), LRUHandleCleanup, block.get());
     return Error::OK();
 }
 
+/*virtual*/ void SstTableReader::MultiGet(const ReadOptions &read_opts,
+                                          const core::InternalKeyComparator *ikcmp,
+                                          const std::vector<GetSlot *> &slots) {
+    if (!table_props_) {
+        for (GetSlot *slot : slots) {
+            slot->rs = MAI_CORRUPTION("Table reader not prepared!");
+        }
+        return;
+    }
+    std::unique_ptr<Iterator> index_iter(NewIndexIterator(ikcmp));
+    if (index_iter->error().fail()) {
+        for (GetSlot *slot : slots) {
+            slot->rs = index_iter->error();
+        }
+        return;
+    }
+    std::unique_ptr<Iterator> filter_index;
+    if (table_props_->partitioned_filter) {
+        filter_index.reset(NewFilterIndexIterator(ikcmp));
+    }
+    std::unique_ptr<bool[]> may_match(new bool[slots.size()]);
+    if (!table_props_->partitioned_filter &&
+        table_props_->filter_format == kBlockedBloomFilter) {
+        // The whole blocked filter can probe all keys in one batch.
+        std::unique_ptr<uint64_t[]> hash_vals(new uint64_t[slots.size()]);
+        for (size_t i = 0; i < slots.size(); ++i) {
+            hash_vals[i] = BlockedBloomFilter::Hash(
+                KeyBoundle::ExtractUserKey(slots[i]->key));
+        }
+        BlockedBloomFilter::MayMatchBatch(hash_vals.get(), slots.size(),
+            static_cast<BlockedKeyFilter *>(bloom_filter_.get())->bits(),
+            may_match.get());
+    } else {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            may_match[i] = FilterMayMatch(filter_index.get(), slots[i]->key,
+                                          read_opts);
+        }
+    }
+    if (read_opts.fill_cache) {
+        PrefetchBlocks(ikcmp, index_iter.get(), slots, may_match.get(),
+                       read_opts.verify_checksums);
+    }
+    
+    std::unique_ptr<Iterator> iter;
+    uint64_t block_offset = 0;
+    bool index_seeked = false;
+    
+    for (size_t i = 0; i < slots.size(); ++i) {
+        GetSlot *slot = slots[i];
+        std::string_view user_key = KeyBoundle::ExtractUserKey(slot->key);
+        if (!may_match[i]) {
+            slot->rs = MAI_NOT_FOUND("Filter");
+            continue;
+        }
+        
+        // Slots are sorted, so the keys in the same block are adjacent. Only
+        // seek index when the key is out of current block.
+        if (!index_seeked || !index_iter->Valid() ||
+            ikcmp->Compare(slot->key, index_iter->key()) > 0) {
+            index_iter->Seek(slot->key);
+            index_seeked = true;
+        }
+        if (!index_iter->Valid()) {
+            slot->rs = MAI_NOT_FOUND("Index Seek()");
+            continue;
+        }
+        
+        BlockHandle bh;
+        bh.Decode(index_iter->value());
+        if (!iter || block_offset != bh.offset()) {
+            iter.reset(NewBlockIterator(ikcmp, bh, read_opts.verify_checksums,
+                                        read_opts.fill_cache));
+            block_offset = bh.offset();
+        }
+        iter->Seek(slot->key);
+        if (!iter->Valid()) {
+            slot->rs = iter->error().fail() ? iter->error() :
+                       MAI_NOT_FOUND("Data block Seek()");
+            continue;
+        }
+        
+        ParsedTaggedKey ikey;
+        KeyBoundle::ParseTaggedKey(iter->key(), &ikey);
+        if (!ikcmp->ucmp()->Equals(ikey.user_key, user_key)) {
+            slot->rs = MAI_NOT_FOUND("Key not seeked!");
+            continue;
+        }
+        if (slot->tag) {
+            *slot->tag = ikey.tag;
+        }
+        slot->value->assign(iter->value().data(), iter->value().size());
+        slot->rs = Error::OK();
+    }
+}
+
 /*virtual*/ size_t SstTableReader::ApproximateMemoryUsage() const {
     size_t usage = sizeof(*this);
     usage += (!table_props_boundle_.is_null() ? sizeof(TablePropsBoundle) : 0);
     usage += (!bloom_filter_.is_null() ? bloom_filter_->memory_usage() : 0);
+    usage += (!prefix_filter_.is_null() ? prefix_filter_->memory_usage() : 0);
     // TODO:
     return usage;
 }
@@ -302,45 +475,88 @@ SstTableReader::GetTableProperties() const { return table_props_boundle_; }
 /*virtual*/ base::intrusive_ptr<core::KeyFilter>
 SstTableReader::GetKeyFilter() const { return bloom_filter_; }
     
+/*virtual*/ bool
+SstTableReader::KeyMayExists(const core::InternalKeyComparator *ikcmp,
+                             std::string_view user_key) {
+    if (!table_props_) {
+        return true;
+    }
+    std::unique_ptr<Iterator> filter_index;
+    if (table_props_->partitioned_filter) {
+        filter_index.reset(NewFilterIndexIterator(ikcmp));
+    }
+    std::string target = KeyBoundle::MakeKey(user_key, Tag::kMaxSequenceNumber,
+                                             Tag::kFlagValueForSeek);
+    return FilterMayMatch(filter_index.get(), target, ReadOptions{});
+}
+    
+/*virtual*/ bool SstTableReader::PrefixMayExists(const PrefixExtractor *extractor,
+                                                 std::string_view prefix) {
+    if (prefix_filter_.is_null() || !extractor ||
+        table_props_->prefix_extractor.compare(extractor->Name()) != 0 ||
+        !extractor->InDomain(prefix)) {
+        return true;
+    }
+    // The keys with this prefix have the same extracted prefix.
+    return prefix_filter_->MayExists(extractor->Extract(prefix));
+}
+    
 Iterator *
 SstTableReader::NewIndexIterator(const core::InternalKeyComparator *ikcmp) {
     if (!table_props_) {
         return Iterator::AsError(MAI_CORRUPTION("Table reader not prepared!"));
     }
     
-    base::intrusive_ptr<core::LRUHandle> handle;
-    Error rs = cache_->GetOrLoad(file_, file_number_,
-                                 table_props_->index_position,
-                                 table_props_->index_size , checksum_verify_,
-                                 &handle);
-    if (!rs) {
-        return Iterator::AsError(rs);
-    }
+    return NewIteratorForBlock(ikcmp, file_, {table_props_->index_position,
+                                              table_props_->index_size}, false,
+                               checksum_verify_, true, nullptr);
+}
     
-    auto iter = new BlockIterator(ikcmp, handle->value,
-                                  table_props_->index_size  - 4);
-    handle->AddRef();
-    iter->RegisterCleanup(LRUHandleCleanup, handle.get());
-    return iter;
+Iterator *
+SstTableReader::NewFilterIndexIterator(const core::InternalKeyComparator *ikcmp) {
+    if (!table_props_) {
+        return Iterator::AsError(MAI_CORRUPTION("Table reader not prepared!"));
+    }
+    DCHECK(table_props_->partitioned_filter);
+    return NewIteratorForBlock(ikcmp, file_, {table_props_->filter_position,
+                                              table_props_->filter_size}, false,
+                               checksum_verify_, true, nullptr);
 }
     
 Iterator *
 SstTableReader::NewBlockIterator(const core::InternalKeyComparator *ikcmp,
-                                 BlockHandle bh, bool checksum_verify) {
+                                 BlockHandle bh, bool checksum_verify,
+                                 bool fill_cache,
+                                 base::intrusive_ptr<core::LRUHandle> *block) {
+    return NewIteratorForBlock(ikcmp, file_, bh, has_trailer(),
+                               checksum_verify, fill_cache, block);
+}
+    
+Iterator *
+SstTableReader::NewIteratorForBlock(const core::InternalKeyComparator *ikcmp,
+                                    RandomAccessFile *file,
+                                    BlockHandle bh, bool has_trailer,
+                                    bool checksum_verify, bool fill_cache,
+                                    base::intrusive_ptr<core::LRUHandle> *block) {
     if (!table_props_) {
         return Iterator::AsError(MAI_CORRUPTION("Table reader not prepared!"));
     }
     
     base::intrusive_ptr<core::LRUHandle> handle;
-    Error rs = cache_->GetOrLoad(file_, file_number_, bh.offset(), bh.size(),
-                                 checksum_verify, &handle);
+    Error rs = cache_->GetOrLoad(file, file_number_, bh.offset(), bh.size(),
+                                 has_trailer, checksum_verify, fill_cache,
+                                 &handle);
     if (!rs) {
         return Iterator::AsError(rs);
     }
     
-    auto iter = new BlockIterator(ikcmp, handle->value, bh.size() - 4);
+    std::string_view contents = BlockCache::GetBlock(handle.get());
+    auto iter = new BlockIterator(ikcmp, contents.data(), contents.size());
     handle->AddRef();
     iter->RegisterCleanup(LRUHandleCleanup, handle.get());
+    if (block) {
+        *block = handle;
+    }
     return iter;
 }
     
@@ -354,7 +570,7 @@ void SstTableReader::TEST_PrintAll(const core::InternalKeyComparator *ikcmp) {
         BlockHandle bh;
         bh.Decode(index_iter->value());
         
-        Iterator *iter = NewBlockIterator(ikcmp, bh, true);
+        Iterator *iter = NewBlockIterator(ikcmp, bh, true, true);
         for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
             std::string key(KeyBoundle::ExtractUserKey(iter->key()));
             printf("key: %s\n", key.c_str());
@@ -369,6 +585,8 @@ Error SstTableReader::ReadBlock(const BlockHandle &bh, std::string_view *result,
     if (!rs) {
         return rs;
     }
+    PERF_COUNTER_ADD(block_read_count, 1);
+    PERF_COUNTER_ADD(block_read_bytes, result->size());
     if (checksum_verify_) {
         uint32_t checksum = *reinterpret_cast<const uint32_t *>(result->data());
         
@@ -380,6 +598,67 @@ Error SstTableReader::ReadBlock(const BlockHandle &bh, std::string_view *result,
     return Error::OK();
 }
 
+void SstTableReader::PrefetchBlocks(const core::InternalKeyComparator *ikcmp,
+                                    Iterator *index_iter,
+                                    const std::vector<GetSlot *> &slots,
+                                    const bool *may_match,
+                                    bool checksum_verify) {
+    std::vector<BlockHandle> blocks;
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (!may_match[i]) {
+            continue;
+        }
+        if (!blocks.empty() && index_iter->Valid() &&
+            ikcmp->Compare(slots[i]->key, index_iter->key()) <= 0) {
+            continue; // In the same block.
+        }
+        index_iter->Seek(slots[i]->key);
+        if (!index_iter->Valid()) {
+            break; // All remain keys are out of this table.
+        }
+        BlockHandle bh;
+        bh.Decode(index_iter->value());
+        blocks.push_back(bh);
+    }
+    // Only one block, no need to read in parallel.
+    if (blocks.size() > 1) {
+        cache_->Prefetch(file_, file_number_, blocks, has_trailer(),
+                         checksum_verify);
+    }
+}
+    
+bool SstTableReader::FilterMayMatch(Iterator *filter_index,
+                                    std::string_view target,
+                                    const ReadOptions &read_opts) {
+    std::string_view user_key = KeyBoundle::ExtractUserKey(target);
+    if (!table_props_->partitioned_filter) {
+        return bloom_filter_->MayExists(user_key);
+    }
+    if (!filter_index || filter_index->error().fail()) {
+        return true; // Can not load the index, so can not filter.
+    }
+    filter_index->Seek(target);
+    if (!filter_index->Valid()) {
+        return false; // Out of the last partition.
+    }
+    BlockHandle bh;
+    bh.Decode(filter_index->value());
+    
+    base::intrusive_ptr<core::LRUHandle> partition;
+    Error rs = cache_->GetOrLoad(file_, file_number_, bh.offset(), bh.size(),
+                                 false, read_opts.verify_checksums,
+                                 read_opts.fill_cache, &partition);
+    if (!rs) {
+        return true;
+    }
+    std::string_view bits = BlockCache::GetBlock(partition.get());
+    if (table_props_->filter_format == kBlockedBloomFilter) {
+        return BlockedBloomFilter::MayMatch(user_key, bits);
+    }
+    return KeyBloomFilter::MayMatch(bits, user_key, base::Hash::kBloomFilterHashs,
+                                    base::Hash::kNumberBloomFilterHashs);
+}
+
 } // namespace table
 
 } // namespace mai
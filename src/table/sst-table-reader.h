@@ -6,7 +6,11 @@
 #include <vector>
 
 namespace mai {
-    
+namespace core {
+inline namespace v1 {
+struct LRUHandle;
+} // inline namespace v1
+} // namespace core
 namespace table {
     
 class BlockIterator;
@@ -30,24 +34,62 @@ public:
                       core::Tag *tag,
                       std::string_view *value,
                       std::string *scratch) override;
+    virtual Error Get(const ReadOptions &read_opts,
+                      const core::InternalKeyComparator *ikcmp,
+                      std::string_view key,
+                      core::Tag *tag,
+                      PinnableValue *value) override;
+    virtual void MultiGet(const ReadOptions &read_opts,
+                          const core::InternalKeyComparator *ikcmp,
+                          const std::vector<GetSlot *> &slots) override;
     virtual size_t ApproximateMemoryUsage() const override;
     virtual base::intrusive_ptr<TablePropsBoundle> GetTableProperties() const override;
     virtual base::intrusive_ptr<core::KeyFilter> GetKeyFilter() const override;
+    virtual bool KeyMayExists(const core::InternalKeyComparator *ikcmp,
+                              std::string_view user_key) override;
+    virtual bool PrefixMayExists(const PrefixExtractor *extractor,
+                                 std::string_view prefix) override;
     
     Iterator *NewIndexIterator(const core::InternalKeyComparator *ikcmp);
+    // Iterate the index of filter partitions.
+    Iterator *NewFilterIndexIterator(const core::InternalKeyComparator *ikcmp);
     Iterator *NewBlockIterator(const core::InternalKeyComparator *ikcmp,
-                               BlockHandle bh, bool checksum_verify);
+                               BlockHandle bh, bool checksum_verify,
+                               bool fill_cache,
+                               base::intrusive_ptr<core::LRUHandle> *block = nullptr);
     
     void TEST_PrintAll(const core::InternalKeyComparator *ikcmp);
 private:
     class IteratorImpl;
     
+    // The data blocks have compression type trailer?
+    bool has_trailer() const {
+        return table_props_->compression != kNoCompression;
+    }
+    // Load the missed block from file, it's file_ or a readahead of file_.
+    Iterator *NewIteratorForBlock(const core::InternalKeyComparator *ikcmp,
+                                  RandomAccessFile *file,
+                                  BlockHandle bh, bool has_trailer,
+                                  bool checksum_verify, bool fill_cache,
+                                  base::intrusive_ptr<core::LRUHandle> *block);
+    
     Error GetFirstKey(BlockHandle handle, std::string_view *result,
                       std::string *scratch);
     Error GetKey(std::string_view prev_key, uint64_t *offset,
                  std::string_view *result, std::string *scratch);
     Error ReadBlock(const BlockHandle &bh, std::string_view *result,
                     std::string *scatch) const;
+    // The filter_index is only need by partitioned filter, the partition be
+    // loaded by block cache.
+    bool FilterMayMatch(Iterator *filter_index, std::string_view target,
+                        const ReadOptions &read_opts);
+    // Read the data blocks of all keys (may match by filter) into block cache
+    // in parallel, so MultiGet() only waits one I/O round trip.
+    void PrefetchBlocks(const core::InternalKeyComparator *ikcmp,
+                        Iterator *index_iter,
+                        const std::vector<GetSlot *> &slots,
+                        const bool *may_match,
+                        bool checksum_verify);
     
     RandomAccessFile *const file_;
     const uint64_t file_number_;
@@ -57,7 +99,8 @@ private:
     
     base::intrusive_ptr<TablePropsBoundle> table_props_boundle_;
     const TableProperties *table_props_ = nullptr;
-    base::intrusive_ptr<core::KeyFilter> bloom_filter_;
+    base::intrusive_ptr<core::KeyFilter> bloom_filter_; // Null if partitioned
+    base::intrusive_ptr<core::KeyFilter> prefix_filter_;
 }; // class SstTableReader
     
 } // namespace table
@@ -4,25 +4,37 @@
 #include "base/reference-count.h"
 #include "base/base.h"
 #include "mai/error.h"
+#include "mai/pinnable-value.h"
+#include "core/key-filter.h"
 #include <string_view>
+#include <string>
 #include <memory>
+#include <vector>
 
 namespace mai {
     
 struct ReadOptions;
 class Comparator;
 class Iterator;
+class PrefixExtractor;
 
 namespace core {
 class Tag;
 class InternalKeyComparator;
-class KeyFilter;
 } // namespace core
     
 namespace table {
     
 struct TableProperties;
 class  TablePropsBoundle;
+    
+// One key of TableReader::MultiGet()
+struct GetSlot {
+    std::string_view key; // The internal key for seeking.
+    core::Tag       *tag;
+    std::string     *value;
+    Error            rs;
+}; // struct GetSlot
 
 class TableReader {
 public:
@@ -42,12 +54,58 @@ public:
                       std::string_view *value,
                       std::string *scratch) = 0;
     
+    // Get value without copying if the reader can pin its block.
+    virtual Error Get(const ReadOptions &read_opts,
+                      const core::InternalKeyComparator *ikcmp,
+                      std::string_view key,
+                      core::Tag *tag,
+                      PinnableValue *value) {
+        std::string_view result;
+        std::string scratch;
+        Error rs = Get(read_opts, ikcmp, key, tag, &result, &scratch);
+        if (rs.ok()) {
+            value->Assign(result);
+        }
+        return rs;
+    }
+    
+    // Get a batch of keys. The slots must be sorted by internal key, every
+    // slot's result will be set to its rs.
+    virtual void MultiGet(const ReadOptions &read_opts,
+                          const core::InternalKeyComparator *ikcmp,
+                          const std::vector<GetSlot *> &slots) {
+        std::string_view result;
+        std::string scratch;
+        for (GetSlot *slot : slots) {
+            slot->rs = Get(read_opts, ikcmp, slot->key, slot->tag, &result,
+                           &scratch);
+            if (slot->rs.ok()) {
+                slot->value->assign(result.data(), result.size());
+            }
+        }
+    }
+    
     virtual size_t ApproximateMemoryUsage() const = 0;
     
     virtual base::intrusive_ptr<TablePropsBoundle> GetTableProperties() const = 0;
     
+    // The whole key filter. It's null if the filter be partitioned.
     virtual base::intrusive_ptr<core::KeyFilter> GetKeyFilter() const = 0;
     
+    // May the user key exist in this table? It works for partitioned filter.
+    virtual bool KeyMayExists(const core::InternalKeyComparator */*ikcmp*/,
+                              std::string_view user_key) {
+        base::intrusive_ptr<core::KeyFilter> filter = GetKeyFilter();
+        return filter.is_null() || filter->MayExists(user_key);
+    }
+    
+    // May the keys with this prefix exist in this table? The prefix filter
+    // only be used if the table was built by the same extractor.
+    virtual bool PrefixMayExists(const PrefixExtractor */*extractor*/,
+                                 std::string_view /*prefix*/) {
+        return true;
+    }
+    
     DISALLOW_IMPLICIT_CONSTRUCTORS(TableReader);
 }; // class TableReader
 
@@ -1,6 +1,7 @@
 #include "table/table.h"
 #include "base/slice.h"
 #include "base/varint-encoding.h"
+#include "base/lz4.h"
 #include "mai/env.h"
 
 namespace mai {
@@ -43,6 +44,30 @@ void Table::WriteProperties(const TableProperties &props, std::string *buf) {
     buf->append(props.smallest_key);
     buf->append(Slice::GetV64(props.largest_key.size(), &scope));
     buf->append(props.largest_key);
+    
+    if (!props.partitioned_filter && props.prefix_filter_size == 0 &&
+        props.filter_format == kLegacyBloomFilter &&
+        props.compression == kNoCompression) {
+        return; // Keep the old format.
+    }
+    const char partitioned_filter = props.partitioned_filter ? 1 : 0;
+    buf->append(std::string_view(&partitioned_filter, 1));
+    buf->append(Slice::GetU64(props.prefix_filter_position, &scope));
+    buf->append(Slice::GetU32(static_cast<uint32_t>(props.prefix_filter_size),
+                              &scope));
+    buf->append(Slice::GetV64(props.prefix_extractor.size(), &scope));
+    buf->append(props.prefix_extractor);
+    const char filter_format = static_cast<char>(props.filter_format);
+    buf->append(std::string_view(&filter_format, 1));
+    
+    if (props.compression == kNoCompression) {
+        return;
+    }
+    const char compression = static_cast<char>(props.compression);
+    buf->append(std::string_view(&compression, 1));
+    buf->append(Slice::GetV64(props.raw_data_size, &scope));
+    buf->append(Slice::GetV64(props.compressed_data_size, &scope));
+    buf->append(Slice::GetV64(props.compression_micros, &scope));
 }
 
 #define TRY_RUN(expr) \
@@ -65,6 +90,30 @@ void Table::WriteProperties(const TableProperties &props, std::string *buf) {
     TRY_RUN(props->last_version    = reader.ReadFixed64());
     TRY_RUN(props->smallest_key    = reader.ReadString());
             props->largest_key     = reader.ReadString();
+    if (reader.Eof()) {
+        return Error::OK(); // No optional properties.
+    }
+    TRY_RUN(props->partitioned_filter = reader.ReadByte() ? true : false);
+    TRY_RUN(props->prefix_filter_position = reader.ReadFixed64());
+    TRY_RUN(props->prefix_filter_size = reader.ReadFixed32());
+            props->prefix_extractor = reader.ReadString();
+    if (reader.Eof()) {
+        return Error::OK();
+    }
+    props->filter_format = static_cast<uint8_t>(reader.ReadByte());
+    if (props->filter_format > kBlockedBloomFilter) {
+        return MAI_CORRUPTION("Unknown filter format.");
+    }
+    if (reader.Eof()) {
+        return Error::OK();
+    }
+    TRY_RUN(props->compression = static_cast<CompressionType>(reader.ReadByte()));
+    if (props->compression > kLZ4Compression) {
+        return MAI_CORRUPTION("Unknown compression type.");
+    }
+    TRY_RUN(props->raw_data_size = reader.ReadVarint64());
+    TRY_RUN(props->compressed_data_size = reader.ReadVarint64());
+            props->compression_micros = reader.ReadVarint64();
     return Error::OK();
 }
     
@@ -82,6 +131,87 @@ void Table::WriteProperties(const TableProperties &props, std::string *buf) {
     return ReadProperties(result, props);
 }
     
+/*static*/ void Table::CompressBlock(std::string_view raw, CompressionType type,
+                                    std::string *buf) {
+    using base::Slice;
+    
+    buf->clear();
+    if (type == kLZ4Compression) {
+        base::ScopedMemory scope;
+        buf->append(Slice::GetV32(static_cast<uint32_t>(raw.size()), &scope));
+        size_t header_size = buf->size();
+        buf->resize(header_size + base::Lz4::MaxCompressedSize(raw.size()));
+        size_t size = base::Lz4::Compress(raw.data(), raw.size(),
+                                          &(*buf)[header_size]);
+        buf->resize(header_size + size);
+        if (buf->size() < raw.size() - raw.size() / 8) {
+            buf->push_back(static_cast<char>(type));
+            return;
+        }
+        buf->clear(); // Not worth to compress.
+    }
+    buf->append(raw);
+    buf->push_back(static_cast<char>(kNoCompression));
+}
+    
+/*static*/ Error Table::ParseBlockTrailer(std::string_view block,
+                                          CompressionType *type,
+                                          std::string_view *contents,
+                                          size_t *raw_size) {
+    using base::Varint32;
+    
+    if (block.empty()) {
+        return MAI_CORRUPTION("No block trailer.");
+    }
+    *type = static_cast<CompressionType>(block.back());
+    block.remove_suffix(1);
+    switch (*type) {
+        case kNoCompression:
+            *contents = block;
+            *raw_size = block.size();
+            break;
+        case kLZ4Compression: {
+            // The varint must be terminated in the block.
+            size_t varint_len = 0;
+            while (varint_len < block.size() && varint_len < Varint32::kMaxLen &&
+                   (block[varint_len] & 0x80)) {
+                varint_len++;
+            }
+            if (varint_len >= block.size() || varint_len >= Varint32::kMaxLen) {
+                return MAI_CORRUPTION("Bad uncompressed size.");
+            }
+            *raw_size = Varint32::Decode(block.data(), &varint_len);
+            block.remove_prefix(varint_len);
+            *contents = block;
+        } break;
+        default:
+            return MAI_CORRUPTION("Unknown compression type.");
+    }
+    return Error::OK();
+}
+    
+/*static*/ Error Table::UncompressBlock(CompressionType type,
+                                        std::string_view contents, char *buf,
+                                        size_t raw_size) {
+    switch (type) {
+        case kNoCompression:
+            if (contents.size() != raw_size) {
+                return MAI_CORRUPTION("Bad block size.");
+            }
+            ::memcpy(buf, contents.data(), raw_size);
+            break;
+        case kLZ4Compression:
+            if (!base::Lz4::Uncompress(contents.data(), contents.size(), buf,
+                                       raw_size)) {
+                return MAI_CORRUPTION("Uncompress block fail.");
+            }
+            break;
+        default:
+            return MAI_CORRUPTION("Unknown compression type.");
+    }
+    return Error::OK();
+}
+    
 void BlockHandle::Encode(std::string *buf) const {
     using ::mai::base::Slice;
     using ::mai::base::ScopedMemory;
@@ -3,6 +3,7 @@
 
 #include "base/reference-count.h"
 #include "base/base.h"
+#include "mai/options.h"
 #include "mai/error.h"
 #include <stdint.h>
 #include <string>
@@ -14,6 +15,12 @@ namespace table {
     
 struct TableProperties;
     
+// The format of key filters and prefix filter.
+enum FilterFormat : uint32_t {
+    kLegacyBloomFilter  = 0, // Multi hash functions, see KeyBloomFilter
+    kBlockedBloomFilter = 1, // See BlockedBloomFilter
+};
+    
 struct Table final {
     static const uint32_t kHmtMagicNumber;
     static const uint32_t kXmtMagicNumber;
@@ -29,6 +36,24 @@ struct Table final {
     
     static Error ReadProperties(std::string_view buf, TableProperties *props);
     
+    // The data block of compressed table has a compression type trailer:
+    // [contents][type:1]
+    // if it be compressed, the contents is:
+    // [uncompressed-size:varint32][compressed-data]
+    // The block be stored uncompressed if compression saves less than 1/8.
+    static void CompressBlock(std::string_view raw, CompressionType type,
+                              std::string *buf);
+    
+    // Parse the block with trailer. If the block is not compressed, the
+    // contents is the raw block, otherwise raw_size is the uncompressed size.
+    static Error ParseBlockTrailer(std::string_view block, CompressionType *type,
+                                   std::string_view *contents,
+                                   size_t *raw_size);
+    
+    // REQUIRES: buf has raw_size bytes.
+    static Error UncompressBlock(CompressionType type, std::string_view contents,
+                                 char *buf, size_t raw_size);
+    
     DISALLOW_ALL_CONSTRUCTORS(Table);
 }; // struct Table
     
@@ -41,6 +66,16 @@ struct Table final {
 // last-version
 // smallest-key
 // largest-key
+// [optional]
+// partitioned-filter?
+// prefix-filter-position
+// prefix-filter-size
+// prefix-extractor
+// filter-format
+// compression
+// raw-data-size
+// compressed-data-size
+// compression-micros
 struct TableProperties final {
     bool        unordered       = false;
     bool        last_level      = false;
@@ -53,6 +88,19 @@ struct TableProperties final {
     uint64_t    last_version    = 0;
     std::string smallest_key;
     std::string largest_key;
+    // If filter be partitioned, filter-position is the index of partitions.
+    bool        partitioned_filter     = false;
+    uint64_t    prefix_filter_position = 0;
+    size_t      prefix_filter_size     = 0;
+    std::string prefix_extractor;
+    uint32_t    filter_format          = kLegacyBloomFilter;
+    // If compression is not kNoCompression, the data blocks have trailer.
+    CompressionType compression        = kNoCompression;
+    // Total bytes of data blocks before and after compression.
+    uint64_t    raw_data_size          = 0;
+    uint64_t    compressed_data_size   = 0;
+    // CPU time of compressing data blocks.
+    uint64_t    compression_micros     = 0;
 }; // struct FileProperties
 
 
@@ -32,7 +32,7 @@ public:
     
     TableTest()
         : ikcmp_(Comparator::Bytewise())
-        , block_cache_(env_->GetLowLevelAllocator(), 1000) {}
+        , block_cache_(base::kMB) {}
     
     void Add(table::TableBuilder *builder,
              std::string_view key,
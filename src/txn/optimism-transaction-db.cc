@@ -9,7 +9,11 @@ namespace txn {
 OptimismTransactionDB::OptimismTransactionDB(const TransactionDBOptions &opts,
                                              DB *db)
     : TransactionDB(db)
-    , options_(opts) {}
+    , options_(opts) {
+    if (options_.recent_writes_slots > 0) {
+        impl()->EnableRecentWrites(options_.recent_writes_slots);
+    }
+}
     
 /*virtual*/ OptimismTransactionDB::~OptimismTransactionDB() {
 }
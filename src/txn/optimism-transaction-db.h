@@ -18,6 +18,11 @@ public:
     virtual Transaction *BeginTransaction(const WriteOptions &wr_opts,
                                           const TransactionOptions &txn_opts,
                                           Transaction *old_txn) override;
+    virtual Error
+    GetAllPreparedTransactions(std::vector<Transaction *> *txns) override {
+        txns->clear(); // Two-phase commit is not supported.
+        return Error::OK();
+    }
     
     db::DBImpl *impl() const;
     
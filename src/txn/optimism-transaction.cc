@@ -3,9 +3,12 @@
 #include "txn/write-batch-with-index.h"
 #include "db/db-impl.h"
 #include "db/column-family.h"
+#include "db/recent-writes.h"
+#include "core/perf-context-impl.h"
 #include "base/slice.h"
 #include "mai/iterator.h"
 #include "glog/logging.h"
+#include <algorithm>
 
 namespace mai {
     
@@ -69,32 +72,60 @@ Error OptimismTransaction::TryLock(ColumnFamily* cf, std::string_view key,
     return Error::OK();
 }
     
+// Check keys of every column family in one batch. The keys that not be
+// written after tracked can be skipped by recent writes, others be looked up
+// in order.
 Error OptimismTransaction::CheckTransactionForConflicts(db::DBImpl *db) {
+    const db::RecentWrites *recent_writes = db->recent_writes();
+    std::vector<std::pair<std::string_view, core::SequenceNumber>> checks;
+    std::vector<std::string_view> keys;
+    std::vector<core::SequenceNumber> seqs;
+    
     Error rs;
     for (const auto &keys_iter : tracked_keys()) {
         uint32_t cfid = keys_iter.first;
-        const TxnKeyMap &keys = keys_iter.second;
+        
+        checks.clear();
+        for (const auto &key_iter : keys_iter.second) {
+            const core::SequenceNumber key_seq = key_iter.second.seq;
+            if (recent_writes &&
+                recent_writes->Check(cfid, key_iter.first, key_seq) ==
+                db::RecentWrites::kNotWritten) {
+                PERF_COUNTER_ADD(txn_check_skips, 1);
+                continue;
+            }
+            checks.push_back({key_iter.first, key_seq});
+        }
+        if (checks.empty()) {
+            continue;
+        }
+        PERF_COUNTER_ADD(txn_check_lookups, checks.size());
         
         base::intrusive_ptr<db::ColumnFamilyImpl> impl;
         rs = db->GetColumnFamilyImpl(cfid, &impl);
         if (!rs) {
             break;
         }
-        
-        // TODO: use memory-table earliest_seq
-        core::SequenceNumber earliest_seq = core::Tag::kMaxSequenceNumber;
-        for (const auto &key_iter : keys) {
-            const std::string &key = key_iter.first;
-            const core::SequenceNumber key_seq = key_iter.second.seq;
-            
-            rs = CheckKey(db, impl.get(), earliest_seq, key_seq, key, false);
-            if (!rs) {
-                break;
-            }
+        const Comparator *ucmp = impl->ikcmp()->ucmp();
+        std::sort(checks.begin(), checks.end(),
+                  [ucmp] (const auto &lhs, const auto &rhs) {
+                      return ucmp->Compare(lhs.first, rhs.first) < 0;
+                  });
+        keys.clear();
+        for (const auto &check : checks) {
+            keys.push_back(check.first);
         }
+        
+        rs = db->GetLatestSequenceForKeys(impl.get(), keys, &seqs);
         if (!rs) {
             break;
         }
+        for (size_t i = 0; i < checks.size(); ++i) {
+            if (seqs[i] != core::Tag::kMaxSequenceNumber &&
+                checks[i].second < seqs[i]) {
+                return MAI_BUSY("Transaction write conflict");
+            }
+        }
     }
     return rs;
 }
@@ -1,7 +1,11 @@
 #include "txn/pessimistic-transaction-db.h"
 #include "txn/pessimistic-transaction.h"
+#include "db/db-impl.h"
 #include "mai/transaction.h"
+#include "mai/iterator.h"
+#include "base/slice.h"
 #include "gtest/gtest.h"
+#include <thread>
 
 namespace mai {
     
@@ -24,12 +28,7 @@ public:
     }
     
     ~PessimisticTransactionDBTest() override {
-        if (txn_db_) {
-            for (auto cf : cfs_) {
-                txn_db_->ReleaseColumnFamily(cf);
-            }
-            delete txn_db_;
-        }
+        Close();
         
         int i = 0;
         while (tmp_dirs[i]) {
@@ -45,6 +44,17 @@ public:
         txn_db_ = down_cast<PessimisticTransactionDB>(db);
     }
     
+    void Close() {
+        if (txn_db_) {
+            for (auto cf : cfs_) {
+                txn_db_->ReleaseColumnFamily(cf);
+            }
+            cfs_.clear();
+            delete txn_db_;
+            txn_db_ = nullptr;
+        }
+    }
+    
     Env *env_ = Env::Default();
     PessimisticTransactionDB *txn_db_ = nullptr;
     std::vector<ColumnFamily *> cfs_;
@@ -63,6 +73,13 @@ const char *PessimisticTransactionDBTest::tmp_dirs[] = {
     "tests/03-pessimistic-txn-db-put-commit",
     "tests/04-pessimistic-txn-db-write",
     "tests/05-pessimistic-txn-db-write-wait",
+    "tests/06-pessimistic-txn-db-shared-lock",
+    "tests/07-pessimistic-txn-db-lock-release",
+    "tests/08-pessimistic-txn-db-deadlock",
+    "tests/09-pessimistic-txn-db-range-lock",
+    "tests/10-pessimistic-txn-db-prepare-commit",
+    "tests/11-pessimistic-txn-db-prepare-rollback",
+    "tests/12-pessimistic-txn-db-prepare-recovery",
     nullptr,
 };
     
@@ -222,6 +239,323 @@ TEST_F(PessimisticTransactionDBTest, WriteWait) {
     ASSERT_TRUE(rs.IsTimeout()) << rs.ToString();
 }
     
+TEST_F(PessimisticTransactionDBTest, SharedLock) {
+    Open(6);
+    
+    WriteOptions wr_opts;
+    TransactionOptions txn_opts;
+    txn_opts.lock_timeout = 100;
+    std::unique_ptr<Transaction> txn1(txn_db_->BeginTransaction(wr_opts, txn_opts, nullptr));
+    std::unique_ptr<Transaction> txn2(txn_db_->BeginTransaction(wr_opts, txn_opts, nullptr));
+    std::unique_ptr<Transaction> txn3(txn_db_->BeginTransaction(wr_opts, txn_opts, nullptr));
+    
+    auto cf = cfs_[0];
+    ReadOptions rd_opts;
+    std::string value;
+    auto rs = txn1->GetForUpdate(rd_opts, cf, "aaaa", &value, false);
+    ASSERT_TRUE(rs.IsNotFound()) << rs.ToString();
+    rs = txn2->GetForUpdate(rd_opts, cf, "aaaa", &value, false);
+    ASSERT_TRUE(rs.IsNotFound()) << rs.ToString();
+    
+    rs = txn3->Put(cf, "aaaa", "cccc");
+    ASSERT_TRUE(rs.IsTimeout()) << rs.ToString();
+    
+    ASSERT_TRUE(txn1->Rollback().ok());
+    rs = txn3->Put(cf, "aaaa", "cccc");
+    ASSERT_TRUE(rs.IsTimeout()) << rs.ToString();
+    
+    ASSERT_TRUE(txn2->Rollback().ok());
+    rs = txn3->Put(cf, "aaaa", "cccc");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+}
+    
+TEST_F(PessimisticTransactionDBTest, LockRelease) {
+    Open(7);
+    
+    WriteOptions wr_opts;
+    TransactionOptions txn_opts;
+    txn_opts.lock_timeout = 1000;
+    std::unique_ptr<Transaction> txn1(txn_db_->BeginTransaction(wr_opts, txn_opts, nullptr));
+    std::unique_ptr<Transaction> txn2(txn_db_->BeginTransaction(wr_opts, txn_opts, nullptr));
+    
+    auto cf = cfs_[0];
+    for (int i = 0; i < 100; ++i) {
+        auto rs = txn1->Put(cf, base::Sprintf("k.%d", i), "v");
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    
+    std::thread waiter([&] () {
+        for (int i = 0; i < 100; ++i) {
+            auto rs = txn2->Put(cf, base::Sprintf("k.%d", i), "w");
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    auto rs = txn1->Commit();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    waiter.join();
+    
+    rs = txn2->Commit();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    std::unique_ptr<Transaction> txn3(txn_db_->BeginTransaction(wr_opts, txn_opts, nullptr));
+    rs = txn3->LockRange(cf, "k.0", "k.9");
+    ASSERT_TRUE(rs.IsNotSupported()) << rs.ToString();
+    
+    ReadOptions rd_opts;
+    std::string value;
+    rs = txn_db_->Get(rd_opts, cf, "k.99", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("w", value);
+}
+    
+TEST_F(PessimisticTransactionDBTest, DeadLock) {
+    Open(8);
+    
+    WriteOptions wr_opts;
+    TransactionOptions txn_opts;
+    txn_opts.lock_timeout = 5000;
+    txn_opts.deadlock_detect = true;
+    std::unique_ptr<Transaction> txn1(txn_db_->BeginTransaction(wr_opts, txn_opts, nullptr));
+    std::unique_ptr<Transaction> txn2(txn_db_->BeginTransaction(wr_opts, txn_opts, nullptr));
+    
+    auto cf = cfs_[0];
+    ASSERT_TRUE(txn1->Put(cf, "aaaa", "1").ok());
+    ASSERT_TRUE(txn2->Put(cf, "bbbb", "2").ok());
+    
+    Error rs1;
+    std::thread waiter([&] () {
+        rs1 = txn1->Put(cf, "bbbb", "1");
+        if (rs1.IsBusy()) {
+            txn1->Rollback();
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    auto rs2 = txn2->Put(cf, "aaaa", "2");
+    if (rs2.IsBusy()) {
+        txn2->Rollback();
+    }
+    waiter.join();
+    
+    // One of them must be the victim, the other one get the lock.
+    ASSERT_TRUE(rs1.IsBusy() || rs2.IsBusy())
+        << rs1.ToString() << ", " << rs2.ToString();
+    ASSERT_TRUE(rs1.ok() || rs2.ok())
+        << rs1.ToString() << ", " << rs2.ToString();
+}
+    
+TEST_F(PessimisticTransactionDBTest, RangeLock) {
+    txn_db_opts_.range_locking = true;
+    Open(9);
+    
+    WriteOptions wr_opts;
+    TransactionOptions txn_opts;
+    txn_opts.lock_timeout = 100;
+    std::unique_ptr<Transaction> txn1(txn_db_->BeginTransaction(wr_opts, txn_opts, nullptr));
+    std::unique_ptr<Transaction> txn2(txn_db_->BeginTransaction(wr_opts, txn_opts, nullptr));
+    
+    auto cf = cfs_[0];
+    auto rs = txn1->LockRange(cf, "bbbb", "dddd", true);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = txn1->Put(cf, "cccc", "1");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    // Can not insert into the gap.
+    rs = txn2->Put(cf, "bbbc", "2");
+    ASSERT_TRUE(rs.IsTimeout()) << rs.ToString();
+    rs = txn2->LockRange(cf, "aaaa", "bbbb", false);
+    ASSERT_TRUE(rs.IsTimeout()) << rs.ToString();
+    rs = txn2->Put(cf, "eeee", "2");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    txn_opts.lock_timeout = 5000;
+    std::unique_ptr<Transaction> txn3(txn_db_->BeginTransaction(wr_opts, txn_opts, nullptr));
+    Error rs3;
+    std::thread waiter([&] () {
+        rs3 = txn3->LockRange(cf, "a", "z", false);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_TRUE(txn1->Commit().ok());
+    ASSERT_TRUE(txn2->Commit().ok());
+    waiter.join();
+    ASSERT_TRUE(rs3.ok()) << rs3.ToString();
+    
+    ReadOptions rd_opts;
+    std::string value;
+    rs = txn_db_->Get(rd_opts, cf, "cccc", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("1", value);
+}
+    
+TEST_F(PessimisticTransactionDBTest, PrepareCommit) {
+    Open(10);
+    
+    WriteOptions wr_opts;
+    ReadOptions rd_opts;
+    auto cf = cfs_[0];
+    ASSERT_TRUE(txn_db_->Put(wr_opts, cf, "aaaa", "0").ok());
+    
+    std::unique_ptr<Transaction> txn(txn_db_->BeginTransaction(wr_opts, {}, nullptr));
+    auto rs = txn->Prepare();
+    ASSERT_TRUE(rs.IsCorruption()) << "Not named.";
+    ASSERT_TRUE(txn->SetName("txn1").ok());
+    ASSERT_TRUE(txn->Put(cf, "aaaa", "1").ok());
+    ASSERT_TRUE(txn->Put(cf, "bbbb", "1").ok());
+    rs = txn->Prepare();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(Transaction::PREPARED, txn->state());
+    
+    // Prepared but invisible.
+    std::string value;
+    rs = txn_db_->Get(rd_opts, cf, "aaaa", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("0", value);
+    rs = txn_db_->Get(rd_opts, cf, "bbbb", &value);
+    ASSERT_TRUE(rs.IsNotFound()) << rs.ToString();
+    
+    const Snapshot *snapshot = txn_db_->GetSnapshot();
+    rs = txn->Commit();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(Transaction::COMMITED, txn->state());
+    
+    rs = txn_db_->Get(rd_opts, cf, "aaaa", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("1", value);
+    
+    std::unique_ptr<Iterator> iter(txn_db_->NewIterator(rd_opts, cf));
+    iter->SeekToFirst();
+    ASSERT_TRUE(iter->Valid());
+    EXPECT_EQ("aaaa", iter->key());
+    EXPECT_EQ("1", iter->value());
+    iter->Next();
+    ASSERT_TRUE(iter->Valid());
+    EXPECT_EQ("bbbb", iter->key());
+    iter.reset();
+    
+    // The snapshot before commit can not see it.
+    rd_opts.snapshot = snapshot;
+    rs = txn_db_->Get(rd_opts, cf, "aaaa", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("0", value);
+    iter.reset(txn_db_->NewIterator(rd_opts, cf));
+    iter->SeekToFirst();
+    ASSERT_TRUE(iter->Valid());
+    EXPECT_EQ("0", iter->value());
+    iter->Next();
+    ASSERT_FALSE(iter->Valid());
+    iter.reset();
+    txn_db_->ReleaseSnapshot(snapshot);
+    
+    rd_opts.snapshot = nullptr;
+    rs = txn_db_->Get(rd_opts, cf, "aaaa", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("1", value);
+}
+    
+TEST_F(PessimisticTransactionDBTest, PrepareRollback) {
+    Open(11);
+    
+    WriteOptions wr_opts;
+    ReadOptions rd_opts;
+    auto cf = cfs_[0];
+    ASSERT_TRUE(txn_db_->Put(wr_opts, cf, "aaaa", "0").ok());
+    
+    std::unique_ptr<Transaction> txn(txn_db_->BeginTransaction(wr_opts, {}, nullptr));
+    ASSERT_TRUE(txn->SetName("txn1").ok());
+    ASSERT_TRUE(txn->Put(cf, "aaaa", "1").ok());
+    ASSERT_TRUE(txn->Put(cf, "bbbb", "1").ok());
+    auto rs = txn->Prepare();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = txn->Rollback();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(Transaction::ROLLEDBACK, txn->state());
+    
+    // The old values be restored.
+    std::string value;
+    rs = txn_db_->Get(rd_opts, cf, "aaaa", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("0", value);
+    rs = txn_db_->Get(rd_opts, cf, "bbbb", &value);
+    ASSERT_TRUE(rs.IsNotFound()) << rs.ToString();
+    
+    // The keys has been unlocked.
+    ASSERT_TRUE(txn_db_->Put(wr_opts, cf, "bbbb", "2").ok());
+    rs = txn_db_->Get(rd_opts, cf, "bbbb", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("2", value);
+}
+    
+TEST_F(PessimisticTransactionDBTest, PrepareRecovery) {
+    Open(12);
+    
+    WriteOptions wr_opts;
+    ReadOptions rd_opts;
+    ASSERT_TRUE(txn_db_->Put(wr_opts, cfs_[0], "aaaa", "0").ok());
+    
+    Transaction *txn = txn_db_->BeginTransaction(wr_opts, {}, nullptr);
+    ASSERT_TRUE(txn->SetName("txn1").ok());
+    ASSERT_TRUE(txn->Put(cfs_[0], "aaaa", "1").ok());
+    ASSERT_TRUE(txn->Put(cfs_[1], "bbbb", "1").ok());
+    auto rs = txn->Prepare();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    delete txn; // Crash before commit.
+    Close();
+    
+    Open(12);
+    std::string value;
+    rs = txn_db_->Get(rd_opts, cfs_[0], "aaaa", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("0", value);
+    rs = txn_db_->Get(rd_opts, cfs_[1], "bbbb", &value);
+    ASSERT_TRUE(rs.IsNotFound()) << rs.ToString();
+    
+    // Not claimed, must be recovered again, even if the old log be deleted.
+    ASSERT_TRUE(txn_db_->Put(wr_opts, cfs_[0], "cccc", "0").ok());
+    auto impl = down_cast<db::DBImpl>(txn_db_->GetDB());
+    for (int i = 0; i < 2; ++i) { // Only non-empty column families
+        rs = impl->TEST_ForceDumpImmutableTable(cfs_[i], true);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    Close();
+    Open(12);
+    
+    std::vector<Transaction *> txns;
+    rs = txn_db_->GetAllPreparedTransactions(&txns);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ(1, txns.size());
+    std::unique_ptr<Transaction> recovered(txns[0]);
+    EXPECT_EQ("txn1", recovered->name());
+    EXPECT_EQ(Transaction::PREPARED, recovered->state());
+    
+    // Still locked by recovered transaction.
+    TransactionOptions txn_opts;
+    txn_opts.lock_timeout = 10;
+    std::unique_ptr<Transaction> other(txn_db_->BeginTransaction(wr_opts, txn_opts, nullptr));
+    rs = other->Put(cfs_[0], "aaaa", "2");
+    ASSERT_TRUE(rs.IsTimeout()) << rs.ToString();
+    
+    rs = recovered->Commit();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = txn_db_->Get(rd_opts, cfs_[0], "aaaa", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("1", value);
+    rs = txn_db_->Get(rd_opts, cfs_[1], "bbbb", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("1", value);
+    recovered.reset();
+    other.reset();
+    
+    // The decision has been logged.
+    Close();
+    Open(12);
+    rs = txn_db_->GetAllPreparedTransactions(&txns);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_TRUE(txns.empty());
+    rs = txn_db_->Get(rd_opts, cfs_[1], "bbbb", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("1", value);
+}
+    
 } // namespace txn
 
 } // namespace mai
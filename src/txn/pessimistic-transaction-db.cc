@@ -1,5 +1,7 @@
 #include "txn/pessimistic-transaction-db.h"
 #include "txn/pessimistic-transaction.h"
+#include "db/db-impl.h"
+#include "db/commit-map.h"
 
 namespace mai {
     
@@ -16,6 +18,12 @@ PessimisticTransactionDB::PessimisticTransactionDB(const TransactionDBOptions &o
 }
     
 /*virtual*/ PessimisticTransactionDB::~PessimisticTransactionDB() {
+    // The not claimed transactions keep prepared, they will be recovered
+    // again by next opening.
+    for (auto txn : recovered_txns_) {
+        delete txn;
+    }
+    recovered_txns_.clear();
     DCHECK(txns_.empty());
     DCHECK(expirable_txns_.empty());
 }
@@ -31,7 +39,7 @@ PessimisticTransactionDB::NewColumnFamily(const std::string &name,
         return rs;
     }
     
-    lock_mgr_.AddColumnFamily((*result)->id());
+    AddColumnFamily(*result);
     return rs;
 }
     
@@ -86,6 +94,37 @@ PessimisticTransactionDB::BeginTransaction(const WriteOptions &wr_opts,
     return new PessimisticTransaction(txn_opts, wr_opts, this);
 }
     
+/*virtual*/ Error
+PessimisticTransactionDB::GetAllPreparedTransactions(std::vector<Transaction *> *txns) {
+    std::lock_guard<std::mutex> lock(name_mutex_);
+    txns->swap(recovered_txns_);
+    recovered_txns_.clear();
+    return Error::OK();
+}
+    
+Error PessimisticTransactionDB::RecoverPreparedTransactions() {
+    db::DBImpl *impl = down_cast<db::DBImpl>(GetDB());
+    std::vector<db::CommitMap::Prepared> prepared;
+    impl->commit_map()->GetAllPrepared(&prepared);
+    
+    for (const auto &item : prepared) {
+        std::unique_ptr<PessimisticTransaction>
+        txn(new PessimisticTransaction(TransactionOptions{}, WriteOptions{},
+                                       this));
+        Error rs = txn->SetName(item.name);
+        if (!rs) {
+            return rs;
+        }
+        rs = txn->RecoverPrepared(item.entries);
+        if (!rs) {
+            return rs;
+        }
+        std::lock_guard<std::mutex> lock(name_mutex_);
+        recovered_txns_.push_back(txn.release());
+    }
+    return Error::OK();
+}
+    
 Transaction *PessimisticTransactionDB::GetTransactionByName(const std::string &name) {
     std::lock_guard<std::mutex> lock(name_mutex_);
     auto iter = txns_.find(name);
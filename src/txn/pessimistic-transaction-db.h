@@ -9,6 +9,7 @@
 #include <atomic>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace mai {
     
@@ -35,12 +36,23 @@ public:
     virtual Transaction *BeginTransaction(const WriteOptions &wr_opts,
                                           const TransactionOptions &txn_opts,
                                           Transaction *old_txn) override;
+    virtual Error
+    GetAllPreparedTransactions(std::vector<Transaction *> *txns) override;
+    
+    // Rebuild the prepared transactions in DB after opening.
+    // REQUIRES: All column families has been added.
+    Error RecoverPreparedTransactions();
     
     Transaction *GetTransactionByName(const std::string &name);
     
     Error TryLock(PessimisticTransaction *txn, uint32_t cfid,
                   const std::string &hold_key,
                   bool exclusive);
+    Error TryLockRange(PessimisticTransaction *txn, uint32_t cfid,
+                       const std::string &begin, const std::string &end,
+                       bool exclusive) {
+        return lock_mgr_.TryLockRange(txn, cfid, begin, end, exclusive);
+    }
     void UnLock(PessimisticTransaction *txn,
                 const TxnKeyMaps *tracked_keys);
     void InsertExpirableTransaction(TxnID id, PessimisticTransaction *txn);
@@ -51,8 +63,8 @@ public:
     
     TxnID GenerateTxnID() { return next_txn_id_.fetch_add(1); }
     
-    void AddColumnFamily(uint32_t cfid) {
-        lock_mgr_.AddColumnFamily(cfid);
+    void AddColumnFamily(ColumnFamily *cf) {
+        lock_mgr_.AddColumnFamily(cf->id(), cf->comparator());
     }
 
     DISALLOW_IMPLICIT_CONSTRUCTORS(PessimisticTransactionDB);
@@ -67,6 +79,7 @@ private:
     std::unordered_map<TxnID, PessimisticTransaction *> expirable_txns_;
     std::mutex name_mutex_;
     std::unordered_map<std::string, Transaction *> txns_;
+    std::vector<Transaction *> recovered_txns_; // Not be claimed yet.
 }; // class PessimismTransactionDB
 
 } // namespace txn
@@ -33,6 +33,8 @@ void PessimisticTransaction::Reinitialize(const TransactionOptions &options,
         owns()->UnregisterTransaction(this);
     }
     TransactionBase::Reinitialize(wr_opts, db);
+    range_locked_cfs_.clear();
+    prepared_in_db_ = false;
     Initialize(options);
 }
     
@@ -69,6 +71,7 @@ bool PessimisticTransaction::IsExpired() const {
     
 /*virtual*/ void PessimisticTransaction::Clear() {
     owns()->UnLock(this, &tracked_keys());
+    range_locked_cfs_.clear();
     TransactionBase::Clear();
 }
     
@@ -98,6 +101,17 @@ bool PessimisticTransaction::IsExpired() const {
             Clear();
             set_state(ROLLEDBACK);
             break;
+        case PREPARED:
+            set_state(AWAITING_ROLLBACK);
+            // Must restore the old values before unlocking the keys.
+            if (prepared_in_db_) {
+                rs = impl()->RollbackPrepared(write_opts(), name_);
+            }
+            Clear();
+            if (rs.ok()) {
+                set_state(ROLLEDBACK);
+            }
+            break;
         case COMMITED:
             rs = MAI_CORRUPTION("This transaction has already been commited.");
             break;
@@ -108,7 +122,61 @@ bool PessimisticTransaction::IsExpired() const {
     return rs;
 }
 
+/*virtual*/ Error PessimisticTransaction::Prepare() {
+    if (name_.empty()) {
+        return MAI_CORRUPTION("Transaction must be named before prepare.");
+    }
+    if (IsExpired()) {
+        return MAI_CORRUPTION("This transaction has been expired.");
+    }
+    
+    bool ready_for_prepare = false;
+    if (expiration_time_ > 0) {
+        ready_for_prepare = update_state(STARTED, AWAITING_PREPARE);
+    } else if (state() == STARTED) {
+        ready_for_prepare = true;
+    }
+    
+    Error rs;
+    if (ready_for_prepare) {
+        set_state(AWAITING_PREPARE);
+        // Nothing to prepare, but still keep the state.
+        if (mutable_write_batch()->n_entries() > 0) {
+            rs = impl()->Prepare(write_opts(), name_, mutable_write_batch());
+            prepared_in_db_ = rs.ok();
+        }
+        set_state(rs.ok() ? PREPARED : STARTED);
+    } else if (state() == LOCKS_STOLEN) {
+        rs = MAI_CORRUPTION("This transaction has been expired.");
+    } else if (state() == PREPARED) {
+        rs = MAI_CORRUPTION("Transaction has already been prepared.");
+    } else if (state() == COMMITED) {
+        rs = MAI_CORRUPTION("Transaction has already been commited.");
+    } else if (state() == ROLLEDBACK) {
+        rs = MAI_CORRUPTION("Transaction has already been rollback.");
+    } else {
+        rs = MAI_CORRUPTION("Transaction is not in state for prepare.");
+    }
+    return rs;
+}
+
 /*virtual*/ Error PessimisticTransaction::Commit() {
+    Error rs;
+    if (state() == PREPARED) {
+        // The prepared transaction never be expired: its locks can not be
+        // stolen.
+        set_state(AWAITING_COMMIT);
+        if (prepared_in_db_) {
+            rs = impl()->CommitPrepared(write_opts(), name_);
+        }
+        owns()->UnregisterTransaction(this);
+        Clear();
+        if (rs.ok()) {
+            set_state(COMMITED);
+        }
+        return rs;
+    }
+    
     if (IsExpired()) {
         return MAI_CORRUPTION("This transaction has been expired.");
     }
@@ -120,7 +188,6 @@ bool PessimisticTransaction::IsExpired() const {
         ready_for_commit = true;
     }
     
-    Error rs;
     if (ready_for_commit) {
         set_state(AWAITING_COMMIT);
         rs = impl()->WriteImpl(write_opts(), mutable_write_batch(), nullptr);
@@ -188,6 +255,23 @@ PessimisticTransaction::TryLock(ColumnFamily* cf, std::string_view key,
     return rs;
 }
     
+/*virtual*/ Error
+PessimisticTransaction::LockRange(ColumnFamily *cf, std::string_view begin,
+                                  std::string_view end, bool exclusive) {
+    if (cf->comparator()->Compare(begin, end) > 0) {
+        return MAI_CORRUPTION("Bad range, begin > end.");
+    }
+    
+    uint32_t cfid = cf->id();
+    Error rs = owns()->TryLockRange(this, cfid, std::string(begin),
+                                    std::string(end), exclusive);
+    if (rs.ok() && std::find(range_locked_cfs_.begin(), range_locked_cfs_.end(),
+                             cfid) == range_locked_cfs_.end()) {
+        range_locked_cfs_.push_back(cfid);
+    }
+    return rs;
+}
+    
 Error PessimisticTransaction::CommitBatch(WriteBatch *updates) {
     TxnKeyMaps keys_to_unlock;
     Error rs = LockBatch(updates, &keys_to_unlock);
@@ -272,6 +356,27 @@ Error PessimisticTransaction::LockBatch(WriteBatch *updates,
     }
     return rs;
 }
+    
+Error PessimisticTransaction::RecoverPrepared(const std::string &entries) {
+    DCHECK_EQ(STARTED, state());
+    RecordHandler handler;
+    Error rs = WriteBatch::Iterate(entries.data(), entries.size(), &handler);
+    if (!rs) {
+        return rs;
+    }
+    for (const auto &cf : handler.keys_) {
+        for (const auto &key : cf.second) {
+            rs = owns()->TryLock(this, cf.first, key, true);
+            if (!rs) {
+                return rs;
+            }
+            TrackKey(cf.first, key, core::Tag::kMaxSequenceNumber, false, true);
+        }
+    }
+    prepared_in_db_ = true;
+    set_state(PREPARED);
+    return Error::OK();
+}
 
 } // namespace txn
     
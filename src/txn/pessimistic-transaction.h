@@ -60,9 +60,17 @@ public:
     virtual Error SetName(const std::string &name) override;
     
     virtual Error Rollback() override;
+    virtual Error Prepare() override;
     virtual Error Commit() override;
     virtual Error TryLock(ColumnFamily* cf, std::string_view key, bool read_only,
                           bool exclusive, const bool do_validate) override;
+    virtual Error LockRange(ColumnFamily *cf, std::string_view begin,
+                            std::string_view end, bool exclusive) override;
+    
+    // The column families in which this transaction locked ranges.
+    const std::vector<uint32_t> &range_locked_cfs() const {
+        return range_locked_cfs_;
+    }
     
     bool TryStealingLocks() {
         DCHECK(IsExpired());
@@ -72,17 +80,22 @@ public:
     Error CommitBatch(WriteBatch *updates);
     Error LockBatch(WriteBatch *updates, TxnKeyMaps *keys_to_unlock);
     
+    // Lock the keys of prepared entries again, after DB reopen.
+    Error RecoverPrepared(const std::string &entries);
+    
     DISALLOW_IMPLICIT_CONSTRUCTORS(PessimisticTransaction);
 private:
     TxnID txn_id_ = 0;
     std::string name_;
     std::vector<TxnID> waiting_txn_ids_;
+    std::vector<uint32_t> range_locked_cfs_;
     uint32_t waiting_cfid_ = 0;
     const std::string *waiting_key_ = nullptr;
     std::mutex wait_mutex_;
     mutable std::mutex mutex_;
     int64_t lock_timeout_ = -1;
     uint64_t expiration_time_ = 0;
+    bool prepared_in_db_ = false; // Has written the prepared entries into DB.
     bool deadlock_detect_ = false;
     int64_t deadlock_detect_depth_ = 50;
 }; // class PessimisticTransaction
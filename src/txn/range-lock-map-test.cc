@@ -0,0 +1,179 @@
+#include "txn/range-lock-map.h"
+#include "base/slice.h"
+#include "gtest/gtest.h"
+
+namespace mai {
+
+namespace txn {
+
+class RangeLockMapTest : public ::testing::Test {
+public:
+    RangeLockMapTest() {}
+
+    bool Lock(RangeLockMap *map, TxnID txn_id, std::string_view begin,
+              std::string_view end, bool exclusive) {
+        std::lock_guard<std::mutex> lock(*map->mutex());
+        return map->TryLock(txn_id, 0, begin, end, exclusive, &txn_ids_);
+    }
+
+    bool Lock(RangeLockMap *map, TxnID txn_id, std::string_view key,
+              bool exclusive) {
+        return Lock(map, txn_id, key, key, exclusive);
+    }
+
+    void UnlockAll(RangeLockMap *map, TxnID txn_id) {
+        std::lock_guard<std::mutex> lock(*map->mutex());
+        map->UnlockAll(txn_id);
+    }
+
+    const Comparator *cmp_ = Comparator::Bytewise();
+    std::vector<TxnID> txn_ids_;
+};
+
+TEST_F(RangeLockMapTest, PointLocks) {
+    RangeLockMap map(cmp_, 0);
+
+    ASSERT_TRUE(Lock(&map, 1, "aaa", false));
+    ASSERT_TRUE(Lock(&map, 2, "aaa", false));
+    ASSERT_FALSE(Lock(&map, 3, "aaa", true));
+    ASSERT_EQ(2, txn_ids_.size());
+    ASSERT_EQ(1, txn_ids_[0]);
+    ASSERT_EQ(2, txn_ids_[1]);
+
+    // Upgrade to exclusive after the other shared owner leaves.
+    ASSERT_FALSE(Lock(&map, 1, "aaa", true));
+    UnlockAll(&map, 2);
+    ASSERT_TRUE(Lock(&map, 1, "aaa", true));
+    ASSERT_FALSE(Lock(&map, 2, "aaa", false));
+    ASSERT_EQ(1, txn_ids_.size());
+    ASSERT_EQ(1, txn_ids_[0]);
+
+    ASSERT_TRUE(Lock(&map, 2, "aab", true));
+    UnlockAll(&map, 1);
+    ASSERT_TRUE(Lock(&map, 3, "aaa", true));
+}
+
+TEST_F(RangeLockMapTest, RangeLocks) {
+    RangeLockMap map(cmp_, 0);
+
+    ASSERT_TRUE(Lock(&map, 1, "b", "d", true));
+    // Keys in the gap can not be locked.
+    ASSERT_FALSE(Lock(&map, 2, "c", false));
+    ASSERT_FALSE(Lock(&map, 2, "bbbb", true));
+    ASSERT_FALSE(Lock(&map, 2, "a", "b", false));
+    ASSERT_FALSE(Lock(&map, 2, "d", "e", false));
+    ASSERT_TRUE(Lock(&map, 2, "a", "aaaa", true));
+    ASSERT_TRUE(Lock(&map, 2, "dd", "e", true));
+
+    // Owner can lock the keys in its range.
+    ASSERT_TRUE(Lock(&map, 1, "c", true));
+    ASSERT_EQ(0, map.NumPointLocks(1));
+    ASSERT_EQ(1, map.NumRangeLocks(1));
+
+    // Shared ranges can overlap.
+    ASSERT_TRUE(Lock(&map, 3, "x", "z", false));
+    ASSERT_TRUE(Lock(&map, 4, "w", "y", false));
+    ASSERT_TRUE(Lock(&map, 5, "y", false));
+    ASSERT_FALSE(Lock(&map, 5, "y", true));
+    ASSERT_EQ(2, txn_ids_.size());
+
+    UnlockAll(&map, 1);
+    ASSERT_TRUE(Lock(&map, 6, "c", true));
+    ASSERT_FALSE(Lock(&map, 7, "a", "z", false));
+    ASSERT_EQ(2, txn_ids_.size()); // txn 2 and 6
+}
+
+TEST_F(RangeLockMapTest, MergePointsIntoRange) {
+    RangeLockMap map(cmp_, 0);
+
+    ASSERT_TRUE(Lock(&map, 1, "b", false));
+    ASSERT_TRUE(Lock(&map, 1, "c", true));
+    ASSERT_TRUE(Lock(&map, 1, "x", true));
+    ASSERT_EQ(3, map.NumPointLocks(1));
+
+    // Shared range only covers shared points.
+    ASSERT_TRUE(Lock(&map, 1, "a", "d", false));
+    ASSERT_EQ(2, map.NumPointLocks(1));
+    ASSERT_TRUE(Lock(&map, 1, "a", "d", true));
+    ASSERT_EQ(1, map.NumPointLocks(1));
+    ASSERT_EQ(2, map.NumRangeLocks(1));
+
+    ASSERT_FALSE(Lock(&map, 2, "b", false));
+    UnlockAll(&map, 1);
+    ASSERT_EQ(0, map.NumPointLocks(1));
+    ASSERT_EQ(0, map.NumRangeLocks(1));
+    ASSERT_TRUE(Lock(&map, 2, "a", "z", true));
+}
+
+TEST_F(RangeLockMapTest, Escalation) {
+    RangeLockMap map(cmp_, 16);
+
+    for (int i = 0; i < 15; ++i) {
+        ASSERT_TRUE(Lock(&map, 1, base::Sprintf("k.%03d", i * 2), true));
+    }
+    ASSERT_EQ(15, map.NumPointLocks(1));
+    ASSERT_TRUE(Lock(&map, 2, "k.001", true));
+
+    // Can not escalate, txn 2 holds a key in range.
+    ASSERT_TRUE(Lock(&map, 1, "k.030", true));
+    ASSERT_EQ(16, map.NumPointLocks(1));
+    ASSERT_EQ(0, map.NumRangeLocks(1));
+
+    UnlockAll(&map, 2);
+    for (int i = 16; i < 32; ++i) {
+        ASSERT_TRUE(Lock(&map, 1, base::Sprintf("k.%03d", i * 2), true));
+    }
+    ASSERT_EQ(0, map.NumPointLocks(1));
+    ASSERT_EQ(1, map.NumRangeLocks(1));
+
+    // The gaps be locked after escalation.
+    ASSERT_FALSE(Lock(&map, 2, "k.001", false));
+    ASSERT_FALSE(Lock(&map, 2, "k.061", false));
+    ASSERT_TRUE(Lock(&map, 2, "k.063", false));
+}
+
+TEST_F(RangeLockMapTest, EscalateNearbyKeys) {
+    RangeLockMap map(cmp_, 4);
+
+    ASSERT_TRUE(Lock(&map, 1, "a.01", true));
+    ASSERT_TRUE(Lock(&map, 1, "a.02", true));
+    ASSERT_TRUE(Lock(&map, 1, "z.01", true));
+    ASSERT_TRUE(Lock(&map, 1, "z.02", true));
+    ASSERT_EQ(0, map.NumPointLocks(1));
+    ASSERT_EQ(2, map.NumRangeLocks(1));
+
+    // The unrelated key between two distant clusters is not blocked.
+    ASSERT_TRUE(Lock(&map, 2, "m", true));
+    ASSERT_TRUE(Lock(&map, 2, "b", "y", true));
+    ASSERT_FALSE(Lock(&map, 2, "a.015", false));
+    ASSERT_FALSE(Lock(&map, 2, "z.015", false));
+}
+
+TEST_F(RangeLockMapTest, ManyRanges) {
+    RangeLockMap map(cmp_, 0);
+
+    static const int kN = 1000;
+    for (int i = 0; i < kN; ++i) {
+        ASSERT_TRUE(Lock(&map, i + 1, base::Sprintf("k.%04d.0", i),
+                         base::Sprintf("k.%04d.5", i), i % 2 == 0));
+    }
+    for (int i = 0; i < kN; ++i) {
+        ASSERT_TRUE(Lock(&map, kN + 1, base::Sprintf("k.%04d.7", i), true));
+        ASSERT_FALSE(Lock(&map, kN + 1, base::Sprintf("k.%04d.3", i), true));
+        ASSERT_EQ(1, txn_ids_.size());
+        ASSERT_EQ(i + 1, txn_ids_[0]);
+    }
+    ASSERT_FALSE(Lock(&map, kN + 2, "k.0000.4", "k.0002.1", false));
+    // Ranges of txn 1 and 3, points of txn kN + 1, not shared range of txn 2
+    ASSERT_EQ(3, txn_ids_.size());
+
+    for (int i = 0; i < kN + 1; ++i) {
+        UnlockAll(&map, i + 1);
+    }
+    ASSERT_TRUE(Lock(&map, kN + 2, "k.0000.0", "k.0999.5", false));
+    ASSERT_FALSE(Lock(&map, kN + 3, "k.0500.0", "k.0500.1", true));
+}
+
+} // namespace txn
+
+} // namespace mai
@@ -0,0 +1,360 @@
+#include "txn/range-lock-map.h"
+#include "glog/logging.h"
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+namespace mai {
+
+namespace txn {
+
+RangeLockMap::RangeLockMap(const Comparator *ucmp, int escalation_threshold)
+    : ucmp_(DCHECK_NOTNULL(ucmp))
+    , escalation_threshold_(escalation_threshold)
+    , bound_less_{ucmp}
+    , points_(KeyLess{ucmp})
+    , segments_(bound_less_) {
+}
+
+bool RangeLockMap::TryLock(TxnID txn_id, uint64_t expiration_time,
+                           std::string_view begin, std::string_view end,
+                           bool exclusive, std::vector<TxnID> *txn_ids) {
+    DCHECK_LE(ucmp_->Compare(begin, end), 0);
+    const bool is_point = ucmp_->Compare(begin, end) == 0;
+    if (is_point && IsCoveredByOwnRange(txn_id, begin, exclusive)) {
+        return true;
+    }
+
+    txn_ids->clear();
+    GetConflicts(txn_id, begin, end, exclusive, txn_ids);
+    if (!txn_ids->empty()) {
+        return false;
+    }
+
+    Owner *owner = GetOrNewOwner(txn_id);
+    owner->expiration_time = expiration_time;
+    if (!is_point) {
+        AddRange(owner, txn_id, begin, end, exclusive);
+        return true;
+    }
+
+    AddPoint(owner, txn_id, begin, exclusive);
+    // Try escalation at every threshold points, not on every lock.
+    if (escalation_threshold_ > 0 &&
+        owner->points.size() >= static_cast<size_t>(escalation_threshold_) &&
+        owner->points.size() % escalation_threshold_ == 0) {
+        TryEscalate(owner, txn_id);
+    }
+    return true;
+}
+
+void RangeLockMap::UnlockAll(TxnID txn_id) {
+    auto iter = owners_.find(txn_id);
+    if (iter == owners_.end()) {
+        return;
+    }
+
+    for (const auto &key : iter->second.points) {
+        auto point = points_.find(key);
+        DCHECK(point != points_.end());
+        RemovePoint(point, txn_id);
+    }
+    for (const auto &range : iter->second.ranges) {
+        UnlockSegments(txn_id, range.first, range.second);
+    }
+    owners_.erase(iter);
+}
+
+uint64_t RangeLockMap::GetExpirationTime(TxnID txn_id) const {
+    auto iter = owners_.find(txn_id);
+    return iter == owners_.end() ? 0 : iter->second.expiration_time;
+}
+
+size_t RangeLockMap::NumPointLocks(TxnID txn_id) const {
+    auto iter = owners_.find(txn_id);
+    return iter == owners_.end() ? 0 : iter->second.points.size();
+}
+
+size_t RangeLockMap::NumRangeLocks(TxnID txn_id) const {
+    auto iter = owners_.find(txn_id);
+    return iter == owners_.end() ? 0 : iter->second.ranges.size();
+}
+
+void RangeLockMap::Wait() {
+    std::unique_lock<std::mutex> lock(mutex_, std::adopt_lock);
+    cv_.wait(lock);
+    lock.release();
+}
+
+void RangeLockMap::WaitFor(uint64_t micro_secs) {
+    std::unique_lock<std::mutex> lock(mutex_, std::adopt_lock);
+    cv_.wait_for(lock, std::chrono::microseconds(micro_secs));
+    lock.release();
+}
+
+void RangeLockMap::GetConflicts(TxnID txn_id, std::string_view begin,
+                                std::string_view end, bool exclusive,
+                                std::vector<TxnID> *txn_ids) const {
+    for (auto iter = points_.lower_bound(begin);
+         iter != points_.end() && ucmp_->Compare(iter->first, end) <= 0;
+         ++iter) {
+        if (!exclusive && !iter->second.exclusive) {
+            continue;
+        }
+        for (auto id : iter->second.txn_ids) {
+            if (id != txn_id) {
+                txn_ids->push_back(id);
+            }
+        }
+    }
+    const Bound limit{std::string(end), true};
+    for (auto iter = FindSegment(Bound{std::string(begin), false});
+         iter != segments_.end() && bound_less_(iter->first, limit); ++iter) {
+        for (const auto &holder : iter->second.holders) {
+            if (holder.txn_id != txn_id && (exclusive || holder.exclusive)) {
+                txn_ids->push_back(holder.txn_id);
+            }
+        }
+    }
+    std::sort(txn_ids->begin(), txn_ids->end());
+    txn_ids->erase(std::unique(txn_ids->begin(), txn_ids->end()),
+                   txn_ids->end());
+}
+
+bool RangeLockMap::IsCoveredByOwnRange(TxnID txn_id, std::string_view key,
+                                       bool exclusive) const {
+    auto iter = owners_.find(txn_id);
+    if (iter == owners_.end() || iter->second.ranges.empty()) {
+        return false;
+    }
+    // No segment starts in [{key, false}, {key, true}), so the segment
+    // covers the key if it covers {key, false}.
+    const Bound start{std::string(key), false};
+    auto segment = FindSegment(start);
+    if (segment == segments_.end() || bound_less_(start, segment->first)) {
+        return false;
+    }
+    for (const auto &holder : segment->second.holders) {
+        if (holder.txn_id == txn_id) {
+            return holder.exclusive || !exclusive;
+        }
+    }
+    return false;
+}
+
+void RangeLockMap::AddPoint(Owner *owner, TxnID txn_id, std::string_view key,
+                            bool exclusive) {
+    auto iter = points_.find(key);
+    if (iter == points_.end()) {
+        points_.emplace(std::string(key), PointLock{exclusive, {txn_id}});
+        owner->points.emplace(key);
+        return;
+    }
+
+    auto *txn_ids = &iter->second.txn_ids;
+    if (std::find(txn_ids->begin(), txn_ids->end(), txn_id) == txn_ids->end()) {
+        DCHECK(!exclusive && !iter->second.exclusive);
+        txn_ids->push_back(txn_id);
+        owner->points.emplace(key);
+    } else {
+        // Upgrade: This transaction is the only owner.
+        DCHECK(!exclusive || txn_ids->size() == 1);
+        iter->second.exclusive = iter->second.exclusive || exclusive;
+    }
+}
+
+void RangeLockMap::AddRange(Owner *owner, TxnID txn_id, std::string_view begin,
+                            std::string_view end, bool exclusive) {
+    // Own points in range be merged into range.
+    auto iter = owner->points.lower_bound(begin);
+    while (iter != owner->points.end() && ucmp_->Compare(*iter, end) <= 0) {
+        auto point = points_.find(*iter);
+        DCHECK(point != points_.end());
+        if (exclusive || !point->second.exclusive) {
+            RemovePoint(point, txn_id);
+            iter = owner->points.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    LockSegments(txn_id, begin, end, exclusive);
+    owner->ranges.emplace_back(begin, end);
+}
+
+void RangeLockMap::RemovePoint(PointMap::iterator iter, TxnID txn_id) {
+    auto *txn_ids = &iter->second.txn_ids;
+    auto found = std::find(txn_ids->begin(), txn_ids->end(), txn_id);
+    DCHECK(found != txn_ids->end());
+    *found = txn_ids->back();
+    txn_ids->pop_back();
+    if (txn_ids->empty()) {
+        points_.erase(iter);
+    }
+}
+
+void RangeLockMap::TryEscalate(Owner *owner, TxnID txn_id) {
+    // Split the points into clusters of nearby keys.
+    std::vector<std::pair<std::string, std::string>> clusters;
+    for (const auto &key : owner->points) {
+        if (clusters.empty() || !IsNearby(clusters.back().second, key)) {
+            clusters.emplace_back(key, key);
+        } else {
+            clusters.back().second = key;
+        }
+    }
+    
+    std::vector<TxnID> txn_ids;
+    for (const auto &cluster : clusters) {
+        const std::string &begin = cluster.first;
+        const std::string &end   = cluster.second;
+        if (ucmp_->Compare(begin, end) == 0) {
+            continue; // Only one point.
+        }
+        bool exclusive = false;
+        for (auto iter = owner->points.lower_bound(begin);
+             iter != owner->points.end() && ucmp_->Compare(*iter, end) <= 0;
+             ++iter) {
+            if (points_.find(*iter)->second.exclusive) {
+                exclusive = true;
+                break;
+            }
+        }
+        txn_ids.clear();
+        GetConflicts(txn_id, begin, end, exclusive, &txn_ids);
+        if (!txn_ids.empty()) {
+            continue; // Keep the point locks.
+        }
+        AddRange(owner, txn_id, begin, end, exclusive);
+    }
+}
+    
+bool RangeLockMap::IsNearby(std::string_view lhs, std::string_view rhs) const {
+    size_t n = std::min(lhs.size(), rhs.size());
+    size_t prefix = 0;
+    while (prefix < n && lhs[prefix] == rhs[prefix]) {
+        prefix++;
+    }
+    return prefix + kClusterSuffixBytes >= std::max(lhs.size(), rhs.size());
+}
+
+RangeLockMap::Owner *RangeLockMap::GetOrNewOwner(TxnID txn_id) {
+    auto iter = owners_.find(txn_id);
+    if (iter == owners_.end()) {
+        iter = owners_.emplace(txn_id, Owner(KeyLess{ucmp_})).first;
+    }
+    return &iter->second;
+}
+
+RangeLockMap::SegmentMap::const_iterator
+RangeLockMap::FindSegment(const Bound &bound) const {
+    auto iter = segments_.upper_bound(bound);
+    if (iter != segments_.begin()) {
+        auto prev = std::prev(iter);
+        if (bound_less_(bound, prev->second.limit)) {
+            return prev;
+        }
+    }
+    return iter;
+}
+    
+void RangeLockMap::SplitSegment(const Bound &bound) {
+    auto iter = segments_.upper_bound(bound);
+    if (iter == segments_.begin()) {
+        return;
+    }
+    --iter;
+    if (!bound_less_(iter->first, bound) ||
+        !bound_less_(bound, iter->second.limit)) {
+        return; // Be start of segment or not in segment.
+    }
+    Segment right{iter->second.limit, iter->second.holders};
+    iter->second.limit = bound;
+    segments_.emplace_hint(std::next(iter), bound, std::move(right));
+}
+    
+RangeLockMap::SegmentMap::iterator
+RangeLockMap::MergeSegment(SegmentMap::iterator iter) {
+    if (iter == segments_.begin() || iter == segments_.end()) {
+        return iter;
+    }
+    auto prev = std::prev(iter);
+    if (bound_less_(prev->second.limit, iter->first) ||
+        prev->second.holders.size() != iter->second.holders.size()) {
+        return iter;
+    }
+    for (size_t i = 0; i < iter->second.holders.size(); ++i) {
+        const Holder &lhs = prev->second.holders[i];
+        const Holder &rhs = iter->second.holders[i];
+        if (lhs.txn_id != rhs.txn_id || lhs.exclusive != rhs.exclusive) {
+            return iter;
+        }
+    }
+    prev->second.limit = iter->second.limit;
+    segments_.erase(iter);
+    return prev;
+}
+    
+void RangeLockMap::LockSegments(TxnID txn_id, std::string_view begin,
+                                std::string_view end, bool exclusive) {
+    const Bound start{std::string(begin), false};
+    const Bound limit{std::string(end), true};
+    SplitSegment(start);
+    SplitSegment(limit);
+    
+    Bound pos = start;
+    auto iter = segments_.lower_bound(start);
+    while (bound_less_(pos, limit)) {
+        if (iter == segments_.end() || bound_less_(pos, iter->first)) {
+            // Fill the gap before next segment.
+            Bound gap_limit = (iter == segments_.end() ||
+                               bound_less_(limit, iter->first)) ?
+                              limit : iter->first;
+            iter = segments_.emplace_hint(iter, pos,
+                                          Segment{gap_limit,
+                                                  {{txn_id, exclusive}}});
+        } else {
+            auto *holders = &iter->second.holders;
+            auto found = std::lower_bound(holders->begin(), holders->end(),
+                                          txn_id,
+                                          [] (const Holder &h, TxnID id) {
+                                              return h.txn_id < id;
+                                          });
+            if (found != holders->end() && found->txn_id == txn_id) {
+                found->exclusive = found->exclusive || exclusive;
+            } else {
+                holders->insert(found, Holder{txn_id, exclusive});
+            }
+        }
+        pos = iter->second.limit;
+        iter = MergeSegment(iter);
+        ++iter;
+    }
+    MergeSegment(iter);
+}
+    
+void RangeLockMap::UnlockSegments(TxnID txn_id, std::string_view begin,
+                                  std::string_view end) {
+    // All segments of the transaction be in its ranges, so it can be removed
+    // from the whole segment.
+    const Bound limit{std::string(end), true};
+    auto first = FindSegment(Bound{std::string(begin), false});
+    auto iter = segments_.erase(first, first); // To mutable iterator.
+    while (iter != segments_.end() && bound_less_(iter->first, limit)) {
+        auto *holders = &iter->second.holders;
+        holders->erase(std::remove_if(holders->begin(), holders->end(),
+                                      [txn_id] (const Holder &h) {
+                                          return h.txn_id == txn_id;
+                                      }), holders->end());
+        if (holders->empty()) {
+            iter = segments_.erase(iter);
+        } else {
+            iter = MergeSegment(iter);
+            ++iter;
+        }
+    }
+    MergeSegment(iter);
+}
+    
+} // namespace txn
+
+} // namespace mai
@@ -0,0 +1,155 @@
+#ifndef MAI_TXN_RANGE_LOCK_MAP_H_
+#define MAI_TXN_RANGE_LOCK_MAP_H_
+
+#include "base/base.h"
+#include "mai/comparator.h"
+#include "mai/transaction.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mai {
+
+namespace txn {
+
+// The ordered lock table of one column family, for range locking. A point
+// lock is the range [key, key]. The range locks also lock the gaps between
+// keys, so no other transaction can insert a key into a locked range.
+//
+// The range locks be split into disjoint segments in an ordered map, every
+// segment has its holders. So a lock only looks up the overlapping segments.
+//
+// When a transaction holds too many point locks, every cluster of nearby
+// keys be escalated to one range lock, if no other transaction holds a
+// conflicting lock in it. The keys in one cluster only differ in the last
+// kClusterSuffixBytes bytes, so the far away keys never be escalated
+// together and the large gaps between them be not locked.
+class RangeLockMap final {
+public:
+    static const size_t kClusterSuffixBytes = 2;
+    
+    RangeLockMap(const Comparator *ucmp, int escalation_threshold);
+
+    // Lock [begin, end] for the transaction. If fail, the conflicting
+    // transactions be returned in txn_ids.
+    // REQUIRES: mutex()->lock()
+    bool TryLock(TxnID txn_id, uint64_t expiration_time,
+                 std::string_view begin, std::string_view end,
+                 bool exclusive, std::vector<TxnID> *txn_ids);
+
+    // Unlock all points and ranges of the transaction.
+    // REQUIRES: mutex()->lock()
+    void UnlockAll(TxnID txn_id);
+
+    // REQUIRES: mutex()->lock()
+    uint64_t GetExpirationTime(TxnID txn_id) const;
+    // REQUIRES: mutex()->lock()
+    size_t NumPointLocks(TxnID txn_id) const;
+    // REQUIRES: mutex()->lock()
+    size_t NumRangeLocks(TxnID txn_id) const;
+
+    std::mutex *mutex() { return &mutex_; }
+
+    // REQUIRES: mutex()->lock()
+    void Wait();
+    // REQUIRES: mutex()->lock()
+    void WaitFor(uint64_t micro_secs);
+    void NotifyAll() { cv_.notify_all(); }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(RangeLockMap);
+private:
+    struct KeyLess final {
+        using is_transparent = void; // Find by std::string_view
+
+        const Comparator *ucmp;
+        bool operator () (std::string_view lhs, std::string_view rhs) const {
+            return ucmp->Compare(lhs, rhs) < 0;
+        }
+    }; // struct KeyLess
+
+    struct PointLock {
+        bool exclusive;
+        std::vector<TxnID> txn_ids;
+    }; // struct PointLock
+
+    // The position just before or after a key, so the closed range
+    // [begin, end] be the half-open range [{begin, false}, {end, true}).
+    struct Bound {
+        std::string key;
+        bool after;
+    }; // struct Bound
+
+    struct BoundLess final {
+        const Comparator *ucmp;
+        bool operator () (const Bound &lhs, const Bound &rhs) const {
+            int rv = ucmp->Compare(lhs.key, rhs.key);
+            return rv == 0 ? (!lhs.after && rhs.after) : rv < 0;
+        }
+    }; // struct BoundLess
+
+    struct Holder {
+        TxnID txn_id;
+        bool exclusive;
+    }; // struct Holder
+
+    // The segment [start, limit), start is the key of SegmentMap.
+    struct Segment {
+        Bound limit;
+        std::vector<Holder> holders; // Ordered by txn_id
+    }; // struct Segment
+
+    struct Owner {
+        uint64_t expiration_time = 0;
+        std::set<std::string, KeyLess> points;
+        std::vector<std::pair<std::string, std::string>> ranges;
+
+        explicit Owner(KeyLess less) : points(less) {}
+    }; // struct Owner
+
+    using PointMap = std::map<std::string, PointLock, KeyLess>;
+    using SegmentMap = std::map<Bound, Segment, BoundLess>;
+
+    void GetConflicts(TxnID txn_id, std::string_view begin,
+                      std::string_view end, bool exclusive,
+                      std::vector<TxnID> *txn_ids) const;
+    bool IsCoveredByOwnRange(TxnID txn_id, std::string_view key,
+                             bool exclusive) const;
+    void AddPoint(Owner *owner, TxnID txn_id, std::string_view key,
+                  bool exclusive);
+    void AddRange(Owner *owner, TxnID txn_id, std::string_view begin,
+                  std::string_view end, bool exclusive);
+    void RemovePoint(PointMap::iterator iter, TxnID txn_id);
+    void TryEscalate(Owner *owner, TxnID txn_id);
+    bool IsNearby(std::string_view lhs, std::string_view rhs) const;
+    Owner *GetOrNewOwner(TxnID txn_id);
+    
+    // The first segment which limit is after bound.
+    SegmentMap::const_iterator FindSegment(const Bound &bound) const;
+    // Split the segment at bound, if bound is in it.
+    void SplitSegment(const Bound &bound);
+    // Merge the segment into the previous one, if they have same holders.
+    SegmentMap::iterator MergeSegment(SegmentMap::iterator iter);
+    void LockSegments(TxnID txn_id, std::string_view begin,
+                      std::string_view end, bool exclusive);
+    void UnlockSegments(TxnID txn_id, std::string_view begin,
+                        std::string_view end);
+
+    const Comparator *const ucmp_;
+    const int escalation_threshold_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    const BoundLess bound_less_;
+    PointMap points_;
+    SegmentMap segments_;
+    std::unordered_map<TxnID, Owner> owners_;
+}; // class RangeLockMap
+
+} // namespace txn
+
+} // namespace mai
+
+#endif // MAI_TXN_RANGE_LOCK_MAP_H_
@@ -58,6 +58,9 @@ public:
     virtual Error SetName(const std::string &name) override {
         return Error::OK();
     }
+    virtual Error Prepare() override {
+        return MAI_NOT_SUPPORTED("Two-phase commit.");
+    }
 
     virtual Error Put(ColumnFamily *cf, std::string_view key,
                       std::string_view value) override;
@@ -69,6 +72,10 @@ public:
                                bool exclusive, const bool do_validate) override;
     virtual Iterator* GetIterator(const ReadOptions& opts,
                                   ColumnFamily* cf) override;
+    virtual Error LockRange(ColumnFamily *cf, std::string_view begin,
+                            std::string_view end, bool exclusive) override {
+        return MAI_NOT_SUPPORTED("Range lock.");
+    }
     
     virtual Error TryLock(ColumnFamily* cf, std::string_view key, bool read_only,
                           bool exclusive, const bool do_validate) = 0;
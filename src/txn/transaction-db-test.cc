@@ -1,6 +1,9 @@
 #include "mai/transaction-db.h"
 #include "mai/transaction.h"
 #include "mai/iterator.h"
+#include "mai/perf-context.h"
+#include "mai/sst-file-writer.h"
+#include "base/slice.h"
 #include "gtest/gtest.h"
 
 namespace mai {
@@ -35,6 +38,8 @@ const char *TransactionDBTest::tmp_dirs[] = {
     "tests/02-txn-db-optimism-put-with-txn",
     "tests/03-txn-db-optimism-write-conflict",
     "tests/04-txn-db-iterate",
+    "tests/05-txn-db-optimism-recent-writes",
+    "tests/06-txn-db-optimism-ingest-files",
     nullptr,
 };
     
@@ -279,4 +284,95 @@ TEST_F(TransactionDBTest, TransactionIterate) {
     ASSERT_FALSE(iter->Valid());
 }
     
+TEST_F(TransactionDBTest, OptimismRecentWrites) {
+    std::unique_ptr<TransactionDB> db;
+    TransactionDB *result = nullptr;
+    Error rs = TransactionDB::Open(options_, txn_db_opts_, tmp_dirs[5], {},
+                                   nullptr, &result);
+    db.reset(result);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    auto cf0 = db->DefaultColumnFamily();
+    WriteOptions wr_opts;
+    for (int i = 0; i < 100; ++i) {
+        rs = db->Put(wr_opts, cf0, base::Sprintf("k.%d", i), "v");
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+    }
+    
+    PerfContext::SetLevel(kPerfEnableCount);
+    PerfContext::Current()->Reset();
+    std::unique_ptr<Transaction> txn(db->BeginTransaction(wr_opts));
+    for (int i = 0; i < 100; ++i) {
+        std::string value;
+        rs = txn->GetForUpdate(ReadOptions{}, cf0, base::Sprintf("k.%d", i),
+                               &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        txn->Put(cf0, base::Sprintf("k.%d", i), "vv");
+    }
+    rs = txn->Commit();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    // No one was written after tracked, all checks be skipped.
+    EXPECT_EQ(100, PerfContext::Current()->txn_check_skips);
+    EXPECT_EQ(0, PerfContext::Current()->txn_check_lookups);
+    
+    PerfContext::Current()->Reset();
+    txn.reset(db->BeginTransaction(wr_opts));
+    for (int i = 0; i < 100; ++i) {
+        txn->Put(cf0, base::Sprintf("k.%d", i), "vvv");
+    }
+    rs = db->Put(wr_opts, cf0, "k.50", "x");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = txn->Commit();
+    ASSERT_TRUE(rs.IsBusy()) << rs.ToString();
+    EXPECT_LE(1, PerfContext::Current()->txn_check_lookups);
+    PerfContext::SetLevel(kPerfDisable);
+    
+    std::string value;
+    rs = db->Get(ReadOptions{}, cf0, "k.50", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("x", value);
+    rs = db->Get(ReadOptions{}, cf0, "k.49", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("vv", value);
+}
+    
+TEST_F(TransactionDBTest, OptimismIngestFiles) {
+    std::unique_ptr<TransactionDB> db;
+    TransactionDB *result = nullptr;
+    Error rs = TransactionDB::Open(options_, txn_db_opts_, tmp_dirs[6], {},
+                                   nullptr, &result);
+    db.reset(result);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    auto cf0 = db->DefaultColumnFamily();
+    WriteOptions wr_opts;
+    rs = db->Put(wr_opts, cf0, "k.1", "v");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    std::unique_ptr<Transaction> txn(db->BeginTransaction(wr_opts));
+    std::string value;
+    rs = txn->GetForUpdate(ReadOptions{}, cf0, "k.1", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    txn->Put(cf0, "k.1", "vv");
+    
+    std::string file = std::string(tmp_dirs[6]) + "/ingest.sst";
+    std::unique_ptr<SstFileWriter> writer(SstFileWriter::New(ColumnFamilyOptions{},
+                                                             env_, 1));
+    rs = writer->Open(file);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = writer->Put("k.1", "x");
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = writer->Finish();
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    rs = db->IngestExternalFiles(IngestExternalFileOptions{}, cf0, {file});
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    
+    // The ingested key be written after tracked.
+    rs = txn->Commit();
+    ASSERT_TRUE(rs.IsBusy()) << rs.ToString();
+    rs = db->Get(ReadOptions{}, cf0, "k.1", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("x", value);
+}
+    
 } // namespace mai
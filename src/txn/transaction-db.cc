@@ -24,7 +24,7 @@ TransactionDB::Open(const Options &opts,
         auto txn_db = new txn::PessimisticTransactionDB(txn_db_opts, db);
         if (column_families && !column_families->empty()) {
             for (auto cf : *column_families) {
-                txn_db->AddColumnFamily(cf->id());
+                txn_db->AddColumnFamily(cf);
             }
         } else {
             std::vector<ColumnFamily *> cfs;
@@ -35,10 +35,15 @@ TransactionDB::Open(const Options &opts,
                 return rs;
             }
             for (auto cf : cfs) {
-                txn_db->AddColumnFamily(cf->id());
+                txn_db->AddColumnFamily(cf);
                 db->ReleaseColumnFamily(cf);
             }
         }
+        rs = txn_db->RecoverPreparedTransactions();
+        if (!rs) {
+            delete txn_db;
+            return rs;
+        }
         *result =txn_db;
     }
     return Error::OK();
@@ -1,8 +1,10 @@
 #include "txn/transaction-lock-mgr.h"
 #include "txn/pessimistic-transaction.h"
 #include "txn/pessimistic-transaction-db.h"
+#include "txn/range-lock-map.h"
 #include "db/db-impl.h"
 #include "base/hash.h"
+#include <thread>
 
 namespace mai {
     
@@ -23,7 +25,7 @@ struct LockInfo {
 struct LockMapStripe {
     std::mutex strip_mutex;
     std::condition_variable stripe_cv;
-    std::unordered_map<std::string, LockInfo> keys;
+    std::unordered_map<uint64_t, LockInfo> keys; // Keyed by hash of key
     
     void Wait() {
         std::unique_lock<std::mutex> lock(strip_mutex, std::adopt_lock);
@@ -41,13 +43,41 @@ struct LockMapStripe {
     }
 }; // struct LockMapStripe
     
+// The word of fast slot:
+//   0                          : Free.
+//   kClaimedWord               : Being locked by fast path.
+//   kExclusiveBit | txn_id     : Locked by one transaction in fast path.
+//   kSharedBit | txn_id        :
+//   kInflatedBit | n           : Governed by stripe, there are n locked keys
+//                                of this slot in the stripe.
+struct FastLockSlot {
+    static constexpr uint64_t kInflatedBit  = 1ULL << 63;
+    static constexpr uint64_t kExclusiveBit = 1ULL << 62;
+    static constexpr uint64_t kSharedBit    = 1ULL << 61;
+    static constexpr uint64_t kClaimedWord  = 1ULL << 60;
+    static constexpr uint64_t kOwnerMask    = kClaimedWord - 1;
+    static constexpr uint64_t kModeMask     = kExclusiveBit | kSharedBit;
+    
+    std::atomic<uint64_t> word{0};
+    std::atomic<uint64_t> key_hash{0};
+    
+    static bool IsOwnedBy(uint64_t word, TxnID txn_id) {
+        return (word & kModeMask) != 0 && (word & ~kModeMask) == txn_id;
+    }
+}; // struct FastLockSlot
+    
 struct LockMap {
     const size_t n_stripes;
+    const size_t n_slots;
     std::atomic<int64_t> lock_count{0};
     std::vector<LockMapStripe *> lock_map_stripes;
+    std::unique_ptr<FastLockSlot[]> slots;
+    std::unique_ptr<RangeLockMap> range_lock_map; // Only for range locking
     
     explicit LockMap(size_t n)
-        : n_stripes(n) {
+        : n_stripes(n)
+        , n_slots(n * TransactionLockMgr::kSlotsPerStripe)
+        , slots(new FastLockSlot[n_slots]) {
         lock_map_stripes.reserve(n);
         for (size_t i = 0; i < n; ++i) {
             lock_map_stripes.push_back(new LockMapStripe);
@@ -60,8 +90,89 @@ struct LockMap {
         }
     }
     
-    size_t GetStripe(const std::string &key) const {
-        return base::Hash::Js(key.data(), key.size()) % n_stripes;
+    FastLockSlot *GetSlot(uint64_t key_hash) const {
+        return &slots[key_hash % n_slots];
+    }
+    
+    // The slot of key always belongs to the stripe of key.
+    size_t GetStripe(uint64_t key_hash) const {
+        return (key_hash % n_slots) % n_stripes;
+    }
+    
+    // Lock the key by CAS if no other key or transaction be using its slot.
+    bool TryFastLock(TxnID txn_id, uint64_t key_hash, bool exclusive) {
+        FastLockSlot *slot = GetSlot(key_hash);
+        const uint64_t mode = exclusive ? FastLockSlot::kExclusiveBit :
+                              FastLockSlot::kSharedBit;
+        uint64_t word = slot->word.load(std::memory_order_acquire);
+        if (word == 0) {
+            if (!slot->word.compare_exchange_strong(word,
+                                                    FastLockSlot::kClaimedWord,
+                                                    std::memory_order_acq_rel)) {
+                return false;
+            }
+            slot->key_hash.store(key_hash, std::memory_order_relaxed);
+            slot->word.store(mode | txn_id, std::memory_order_release);
+            return true;
+        }
+        if (!FastLockSlot::IsOwnedBy(word, txn_id) ||
+            slot->key_hash.load(std::memory_order_relaxed) != key_hash) {
+            return false;
+        }
+        if ((word & FastLockSlot::kExclusiveBit) || !exclusive) {
+            return true; // Has been locked.
+        }
+        // Upgrade: The only shared owner is this transaction.
+        return slot->word.compare_exchange_strong(word,
+                                                  mode | txn_id,
+                                                  std::memory_order_acq_rel);
+    }
+    
+    bool TryFastUnlock(TxnID txn_id, uint64_t key_hash) {
+        FastLockSlot *slot = GetSlot(key_hash);
+        uint64_t word = slot->word.load(std::memory_order_acquire);
+        if (!FastLockSlot::IsOwnedBy(word, txn_id) ||
+            slot->key_hash.load(std::memory_order_relaxed) != key_hash) {
+            return false;
+        }
+        return slot->word.compare_exchange_strong(word, 0,
+                                                  std::memory_order_acq_rel);
+    }
+    
+    // Move the fast path lock of slot into stripe, then all keys of this slot
+    // be locked in stripe, until no key of slot in stripe.
+    // REQUIRES: stripe->strip_mutex.lock()
+    void Inflate(FastLockSlot *slot, LockMapStripe *stripe) {
+        while (true) {
+            uint64_t word = slot->word.load(std::memory_order_acquire);
+            if (word & FastLockSlot::kInflatedBit) {
+                return;
+            }
+            if (word == FastLockSlot::kClaimedWord) {
+                std::this_thread::yield();
+                continue;
+            }
+            uint64_t inflated = FastLockSlot::kInflatedBit + (word == 0 ? 0 : 1);
+            if (!slot->word.compare_exchange_strong(word, inflated,
+                                                    std::memory_order_acq_rel)) {
+                continue;
+            }
+            if (word != 0) {
+                // The owner can not change key_hash after inflated.
+                uint64_t key_hash = slot->key_hash.load(std::memory_order_relaxed);
+                stripe->keys.insert({key_hash,
+                    LockInfo(word & FastLockSlot::kOwnerMask, 0,
+                             (word & FastLockSlot::kExclusiveBit) != 0)});
+            }
+            return;
+        }
+    }
+    
+    // Give the slot back to fast path if no key of it in stripe.
+    // REQUIRES: stripe->strip_mutex.lock()
+    void MaybeDeflate(FastLockSlot *slot) {
+        uint64_t word = FastLockSlot::kInflatedBit;
+        slot->word.compare_exchange_strong(word, 0, std::memory_order_acq_rel);
     }
 }; // struct LockMap
     
@@ -169,12 +280,17 @@ TransactionLockMgr::~TransactionLockMgr() {
     
 }
 
-void TransactionLockMgr::AddColumnFamily(uint32_t cfid) {
+void TransactionLockMgr::AddColumnFamily(uint32_t cfid,
+                                         const Comparator *ucmp) {
     std::lock_guard<std::mutex> lock(lock_map_mutex_);
     DCHECK(lock_maps_.find(cfid) == lock_maps_.end());
 
-    lock_maps_.insert({cfid,
-                       std::shared_ptr<LockMap>(new LockMap(default_num_stripes_))});
+    std::shared_ptr<LockMap> lock_map(new LockMap(default_num_stripes_));
+    if (owns_->options().range_locking) {
+        lock_map->range_lock_map.reset(
+            new RangeLockMap(ucmp, owns_->options().range_lock_escalation));
+    }
+    lock_maps_.insert({cfid, lock_map});
 }
 
 void TransactionLockMgr::RemoveColumnFamily(uint32_t cfid) {
@@ -191,19 +307,53 @@ Error TransactionLockMgr::TryLock(PessimisticTransaction *txn, uint32_t cfid,
     if (!lock_map) {
         return MAI_CORRUPTION("Column family not found!");
     }
+    DCHECK_LT(txn->id(), FastLockSlot::kClaimedWord);
+    if (lock_map->range_lock_map) {
+        return AcquireRange(txn, lock_map->range_lock_map.get(), cfid, key, key,
+                            exclusive);
+    }
     
-    auto stripe_idx = lock_map->GetStripe(key);
+    const uint64_t key_hash = base::Hash::Murmur64(key.data(), key.size());
+    // The fast path can not track the number and the expiration of locks.
+    if (max_num_locks_ <= 0 && txn->expiration_time() == 0 &&
+        lock_map->TryFastLock(txn->id(), key_hash, exclusive)) {
+        return Error::OK();
+    }
+    
+    auto stripe_idx = lock_map->GetStripe(key_hash);
     DCHECK_GT(lock_map->lock_map_stripes.size(), stripe_idx);
     
     auto stripe = lock_map->lock_map_stripes.at(stripe_idx);
     LockInfo lock_info(txn->id(), txn->expiration_time(), exclusive);
     
-    return AcquireWithTimeout(txn, lock_map.get(), stripe, cfid, key,
+    return AcquireWithTimeout(txn, lock_map.get(), stripe, cfid, key, key_hash,
                               txn->lock_timeout(), lock_info);
 }
     
+Error TransactionLockMgr::TryLockRange(PessimisticTransaction *txn,
+                                       uint32_t cfid, const std::string &begin,
+                                       const std::string &end, bool exclusive) {
+    std::shared_ptr<LockMap> lock_map = GetLockMap(cfid);
+    if (!lock_map) {
+        return MAI_CORRUPTION("Column family not found!");
+    }
+    if (!lock_map->range_lock_map) {
+        return MAI_NOT_SUPPORTED("Range locking is disabled.");
+    }
+    return AcquireRange(txn, lock_map->range_lock_map.get(), cfid, begin, end,
+                        exclusive);
+}
+    
 void TransactionLockMgr::Unlock(PessimisticTransaction *txn,
                                 const TxnKeyMaps *tracked_keys) {
+    // The ranges be not tracked by keys.
+    for (auto cfid : txn->range_locked_cfs()) {
+        std::shared_ptr<LockMap> lock_map = GetLockMap(cfid);
+        if (lock_map && lock_map->range_lock_map) {
+            UnlockRanges(txn, lock_map->range_lock_map.get());
+        }
+    }
+    
     for (auto &key_map : *tracked_keys) {
         uint32_t cfid = key_map.first;
         auto &keys = key_map.second;
@@ -212,13 +362,22 @@ void TransactionLockMgr::Unlock(PessimisticTransaction *txn,
         if (!lock_map) {
             return;
         }
+        if (lock_map->range_lock_map) {
+            UnlockRanges(txn, lock_map->range_lock_map.get());
+            continue;
+        }
         
-        std::unordered_map<size_t, std::vector<const std::string *>>
+        std::unordered_map<size_t, std::vector<uint64_t>>
             keys_by_stripe(std::max(keys.size(), lock_map->n_stripes));
         
         for (const auto &pair : keys) {
-            size_t stripe_idx = lock_map->GetStripe(pair.first); // key;
-            keys_by_stripe[stripe_idx].push_back(&pair.first);
+            uint64_t key_hash = base::Hash::Murmur64(pair.first.data(),
+                                                     pair.first.size());
+            if (lock_map->TryFastUnlock(txn->id(), key_hash)) {
+                continue; // No one waits for fast path locks.
+            }
+            size_t stripe_idx = lock_map->GetStripe(key_hash);
+            keys_by_stripe[stripe_idx].push_back(key_hash);
         }
         
         for (const auto &pair : keys_by_stripe) {
@@ -230,8 +389,8 @@ void TransactionLockMgr::Unlock(PessimisticTransaction *txn,
             
             stripe->strip_mutex.lock();
             
-            for (auto key : stripe_keys) {
-                UnlockKey(txn, *key, stripe, lock_map.get());
+            for (auto key_hash : stripe_keys) {
+                UnlockKey(txn, key_hash, stripe, lock_map.get());
             }
             
             stripe->strip_mutex.unlock();
@@ -240,10 +399,18 @@ void TransactionLockMgr::Unlock(PessimisticTransaction *txn,
     }
 }
     
+void TransactionLockMgr::UnlockRanges(PessimisticTransaction *txn,
+                                      RangeLockMap *range_map) {
+    range_map->mutex()->lock();
+    range_map->UnlockAll(txn->id());
+    range_map->mutex()->unlock();
+    range_map->NotifyAll();
+}
+    
 void TransactionLockMgr::UnlockKey(PessimisticTransaction *txn,
-                                   const std::string &key,
+                                   uint64_t key_hash,
                                    LockMapStripe *stripe, LockMap *lock_map) {
-    auto key_found = stripe->keys.find(key);
+    auto key_found = stripe->keys.find(key_hash);
     if (key_found == stripe->keys.end()) {
 #if defined(DEBUG) || defined(_DEBUG)
         DCHECK_GT(txn->expiration_time(), 0);
@@ -257,6 +424,9 @@ void TransactionLockMgr::UnlockKey(PessimisticTransaction *txn,
     if (iter != txn_ids->end()) {
         if (txn_ids->size() == 1) {
             stripe->keys.erase(key_found);
+            FastLockSlot *slot = lock_map->GetSlot(key_hash);
+            slot->word.fetch_sub(1, std::memory_order_acq_rel);
+            lock_map->MaybeDeflate(slot);
         } else {
             auto last_it = txn_ids->end() - 1;
             if (iter != last_it) {
@@ -323,7 +493,8 @@ Error
 TransactionLockMgr::AcquireWithTimeout(PessimisticTransaction *txn,
                                        LockMap *lock_map,
                                        LockMapStripe *stripe, uint32_t cfid,
-                                       const std::string &key, int64_t timeout,
+                                       const std::string &key, uint64_t key_hash,
+                                       int64_t timeout,
                                        const LockInfo &lock_info) {
     uint64_t end_time = timeout > 0 ? env_->CurrentTimeMicros() + timeout : 0;
     
@@ -341,17 +512,22 @@ TransactionLockMgr::AcquireWithTimeout(PessimisticTransaction *txn,
         }
     }
     
+    FastLockSlot *slot = lock_map->GetSlot(key_hash);
+    lock_map->Inflate(slot, stripe);
     
     uint64_t expire_time_hint = 0;
     std::vector<TxnID> wait_ids;
-    Error rs = AcquireLocked(lock_map, stripe, key, lock_info,
+    Error rs = AcquireLocked(lock_map, stripe, key_hash, lock_info,
                              &expire_time_hint, &wait_ids);
     if (rs.ok() || timeout == 0) {
+        lock_map->MaybeDeflate(slot);
         stripe->strip_mutex.unlock();
         return rs;
     }
     
     bool timed_out = false;
+    bool waiting = false; // In the wait-for graph
+    uint64_t detect_time = 0;
     do {
         int64_t cv_end_time = -1;
         
@@ -364,12 +540,27 @@ TransactionLockMgr::AcquireWithTimeout(PessimisticTransaction *txn,
         
         DCHECK(rs.IsBusy() || !wait_ids.empty());
         
+        bool wake_to_detect = false;
         if (!wait_ids.empty()) {
             if (txn->deadlock_detect()) {
-                if (IncrementWaiters(txn, wait_ids, key, cfid,
-                                     lock_info.exclusive)) {
-                    stripe->strip_mutex.unlock();
-                    return MAI_BUSY("Dead lock.");
+                uint64_t now = env_->CurrentTimeMicros();
+                SetWaiter(txn, wait_ids, key, cfid, lock_info.exclusive);
+                if (!waiting) {
+                    // Most of waits are short, do not scan graph for them.
+                    waiting = true;
+                    detect_time = now + kDeadlockDetectIntervalMicros;
+                } else if (now >= detect_time) {
+                    if (DetectDeadlock(txn)) {
+                        RemoveWaiter(txn);
+                        stripe->strip_mutex.unlock();
+                        return MAI_BUSY("Dead lock.");
+                    }
+                    detect_time = now + kDeadlockDetectIntervalMicros;
+                }
+                if (cv_end_time < 0 ||
+                    static_cast<uint64_t>(cv_end_time) > detect_time) {
+                    cv_end_time = detect_time;
+                    wake_to_detect = true;
                 }
             }
             txn->SetWaitingTxn(wait_ids, cfid, &key);
@@ -381,38 +572,43 @@ TransactionLockMgr::AcquireWithTimeout(PessimisticTransaction *txn,
             uint64_t now = env_->CurrentTimeMicros();
             if (static_cast<uint64_t>(cv_end_time) > now) {
                 rs = stripe->WaitFor(cv_end_time - now);
+            } else if (wake_to_detect) {
+                rs = MAI_TIMEOUT("Deadlock detection.");
             }
         }
         
         if (!wait_ids.empty()) {
             txn->ClearWaitingTxn();
-            if (txn->deadlock_detect()) {
-                DecrementWaiters(txn, wait_ids);
-            }
         }
         
-        if (rs.IsTimeout()) {
+        if (rs.IsTimeout() && !wake_to_detect) {
             timed_out = true;
         }
         if (rs.ok() || rs.IsTimeout()) {
-            rs = AcquireLocked(lock_map, stripe, key, lock_info,
+            // The slot may be given back to fast path when waiting.
+            lock_map->Inflate(slot, stripe);
+            rs = AcquireLocked(lock_map, stripe, key_hash, lock_info,
                                &expire_time_hint, &wait_ids);
         }
     } while (!rs && !timed_out);
     
+    if (waiting) {
+        RemoveWaiter(txn);
+    }
+    lock_map->MaybeDeflate(slot);
     stripe->strip_mutex.unlock();
     return rs;
 }
     
 Error TransactionLockMgr::AcquireLocked(LockMap *lock_map, LockMapStripe *stripe,
-                                        const std::string &key,
+                                        uint64_t key_hash,
                                         const LockInfo &txn_lock_info,
                                         uint64_t *expire_time,
                                         std::vector<TxnID> *txn_ids) {
     DCHECK_EQ(txn_lock_info.txn_ids.size(), 1);
     
     Error rs;
-    auto key_found = stripe->keys.find(key);
+    auto key_found = stripe->keys.find(key_hash);
     if (key_found != stripe->keys.end()) {
         
         LockInfo *lock_info = &key_found->second;
@@ -448,7 +644,10 @@ Error TransactionLockMgr::AcquireLocked(LockMap *lock_map, LockMapStripe *stripe
             lock_map->lock_count.load(std::memory_order_acquire) >= max_num_locks_) {
             rs = MAI_BUSY("Lock limit");
         } else {
-            stripe->keys.insert({key, txn_lock_info});
+            stripe->keys.insert({key_hash, txn_lock_info});
+            // Count the keys of slot in stripe.
+            lock_map->GetSlot(key_hash)->word.fetch_add(1,
+                                                        std::memory_order_acq_rel);
             
             if (max_num_locks_) {
                 lock_map->lock_count.fetch_add(1);
@@ -458,40 +657,147 @@ Error TransactionLockMgr::AcquireLocked(LockMap *lock_map, LockMapStripe *stripe
     return rs;
 }
     
-bool TransactionLockMgr::IncrementWaiters(const PessimisticTransaction *txn,
-                                          const std::vector<TxnID> &wait_ids,
-                                          const std::string &key, uint32_t cfid,
-                                          bool exclusive) {
-    TxnID txn_id = txn->id();
+Error TransactionLockMgr::AcquireRange(PessimisticTransaction *txn,
+                                       RangeLockMap *range_map, uint32_t cfid,
+                                       const std::string &begin,
+                                       const std::string &end, bool exclusive) {
+    const int64_t timeout = txn->lock_timeout();
+    const uint64_t end_time = timeout > 0 ?
+                              env_->CurrentTimeMicros() + timeout : 0;
     
-    std::vector<int> queue_parents(txn->deadlock_detect_depth());
-    std::vector<TxnID> queue_values(txn->deadlock_detect_depth());
+    range_map->mutex()->lock();
     
-    std::lock_guard<std::mutex> lock(wait_txn_map_mutex_);
-    DCHECK(wait_txn_map_.find(txn_id) == wait_txn_map_.end());
+    Error rs;
+    bool waiting = false; // In the wait-for graph
+    uint64_t detect_time = 0;
+    uint64_t expire_time_hint = 0;
+    std::vector<TxnID> wait_ids;
+    while (!range_map->TryLock(txn->id(), txn->expiration_time(), begin, end,
+                               exclusive, &wait_ids)) {
+        if (StealExpiredRangeLocks(range_map, wait_ids, &expire_time_hint)) {
+            continue;
+        }
+        
+        uint64_t now = env_->CurrentTimeMicros();
+        if (timeout == 0 || (timeout > 0 && now >= end_time)) {
+            rs = MAI_TIMEOUT("Lock time out!");
+            break;
+        }
+        
+        int64_t cv_end_time = timeout > 0 ? end_time : -1;
+        if (expire_time_hint > 0 &&
+            (cv_end_time < 0 ||
+             expire_time_hint < static_cast<uint64_t>(cv_end_time))) {
+            cv_end_time = expire_time_hint;
+        }
+        
+        if (txn->deadlock_detect()) {
+            SetWaiter(txn, wait_ids, begin, cfid, exclusive);
+            if (!waiting) {
+                waiting = true;
+                detect_time = now + kDeadlockDetectIntervalMicros;
+            } else if (now >= detect_time) {
+                if (DetectDeadlock(txn)) {
+                    rs = MAI_BUSY("Dead lock.");
+                    break;
+                }
+                detect_time = now + kDeadlockDetectIntervalMicros;
+            }
+            if (cv_end_time < 0 ||
+                static_cast<uint64_t>(cv_end_time) > detect_time) {
+                cv_end_time = detect_time;
+            }
+        }
+        
+        txn->SetWaitingTxn(wait_ids, cfid, &begin);
+        if (cv_end_time < 0) {
+            range_map->Wait();
+        } else if (static_cast<uint64_t>(cv_end_time) > now) {
+            range_map->WaitFor(cv_end_time - now);
+        }
+        txn->ClearWaitingTxn();
+    }
     
-    wait_txn_map_.insert({txn_id, {wait_ids, cfid, key, exclusive}});
+    if (waiting) {
+        RemoveWaiter(txn);
+    }
+    range_map->mutex()->unlock();
+    return rs;
+}
     
-    for (auto wid : wait_ids) {
-        if (rev_wait_txn_map_.find(wid) != rev_wait_txn_map_.end()) {
-            rev_wait_txn_map_[wid]++;
-        } else {
-            rev_wait_txn_map_[wid] = 1;
+// Steal all locks of expired transactions in range map.
+// REQUIRES: range_map->mutex()->lock()
+bool TransactionLockMgr::StealExpiredRangeLocks(RangeLockMap *range_map,
+                                                const std::vector<TxnID> &txn_ids,
+                                                uint64_t *expire_time) {
+    uint64_t now = env_->CurrentTimeMicros();
+    bool stolen = false;
+    *expire_time = 0;
+    for (auto id : txn_ids) {
+        uint64_t expiration_time = range_map->GetExpirationTime(id);
+        if (expiration_time == 0) {
+            continue;
+        }
+        if (expiration_time <= now) {
+            if (owns_->TryStealingExpiredTransactionLocks(id)) {
+                range_map->UnlockAll(id);
+                stolen = true;
+            }
+        } else if (*expire_time == 0 || expiration_time < *expire_time) {
+            *expire_time = expiration_time;
         }
     }
-    if (rev_wait_txn_map_.find(txn_id) == rev_wait_txn_map_.end()) {
+    return stolen;
+}
+    
+void TransactionLockMgr::SetWaiter(const PessimisticTransaction *txn,
+                                   const std::vector<TxnID> &wait_ids,
+                                   const std::string &key, uint32_t cfid,
+                                   bool exclusive) {
+    WaitForShard *shard = GetWaitForShard(txn->id());
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->waits[txn->id()] = {wait_ids, cfid, key, exclusive};
+}
+    
+void TransactionLockMgr::RemoveWaiter(const PessimisticTransaction *txn) {
+    WaitForShard *shard = GetWaitForShard(txn->id());
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->waits.erase(txn->id());
+}
+    
+bool TransactionLockMgr::GetWaiter(TxnID txn_id, TrackedTxnInfo *info) {
+    WaitForShard *shard = GetWaitForShard(txn_id);
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    auto iter = shard->waits.find(txn_id);
+    if (iter == shard->waits.end()) {
+        return false;
+    }
+    *info = iter->second;
+    return true;
+}
+    
+// Breadth-first search the wait-for graph from txn, only one shard be locked
+// at a time, so the path found may be stale. The transaction just retries if
+// it is a false deadlock.
+bool TransactionLockMgr::DetectDeadlock(const PessimisticTransaction *txn) {
+    TxnID txn_id = txn->id();
+    
+    TrackedTxnInfo info;
+    if (!GetWaiter(txn_id, &info)) {
         return false;
     }
+    std::vector<int> queue_parents(txn->deadlock_detect_depth());
+    std::vector<TxnID> queue_values(txn->deadlock_detect_depth());
     
-    const auto *next_ids = &wait_ids;
+    std::vector<TxnID> next_ids(info.neighbors);
+    bool has_next = true;
     int parent = -1;
-    int64_t dlock_time = 0;
     for (int tail = 0, head = 0; head < txn->deadlock_detect_depth(); head++) {
         int i = 0;
-        if (next_ids) {
-            for (; i < next_ids->size() &&
+        if (has_next) {
+            for (; i < next_ids.size() &&
                  tail + i < txn->deadlock_detect_depth(); ++i) {
-                queue_values[tail + i] = next_ids->at(i);
+                queue_values[tail + i] = next_ids[i];
                 queue_parents[tail + i] = parent;
             }
             tail += i;
@@ -505,59 +811,34 @@ bool TransactionLockMgr::IncrementWaiters(const PessimisticTransaction *txn,
         if (next == txn_id) {
             std::vector<DeadLockInfo> path;
             while (head != -1) {
-                DCHECK(wait_txn_map_.find(queue_values[head])
-                       != wait_txn_map_.end());
-                TrackedTxnInfo extracted_info
-                    = wait_txn_map_[queue_values[head]];
-                path.push_back({
-                    queue_values[head],
-                    extracted_info.cfid,
-                    extracted_info.exclusive,
-                    extracted_info.waiting_key
-                });
+                TrackedTxnInfo extracted_info;
+                if (GetWaiter(queue_values[head], &extracted_info)) {
+                    path.push_back({
+                        queue_values[head],
+                        extracted_info.cfid,
+                        extracted_info.exclusive,
+                        extracted_info.waiting_key
+                    });
+                }
                 head = queue_parents[head];
             }
-            dlock_time = env_->CurrentTimeMicros();
             std::reverse(path.begin(), path.end());
-            dlock_buffer_->AddNewPath(DeadLockPath(path, dlock_time));
-            dlock_time = 0;
-            DecrementWaitersLockless(txn, wait_ids);
+            dlock_buffer_->AddNewPath(DeadLockPath(path,
+                                                   env_->CurrentTimeMicros()));
             return true;
-        } else if (wait_txn_map_.find(next) == wait_txn_map_.end()) {
-            next_ids = nullptr;
-            continue;
+        } else if (!GetWaiter(next, &info)) {
+            has_next = false;
         } else {
             parent = head;
-            next_ids = &wait_txn_map_[next].neighbors;
+            next_ids = info.neighbors;
+            has_next = true;
         }
     }
     
-    dlock_time = env_->CurrentTimeMicros();
-    dlock_buffer_->AddNewPath(DeadLockPath(dlock_time, true));
-    DecrementWaitersLockless(txn, wait_ids);
+    dlock_buffer_->AddNewPath(DeadLockPath(env_->CurrentTimeMicros(), true));
     return true;
 }
     
-void TransactionLockMgr::DecrementWaiters(const PessimisticTransaction *txn,
-                                          const std::vector<TxnID> &wait_ids) {
-    std::lock_guard<std::mutex> lock(wait_txn_map_mutex_);
-    DecrementWaitersLockless(txn, wait_ids);
-}
-
-void
-TransactionLockMgr::DecrementWaitersLockless(const PessimisticTransaction *txn,
-                                             const std::vector<TxnID> &wait_ids) {
-    DCHECK(wait_txn_map_.find(txn->id()) != wait_txn_map_.end());
-    wait_txn_map_.erase(txn->id());
-    
-    for (auto wid : wait_ids) {
-        rev_wait_txn_map_[wid]--;
-        if (rev_wait_txn_map_[wid] == 0) {
-            rev_wait_txn_map_.erase(wid);
-        }
-    }
-}
-    
 /*static*/ void TransactionLockMgr::LockMapsDeleter(void *d) {
     delete static_cast<LockMaps *>(d);
 }
@@ -11,12 +11,14 @@
 
 namespace mai {
 class ColumnFamily;
+class Comparator;
 namespace txn {
     
 struct LockInfo;
 struct LockMap;
 struct LockMapStripe;
 class DeadLockInfoBuffer;
+class RangeLockMap;
 
 class PessimisticTransactionDB;
 class PessimisticTransaction;
@@ -27,23 +29,46 @@ struct TrackedTxnInfo {
     std::string waiting_key;
     bool exclusive;
 }; // struct TrackedTxnInfo
+    
+// A shard of wait-for graph, the waiting transactions be sharded by id.
+struct WaitForShard {
+    std::mutex mutex;
+    std::unordered_map<TxnID, TrackedTxnInfo> waits;
+}; // struct WaitForShard
 
+// The locks be keyed by 64 bits hash of key. A uncontended key only be
+// locked by a CAS on its fast slot; the contended ones fall back to the
+// stripe wait queue. The deadlock be detected periodically by blocked
+// transactions, not on every blocked acquire.
+//
+// If TransactionDBOptions::range_locking, all locks of column family be in
+// one ordered RangeLockMap instead, so that ranges can be locked.
 class TransactionLockMgr final {
 public:
+    static const int kNumWaitForShards = 16;
+    // The fast slots of every stripe.
+    static const int kSlotsPerStripe = 256;
+    // A blocked transaction scans the wait-for graph once in this period.
+    static const int64_t kDeadlockDetectIntervalMicros = 1000;
+    
     TransactionLockMgr(PessimisticTransactionDB *owns,
                        size_t default_num_stripes,
                        int64_t max_num_locks,
                        uint32_t max_num_deadlocks);
     ~TransactionLockMgr();
     
-    void AddColumnFamily(uint32_t cfid);
+    void AddColumnFamily(uint32_t cfid, const Comparator *ucmp);
     void RemoveColumnFamily(uint32_t cfid);
     
     Error TryLock(PessimisticTransaction *txn, uint32_t cfid,
                   const std::string &key, bool exclusive);
+    Error TryLockRange(PessimisticTransaction *txn, uint32_t cfid,
+                       const std::string &begin, const std::string &end,
+                       bool exclusive);
     void Unlock(PessimisticTransaction *txn, const TxnKeyMaps *tracked_keys);
-    void UnlockKey(PessimisticTransaction *txn, const std::string &key,
+    void UnlockKey(PessimisticTransaction *txn, uint64_t key_hash,
                    LockMapStripe *stripe, LockMap *lock_map);
+    void UnlockRanges(PessimisticTransaction *txn, RangeLockMap *range_map);
     
     bool IsLockExpired(TxnID txn_id, const LockInfo &lock_info,
                        uint64_t *expire_time);
@@ -55,20 +80,28 @@ private:
     std::shared_ptr<LockMap> GetLockMap(uint32_t cfid);
     Error AcquireWithTimeout(PessimisticTransaction *txn, LockMap *lock_map,
                              LockMapStripe *stripe, uint32_t cfid,
-                             const std::string &key, int64_t timeout,
-                             const LockInfo &lock_info);
+                             const std::string &key, uint64_t key_hash,
+                             int64_t timeout, const LockInfo &lock_info);
     Error AcquireLocked(LockMap *lock_map, LockMapStripe *stripe,
-                        const std::string &key, const LockInfo &lock_info,
+                        uint64_t key_hash, const LockInfo &lock_info,
                         uint64_t *expire_time,
                         std::vector<TxnID> *txn_ids);
-    bool IncrementWaiters(const PessimisticTransaction *txn,
-                          const std::vector<TxnID> &wait_ids,
-                          const std::string &key, uint32_t cfid,
-                          bool exclusive);
-    void DecrementWaiters(const PessimisticTransaction *txn,
-                          const std::vector<TxnID> &wait_ids);
-    void DecrementWaitersLockless(const PessimisticTransaction *txn,
-                                  const std::vector<TxnID> &wait_ids);
+    Error AcquireRange(PessimisticTransaction *txn, RangeLockMap *range_map,
+                       uint32_t cfid, const std::string &begin,
+                       const std::string &end, bool exclusive);
+    bool StealExpiredRangeLocks(RangeLockMap *range_map,
+                                const std::vector<TxnID> &txn_ids,
+                                uint64_t *expire_time);
+    void SetWaiter(const PessimisticTransaction *txn,
+                   const std::vector<TxnID> &wait_ids,
+                   const std::string &key, uint32_t cfid, bool exclusive);
+    void RemoveWaiter(const PessimisticTransaction *txn);
+    bool DetectDeadlock(const PessimisticTransaction *txn);
+    bool GetWaiter(TxnID txn_id, TrackedTxnInfo *info);
+    
+    WaitForShard *GetWaitForShard(TxnID txn_id) {
+        return &wait_for_shards_[txn_id % kNumWaitForShards];
+    }
     
     static void LockMapsDeleter(void *d);
     
@@ -81,9 +114,7 @@ private:
     std::mutex lock_map_mutex_;
     LockMaps lock_maps_;
     std::unique_ptr<ThreadLocalSlot> lock_maps_cache_;
-    std::mutex wait_txn_map_mutex_;
-    std::unordered_map<TxnID, int> rev_wait_txn_map_;
-    std::unordered_map<TxnID, TrackedTxnInfo> wait_txn_map_;
+    WaitForShard wait_for_shards_[kNumWaitForShards];
     
 }; // class TransactionLockMgr
 
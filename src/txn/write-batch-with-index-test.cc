@@ -1,5 +1,6 @@
 #include "txn/write-batch-with-index.h"
 #include "core/key-boundle.h"
+#include "base/slice.h"
 #include "mai/iterator.h"
 #include "test/mock-column-family.h"
 #include "gtest/gtest.h"
@@ -97,6 +98,71 @@ TEST_F(WriteBatchWithIndexTest, Iterate) {
     ASSERT_EQ(Tag::kFlagValue, ikey.tag.flag());
 }
     
+TEST_F(WriteBatchWithIndexTest, SmallAndLargeIndex) {
+    WriteBatchWithIndex batch;
+    
+    // Out of order, and more than small index.
+    const int n = static_cast<int>(WriteBatchWithIndex::kMaxSmallIndexSize) * 4;
+    for (int i = n - 1; i >= 0; --i) {
+        batch.AddOrUpdate(mock_cf0_, Tag::kFlagValue, base::Sprintf("k.%03d", i),
+                          base::Sprintf("v.%d", i));
+        // Update an existing key.
+        batch.AddOrUpdate(mock_cf0_, Tag::kFlagValue, base::Sprintf("k.%03d", n - 1),
+                          "last");
+        
+        std::string value;
+        auto rs = batch.Get(mock_cf0_, base::Sprintf("k.%03d", i), &value);
+        ASSERT_TRUE(rs.ok()) << rs.ToString();
+        ASSERT_EQ(i == n - 1 ? "last" : base::Sprintf("v.%d", i), value);
+        rs = batch.Get(mock_cf0_, base::Sprintf("k.%03d", i) + "0", &value);
+        ASSERT_TRUE(rs.IsNotFound()) << rs.ToString();
+    }
+    
+    std::unique_ptr<Iterator> iter(batch.NewIterator(mock_cf0_));
+    int count = 0;
+    ParsedTaggedKey ikey;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        KeyBoundle::ParseTaggedKey(iter->key(), &ikey);
+        ASSERT_EQ(base::Sprintf("k.%03d", count++), ikey.user_key);
+    }
+    ASSERT_EQ(n, count);
+}
+    
+TEST_F(WriteBatchWithIndexTest, ReuseAfterClear) {
+    WriteBatchWithIndex batch;
+    
+    for (int i = 0; i < 100; ++i) {
+        batch.AddOrUpdate(mock_cf0_, Tag::kFlagValue, base::Sprintf("k.%d", i), "v");
+    }
+    batch.AddOrUpdate(mock_cf1_, Tag::kFlagValue, "aaaa", "bbbb");
+    batch.Clear();
+    ASSERT_EQ(0, batch.n_entries());
+    
+    std::string value;
+    auto rs = batch.Get(mock_cf0_, "k.1", &value);
+    ASSERT_TRUE(rs.IsNotFound()) << rs.ToString();
+    std::unique_ptr<Iterator> iter(batch.NewIterator(mock_cf1_));
+    ASSERT_TRUE(iter->error().IsNotFound());
+    
+    batch.AddOrUpdate(mock_cf0_, Tag::kFlagValue, "bbbb", "1");
+    batch.AddOrUpdate(mock_cf0_, Tag::kFlagDeletion, "aaaa", "");
+    rs = batch.Get(mock_cf0_, "bbbb", &value);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    ASSERT_EQ("1", value);
+    
+    iter.reset(batch.NewIterator(mock_cf0_));
+    iter->Seek("aaab");
+    ASSERT_TRUE(iter->Valid());
+    ParsedTaggedKey ikey;
+    KeyBoundle::ParseTaggedKey(iter->key(), &ikey);
+    ASSERT_EQ("bbbb", ikey.user_key);
+    iter->Prev();
+    ASSERT_TRUE(iter->Valid());
+    KeyBoundle::ParseTaggedKey(iter->key(), &ikey);
+    ASSERT_EQ("aaaa", ikey.user_key);
+    ASSERT_EQ(Tag::kFlagDeletion, ikey.tag.flag());
+}
+    
 } // namespace txn
     
 } // namespace mai
@@ -5,6 +5,7 @@
 #include "base/slice.h"
 #include "mai/iterator.h"
 #include "glog/logging.h"
+#include <algorithm>
 
 namespace mai {
     
@@ -14,49 +15,59 @@ using ::mai::base::Slice;
 using ::mai::base::Varint32;
 using ::mai::base::Varint64;
 
-struct WriteBatchWithIndex::WriteBatchEntry {
-    size_t offset;
-    size_t size;
-    union {
-        size_t key_size;
-        const char *lookup_key;
-    };
-}; // struct WriteBatchWithIndex::KeyComparator::WriteBatchEntry
-    
-    
 class WriteBatchWithIndex::IteratorImpl : public Iterator {
 public:
-    IteratorImpl(const Table *table, const std::string *batch)
-        : iter_(table)
-        , batch_(DCHECK_NOTNULL(batch)) {}
+    IteratorImpl(const Index *index, const std::string *batch)
+        : index_(DCHECK_NOTNULL(index))
+        , iter_(index->table ? new Table::Iterator(index->table.get()) : nullptr)
+        , batch_(DCHECK_NOTNULL(batch))
+        , pos_(index->small.size()) {}
     virtual ~IteratorImpl() override {}
     
-    virtual bool Valid() const override { return iter_.Valid(); }
+    virtual bool Valid() const override {
+        return iter_ ? iter_->Valid() : pos_ < index_->small.size();
+    }
     virtual void SeekToFirst() override {
-        iter_.SeekToFirst();
+        if (iter_) {
+            iter_->SeekToFirst();
+        } else {
+            pos_ = 0;
+        }
         Update();
     }
     virtual void SeekToLast() override {
-        iter_.SeekToLast();
+        if (iter_) {
+            iter_->SeekToLast();
+        } else {
+            pos_ = index_->small.empty() ? 0 : index_->small.size() - 1;
+        }
         Update();
     }
     virtual void Seek(std::string_view target) override {
-        WriteBatchEntry lookup;
-        lookup.key_size = target.size();
-        lookup.lookup_key = target.data();
-        iter_.Seek(&lookup);
+        if (iter_) {
+            WriteBatchEntry lookup = MakeLookup(target);
+            iter_->Seek(&lookup);
+        } else {
+            pos_ = LowerBound(*index_, batch_, target);
+        }
+        Update();
     }
     virtual void Next() override {
-        iter_.Next();
-        if (Valid()) {
-            Update();
+        if (iter_) {
+            iter_->Next();
+        } else {
+            ++pos_;
         }
+        Update();
     }
     virtual void Prev() override {
-        iter_.Prev();
-        if (Valid()) {
-            Update();
+        if (iter_) {
+            iter_->Prev();
+        } else {
+            // Move to the end, if it's the first one.
+            pos_ = (pos_ == 0) ? index_->small.size() : pos_ - 1;
         }
+        Update();
     }
     virtual std::string_view key() const override {
         DCHECK(Valid());
@@ -70,16 +81,22 @@ public:
 private:
     void Update();
     
-    Table::Iterator iter_;
+    const Index *const index_;
+    std::unique_ptr<Table::Iterator> iter_; // Only for skip list index
     const std::string *batch_;
+    size_t pos_; // Position of small index
     std::string saved_key_;
     std::string saved_value_;
     Error error_;
 }; // class WriteBatchWithIndex::IteratorImpl
 
 void WriteBatchWithIndex::IteratorImpl::Update() {
-    const auto entry = iter_.key();
-    base::BufferReader rd(batch_->substr(entry->offset, entry->size));
+    if (!Valid()) {
+        return;
+    }
+    const WriteBatchEntry *entry = iter_ ? iter_->key() : &index_->small[pos_];
+    base::BufferReader rd(std::string_view(*batch_).substr(entry->offset,
+                                                           entry->size));
     auto flag = rd.ReadByte();
     
     bool should_read_value = false;
@@ -109,27 +126,7 @@ void WriteBatchWithIndex::IteratorImpl::Update() {
 
 int WriteBatchWithIndex::KeyComparator::operator () (const WriteBatchEntry *lhs,
                                                      const WriteBatchEntry *rhs) const {
-    size_t n = 0;
-    std::string_view a;
-    if (lhs->offset > 0) {
-        auto p = buf->data() + lhs->offset + 1;
-        auto s = Varint64::Decode(p, &n);
-        DCHECK_EQ(s, lhs->key_size);
-        a = std::string_view(p + n, lhs->key_size);
-    } else {
-        a = std::string_view(lhs->lookup_key, lhs->size);
-    }
-    
-    std::string_view b;
-    if (rhs->offset > 0) {
-        auto p = buf->data() + rhs->offset + 1;
-        auto s = Varint64::Decode(p, &n);
-        DCHECK_EQ(s, rhs->key_size);
-        b = std::string_view(p + n, rhs->key_size);
-    } else {
-        b = std::string_view(rhs->lookup_key, rhs->size);
-    }
-    return cmp->Compare(a, b);
+    return cmp->Compare(GetKey(lhs, buf), GetKey(rhs, buf));
 }
     
 WriteBatchWithIndex::WriteBatchWithIndex() {
@@ -140,25 +137,20 @@ WriteBatchWithIndex::~WriteBatchWithIndex() {
     
 void WriteBatchWithIndex::Clear() {
     WriteBatch::Clear();
-    tables_.clear();
-    arena_.Purge(true);
+    // Keep the indices and their buffers for next transaction.
+    for (auto &pair : indices_) {
+        pair.second.small.clear();
+        pair.second.table.reset();
+    }
+    arena_.Reset();
 }
 
 void WriteBatchWithIndex::AddOrUpdate(ColumnFamily *cf,
                                       uint8_t flag,
                                       std::string_view key,
                                       std::string_view value) {
-    auto iter = tables_.find(cf->id());
-    if (iter == tables_.end()) {
-        KeyComparator cmp{cf->comparator(), mutable_raw_buf()};
-        std::tie(iter, std::ignore) = tables_.emplace(cf->id(),
-                                                      new Table(cmp, &arena_));
-    }
-    
-    WriteBatchEntry lookup;
-    lookup.offset = 0;
-    lookup.size   = key.size();
-    lookup.lookup_key = key.data();
+    Index *index = &indices_[cf->id()];
+    index->ucmp = cf->comparator();
     
     auto pos = raw_buf()->size();
     switch (flag) {
@@ -177,15 +169,39 @@ void WriteBatchWithIndex::AddOrUpdate(ColumnFamily *cf,
     put.key_size = key.size();
     put.size     = raw_buf()->size() - put.offset;
     
-    Table::Iterator table_iter(iter->second.get());
+    if (!index->table) {
+        size_t i = LowerBound(*index, raw_buf(), key);
+        if (i < index->small.size() &&
+            index->ucmp->Equals(GetKey(&index->small[i], raw_buf()), key)) {
+            index->small[i] = put;
+            return;
+        }
+        if (index->small.size() < kMaxSmallIndexSize) {
+            index->small.insert(index->small.begin() + i, put);
+            return;
+        }
+        
+        // The small index is full, move all entries to skip list.
+        KeyComparator cmp{index->ucmp, raw_buf()};
+        index->table.reset(new Table(cmp, &arena_));
+        for (const auto &entry : index->small) {
+            index->table->Put(new (arena_.Allocate(sizeof(WriteBatchEntry)))
+                              WriteBatchEntry(entry));
+        }
+        index->small.clear();
+    }
+    
+    WriteBatchEntry lookup = MakeLookup(key);
+    Table::Iterator table_iter(index->table.get());
     table_iter.Seek(&lookup);
-    if (table_iter.Valid()) {
+    if (table_iter.Valid() &&
+        index->ucmp->Equals(GetKey(table_iter.key(), raw_buf()), key)) {
         ::memcpy(table_iter.key(), &put, sizeof(put));
     } else {
         WriteBatchEntry *wr =
             static_cast<WriteBatchEntry *>(arena_.Allocate(sizeof(WriteBatchEntry)));
         ::memcpy(wr, &put, sizeof(put));
-        iter->second->Put(wr);
+        index->table->Put(wr);
     }
 }
     
@@ -205,24 +221,17 @@ Error WriteBatchWithIndex::Get(ColumnFamily *cf, std::string_view key,
 Error WriteBatchWithIndex::RawGet(ColumnFamily *cf, std::string_view key,
                                   uint8_t *flag,
                                   std::string *value) const {
-    auto iter = tables_.find(cf->id());
-    if (iter == tables_.end()) {
+    auto iter = indices_.find(cf->id());
+    if (iter == indices_.end() || iter->second.empty()) {
         return MAI_NOT_FOUND("No any write.");
     }
     
-    WriteBatchEntry lookup;
-    lookup.offset = 0;
-    lookup.size   = key.size();
-    lookup.lookup_key = key.data();
-    
-    Table::Iterator table_iter(iter->second.get());
-    table_iter.Seek(&lookup);
-    if (!table_iter.Valid()) {
+    const WriteBatchEntry *entry = FindEntry(iter->second, key);
+    if (!entry) {
         return MAI_NOT_FOUND("Not found!");
     }
-    
-    const auto entry = table_iter.key();
-    base::BufferReader rd(raw_buf()->substr(entry->offset, entry->size));
+    base::BufferReader rd(std::string_view(*raw_buf()).substr(entry->offset,
+                                                              entry->size));
     *flag = rd.ReadByte();
     
     bool should_read_value = false;
@@ -239,10 +248,7 @@ Error WriteBatchWithIndex::RawGet(ColumnFamily *cf, std::string_view key,
     
     auto n = rd.ReadVarint64();
     DCHECK_EQ(entry->key_size, n);
-    auto found_key = rd.ReadString(n);
-    if (cf->comparator()->Compare(key, found_key) != 0) {
-        return MAI_NOT_FOUND("Not found!");
-    }
+    rd.ReadString(n); // Skip the key
 
     if (should_read_value) {
         *value = rd.ReadString();
@@ -251,12 +257,12 @@ Error WriteBatchWithIndex::RawGet(ColumnFamily *cf, std::string_view key,
 }
     
 Iterator *WriteBatchWithIndex::NewIterator(ColumnFamily *cf) const {
-    auto iter = tables_.find(cf->id());
-    if (iter == tables_.cend()) {
+    auto iter = indices_.find(cf->id());
+    if (iter == indices_.cend() || iter->second.empty()) {
         return Iterator::AsError(MAI_NOT_FOUND("No any write in this column "
                                                "family."));
     }
-    return new IteratorImpl(iter->second.get(), raw_buf());
+    return new IteratorImpl(&iter->second, raw_buf());
 }
 
 Iterator *WriteBatchWithIndex::NewIteratorWithBase(ColumnFamily *cf,
@@ -268,6 +274,52 @@ Iterator *WriteBatchWithIndex::NewIteratorWithBase(ColumnFamily *cf,
     return new core::DeltaAmendIterator(cf->comparator(), base, delta);
 }
     
+const WriteBatchWithIndex::WriteBatchEntry *
+WriteBatchWithIndex::FindEntry(const Index &index, std::string_view key) const {
+    const WriteBatchEntry *entry = nullptr;
+    if (index.table) {
+        WriteBatchEntry lookup = MakeLookup(key);
+        Table::Iterator table_iter(index.table.get());
+        table_iter.Seek(&lookup);
+        if (table_iter.Valid()) {
+            entry = table_iter.key();
+        }
+    } else {
+        size_t i = LowerBound(index, raw_buf(), key);
+        if (i < index.small.size()) {
+            entry = &index.small[i];
+        }
+    }
+    if (entry && index.ucmp->Equals(GetKey(entry, raw_buf()), key)) {
+        return entry;
+    }
+    return nullptr;
+}
+    
+/*static*/ std::string_view
+WriteBatchWithIndex::GetKey(const WriteBatchEntry *entry,
+                            const std::string *buf) {
+    if (entry->offset == 0) {
+        return std::string_view(entry->lookup_key, entry->size);
+    }
+    size_t n = 0;
+    auto p = buf->data() + entry->offset + 1; // Skip the flag
+    auto s = Varint64::Decode(p, &n);
+    DCHECK_EQ(s, entry->key_size); (void)s;
+    return std::string_view(p + n, entry->key_size);
+}
+    
+/*static*/ size_t WriteBatchWithIndex::LowerBound(const Index &index,
+                                                  const std::string *buf,
+                                                  std::string_view key) {
+    auto iter = std::lower_bound(index.small.begin(), index.small.end(), key,
+                                 [&index, buf] (const WriteBatchEntry &entry,
+                                                std::string_view k) {
+        return index.ucmp->Compare(GetKey(&entry, buf), k) < 0;
+    });
+    return iter - index.small.begin();
+}
+    
 } // namespace txn
     
 } // namespace mai
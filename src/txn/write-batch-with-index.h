@@ -6,6 +6,8 @@
 #include "base/base.h"
 #include "mai/write-batch.h"
 #include <unordered_map>
+#include <memory>
+#include <vector>
 
 namespace mai {
 class Allocator;
@@ -16,8 +18,14 @@ class InternalKeyComparator;
 } // namespace core
 namespace txn {
     
+// The batch can be reused by transactions: Clear() keeps the arena page and
+// the index of every column family, only reset them.
 class WriteBatchWithIndex final : public WriteBatch {
 public:
+    // The first entries of a column family be indexed by a sorted vector, it's
+    // faster than skip list for short transactions.
+    static const size_t kMaxSmallIndexSize = 32;
+    
     WriteBatchWithIndex();
     ~WriteBatchWithIndex();
     
@@ -42,9 +50,17 @@ public:
 
     DISALLOW_IMPLICIT_CONSTRUCTORS(WriteBatchWithIndex);
 private:
-    struct WriteBatchEntry;
     class IteratorImpl;
     
+    struct WriteBatchEntry {
+        size_t offset; // 0 for lookup key
+        size_t size;
+        union {
+            size_t key_size;
+            const char *lookup_key;
+        };
+    }; // struct WriteBatchEntry
+    
     struct KeyComparator final {
         const Comparator  *cmp;
         const std::string *buf;
@@ -54,9 +70,33 @@ private:
     
     using Table = core::SkipList<WriteBatchEntry *, KeyComparator>;
     
-    base::StandaloneArena arena_;
-    std::unordered_map<uint32_t, std::shared_ptr<Table>> tables_;
-    //std::unique_ptr<Table> table_;
+    struct Index {
+        const Comparator *ucmp = nullptr;
+        std::vector<WriteBatchEntry> small; // Sorted by key
+        std::unique_ptr<Table> table; // Replace small index once it's full
+        
+        bool empty() const { return !table && small.empty(); }
+    }; // struct Index
+    
+    const WriteBatchEntry *FindEntry(const Index &index,
+                                     std::string_view key) const;
+    
+    static std::string_view GetKey(const WriteBatchEntry *entry,
+                                   const std::string *buf);
+    // The first entry not less than key in small index.
+    static size_t LowerBound(const Index &index, const std::string *buf,
+                             std::string_view key);
+    
+    static WriteBatchEntry MakeLookup(std::string_view key) {
+        WriteBatchEntry lookup;
+        lookup.offset     = 0;
+        lookup.size       = key.size();
+        lookup.lookup_key = key.data();
+        return lookup;
+    }
+    
+    base::StandaloneArena arena_; // For nodes of skip lists
+    std::unordered_map<uint32_t, Index> indices_;
 }; // class WriteBatchWithIndex
     
 } // namespace txn